@@ -0,0 +1,483 @@
+// Runner of the benchmarks registered with TAG_BENCHMARK.
+// Usage: benchmarks [--filter=<regex>] [--min-time=<seconds>] [--repetitions=<n>]
+//                   [--json=<path or ->] [--list]
+// The JSON output follows the layout of Google Benchmark's, so existing
+// tooling for comparing runs can read it.
+
+#include "Benchmark.hpp"
+
+#include <algorithm> // std::ranges::sort
+#include <cmath>     // std::sqrt
+#include <cstdio>
+#include <ctime>     // std::clock, clock_gettime
+#include <fstream>
+#include <iostream>
+#include <memory>    // std::unique_ptr
+#include <optional>
+#include <regex>
+#include <string_view>
+#include <thread>
+#include <utility>   // std::move
+
+#ifndef TAGLIATELLE_VERSION
+    #define TAGLIATELLE_VERSION "unknown"
+#endif
+
+namespace tagliatelle::bench
+{
+
+    namespace
+    {
+        std::vector<std::unique_ptr<Benchmark>>& Registry()
+        {
+            static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+            return benchmarks;
+        }
+
+        // Process CPU time, in nanosecond resolution where available
+        double CpuSeconds()
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            timespec now{};
+            ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+            return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+#else
+            return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+        }
+
+        std::string RunName(const std::string& name, const std::vector<std::int64_t>& arguments)
+        {
+            std::string result = name;
+            for (const auto argument : arguments)
+                result += "/" + std::to_string(argument);
+            return result;
+        }
+
+        std::string Escape(const std::string_view text)
+        {
+            std::string escaped;
+            for (const char c : text)
+            {
+                if (c == '"' || c == '\\')
+                    escaped += '\\';
+                escaped += c;
+            }
+            return escaped;
+        }
+
+        std::string Number(const double value)
+        {
+            char text[64];
+            std::snprintf(text, sizeof(text), "%.17g", value);
+            return text;
+        }
+    }
+
+    struct Result
+    {
+        std::string                   name;
+        std::uint64_t                 iterations = 0;
+        double                        realNs = 0; // per iteration
+        double                        cpuNs  = 0;
+        double                        bytesPerSecond = 0;
+        double                        itemsPerSecond = 0;
+        std::map<std::string, double> counters;
+        std::string                   label;
+        std::string                   aggregate; // empty for single runs
+    };
+
+    struct Options
+    {
+        std::string filter      = ".*";
+        double      minTime     = 0.5;
+        int         repetitions = 1;
+        std::string json;
+        bool        list        = false;
+    };
+
+    State::State(const std::uint64_t iterations, std::vector<std::int64_t> arguments)
+        : iterations{ iterations }
+        , arguments{ std::move(arguments) }
+    {
+    }
+
+    State::Iterator State::begin()
+    {
+        StartTiming();
+        return Iterator{ this, iterations };
+    }
+
+    State::Iterator State::end()
+    {
+        return Iterator{ this, 0 };
+    }
+
+    std::int64_t State::Range(const std::size_t index) const
+    {
+        return index < arguments.size() ? arguments[index] : 0;
+    }
+
+    std::uint64_t State::Iterations() const
+    {
+        return iterations;
+    }
+
+    void State::PauseTiming()
+    {
+        StopTiming();
+    }
+
+    void State::ResumeTiming()
+    {
+        StartTiming();
+    }
+
+    void State::SetBytesProcessed(const std::uint64_t bytes)
+    {
+        this->bytes = bytes;
+    }
+
+    void State::SetItemsProcessed(const std::uint64_t items)
+    {
+        this->items = items;
+    }
+
+    void State::SetLabel(std::string text)
+    {
+        label = std::move(text);
+    }
+
+    void State::StartTiming()
+    {
+        if (running)
+            return;
+        running = true;
+        cpuStart = CpuSeconds();
+        realStart = Clock::now();
+    }
+
+    void State::StopTiming()
+    {
+        if (!running)
+            return;
+        const std::chrono::duration<double> real = Clock::now() - realStart;
+        realSeconds += real.count();
+        cpuSeconds += CpuSeconds() - cpuStart;
+        running = false;
+    }
+
+    Benchmark::Benchmark(std::string name, Function function)
+        : name{ std::move(name) }
+        , function{ std::move(function) }
+    {
+    }
+
+    Benchmark* Benchmark::Args(const std::initializer_list<std::int64_t> arguments)
+    {
+        runs.emplace_back(arguments);
+        return this;
+    }
+
+    Benchmark* Benchmark::Range(const std::int64_t first, const std::int64_t last, const std::int64_t multiplier)
+    {
+        for (auto argument = first; argument < last; argument *= multiplier)
+            runs.push_back({ argument });
+        runs.push_back({ last });
+        return this;
+    }
+
+    Benchmark* Benchmark::ArgsProduct(const std::vector<std::vector<std::int64_t>>& dimensions)
+    {
+        std::vector<std::vector<std::int64_t>> product = { {} };
+        for (const auto& dimension : dimensions)
+        {
+            std::vector<std::vector<std::int64_t>> next;
+            for (const auto& prefix : product)
+            {
+                for (const auto argument : dimension)
+                {
+                    next.push_back(prefix);
+                    next.back().push_back(argument);
+                }
+            }
+            product = std::move(next);
+        }
+        runs.insert(runs.end(), product.begin(), product.end());
+        return this;
+    }
+
+    const std::string& Benchmark::Name() const
+    {
+        return name;
+    }
+
+    const Function& Benchmark::Body() const
+    {
+        return function;
+    }
+
+    const std::vector<std::vector<std::int64_t>>& Benchmark::Runs() const
+    {
+        return runs;
+    }
+
+    Benchmark* Register(std::string name, Function function)
+    {
+        Registry().push_back(std::make_unique<Benchmark>(std::move(name), std::move(function)));
+        return Registry().back().get();
+    }
+
+    class Runner
+    {
+    public:
+        explicit Runner(const Options& options)
+            : options{ options }
+        {
+        }
+
+        // Grows the iteration count until a run lasts at least the minimum time
+        Result Run(const Benchmark& benchmark, const std::vector<std::int64_t>& arguments) const
+        {
+            std::uint64_t iterations = 1;
+            while (true)
+            {
+                State state{ iterations, arguments };
+                benchmark.Body()(state);
+                state.StopTiming();
+
+                const auto seconds = state.realSeconds;
+                if (seconds >= options.minTime || iterations >= MaxIterations)
+                    return Summarize(RunName(benchmark.Name(), arguments), state);
+
+                // Aim past the minimum, by at most 10x at a time while runs are too short to extrapolate
+                const auto factor = seconds / options.minTime > 0.1 ? options.minTime * 1.4 / seconds : 10.0;
+                iterations = std::min(MaxIterations, std::max(iterations + 1, static_cast<std::uint64_t>(static_cast<double>(iterations) * factor)));
+            }
+        }
+
+    private:
+        static constexpr std::uint64_t MaxIterations = 1'000'000'000;
+
+        static Result Summarize(std::string name, const State& state)
+        {
+            Result result;
+            result.name = std::move(name);
+            result.iterations = state.iterations;
+            const auto iterations = static_cast<double>(state.iterations);
+            result.realNs = state.realSeconds * 1e9 / iterations;
+            result.cpuNs = state.cpuSeconds * 1e9 / iterations;
+            if (state.realSeconds > 0)
+            {
+                result.bytesPerSecond = static_cast<double>(state.bytes) / state.realSeconds;
+                result.itemsPerSecond = static_cast<double>(state.items) / state.realSeconds;
+            }
+            result.counters = state.counters;
+            result.label = state.label;
+            return result;
+        }
+
+        const Options& options;
+    };
+
+    namespace
+    {
+        // Mean, median and standard deviation over the repetitions of one run
+        std::vector<Result> Aggregate(const std::vector<Result>& repetitions)
+        {
+            auto make = [&](const char* kind, auto&& reduce)
+                {
+                    Result result = repetitions.front();
+                    result.name += std::string{ "_" } + kind;
+                    result.aggregate = kind;
+                    result.realNs = reduce(&Result::realNs);
+                    result.cpuNs = reduce(&Result::cpuNs);
+                    result.bytesPerSecond = reduce(&Result::bytesPerSecond);
+                    result.itemsPerSecond = reduce(&Result::itemsPerSecond);
+                    return result;
+                };
+            const auto count = static_cast<double>(repetitions.size());
+            auto mean = [&](double Result::* field)
+                {
+                    double sum = 0;
+                    for (const auto& r : repetitions)
+                        sum += r.*field;
+                    return sum / count;
+                };
+            auto median = [&](double Result::* field)
+                {
+                    std::vector<double> values;
+                    for (const auto& r : repetitions)
+                        values.push_back(r.*field);
+                    std::ranges::sort(values);
+                    const auto middle = values.size() / 2;
+                    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+                };
+            auto stddev = [&](double Result::* field)
+                {
+                    const auto average = mean(field);
+                    double sum = 0;
+                    for (const auto& r : repetitions)
+                        sum += (r.*field - average) * (r.*field - average);
+                    return count > 1 ? std::sqrt(sum / (count - 1)) : 0.0;
+                };
+            return { make("mean", mean), make("median", median), make("stddev", stddev) };
+        }
+
+        void PrintRow(const Result& result)
+        {
+            std::printf("%-48s %14.1f ns %14.1f ns %12llu", result.name.c_str(), result.realNs, result.cpuNs,
+                        static_cast<unsigned long long>(result.iterations));
+            if (result.bytesPerSecond > 0)
+                std::printf(" %10.1f MB/s", result.bytesPerSecond / 1e6);
+            if (result.itemsPerSecond > 0)
+                std::printf(" %10.2f M items/s", result.itemsPerSecond / 1e6);
+            for (const auto& [name, value] : result.counters)
+                std::printf(" %s=%g", name.c_str(), value);
+            if (!result.label.empty())
+                std::printf(" %s", result.label.c_str());
+            std::printf("\n");
+            std::fflush(stdout);
+        }
+
+        void WriteJson(std::ostream& out, const std::vector<Result>& results)
+        {
+            char date[64];
+            const auto now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+            out << "{\n  \"context\": {\n"
+                << "    \"date\": \"" << date << "\",\n"
+                << "    \"version\": \"" << TAGLIATELLE_VERSION << "\",\n"
+                << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+                << "    \"library_build_type\": \"release\"\n"
+#else
+                << "    \"library_build_type\": \"debug\"\n"
+#endif
+                << "  },\n  \"benchmarks\": [";
+            for (std::size_t i = 0; i < results.size(); ++i)
+            {
+                const auto& result = results[i];
+                out << (i > 0 ? "," : "") << "\n    {\n"
+                    << "      \"name\": \"" << Escape(result.name) << "\",\n"
+                    << "      \"run_type\": \"" << (result.aggregate.empty() ? "iteration" : "aggregate") << "\",\n";
+                if (!result.aggregate.empty())
+                    out << "      \"aggregate_name\": \"" << result.aggregate << "\",\n";
+                out << "      \"iterations\": " << result.iterations << ",\n"
+                    << "      \"real_time\": " << Number(result.realNs) << ",\n"
+                    << "      \"cpu_time\": " << Number(result.cpuNs) << ",\n"
+                    << "      \"time_unit\": \"ns\"";
+                if (result.bytesPerSecond > 0)
+                    out << ",\n      \"bytes_per_second\": " << Number(result.bytesPerSecond);
+                if (result.itemsPerSecond > 0)
+                    out << ",\n      \"items_per_second\": " << Number(result.itemsPerSecond);
+                for (const auto& [name, value] : result.counters)
+                    out << ",\n      \"" << Escape(name) << "\": " << Number(value);
+                if (!result.label.empty())
+                    out << ",\n      \"label\": \"" << Escape(result.label) << "\"";
+                out << "\n    }";
+            }
+            out << "\n  ]\n}\n";
+        }
+
+        bool Parse(const int argc, char** argv, Options& options)
+        {
+            for (int i = 1; i < argc; ++i)
+            {
+                const std::string_view argument = argv[i];
+                auto value = [&](const std::string_view flag) -> std::optional<std::string>
+                    {
+                        if (!argument.starts_with(flag) || argument.size() <= flag.size() || argument[flag.size()] != '=')
+                            return std::nullopt;
+                        return std::string{ argument.substr(flag.size() + 1) };
+                    };
+                if (const auto filter = value("--filter"))
+                    options.filter = *filter;
+                else if (const auto minTime = value("--min-time"))
+                    options.minTime = std::stod(*minTime);
+                else if (const auto repetitions = value("--repetitions"))
+                    options.repetitions = std::max(1, std::stoi(*repetitions));
+                else if (const auto json = value("--json"))
+                    options.json = *json;
+                else if (argument == "--list")
+                    options.list = true;
+                else
+                {
+                    std::fprintf(stderr, "Unknown argument %s\n", argv[i]);
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+} // namespace tagliatelle::bench
+
+int main(int argc, char** argv)
+{
+    using namespace tagliatelle::bench;
+
+    Options options;
+    if (!Parse(argc, argv, options))
+        return 2;
+
+    const std::regex filter{ options.filter };
+    std::vector<std::pair<const Benchmark*, std::vector<std::int64_t>>> selected;
+    for (const auto& benchmark : Registry())
+    {
+        auto runs = benchmark->Runs();
+        if (runs.empty())
+            runs.push_back({});
+        for (auto& arguments : runs)
+        {
+            if (std::regex_search(RunName(benchmark->Name(), arguments), filter))
+                selected.emplace_back(benchmark.get(), std::move(arguments));
+        }
+    }
+
+    if (options.list)
+    {
+        for (const auto& [benchmark, arguments] : selected)
+            std::printf("%s\n", RunName(benchmark->Name(), arguments).c_str());
+        return 0;
+    }
+
+    std::printf("%-48s %17s %17s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    const Runner runner{ options };
+    std::vector<Result> results;
+    for (const auto& [benchmark, arguments] : selected)
+    {
+        std::vector<Result> repetitions;
+        for (int i = 0; i < options.repetitions; ++i)
+        {
+            repetitions.push_back(runner.Run(*benchmark, arguments));
+            PrintRow(repetitions.back());
+        }
+        results.insert(results.end(), repetitions.begin(), repetitions.end());
+        if (options.repetitions > 1)
+        {
+            for (const auto& aggregate : Aggregate(repetitions))
+            {
+                PrintRow(aggregate);
+                results.push_back(aggregate);
+            }
+        }
+    }
+
+    if (options.json == "-")
+    {
+        WriteJson(std::cout, results);
+    }
+    else if (!options.json.empty())
+    {
+        std::ofstream out{ options.json };
+        WriteJson(out, results);
+        if (!out)
+        {
+            std::fprintf(stderr, "Cannot write %s\n", options.json.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness in the style of Google Benchmark.
+// Benchmarks register with TAG_BENCHMARK, loop over `for (auto _ : state)`
+// and are run until the measured time reaches --min-time, see Benchmark.cpp
+// for the command line. Results go to the console and optionally to JSON.
+
+namespace tagliatelle::bench
+{
+
+    class State
+    {
+    public:
+        State(std::uint64_t iterations, std::vector<std::int64_t> arguments);
+
+        class Iterator
+        {
+        public:
+            // Not trivially destructible, so that an unused loop variable draws no warning
+            struct Value
+            {
+                ~Value() {}
+            };
+
+            explicit Iterator(State* state, const std::uint64_t remaining)
+                : state{ state }
+                , remaining{ remaining }
+            {
+            }
+
+            Value operator*() const
+            {
+                return {};
+            }
+
+            Iterator& operator++()
+            {
+                --remaining;
+                return *this;
+            }
+
+            bool operator!=(const Iterator&)
+            {
+                if (remaining != 0) [[likely]]
+                    return true;
+                state->StopTiming();
+                return false;
+            }
+
+        private:
+            State*        state;
+            std::uint64_t remaining;
+        };
+
+        // Timing covers the loop only, setup before it is not measured
+        Iterator begin();
+        Iterator end();
+
+        [[nodiscard]] std::int64_t Range(std::size_t index) const;
+        [[nodiscard]] std::uint64_t Iterations() const;
+
+        // Excludes per-iteration setup from the measurement
+        void PauseTiming();
+        void ResumeTiming();
+
+        void SetBytesProcessed(std::uint64_t bytes);
+        void SetItemsProcessed(std::uint64_t items);
+        void SetLabel(std::string text);
+
+        // Reported as is, next to the timings
+        std::map<std::string, double> counters;
+
+    private:
+        friend class Runner;
+
+        void StartTiming();
+        void StopTiming();
+
+        using Clock = std::chrono::steady_clock;
+
+        std::uint64_t             iterations;
+        std::vector<std::int64_t> arguments;
+        Clock::time_point         realStart;
+        double                    cpuStart = 0;
+        bool                      running  = false;
+        double                    realSeconds = 0;
+        double                    cpuSeconds  = 0;
+        std::uint64_t             bytes = 0;
+        std::uint64_t             items = 0;
+        std::string               label;
+    };
+
+    using Function = std::function<void(State&)>;
+
+    class Benchmark
+    {
+    public:
+        Benchmark(std::string name, Function function);
+
+        // Adds a run with the given arguments, available through State::Range()
+        Benchmark* Args(std::initializer_list<std::int64_t> arguments);
+
+        // Adds a run per argument, powers of multiplier from first to last
+        Benchmark* Range(std::int64_t first, std::int64_t last, std::int64_t multiplier = 8);
+
+        // Adds a run per combination of the arguments of each dimension
+        Benchmark* ArgsProduct(const std::vector<std::vector<std::int64_t>>& dimensions);
+
+        [[nodiscard]] const std::string& Name() const;
+        [[nodiscard]] const Function& Body() const;
+        [[nodiscard]] const std::vector<std::vector<std::int64_t>>& Runs() const;
+
+    private:
+        std::string                            name;
+        Function                               function;
+        std::vector<std::vector<std::int64_t>> runs;
+    };
+
+    Benchmark* Register(std::string name, Function function);
+
+    // Keeps the compiler from discarding a value that is never read
+    template <typename T>
+    inline void DoNotOptimize(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const T* sink;
+        sink = &value;
+#endif
+    }
+
+} // namespace tagliatelle::bench
+
+#define TAG_BENCHMARK_CONCAT2(a, b) a##b
+#define TAG_BENCHMARK_CONCAT(a, b) TAG_BENCHMARK_CONCAT2(a, b)
+
+// TAG_BENCHMARK(Function)->Args({ 1, 2 });
+#define TAG_BENCHMARK(function) \
+    [[maybe_unused]] static ::tagliatelle::bench::Benchmark* TAG_BENCHMARK_CONCAT(benchmark_, __LINE__) = \
+        ::tagliatelle::bench::Register(#function, function)
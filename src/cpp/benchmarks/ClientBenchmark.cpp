@@ -0,0 +1,55 @@
+// Per-scope cost of the instrumentation client, on the recording thread only.
+// The sink discards the stream and the rings are flushed outside the timing.
+
+#include <memory> // std::make_unique
+#include <string_view>
+
+#include "Benchmark.hpp"
+#include "tagliatelle_client.hpp"
+
+using namespace tagliatelle;
+using namespace tagliatelle::bench;
+
+namespace
+{
+    class NullSink final : public client::Sink
+    {
+    public:
+        [[nodiscard]] bool Write(std::string_view) override
+        {
+            return true;
+        }
+    };
+
+    void ClientScope(State& state)
+    {
+        auto& collector = client::Collector::Instance();
+        collector.Start(std::make_unique<NullSink>());
+        std::uint64_t count = 0;
+        for (auto _ : state)
+        {
+            TAG_SCOPE("scope");
+            if (++count % (client::Collector::RingCapacity / 2) == 0) [[unlikely]]
+            {
+                state.PauseTiming();
+                collector.Flush();
+                state.ResumeTiming();
+            }
+        }
+        collector.Stop();
+        state.counters["dropped"] = static_cast<double>(collector.Stats().eventsDropped);
+        state.SetItemsProcessed(state.Iterations());
+    }
+
+    void ClientScopeStopped(State& state)
+    {
+        for (auto _ : state)
+        {
+            TAG_SCOPE("scope");
+        }
+        state.SetItemsProcessed(state.Iterations());
+    }
+}
+
+TAG_BENCHMARK(ClientScope);
+TAG_BENCHMARK(ClientScopeStopped);
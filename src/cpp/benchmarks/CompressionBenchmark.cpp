@@ -0,0 +1,177 @@
+// Memory against speed of cold event blocks: packing and unpacking a store,
+// full scans and viewport queries of a packed and an unpacked store, and
+// random access through the decoded block cache with more or less locality.
+
+#include <algorithm> // std::min
+#include <memory>    // std::make_unique
+#include <random>
+#include <string>    // std::to_string
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "EventStore.hpp"
+#include "RenderQuery.hpp"
+
+using namespace tagliatelle;
+using namespace tagliatelle::bench;
+
+namespace
+{
+    constexpr std::size_t StoreEvents = 1'000'000;
+
+    // Nested spans on 16 tracks with jittered times and a few hundred names
+    std::unique_ptr<EventStore> MakeStore(const std::size_t hotEvents)
+    {
+        auto result = std::make_unique<EventStore>();
+        std::vector<NameId> names;
+        for (int i = 0; i < 300; ++i)
+            names.push_back(result->InternName("function " + std::to_string(i)));
+
+        std::mt19937 random{ 23 };
+        EventColumns batch;
+        batch.Reserve(StoreEvents);
+        for (std::size_t i = 0; i < StoreEvents; ++i)
+        {
+            const auto depth = static_cast<Depth>(i % 4);
+            const auto slot = static_cast<Timestamp>(i / 4 / 16) * 4000;
+            batch.PushBack(Event{ slot + depth * 100 + static_cast<Timestamp>(random() % 50), 3000 - depth * 700 + static_cast<Duration>(random() % 200),
+                                  names[random() % names.size()], static_cast<TrackId>(i / 4 % 16), depth });
+        }
+        result->AppendBulk(batch);
+        result->SetHotEvents(hotEvents);
+        return result;
+    }
+
+    const EventStore& HotStore()
+    {
+        static const auto store = MakeStore(EventStore::AllHot);
+        return *store;
+    }
+
+    const EventStore& ColdStore()
+    {
+        static const auto store = MakeStore(0);
+        return *store;
+    }
+
+    void Freeze(State& state)
+    {
+        auto store = MakeStore(EventStore::AllHot);
+        const auto unpacked = store->MemoryBytes();
+        for (auto _ : state)
+        {
+            store->SetHotEvents(0);
+            state.PauseTiming();
+            store->SetHotEvents(EventStore::AllHot);
+            state.ResumeTiming();
+        }
+        store->SetHotEvents(0);
+        state.counters["ratio"] = static_cast<double>(unpacked) / static_cast<double>(store->MemoryBytes());
+        state.SetItemsProcessed(state.Iterations() * store->Size());
+    }
+
+    void Thaw(State& state)
+    {
+        auto store = MakeStore(0);
+        for (auto _ : state)
+        {
+            store->SetHotEvents(EventStore::AllHot);
+            state.PauseTiming();
+            store->SetHotEvents(0);
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.Iterations() * store->Size());
+    }
+
+    void Scan(State& state, const EventStore& store)
+    {
+        for (auto _ : state)
+        {
+            Duration total = 0;
+            store.ForEachPart(0, store.Size(), [&](const EventSpans& columns, const std::size_t first, const std::size_t last)
+                {
+                    for (auto i = first; i < last; ++i)
+                        total += columns.durations[i];
+                });
+            DoNotOptimize(total);
+        }
+        state.SetItemsProcessed(state.Iterations() * store.Size());
+    }
+
+    void ScanHot(State& state)
+    {
+        Scan(state, HotStore());
+    }
+
+    void ScanCold(State& state)
+    {
+        Scan(state, ColdStore());
+    }
+
+    // Viewports over a hundredth of the store at random times
+    void Visible(State& state, const EventStore& store)
+    {
+        const auto length = store.Timestamps().back();
+        const auto window = length / 100;
+        std::mt19937 random{ 37 };
+        std::vector<RenderRecord> records;
+        std::size_t collected = 0;
+        for (auto _ : state)
+        {
+            const auto start = static_cast<Timestamp>(random() % static_cast<std::uint64_t>(length - window));
+            CollectVisible(store, Viewport{ start, start + window, 1920.0f }, records);
+            collected += records.size();
+        }
+        state.SetItemsProcessed(collected);
+    }
+
+    void VisibleHot(State& state)
+    {
+        Visible(state, HotStore());
+    }
+
+    void VisibleCold(State& state)
+    {
+        Visible(state, ColdStore());
+    }
+
+    // Range(0) is the number of blocks the accesses are spread over, the cache holds ColdBlocks::CacheBlocks
+    void RandomAccess(State& state, const EventStore& store)
+    {
+        const auto span = std::min<std::size_t>(static_cast<std::size_t>(state.Range(0)) * ColdBlocks::BlockEvents, store.Size());
+        std::mt19937 random{ 29 };
+        for (auto _ : state)
+            DoNotOptimize(store[random() % span]);
+        state.SetItemsProcessed(state.Iterations());
+    }
+
+    void RandomAccessHot(State& state)
+    {
+        RandomAccess(state, HotStore());
+    }
+
+    void RandomAccessCold(State& state)
+    {
+        RandomAccess(state, ColdStore());
+    }
+
+    void LowerBoundCold(State& state)
+    {
+        const auto& store = ColdStore();
+        const auto end = store.Timestamps().back();
+        std::mt19937 random{ 31 };
+        for (auto _ : state)
+            DoNotOptimize(store.LowerBound(static_cast<Timestamp>(random() % static_cast<std::uint64_t>(end))));
+        state.SetItemsProcessed(state.Iterations());
+    }
+}
+
+TAG_BENCHMARK(Freeze);
+TAG_BENCHMARK(Thaw);
+TAG_BENCHMARK(ScanHot);
+TAG_BENCHMARK(ScanCold);
+TAG_BENCHMARK(VisibleHot);
+TAG_BENCHMARK(VisibleCold);
+TAG_BENCHMARK(RandomAccessHot)->Args({ 1 })->Args({ 8 })->Args({ 64 });
+TAG_BENCHMARK(RandomAccessCold)->Args({ 1 })->Args({ 8 })->Args({ 64 });
+TAG_BENCHMARK(LowerBoundCold);
@@ -0,0 +1,141 @@
+// Ingestion paths on synthetic traces: the stages of the Chrome JSON
+// import, appending to the event store and the native format round trip.
+
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "Benchmark.hpp"
+#include "ChromeTraceImporter.hpp"
+#include "JsonScanner.hpp"
+#include "NativeTrace.hpp"
+#include "Trace.hpp"
+
+using namespace tagliatelle;
+using namespace tagliatelle::bench;
+
+namespace
+{
+    constexpr std::size_t JsonEvents = 100'000;
+
+    const std::string& JsonTrace()
+    {
+        static const std::string json = []
+            {
+                std::string result = "{\"traceEvents\": [\n";
+                for (std::size_t i = 0; i < JsonEvents; ++i)
+                {
+                    const auto depth = i % 4;
+                    result += i > 0 ? ",\n" : "";
+                    result += "{\"name\": \"function_" + std::to_string(i % 97) + "\", \"cat\": \"bench\", \"ph\": \"X\", \"ts\": "
+                            + std::to_string(i / 4 * 100 + depth * 10) + ".125, \"dur\": " + std::to_string(100 - depth * 20)
+                            + ", \"pid\": 1, \"tid\": " + std::to_string(i % 8) + ", \"args\": {\"frame\": \"0x7ff\\\"" + std::to_string(i) + "\"}}";
+                }
+                result += "\n]}\n";
+                return result;
+            }();
+        return json;
+    }
+
+    JsonScanKernel Kernel(const State& state)
+    {
+        return state.Range(0) == 0 ? JsonScanKernel::Scalar : JsonScanKernel::Best;
+    }
+
+    void JsonScan(State& state)
+    {
+        const auto& json = JsonTrace();
+        for (auto _ : state)
+        {
+            JsonStructuralScanner scanner{ json, Kernel(state) };
+            std::size_t count = 0;
+            while (scanner.Next() != JsonStructuralScanner::npos)
+                ++count;
+            DoNotOptimize(count);
+        }
+        state.SetBytesProcessed(state.Iterations() * json.size());
+        state.SetLabel(state.Range(0) == 0 ? "scalar" : JsonScannerHasAvx2() ? "avx2" : "scalar fallback");
+    }
+
+    void ChromeImport(State& state)
+    {
+        const auto& json = JsonTrace();
+        for (auto _ : state)
+        {
+            ParsedChunk chunk;
+            ImportChromeTrace(json, chunk, nullptr, Kernel(state));
+            DoNotOptimize(chunk.columns.Size());
+        }
+        state.SetBytesProcessed(state.Iterations() * json.size());
+        state.SetItemsProcessed(state.Iterations() * JsonEvents);
+    }
+
+    // Events of a few tracks, in order up to the jitter of producers handing them over
+    EventColumns MakeBatch(const std::size_t count, const NameId name)
+    {
+        std::mt19937 random{ 19 };
+        EventColumns batch;
+        batch.Reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto timestamp = static_cast<Timestamp>(i * 100 + random() % 1000);
+            batch.PushBack(Event{ timestamp, 50, name, static_cast<TrackId>(i % 16), 0 });
+        }
+        return batch;
+    }
+
+    void EventStoreAppend(State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.Range(0));
+        Trace scratch;
+        const auto batch = MakeBatch(count, scratch.InternName("event"));
+        for (auto _ : state)
+        {
+            Trace trace;
+            for (std::size_t i = 0; i < count; ++i)
+                trace.Append(batch[i]);
+            DoNotOptimize(trace.Events().Size());
+        }
+        state.SetItemsProcessed(state.Iterations() * count);
+    }
+
+    void EventStoreAppendBulk(State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.Range(0));
+        Trace scratch;
+        const auto batch = MakeBatch(count, scratch.InternName("event"));
+        for (auto _ : state)
+        {
+            Trace trace;
+            trace.AppendBulk(batch);
+            DoNotOptimize(trace.Events().Size());
+        }
+        state.SetItemsProcessed(state.Iterations() * count);
+    }
+
+    void NativeTraceRoundTrip(State& state)
+    {
+        const auto count = static_cast<std::size_t>(state.Range(0));
+        Trace trace;
+        trace.AppendBulk(MakeBatch(count, trace.InternName("event")));
+        std::ostringstream out;
+        WriteNativeTrace(trace.Events(), out);
+        const auto data = out.str();
+
+        for (auto _ : state)
+        {
+            ParsedChunk chunk;
+            ImportNativeTrace(data, chunk);
+            DoNotOptimize(chunk.columns.Size());
+        }
+        state.SetBytesProcessed(state.Iterations() * data.size());
+        state.SetItemsProcessed(state.Iterations() * count);
+        state.counters["bytes_per_event"] = static_cast<double>(data.size()) / static_cast<double>(count);
+    }
+}
+
+TAG_BENCHMARK(JsonScan)->Args({ 0 })->Args({ 1 });
+TAG_BENCHMARK(ChromeImport)->Args({ 0 })->Args({ 1 });
+TAG_BENCHMARK(EventStoreAppend)->Range(1'000, 1'000'000, 10);
+TAG_BENCHMARK(EventStoreAppendBulk)->Range(1'000, 1'000'000, 10);
+TAG_BENCHMARK(NativeTraceRoundTrip)->Range(10'000, 1'000'000, 10);
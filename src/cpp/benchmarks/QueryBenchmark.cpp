@@ -0,0 +1,226 @@
+// Query paths on a synthetic trace: time lookups, viewport collection at
+// different zoom levels with and without the render query cache, interval
+// index stabbing queries, counter decimation and critical paths along flows.
+
+#include <cmath>  // std::sin
+#include <memory> // std::make_unique
+#include <random>
+#include <shared_mutex>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "CounterStore.hpp"
+#include "IntervalIndex.hpp"
+#include "RenderQuery.hpp"
+#include "RenderQueryCache.hpp"
+#include "Trace.hpp"
+
+using namespace tagliatelle;
+using namespace tagliatelle::bench;
+
+namespace
+{
+    constexpr std::size_t TraceEvents = 2'000'000;
+    constexpr TrackId     TraceTracks = 16;
+    constexpr Timestamp   TraceLength = static_cast<Timestamp>(TraceEvents) * 100;
+    constexpr Timestamp   SlotLength  = TraceLength / static_cast<Timestamp>(TraceEvents / 4 / TraceTracks);
+
+    // Nested spans on every track, four levels deep, spread over the trace length
+    const Trace& QueryTrace()
+    {
+        static const auto trace = []
+            {
+                auto result = std::make_unique<Trace>();
+                const auto name = result->InternName("span");
+                EventColumns batch;
+                batch.Reserve(TraceEvents);
+                for (std::size_t i = 0; i < TraceEvents; ++i)
+                {
+                    const auto depth = static_cast<Depth>(i % 4);
+                    const auto slot = static_cast<Timestamp>(i / 4 / TraceTracks) * SlotLength;
+                    batch.PushBack(Event{ slot + depth * 10, 400 - depth * 90, name, static_cast<TrackId>(i / 4 % TraceTracks), depth });
+                }
+                result->AppendBulk(batch);
+                return result;
+            }();
+        return *trace;
+    }
+
+    // The query trace and a span per track that lasts all of it, which raw event queries must look back to
+    const Trace& LongSpanTrace()
+    {
+        static const auto trace = []
+            {
+                auto result = std::make_unique<Trace>();
+                const auto& events = QueryTrace().Events();
+                for (std::size_t i = 0; i < events.Size(); ++i)
+                {
+                    auto event = events[i];
+                    ++event.depth;
+                    result->Append(event);
+                }
+                const auto name = result->InternName("frame");
+                for (TrackId track = 0; track < TraceTracks; ++track)
+                    result->Append(Event{ 0, TraceLength, name, track, 0 });
+                return result;
+            }();
+        return *trace;
+    }
+
+    void LowerBound(State& state)
+    {
+        const auto& events = QueryTrace().Events();
+        std::mt19937 random{ 19 };
+        for (auto _ : state)
+            DoNotOptimize(events.LowerBound(static_cast<Timestamp>(random() % TraceLength)));
+        state.SetItemsProcessed(state.Iterations());
+    }
+
+    // Range(0) is the visible fraction of the trace in thousandths
+    void VisibleSpans(State& state)
+    {
+        const auto& events = QueryTrace().Events();
+        const auto window = TraceLength * state.Range(0) / 1000;
+        std::mt19937 random{ 19 };
+        std::vector<RenderRecord> records;
+        std::size_t collected = 0;
+        for (auto _ : state)
+        {
+            const auto start = static_cast<Timestamp>(random() % static_cast<std::uint64_t>(TraceLength - window + 1));
+            records.clear();
+            CollectVisible(events, Viewport{ start, start + window, 1920.0f }, records);
+            collected += records.size();
+        }
+        state.SetItemsProcessed(collected);
+    }
+
+    // Pans by a pixel per frame, Range(0) selects the cache, Range(1) is the visible fraction in thousandths,
+    // Range(2) selects the trace with spans as long as the trace
+    void LodPan(State& state)
+    {
+        const auto& trace = state.Range(2) != 0 ? LongSpanTrace() : QueryTrace();
+        const bool cached = state.Range(0) != 0;
+        const auto window = TraceLength * state.Range(1) / 1000;
+        std::shared_mutex mutex;
+        RenderQueryCache cache{ trace, mutex };
+        std::vector<LodRecord> records(1 << 20);
+
+        Timestamp start = 0;
+        std::size_t collected = 0;
+        for (auto _ : state)
+        {
+            start = (start + window / 1920) % (TraceLength - window);
+            const Viewport viewport{ start, start + window, 1920.0f };
+            if (cached)
+            {
+                collected += cache.Query(viewport, records).count;
+            }
+            else
+            {
+                std::size_t count = 0;
+                auto collect = [&](const LodRecord& record) { records[count++ % records.size()] = record; };
+                if (!trace.Lod().ForEachVisible(viewport, collect))
+                {
+                    ForEachVisible(trace.Events(), viewport, [&](const RenderRecord& r)
+                        {
+                            collect(LodRecord{ r.x, r.width, r.track, r.depth, r.colorIndex, r.label, 1 });
+                        });
+                }
+                collected += count;
+            }
+        }
+        state.SetItemsProcessed(collected);
+    }
+
+    void IntervalStabbing(State& state)
+    {
+        const auto& events = QueryTrace().Events();
+        state.PauseTiming();
+        IntervalIndex index;
+        index.Build(events);
+        state.ResumeTiming();
+
+        std::mt19937 random{ 19 };
+        std::size_t found = 0;
+        for (auto _ : state)
+        {
+            const auto time = static_cast<Timestamp>(random() % TraceLength);
+            index.ForEachStabbing(static_cast<TrackId>(random() % TraceTracks), time, [&](IntervalIndex::EventIndex) { ++found; });
+        }
+        DoNotOptimize(found);
+        state.SetItemsProcessed(state.Iterations());
+    }
+
+    void IntervalIndexBuild(State& state)
+    {
+        const auto& events = QueryTrace().Events();
+        for (auto _ : state)
+        {
+            IntervalIndex index;
+            index.Build(events);
+            DoNotOptimize(index.TrackCount());
+        }
+        state.SetItemsProcessed(state.Iterations() * events.Size());
+    }
+
+    // Range(0) is the visible fraction of a 10M sample series in thousandths
+    void CounterDecimate(State& state)
+    {
+        constexpr std::size_t Samples = 10'000'000;
+        state.PauseTiming();
+        CounterStore counters;
+        const auto series = counters.Series(0);
+        for (std::size_t i = 0; i < Samples; ++i)
+            counters.Append(series, static_cast<Timestamp>(i) * 10, std::sin(static_cast<double>(i) * 1e-4));
+        state.ResumeTiming();
+
+        const auto length = static_cast<Timestamp>(Samples) * 10;
+        const auto window = length * state.Range(0) / 1000;
+        std::mt19937 random{ 19 };
+        std::vector<CounterPoint> points;
+        std::size_t produced = 0;
+        for (auto _ : state)
+        {
+            const auto start = static_cast<Timestamp>(random() % static_cast<std::uint64_t>(length - window + 1));
+            counters.Decimate(series, Viewport{ start, start + window, 1920.0f }, points);
+            produced += points.size();
+        }
+        state.SetItemsProcessed(produced);
+    }
+
+    // Range(0) hops between spans on 16 tracks
+    void CriticalPath(State& state)
+    {
+        const auto hops = static_cast<std::uint32_t>(state.Range(0));
+        state.PauseTiming();
+        Trace trace;
+        const auto name = trace.InternName("hop");
+        std::vector<FlowPoint> points;
+        for (std::uint32_t i = 0; i < hops; ++i)
+        {
+            const auto start = static_cast<Timestamp>(i) * 10;
+            trace.Append(Event{ start, 15, name, i % TraceTracks, 0 });
+            points.push_back(FlowPoint{ i, start + 5, i % TraceTracks, FlowPhase::Start });
+            points.push_back(FlowPoint{ i, start + 11, (i + 1) % TraceTracks, FlowPhase::End });
+        }
+        trace.AppendFlows(points);
+        const auto& flows = trace.Flows();
+        state.ResumeTiming();
+
+        std::vector<FlowStore::EventIndex> path;
+        for (auto _ : state)
+        {
+            flows.CriticalPath(trace.Events(), trace.Intervals(), 0, path);
+            DoNotOptimize(path.data());
+        }
+        state.SetItemsProcessed(state.Iterations() * hops);
+    }
+}
+
+TAG_BENCHMARK(LowerBound);
+TAG_BENCHMARK(VisibleSpans)->Args({ 1 })->Args({ 10 })->Args({ 100 })->Args({ 1000 });
+TAG_BENCHMARK(LodPan)->Args({ 0, 1, 0 })->Args({ 1, 1, 0 })->Args({ 0, 100, 0 })->Args({ 1, 100, 0 })->Args({ 0, 1, 1 })->Args({ 1, 1, 1 });
+TAG_BENCHMARK(IntervalStabbing);
+TAG_BENCHMARK(IntervalIndexBuild);
+TAG_BENCHMARK(CounterDecimate)->Args({ 1 })->Args({ 100 })->Args({ 1000 });
+TAG_BENCHMARK(CriticalPath)->Args({ 1000 })->Args({ 100000 });
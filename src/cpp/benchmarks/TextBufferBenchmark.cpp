@@ -0,0 +1,211 @@
+// StableTextBuffer and InternedTextBuffer: store throughput by string size
+// distribution and page size, the cost of recycling and pruning, and the
+// page allocators on a large string table, single threaded and with one
+// table per thread.
+
+#include <algorithm> // std::max
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "InternedTextBuffer.hpp"
+#include "SlabAllocator.hpp"
+#include "StableTextBuffer.hpp"
+
+using namespace tagliatelle;
+using namespace tagliatelle::bench;
+
+namespace
+{
+    enum Distribution : std::int64_t
+    {
+        Short,     // identifiers, 4 to 32 bytes
+        Mixed,     // mostly short, a long tail up to 2 KB
+        Long,      // paths and messages, 256 bytes to 8 KB, partly larger than small pages
+    };
+
+    std::vector<std::string> MakeStrings(const std::int64_t distribution, const std::size_t count)
+    {
+        std::mt19937 random{ 19 };
+        std::uniform_int_distribution<std::size_t> shortLength{ 4, 32 };
+        std::lognormal_distribution<double> mixedLength{ 3.0, 1.0 };
+        std::uniform_int_distribution<std::size_t> longLength{ 256, 8192 };
+
+        std::vector<std::string> strings;
+        strings.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::size_t length = 0;
+            switch (distribution)
+            {
+            case Short: length = shortLength(random); break;
+            case Mixed: length = std::min<std::size_t>(2048, 1 + static_cast<std::size_t>(mixedLength(random))); break;
+            default:    length = longLength(random); break;
+            }
+            strings.emplace_back(length, static_cast<char>('a' + i % 26));
+        }
+        return strings;
+    }
+
+    std::size_t TotalBytes(const std::vector<std::string>& strings)
+    {
+        std::size_t bytes = 0;
+        for (const auto& string : strings)
+            bytes += string.size();
+        return bytes;
+    }
+
+    // Fresh buffer per iteration, so page allocation is part of the cost
+    template <std::size_t PageSz>
+    void StableTextBufferStore(State& state)
+    {
+        const auto strings = MakeStrings(state.Range(0), 100'000);
+        for (auto _ : state)
+        {
+            StableTextBuffer<PageSz> buffer;
+            for (const auto& string : strings)
+                DoNotOptimize(buffer.Store(string));
+        }
+        state.SetItemsProcessed(state.Iterations() * strings.size());
+        state.SetBytesProcessed(state.Iterations() * TotalBytes(strings));
+    }
+
+    // Refilling recycled pages, the steady state of a buffer that is reused
+    template <std::size_t PageSz>
+    void StableTextBufferRecycledStore(State& state)
+    {
+        const auto strings = MakeStrings(state.Range(0), 100'000);
+        StableTextBuffer<PageSz> buffer;
+        for (auto _ : state)
+        {
+            buffer.Recycle();
+            for (const auto& string : strings)
+                DoNotOptimize(buffer.Store(string));
+        }
+        state.SetItemsProcessed(state.Iterations() * strings.size());
+        state.SetBytesProcessed(state.Iterations() * TotalBytes(strings));
+    }
+
+    void StableTextBufferRecycle(State& state)
+    {
+        const auto pages = static_cast<std::size_t>(state.Range(0));
+        StableTextBuffer<16 * 1024> buffer;
+        const std::string page(16 * 1024, 'p');
+        for (std::size_t i = 0; i < pages; ++i)
+            DoNotOptimize(buffer.Store(page));
+        for (auto _ : state)
+            buffer.Recycle();
+        state.SetItemsProcessed(state.Iterations() * pages);
+    }
+
+    // Prunes a buffer whose pages are half in use after a recycle
+    void StableTextBufferPrune(State& state)
+    {
+        const auto pages = static_cast<std::size_t>(state.Range(0));
+        const std::string page(16 * 1024, 'p');
+        auto pool = std::make_shared<PagePool<16 * 1024>>(PagePoolOptions{ pages, false });
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            StableTextBuffer<16 * 1024> buffer{ pool };
+            for (std::size_t i = 0; i < pages; ++i)
+                DoNotOptimize(buffer.Store(page));
+            buffer.Recycle();
+            for (std::size_t i = 0; i < pages / 2; ++i)
+                DoNotOptimize(buffer.Store(page));
+            state.ResumeTiming();
+
+            buffer.Prune();
+
+            state.PauseTiming();
+            buffer.Clear();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.Iterations() * pages);
+    }
+
+    enum PageAllocator : std::int64_t
+    {
+        Default,
+        Slab,
+        SlabHugePages,
+        SlabNodeLocal,
+    };
+
+    template <typename Allocator>
+    void InternAndLookUp(const std::span<const std::string> names, const std::uint32_t seed, const Allocator& allocator)
+    {
+        InternedTextBuffer<16 * 1024, Allocator> table{ allocator };
+        for (const auto& name : names)
+            DoNotOptimize(table.Intern(name));
+
+        // Random reads over the whole table, which is where TLB misses show
+        std::mt19937 random{ seed };
+        for (std::size_t i = 0; i < 4 * names.size(); ++i)
+            DoNotOptimize(table.View(static_cast<std::uint32_t>(random() % names.size())).back());
+    }
+
+    // One table per thread, as with one table per ingestion thread, each on a
+    // share of the names and with an allocator of its own
+    template <typename Allocator>
+    void InternAndLookUp(const std::vector<std::string>& names, const std::vector<Allocator>& allocators)
+    {
+        if (allocators.size() == 1)
+        {
+            InternAndLookUp(names, 18, allocators.front());
+            return;
+        }
+        const auto share = names.size() / allocators.size();
+        std::vector<std::jthread> workers;
+        for (std::size_t t = 0; t < allocators.size(); ++t)
+            workers.emplace_back([&, t] { InternAndLookUp(std::span{ names }.subspan(t * share, share), static_cast<std::uint32_t>(18 + t), allocators[t]); });
+    }
+
+    template <typename Allocator>
+    void InternAndLookUp(State& state, const std::vector<std::string>& names, std::vector<Allocator> allocators)
+    {
+        // A first pass maps and faults the slabs, the tables of the timed
+        // passes get the same blocks back from the free lists
+        InternAndLookUp(names, allocators);
+        for (auto _ : state)
+            InternAndLookUp(names, allocators);
+    }
+
+    void InternedTextBufferAllocator(State& state)
+    {
+        std::vector<std::string> names;
+        for (std::int64_t i = 0; i < state.Range(1); ++i)
+            names.push_back("namespace::module_" + std::to_string(i % 4096) + "::function_" + std::to_string(i));
+
+        const auto threads = static_cast<std::size_t>(state.Range(2));
+        auto slabs = [threads](const bool hugePages, const bool nodeLocal)
+            {
+                std::vector<SlabAllocator<char>> allocators;
+                for (std::size_t t = 0; t < threads; ++t)
+                    allocators.emplace_back(std::make_shared<SlabArena>(SlabOptions{ 32 * 1024 * 1024, hugePages, nodeLocal }));
+                return allocators;
+            };
+        switch (state.Range(0))
+        {
+        case Default:       InternAndLookUp(state, names, std::vector<std::allocator<char>>(threads)); break;
+        case Slab:          InternAndLookUp(state, names, slabs(false, false)); break;
+        case SlabHugePages: InternAndLookUp(state, names, slabs(true, false)); break;
+        default:            InternAndLookUp(state, names, slabs(true, true)); break;
+        }
+        state.SetItemsProcessed(state.Iterations() * (names.size() / threads * threads));
+    }
+}
+
+TAG_BENCHMARK(StableTextBufferStore<4096>)->Args({ Short })->Args({ Mixed })->Args({ Long });
+TAG_BENCHMARK(StableTextBufferStore<16384>)->Args({ Short })->Args({ Mixed })->Args({ Long });
+TAG_BENCHMARK(StableTextBufferStore<65536>)->Args({ Short })->Args({ Mixed })->Args({ Long });
+TAG_BENCHMARK(StableTextBufferRecycledStore<16384>)->Args({ Short })->Args({ Mixed })->Args({ Long });
+TAG_BENCHMARK(StableTextBufferRecycle)->Range(8, 4096);
+TAG_BENCHMARK(StableTextBufferPrune)->Range(8, 4096);
+TAG_BENCHMARK(InternedTextBufferAllocator)->ArgsProduct({ { Default, Slab, SlabHugePages, SlabNodeLocal },
+                                                                   { 1'000'000 },
+                                                                   { 1, std::max<std::int64_t>(2, std::thread::hardware_concurrency()) } });
@@ -0,0 +1,579 @@
+#pragma once
+
+// Header-only instrumentation client. Programs time their scopes with
+//
+//   TAG_SCOPE("decode");
+//
+// and stream them to a live capture socket or to a file, which tagliatelle
+// loads like any other trace. See LiveProtocol.hpp for the format.
+//
+//   tagliatelle::client::Collector::Instance().Start(tagliatelle::client::SocketSink::Connect("/tmp/app.sock"));
+//
+// Every thread records into its own lock-free ring. A flusher thread drains
+// the rings and writes the events in batches. When a ring is full, new events
+// are dropped and counted, so a stalled sink never blocks the program.
+// Names are cached by address on every thread, so they must outlive the
+// collector, like string literals do, and interned by text. A scope costs two time stamp counter reads and a ring
+// push, and a relaxed load while the collector is stopped.
+// Defining TAGLIATELLE_CLIENT_DISABLE compiles the macros to nothing.
+
+#include <algorithm> // std::ranges::find
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "InternedTextBuffer.hpp"
+#include "LiveProtocol.hpp"
+#include "SpscRing.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define TAGLIATELLE_CLIENT_TSC 1
+    #include <x86intrin.h>
+#elif defined(_M_X64)
+    #define TAGLIATELLE_CLIENT_TSC 1
+    #include <intrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define TAGLIATELLE_CLIENT_SOCKET 1
+    #include <cerrno>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace tagliatelle::client
+{
+
+    // Destination of the encoded stream, written from the flusher thread only
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+
+        // False if the destination is gone, the collector then stops recording
+        [[nodiscard]] virtual bool Write(std::string_view bytes) = 0;
+    };
+
+    class FileSink final : public Sink
+    {
+    public:
+        // Throws std::system_error if the file cannot be created
+        [[nodiscard]] static std::unique_ptr<FileSink> Create(const std::filesystem::path& path)
+        {
+            auto sink = std::make_unique<FileSink>();
+            sink->file.open(path, std::ios::binary | std::ios::trunc);
+            if (!sink->file)
+                throw std::system_error(std::make_error_code(std::errc::io_error), "FileSink: " + path.string());
+            return sink;
+        }
+
+        [[nodiscard]] bool Write(const std::string_view bytes) override
+        {
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            file.flush();
+            return static_cast<bool>(file);
+        }
+
+    private:
+        std::ofstream file;
+    };
+
+    // Connection to a live capture socket
+    class SocketSink final : public Sink
+    {
+    public:
+        explicit SocketSink(const int fd)
+            : fd{ fd }
+        {
+        }
+
+        ~SocketSink() override
+        {
+#ifdef TAGLIATELLE_CLIENT_SOCKET
+            ::close(fd);
+#endif
+        }
+
+        SocketSink(const SocketSink&) = delete;
+        SocketSink& operator=(const SocketSink&) = delete;
+
+        // Throws std::system_error if nothing listens on the path
+        [[nodiscard]] static std::unique_ptr<SocketSink> Connect(const std::filesystem::path& socketPath)
+        {
+#ifdef TAGLIATELLE_CLIENT_SOCKET
+            const auto native = socketPath.native();
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (native.size() >= sizeof(address.sun_path))
+                throw std::system_error(std::make_error_code(std::errc::filename_too_long), "SocketSink: socket path");
+            native.copy(address.sun_path, native.size());
+
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                throw std::system_error(errno, std::generic_category(), "SocketSink: socket");
+            if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+            {
+                const int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "SocketSink: connect");
+            }
+    #ifdef SO_NOSIGPIPE
+            const int on = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    #endif
+            return std::make_unique<SocketSink>(fd);
+#else
+            (void)socketPath;
+            throw std::system_error(std::make_error_code(std::errc::not_supported), "SocketSink: Unix domain sockets are not available");
+#endif
+        }
+
+        [[nodiscard]] bool Write(std::string_view bytes) override
+        {
+#ifdef TAGLIATELLE_CLIENT_SOCKET
+    #ifdef MSG_NOSIGNAL
+            constexpr int Flags = MSG_NOSIGNAL;
+    #else
+            constexpr int Flags = 0;
+    #endif
+            while (!bytes.empty())
+            {
+                const auto sent = ::send(fd, bytes.data(), bytes.size(), Flags);
+                if (sent < 0 && errno == EINTR)
+                    continue;
+                if (sent <= 0)
+                    return false;
+                bytes.remove_prefix(static_cast<std::size_t>(sent));
+            }
+            return true;
+#else
+            (void)bytes;
+            return false;
+#endif
+        }
+
+    private:
+        const int fd;
+    };
+
+    struct ClientStats
+    {
+        std::uint64_t eventsWritten = 0;
+        std::uint64_t eventsDropped = 0; // the thread's ring was full
+        std::uint64_t bytesWritten  = 0;
+        bool          failed        = false; // the sink could not be written, recording stopped
+    };
+
+    // Process-wide owner of the per-thread rings and the sink
+    class Collector
+    {
+    public:
+        static constexpr std::size_t RingCapacity  = 1 << 14;
+        static constexpr std::size_t NameCacheSize = 64; // per thread, direct mapped by address
+        static constexpr std::size_t NamePageSize  = 4096;
+        static constexpr auto        FlushInterval = std::chrono::milliseconds{ 10 };
+
+        static Collector& Instance()
+        {
+            static Collector collector;
+            return collector;
+        }
+
+        ~Collector()
+        {
+            Stop();
+        }
+
+        Collector(const Collector&) = delete;
+        Collector& operator=(const Collector&) = delete;
+
+        // Writes the handshake and every name known so far, then starts recording.
+        // Throws std::system_error if the handshake cannot be written.
+        void Start(std::unique_ptr<Sink> sink)
+        {
+            Stop();
+            std::scoped_lock lock{ flushMutex };
+            std::string header;
+            LiveEncodeHandshake(header);
+            {
+                std::scoped_lock namesLock{ namesMutex };
+                const auto views = names.Views();
+                for (std::uint32_t id = 0; id < views.size(); ++id)
+                    LiveEncodeText(header, LiveMessageType::Name, id, views[id]);
+                for (const auto& [track, name] : trackNames)
+                    LiveEncodeText(header, LiveMessageType::TrackName, track, name);
+                pendingText.clear();
+            }
+            if (!sink->Write(header))
+                throw std::system_error(std::make_error_code(std::errc::io_error), "Collector: handshake");
+
+            this->sink = std::move(sink);
+            stats = ClientStats{};
+            anchorTicks = Ticks();
+            anchorNanoseconds = Nanoseconds();
+            stats.bytesWritten = header.size();
+            enabled.store(true, std::memory_order_release);
+            flusher = std::jthread([this](std::stop_token stop) { FlushLoop(stop); });
+        }
+
+        // Stops recording, writes what was recorded and closes the sink
+        void Stop()
+        {
+            enabled.store(false, std::memory_order_relaxed);
+            if (flusher.joinable())
+            {
+                flusher.request_stop();
+                flusher.join();
+            }
+            Flush();
+            std::scoped_lock lock{ flushMutex };
+            sink.reset();
+        }
+
+        // Writes the events recorded so far
+        void Flush()
+        {
+            std::scoped_lock lock{ flushMutex };
+            if (!sink)
+                return;
+
+            std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+            {
+                std::scoped_lock buffersLock{ buffersMutex };
+                snapshot = buffers;
+            }
+
+            // Events first: the names they use were interned before they were pushed,
+            // so the pending definitions taken afterwards cover them
+            std::string events;
+            std::array<EventRecord, 1024> popped;
+            const auto scale = NanosecondsPerTick();
+            std::vector<ThreadBuffer*> finished;
+            for (const auto& buffer : snapshot)
+            {
+                const bool exited = buffer->exited.load(std::memory_order_acquire);
+                std::size_t count = 0;
+                while ((count = buffer->ring.PopBulk(popped)) > 0)
+                {
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        const auto& event = popped[i];
+                        const auto start = ToNanoseconds(event.start, scale);
+                        LiveEncodeEvent(events, start, ToNanoseconds(event.end, scale) - start, event.name, buffer->track, event.depth);
+                    }
+                    stats.eventsWritten += count;
+                }
+                stats.eventsDropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+                if (exited)
+                    finished.push_back(buffer.get());
+            }
+
+            std::string batch;
+            {
+                std::scoped_lock namesLock{ namesMutex };
+                batch.swap(pendingText);
+            }
+            batch += events;
+
+            if (!batch.empty())
+            {
+                if (sink->Write(batch))
+                {
+                    stats.bytesWritten += batch.size();
+                }
+                else
+                {
+                    stats.failed = true;
+                    enabled.store(false, std::memory_order_relaxed);
+                }
+            }
+
+            if (!finished.empty())
+            {
+                {
+                    std::scoped_lock buffersLock{ buffersMutex };
+                    std::erase_if(buffers, [&](const auto& buffer) { return std::ranges::find(finished, buffer.get()) != finished.end(); });
+                }
+                // Tracks of exited threads are reused, the protocol bounds their number
+                std::scoped_lock namesLock{ namesMutex };
+                for (const auto* buffer : finished)
+                    freeTracks.push_back(buffer->track);
+            }
+        }
+
+        [[nodiscard]] bool Enabled() const noexcept
+        {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] ClientStats Stats() const
+        {
+            std::scoped_lock lock{ flushMutex };
+            return stats;
+        }
+
+        // Names the calling thread's track, threads are "thread N" by default
+        void SetThreadName(const std::string_view name)
+        {
+            auto* const buffer = Local();
+            if (buffer == nullptr)
+                return;
+            std::scoped_lock lock{ namesMutex };
+            trackNames[buffer->track] = std::string{ name.substr(0, LiveMaxTextLength) };
+            LiveEncodeText(pendingText, LiveMessageType::TrackName, buffer->track, name);
+        }
+
+        // Called by Scope with times in Ticks(), drops the event if the ring is full
+        void Record(const char* const name, const std::int64_t start, const std::int64_t end, const std::uint16_t depth) noexcept
+        {
+            auto* const buffer = Local();
+            if (buffer == nullptr) [[unlikely]]
+                return;
+
+            auto& cached = buffer->names[(reinterpret_cast<std::uintptr_t>(name) >> 3) % NameCacheSize];
+            if (cached.first != name) [[unlikely]]
+            {
+                try
+                {
+                    cached = { name, Intern(name) };
+                }
+                catch (...)
+                {
+                    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            if (!buffer->ring.TryPush(EventRecord{ start, end, cached.second, depth })) [[unlikely]]
+                buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Timestamps of the scopes: the time stamp counter where there is one,
+        // as it costs a fraction of a clock read, converted on flush
+        static std::int64_t Ticks() noexcept
+        {
+#ifdef TAGLIATELLE_CLIENT_TSC
+            return static_cast<std::int64_t>(__rdtsc());
+#else
+            return Nanoseconds();
+#endif
+        }
+
+        static std::int64_t Nanoseconds() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+    private:
+        struct EventRecord
+        {
+            std::int64_t  start = 0; // ticks
+            std::int64_t  end   = 0;
+            std::uint32_t name  = 0;
+            std::uint16_t depth = 0;
+        };
+
+        struct ThreadBuffer
+        {
+            explicit ThreadBuffer(const std::uint32_t track)
+                : track{ track }
+            {
+            }
+
+            SpscRing<EventRecord, RingCapacity> ring;
+            const std::uint32_t                 track;
+            std::atomic<std::uint64_t>          dropped = 0;
+            std::atomic<bool>                   exited  = false; // the owning thread will not push again
+
+            // Owning thread only
+            std::array<std::pair<const char*, std::uint32_t>, NameCacheSize> names{};
+        };
+
+        // Marks the buffer as exited with its thread, the flusher drops it once drained
+        struct LocalBuffer
+        {
+            std::shared_ptr<ThreadBuffer> buffer;
+
+            ~LocalBuffer()
+            {
+                if (buffer)
+                    buffer->exited.store(true, std::memory_order_release);
+            }
+        };
+
+        Collector() = default;
+
+        ThreadBuffer* Local() noexcept
+        {
+            try
+            {
+                thread_local const LocalBuffer local{ Register() };
+                return local.buffer.get();
+            }
+            catch (...)
+            {
+                return nullptr;
+            }
+        }
+
+        std::shared_ptr<ThreadBuffer> Register()
+        {
+            std::uint32_t track = 0;
+            {
+                std::scoped_lock lock{ namesMutex };
+                if (freeTracks.empty())
+                {
+                    track = nextTrack++;
+                }
+                else
+                {
+                    track = freeTracks.back();
+                    freeTracks.pop_back();
+                }
+                trackNames[track] = "thread " + std::to_string(track);
+                LiveEncodeText(pendingText, LiveMessageType::TrackName, track, trackNames[track]);
+            }
+            auto buffer = std::make_shared<ThreadBuffer>(track);
+            std::scoped_lock lock{ buffersMutex };
+            buffers.push_back(buffer);
+            return buffer;
+        }
+
+        std::uint32_t Intern(const char* const name)
+        {
+            std::scoped_lock lock{ namesMutex };
+            const auto count = names.Size();
+            const auto id = names.Intern(std::string_view{ name }.substr(0, LiveMaxTextLength));
+            if (id == count)
+                LiveEncodeText(pendingText, LiveMessageType::Name, id, names.View(id));
+            return id;
+        }
+
+        // Measured over the whole session, which assumes an invariant counter
+        [[nodiscard]] double NanosecondsPerTick() const
+        {
+#ifdef TAGLIATELLE_CLIENT_TSC
+            const auto ticks = Ticks() - anchorTicks;
+            const auto nanoseconds = Nanoseconds() - anchorNanoseconds;
+            return ticks > 0 && nanoseconds > 0 ? static_cast<double>(nanoseconds) / static_cast<double>(ticks) : 1.0;
+#else
+            return 1.0;
+#endif
+        }
+
+        [[nodiscard]] std::int64_t ToNanoseconds(const std::int64_t ticks, const double scale) const
+        {
+#ifdef TAGLIATELLE_CLIENT_TSC
+            return anchorNanoseconds + static_cast<std::int64_t>(static_cast<double>(ticks - anchorTicks) * scale);
+#else
+            (void)scale;
+            return ticks;
+#endif
+        }
+
+        void FlushLoop(std::stop_token stop)
+        {
+            std::mutex waitMutex;
+            std::condition_variable_any wake;
+            std::unique_lock lock{ waitMutex };
+            while (!wake.wait_for(lock, stop, FlushInterval, [] { return false; }))
+            {
+                if (stop.stop_requested())
+                    break;
+                Flush();
+            }
+        }
+
+        std::atomic<bool> enabled = false;
+
+        // Names and their definitions not yet written, also the track names
+        std::mutex                                      namesMutex;
+        InternedTextBuffer<NamePageSize>                names; // by ID, resent on every Start()
+        std::unordered_map<std::uint32_t, std::string>  trackNames;
+        std::uint32_t                                   nextTrack = 0;
+        std::vector<std::uint32_t>                      freeTracks;
+        std::string                                     pendingText;
+
+        std::mutex                                 buffersMutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+        mutable std::mutex    flushMutex;
+        std::unique_ptr<Sink> sink;
+        ClientStats           stats;
+        std::int64_t          anchorTicks       = 0; // at Start(), for the conversion to nanoseconds
+        std::int64_t          anchorNanoseconds = 0;
+        std::jthread          flusher;
+    };
+
+    // Records the lifetime of the scope while the collector is started
+    class Scope
+    {
+    public:
+        explicit Scope(const char* const name) noexcept
+            : name{ Collector::Instance().Enabled() ? name : nullptr }
+        {
+            if (this->name != nullptr)
+            {
+                depth = Depth()++;
+                start = Collector::Ticks();
+            }
+        }
+
+        ~Scope()
+        {
+            if (name == nullptr)
+                return;
+            const auto end = Collector::Ticks();
+            --Depth();
+            Collector::Instance().Record(name, start, end, depth);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        static std::uint16_t& Depth() noexcept
+        {
+            thread_local std::uint16_t depth = 0;
+            return depth;
+        }
+
+        const char* const name;
+        std::uint16_t     depth = 0;
+        std::int64_t      start = 0;
+    };
+
+} // namespace tagliatelle::client
+
+#ifndef TAGLIATELLE_CLIENT_DISABLE
+
+    #define TAG_CLIENT_CONCAT2(a,b) a##b
+    #define TAG_CLIENT_CONCAT(a,b) TAG_CLIENT_CONCAT2(a,b)
+
+    // Times the rest of the enclosing scope, name must outlive the collector (a literal)
+    #define TAG_SCOPE(name) const ::tagliatelle::client::Scope TAG_CLIENT_CONCAT(tagScope_, __LINE__){ name }
+    #define TAG_FUNCTION() TAG_SCOPE(__func__)
+    #define TAG_THREAD_NAME(name) ::tagliatelle::client::Collector::Instance().SetThreadName(name)
+
+#else
+
+    #define TAG_SCOPE(name)
+    #define TAG_FUNCTION()
+    #define TAG_THREAD_NAME(name)
+
+#endif
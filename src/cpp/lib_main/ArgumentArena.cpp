@@ -0,0 +1,115 @@
+#include "ArgumentArena.hpp"
+
+#include <algorithm> // std::ranges::copy
+#include <memory>    // std::uninitialized_default_construct_n
+#include <utility>   // std::move
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        bool IsNumber(const Argument& argument)
+        {
+            return argument.type == ArgumentType::Int || argument.type == ArgumentType::Double;
+        }
+
+        double AsDouble(const Argument& argument)
+        {
+            return argument.type == ArgumentType::Int ? static_cast<double>(argument.integer) : argument.number;
+        }
+
+        // -1, 0 or 1, or 2 if the values are not comparable
+        int Compare(const Argument& lhs, const Argument& rhs)
+        {
+            if (lhs.type == ArgumentType::Int && rhs.type == ArgumentType::Int)
+                return (lhs.integer > rhs.integer) - (lhs.integer < rhs.integer);
+            if (IsNumber(lhs) && IsNumber(rhs))
+            {
+                const auto l = AsDouble(lhs);
+                const auto r = AsDouble(rhs);
+                return l < r ? -1 : l > r ? 1 : l == r ? 0 : 2;
+            }
+            if (lhs.type != rhs.type)
+                return 2;
+
+            switch (lhs.type)
+            {
+            case ArgumentType::Null:
+                return 0;
+            case ArgumentType::Bool:
+                return lhs.boolean == rhs.boolean ? 0 : 2;
+            case ArgumentType::String:
+                return lhs.text == rhs.text ? 0 : 2;
+            default: // objects are never equal
+                return 2;
+            }
+        }
+    }
+
+    ArgumentArena::ArgumentArena(MemoryBudget* const budget)
+        : allocator{ budget }
+    {
+    }
+
+    ArgumentOffset ArgumentArena::Append(const std::span<const Argument> arguments)
+    {
+        ASSERT((arguments.size() <= PageRecords), "ArgumentArena: too many arguments for one event");
+        if (arguments.empty())
+            return 0;
+
+        if (pages.empty() || PageRecords - used < arguments.size())
+        {
+            std::unique_ptr<Argument[], PageDeleter> page{ allocator.allocate(PageRecords), PageDeleter{ allocator } };
+            std::uninitialized_default_construct_n(page.get(), PageRecords);
+            pages.push_back(std::move(page));
+            used = 0;
+        }
+
+        const auto offset = static_cast<ArgumentOffset>((pages.size() - 1) * PageRecords + used);
+        std::ranges::copy(arguments, pages.back().get() + used);
+        used += arguments.size();
+        return offset;
+    }
+
+    void ArgumentArena::Clear()
+    {
+        pages.clear();
+        used = 0;
+    }
+
+    const Argument* FindArgument(const std::span<const Argument> arguments, const std::uint32_t key)
+    {
+        for (std::size_t i = 0; i < arguments.size(); ++i)
+        {
+            if (arguments[i].key == key)
+                return &arguments[i];
+            if (arguments[i].type == ArgumentType::Object)
+                i += arguments[i].size;
+        }
+        return nullptr;
+    }
+
+    bool ArgumentFilter::Matches(const std::span<const Argument> arguments) const
+    {
+        const auto* argument = FindArgument(arguments, key);
+        if (argument == nullptr)
+            return op == ArgumentOp::NotEqual;
+
+        switch (op)
+        {
+        case ArgumentOp::Exists:
+            return true;
+        case ArgumentOp::Equal:
+            return Compare(*argument, value) == 0;
+        case ArgumentOp::NotEqual:
+            return Compare(*argument, value) != 0;
+        case ArgumentOp::Less:
+            return IsNumber(*argument) && IsNumber(value) && Compare(*argument, value) == -1;
+        case ArgumentOp::Greater:
+            return IsNumber(*argument) && IsNumber(value) && Compare(*argument, value) == 1;
+        }
+        return false;
+    }
+
+} // namespace tagliatelle
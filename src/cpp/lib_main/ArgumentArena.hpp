@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "MemoryBudget.hpp"
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    enum class ArgumentType : std::uint8_t
+    {
+        Null,
+        Bool,
+        Int,
+        Double,
+        String,
+        Object, // followed by its members, see Argument::size
+    };
+
+    // One key/value record of an event's arguments.
+    // Keys and string values are IDs in the name table of the store that
+    // owns the arena, so string values are views into its text buffer.
+    // Nested objects are flattened in preorder: an Object record is followed
+    // by the `size` records of its members, including nested ones.
+    // Arrays are stored as objects keyed "0", "1", ...
+    struct Argument
+    {
+        std::uint32_t key  = 0;
+        ArgumentType  type = ArgumentType::Null;
+        union
+        {
+            bool          boolean;
+            std::int64_t  integer;
+            double        number;
+            std::uint32_t text; // name ID
+            std::uint32_t size; // member records of an object
+        };
+
+        Argument()
+            : integer{ 0 }
+        {
+        }
+    };
+
+    static_assert(sizeof(Argument) == 16);
+
+    using ArgumentOffset = std::uint32_t;
+
+    // Bump allocator of argument records.
+    // Each event's arguments are one contiguous run within a page, addressed
+    // by (offset, count); pages are never moved, so views stay valid until
+    // Clear(). Nothing is freed individually. Pages count towards the budget
+    // of the arena, if it has one.
+    class ArgumentArena
+    {
+    public:
+        static constexpr std::size_t PageRecords = 4096; // also the most records one event can have
+
+        ArgumentArena() = default;
+
+        // Pages are allocated from the budget, which must outlive the arena
+        explicit ArgumentArena(MemoryBudget* budget);
+
+        MOVE_ONLY(ArgumentArena);
+
+        // Copies the run to the arena and returns its offset, empty runs take no space
+        [[nodiscard]] ArgumentOffset Append(std::span<const Argument> arguments);
+
+        [[nodiscard]] std::span<const Argument> View(const ArgumentOffset offset, const std::size_t count) const
+        {
+            if (count == 0)
+                return {};
+            return std::span{ pages[offset / PageRecords].get() + offset % PageRecords, count };
+        }
+
+        [[nodiscard]] std::span<Argument> View(const ArgumentOffset offset, const std::size_t count)
+        {
+            if (count == 0)
+                return {};
+            return std::span{ pages[offset / PageRecords].get() + offset % PageRecords, count };
+        }
+
+        // Records allocated, including the unused tails of full pages
+        [[nodiscard]] std::size_t Size() const
+        {
+            return pages.empty() ? 0 : (pages.size() - 1) * PageRecords + used;
+        }
+
+        // Deallocates all pages
+        void Clear();
+
+        // Bytes of the pages
+        [[nodiscard]] std::size_t CapacityBytes() const
+        {
+            return pages.size() * PageRecords * sizeof(Argument);
+        }
+
+    private:
+        struct PageDeleter
+        {
+            BudgetAllocator<Argument> allocator;
+
+            void operator()(Argument* const page) const
+            {
+                BudgetAllocator<Argument>{ allocator }.deallocate(page, PageRecords);
+            }
+        };
+
+        BudgetAllocator<Argument>                             allocator;
+        std::vector<std::unique_ptr<Argument[], PageDeleter>> pages;
+        std::size_t                                           used = 0; // records in the last page
+    };
+
+    // Top-level argument with the key, nullptr if there is none.
+    // Members of nested objects are skipped, search ObjectMembers() for them.
+    [[nodiscard]] const Argument* FindArgument(std::span<const Argument> arguments, std::uint32_t key);
+
+    // Members of an Object record, which must be inside an arena run
+    [[nodiscard]] inline std::span<const Argument> ObjectMembers(const Argument& object)
+    {
+        ASSERT((object.type == ArgumentType::Object), "ObjectMembers: argument is not an object");
+        return std::span{ &object + 1, object.size };
+    }
+
+    enum class ArgumentOp : std::uint8_t
+    {
+        Exists,
+        Equal,
+        NotEqual,
+        Less,
+        Greater,
+    };
+
+    // Predicate on one top-level argument of an event.
+    // Ints and doubles compare by value, strings by ID; Less and Greater
+    // only hold for numbers. NotEqual holds when the key is missing.
+    struct ArgumentFilter
+    {
+        std::uint32_t key = 0;
+        ArgumentOp    op  = ArgumentOp::Exists;
+        Argument      value;
+
+        [[nodiscard]] bool Matches(std::span<const Argument> arguments) const;
+    };
+
+} // namespace tagliatelle
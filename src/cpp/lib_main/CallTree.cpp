@@ -0,0 +1,224 @@
+#include "CallTree.hpp"
+
+#include <algorithm> // std::max, std::min, std::ranges::sort
+#include <unordered_map>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        struct Draft
+        {
+            NameId        name;
+            std::uint32_t parent;
+        };
+
+        // Calls fn(EventIndex) for every span overlapping to but not from, the windows must intersect
+        template <typename F>
+        void ForEachEntering(const EventStore& events, const IntervalIndex& intervals, const Timestamp fromFirst, const Timestamp fromLast,
+                             const Timestamp toFirst, const Timestamp toLast, F&& fn)
+        {
+            const auto timestamps = events.Timestamps();
+            const auto durations = events.Durations();
+            for (TrackId track = 0; track < intervals.TrackCount(); ++track)
+            {
+                // Spans crossing a border of from are reported and skipped, at most one per depth
+                if (toFirst < fromFirst)
+                {
+                    intervals.ForEachOverlap(track, toFirst, std::min(toLast, fromFirst - 1), [&](const std::uint32_t event)
+                        {
+                            if (timestamps[event] + durations[event] < fromFirst)
+                                fn(event);
+                        });
+                }
+                if (toLast > fromLast)
+                {
+                    intervals.ForEachOverlap(track, std::max(toFirst, fromLast + 1), toLast, [&](const std::uint32_t event)
+                        {
+                            if (timestamps[event] > fromLast)
+                                fn(event);
+                        });
+                }
+            }
+        }
+    }
+
+    void CallTree::Build(const EventStore& events)
+    {
+        PROFILE_SCOPE("CallTree::Build");
+        const auto timestamps = events.Timestamps();
+        const auto durations = events.Durations();
+        const auto names = events.NameIds();
+        const auto tracks = events.Tracks();
+        const auto depths = events.Depths();
+
+        eventNodes.assign(events.Size(), 0);
+        eventSelf.assign(durations.begin(), durations.end());
+        selection.reset();
+
+        // Nodes are keyed by (parent, name) while merging, then renumbered in preorder
+        std::vector<Draft> drafts;
+        std::unordered_map<std::uint64_t, std::uint32_t> lookup;
+        std::vector<std::vector<std::uint32_t>> stacks(events.TrackCount());
+        for (std::uint32_t i = 0; i < events.Size(); ++i)
+        {
+            auto& stack = stacks[tracks[i]];
+            while (!stack.empty() && (depths[stack.back()] >= depths[i] || timestamps[stack.back()] + durations[stack.back()] < timestamps[i]))
+                stack.pop_back();
+
+            auto parent = NoParent;
+            if (!stack.empty())
+            {
+                parent = eventNodes[stack.back()];
+                eventSelf[stack.back()] -= durations[i];
+            }
+
+            const auto key = (std::uint64_t{ parent + 1u } << 32) | names[i];
+            const auto [it, inserted] = lookup.try_emplace(key, static_cast<std::uint32_t>(drafts.size()));
+            if (inserted)
+                drafts.push_back(Draft{ names[i], parent });
+            eventNodes[i] = it->second;
+            stack.push_back(i);
+        }
+        for (auto& self : eventSelf)
+            self = std::max<Duration>(self, 0);
+
+        // Children in order of appearance, slot 0 holds the top level and slot n + 1 the children of node n
+        const auto slot = [](const std::uint32_t parent) { return parent + 1u; };
+        std::vector<std::uint32_t> childBegin(drafts.size() + 2, 0);
+        for (const auto& draft : drafts)
+            ++childBegin[slot(draft.parent) + 1];
+        for (std::size_t i = 1; i < childBegin.size(); ++i)
+            childBegin[i] += childBegin[i - 1];
+        std::vector<std::uint32_t> children(drafts.size());
+        auto cursor = childBegin;
+        for (std::uint32_t i = 0; i < drafts.size(); ++i)
+            children[cursor[slot(drafts[i].parent)]++] = i;
+
+        std::vector<std::uint32_t> renumber(drafts.size());
+        nodes.clear();
+        nodes.reserve(drafts.size());
+        std::vector<std::uint32_t> pending;
+        const auto pushChildren = [&](const std::uint32_t parent)
+            {
+                for (auto i = childBegin[slot(parent) + 1]; i > childBegin[slot(parent)]; --i)
+                    pending.push_back(children[i - 1]);
+            };
+        pushChildren(NoParent);
+        while (!pending.empty())
+        {
+            const auto draft = pending.back();
+            pending.pop_back();
+
+            const auto& d = drafts[draft];
+            const auto parent = d.parent == NoParent ? NoParent : renumber[d.parent];
+            const auto depth = parent == NoParent ? 0 : nodes[parent].depth + 1;
+            renumber[draft] = static_cast<std::uint32_t>(nodes.size());
+            nodes.push_back(CallTreeNode{ d.name, parent, depth, 0, 0, 0, 0 });
+            pushChildren(draft);
+        }
+
+        for (auto i = nodes.size(); i-- > 0;)
+        {
+            if (nodes[i].parent != NoParent)
+                nodes[nodes[i].parent].descendants += nodes[i].descendants + 1;
+        }
+        for (auto& node : eventNodes)
+            node = renumber[node];
+    }
+
+    void CallTree::Select(const EventStore& events, const IntervalIndex& intervals, const Timestamp first, const Timestamp last)
+    {
+        PROFILE_SCOPE("CallTree::Select");
+        if (first > last)
+        {
+            ClearSelection();
+            return;
+        }
+
+        // A jump to a disjoint window changes every span anyway
+        if (!selection || last < selection->first || first > selection->last)
+        {
+            ClearSelection();
+            for (TrackId track = 0; track < intervals.TrackCount(); ++track)
+                intervals.ForEachOverlap(track, first, last, [&](const std::uint32_t event) { Apply(events, event, true); });
+        }
+        else
+        {
+            const auto old = *selection;
+            ForEachEntering(events, intervals, old.first, old.last, first, last, [&](const std::uint32_t event) { Apply(events, event, true); });
+            ForEachEntering(events, intervals, first, last, old.first, old.last, [&](const std::uint32_t event) { Apply(events, event, false); });
+        }
+        selection = Window{ first, last };
+    }
+
+    void CallTree::ClearSelection()
+    {
+        for (auto& node : nodes)
+        {
+            node.count = 0;
+            node.inclusive = 0;
+            node.self = 0;
+        }
+        selection.reset();
+    }
+
+    void CallTree::Apply(const EventStore& events, const std::uint32_t event, const bool add)
+    {
+        auto& node = nodes[eventNodes[event]];
+        const auto duration = events.Durations()[event];
+        if (add)
+        {
+            ++node.count;
+            node.inclusive += duration;
+            node.self += eventSelf[event];
+        }
+        else
+        {
+            --node.count;
+            node.inclusive -= duration;
+            node.self -= eventSelf[event];
+        }
+    }
+
+    std::vector<NameStats> CallTree::SelfTimeByName() const
+    {
+        std::unordered_map<NameId, NameStats> byName;
+        std::unordered_map<NameId, std::uint32_t> onPath;
+        std::vector<std::uint32_t> path;
+        for (std::uint32_t i = 0; i < nodes.size(); ++i)
+        {
+            const auto& node = nodes[i];
+            while (path.size() > node.depth)
+            {
+                --onPath[nodes[path.back()].name];
+                path.pop_back();
+            }
+
+            if (node.count > 0)
+            {
+                auto& stats = byName.try_emplace(node.name, NameStats{ node.name, 0, 0, 0 }).first->second;
+                stats.count += node.count;
+                stats.self += node.self;
+                if (onPath[node.name] == 0)
+                    stats.total += node.inclusive;
+            }
+            ++onPath[node.name];
+            path.push_back(i);
+        }
+
+        std::vector<NameStats> result;
+        result.reserve(byName.size());
+        for (const auto& [name, stats] : byName)
+            result.push_back(stats);
+        std::ranges::sort(result, [](const NameStats& lhs, const NameStats& rhs)
+            {
+                return lhs.self != rhs.self ? lhs.self > rhs.self : lhs.name < rhs.name;
+            });
+        return result;
+    }
+
+} // namespace tagliatelle
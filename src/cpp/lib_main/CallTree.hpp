@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "EventStore.hpp"
+#include "IntervalIndex.hpp"
+
+namespace tagliatelle
+{
+
+    // A call stack of the merged tree with the weights of the selected spans
+    struct CallTreeNode
+    {
+        NameId        name;
+        std::uint32_t parent;      // NoParent for top-level frames
+        std::uint32_t depth;
+        std::uint32_t descendants; // the subtree is made of the next descendants nodes
+        std::uint64_t count;
+        Duration      inclusive;
+        Duration      self;
+    };
+
+    // Merged call tree of the nested spans of all tracks, the data behind a
+    // flame graph. Every span is mapped to the node of its stack once, so
+    // selecting a time range only adds up weights: the spans overlapping the
+    // range are counted with their full duration and their self time, which
+    // is the duration not covered by direct children. Moving the selection
+    // touches only the spans entering or leaving it, found through the
+    // interval index, so dragging costs O(changed spans + depth).
+    // Nodes are laid out in preorder with children in order of appearance,
+    // the layout does not change with the selection.
+    class CallTree
+    {
+    public:
+        static constexpr std::uint32_t NoParent = std::numeric_limits<std::uint32_t>::max();
+
+        CallTree() = default;
+
+        MOVE_ONLY(CallTree);
+
+        // Rebuilds the tree and clears the selection, events must not change until the next Build
+        void Build(const EventStore& events);
+
+        // Selects the spans overlapping [first, last], the index must belong to the same events
+        void Select(const EventStore& events, const IntervalIndex& intervals, Timestamp first, Timestamp last);
+        void ClearSelection();
+
+        [[nodiscard]] std::span<const CallTreeNode> Nodes() const
+        {
+            return nodes;
+        }
+
+        // Selected time per name ordered by self time, recursive frames count once towards the total
+        [[nodiscard]] std::vector<NameStats> SelfTimeByName() const;
+
+    private:
+        struct Window
+        {
+            Timestamp first;
+            Timestamp last;
+        };
+
+        void Apply(const EventStore& events, std::uint32_t event, bool add);
+
+        std::vector<CallTreeNode>  nodes;
+        std::vector<std::uint32_t> eventNodes;
+        std::vector<Duration>      eventSelf;
+        std::optional<Window>      selection;
+    };
+
+} // namespace tagliatelle
@@ -0,0 +1,944 @@
+#include "ChromeTraceImporter.hpp"
+
+#include <algorithm> // std::sort, std::max, std::min
+#include <charconv>  // std::from_chars, std::to_chars
+#include <cmath>     // std::llround
+#include <functional>
+#include <iterator>  // std::begin, std::end
+#include <limits>
+#include <numeric>   // std::iota
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>   // std::exchange
+#include <vector>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        constexpr TrackId NoTrack = std::numeric_limits<TrackId>::max();
+
+        bool IsWhitespace(const char c)
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        std::string_view Trim(std::string_view str)
+        {
+            while (!str.empty() && IsWhitespace(str.front()))
+                str.remove_prefix(1);
+            while (!str.empty() && IsWhitespace(str.back()))
+                str.remove_suffix(1);
+            return str;
+        }
+
+        // Microseconds, usually with up to three decimals, to nanoseconds
+        bool ParseMicros(const std::string_view text, std::int64_t& ns)
+        {
+            const char* const begin = text.data();
+            const char* const end = begin + text.size();
+
+            std::int64_t whole = 0;
+            auto [p, error] = std::from_chars(begin, end, whole);
+            if (error == std::errc{} && (whole < std::numeric_limits<std::int64_t>::max() / 1000 && whole > std::numeric_limits<std::int64_t>::min() / 1000))
+            {
+                if (p == end)
+                {
+                    ns = whole * 1000;
+                    return true;
+                }
+
+                if (*p == '.')
+                {
+                    ++p;
+                    std::int64_t fraction = 0;
+                    int digits = 0;
+                    for (; p != end && *p >= '0' && *p <= '9' && digits < 3; ++p, ++digits)
+                        fraction = fraction * 10 + (*p - '0');
+                    for (; digits < 3; ++digits)
+                        fraction *= 10;
+                    if (p != end && *p >= '5' && *p <= '9')
+                        ++fraction;
+                    while (p != end && *p >= '0' && *p <= '9')
+                        ++p;
+                    if (p == end)
+                    {
+                        ns = text.front() == '-' ? whole * 1000 - fraction : whole * 1000 + fraction;
+                        return true;
+                    }
+                }
+            }
+
+            // Exponents and out of range values
+            double value = 0;
+            const auto [q, fpError] = std::from_chars(begin, end, value);
+            if (fpError != std::errc{} || q != end || !std::isfinite(value) || std::abs(value) >= 9.2e15)
+                return false;
+            ns = std::llround(value * 1000.0);
+            return true;
+        }
+
+        void AppendUtf8(std::string& out, const std::uint32_t codePoint)
+        {
+            if (codePoint < 0x80)
+            {
+                out += static_cast<char>(codePoint);
+            }
+            else if (codePoint < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        bool ParseHex4(const std::string_view str, const std::size_t pos, std::uint32_t& value)
+        {
+            if (pos + 4 > str.size())
+                return false;
+            const auto [p, error] = std::from_chars(str.data() + pos, str.data() + pos + 4, value, 16);
+            return error == std::errc{} && p == str.data() + pos + 4;
+        }
+
+        // Decodes JSON escapes, returns the raw text if there are none
+        std::string_view Unescape(const std::string_view raw, std::string& scratch)
+        {
+            auto backslash = raw.find('\\');
+            if (backslash == std::string_view::npos) [[likely]]
+                return raw;
+
+            scratch.assign(raw.substr(0, backslash));
+            for (std::size_t i = backslash; i < raw.size(); ++i)
+            {
+                if (raw[i] != '\\' || i + 1 == raw.size())
+                {
+                    scratch += raw[i];
+                    continue;
+                }
+
+                switch (const char c = raw[++i])
+                {
+                case 'b': scratch += '\b'; break;
+                case 'f': scratch += '\f'; break;
+                case 'n': scratch += '\n'; break;
+                case 'r': scratch += '\r'; break;
+                case 't': scratch += '\t'; break;
+                case 'u':
+                {
+                    std::uint32_t codePoint = 0;
+                    if (!ParseHex4(raw, i + 1, codePoint))
+                    {
+                        scratch += c;
+                        break;
+                    }
+                    i += 4;
+
+                    std::uint32_t low = 0;
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00 && raw.substr(i + 1, 2) == "\\u" && ParseHex4(raw, i + 3, low) && low >= 0xDC00 && low < 0xE000)
+                    {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                    AppendUtf8(scratch, codePoint);
+                    break;
+                }
+                default: // '"', '\\', '/' and invalid escapes
+                    scratch += c;
+                    break;
+                }
+            }
+            return scratch;
+        }
+
+        // JSON literal or number as an argument value, false if it is neither
+        bool ParseScalar(const std::string_view text, Argument& argument)
+        {
+            if (text == "true" || text == "false")
+            {
+                argument.type = ArgumentType::Bool;
+                argument.boolean = text == "true";
+                return true;
+            }
+            if (text == "null")
+            {
+                argument.type = ArgumentType::Null;
+                return true;
+            }
+
+            const char* const end = text.data() + text.size();
+            std::int64_t integer = 0;
+            if (const auto [p, error] = std::from_chars(text.data(), end, integer); error == std::errc{} && p == end)
+            {
+                argument.type = ArgumentType::Int;
+                argument.integer = integer;
+                return true;
+            }
+            // Fractions, exponents and integers out of range
+            double number = 0;
+            if (const auto [p, error] = std::from_chars(text.data(), end, number); error == std::errc{} && p == end)
+            {
+                argument.type = ArgumentType::Double;
+                argument.number = number;
+                return true;
+            }
+            return false;
+        }
+
+        struct StringHash
+        {
+            using is_transparent = void;
+
+            std::size_t operator()(const std::string_view str) const
+            {
+                return std::hash<std::string_view>{}(str);
+            }
+        };
+
+        using StringMap = std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>>;
+
+        class ChromeImporter
+        {
+        public:
+            // Without a sink everything goes into out
+            ChromeImporter(const std::string_view json, ParsedChunk& out, std::atomic<std::uint64_t>* bytesScanned, const JsonScanKernel kernel,
+                           const std::size_t chunkEvents = 0, const ChunkSink* sink = nullptr)
+                : json{ json }
+                , scanner{ json, kernel }
+                , out{ out }
+                , bytesScanned{ bytesScanned }
+                , chunkEvents{ chunkEvents }
+                , sink{ sink }
+            {
+            }
+
+            void Run()
+            {
+                try
+                {
+                    Parse();
+                }
+                catch (const Cancelled&)
+                {
+                }
+            }
+
+        private:
+            struct Cancelled
+            {
+            };
+
+            void Parse()
+            {
+                const auto first = scanner.Next();
+                if (first == JsonStructuralScanner::npos)
+                    throw std::runtime_error("ChromeTraceImporter: empty document");
+
+                if (json[first] == '[')
+                {
+                    ParseEvents();
+                }
+                else if (json[first] == '{')
+                {
+                    ForEachMember([this](const std::string_view key, const std::size_t colon)
+                        {
+                            if (key == "traceEvents")
+                            {
+                                if (json[NextOrThrow()] != '[')
+                                    throw std::runtime_error("ChromeTraceImporter: traceEvents is not an array");
+                                ParseEvents();
+                            }
+                            else
+                            {
+                                (void)ReadValue(colon);
+                            }
+                        });
+                }
+                else
+                {
+                    throw std::runtime_error("ChromeTraceImporter: document is neither an object nor an array");
+                }
+
+                Finish();
+            }
+
+            enum class ValueKind { String, Scalar, Composite };
+
+            struct Value
+            {
+                ValueKind        kind = ValueKind::Scalar;
+                std::string_view text;
+            };
+
+            struct RawEvent
+            {
+                Value name, phase, pid, tid, ts, dur, args;
+                Value cat, id, bp; // of flow events
+            };
+
+            struct ArgumentRun
+            {
+                ArgumentOffset offset = 0;
+                std::uint16_t  count  = 0;
+            };
+
+            struct OpenSpan
+            {
+                Timestamp   timestamp;
+                NameId      name;
+                ArgumentRun arguments;
+            };
+
+            struct TrackInfo
+            {
+                std::string pid;
+                std::string tid;
+                std::string threadName;
+                bool        renamed = true; // since the name was last emitted
+
+                // Nesting of the spans of earlier chunks
+                std::vector<Timestamp> ends;
+                Timestamp              lastStart    = std::numeric_limits<Timestamp>::min();
+                Duration               lastDuration = 0;
+                bool                   provisional  = false;
+            };
+
+            std::size_t NextOrThrow()
+            {
+                const auto pos = scanner.Next();
+                if (pos == JsonStructuralScanner::npos)
+                    throw std::runtime_error("ChromeTraceImporter: unexpected end of document");
+                return pos;
+            }
+
+            std::size_t PeekOrThrow()
+            {
+                const auto pos = scanner.Peek();
+                if (pos == JsonStructuralScanner::npos)
+                    throw std::runtime_error("ChromeTraceImporter: unexpected end of document");
+                return pos;
+            }
+
+            // Raw contents of the next string, escapes are not decoded
+            std::string_view ReadString()
+            {
+                const auto open = NextOrThrow();
+                if (json[open] != '"')
+                    throw std::runtime_error("ChromeTraceImporter: expected a string");
+                const auto close = NextOrThrow();
+                return json.substr(open + 1, close - open - 1);
+            }
+
+            // Consumes the value following the colon
+            Value ReadValue(const std::size_t colon)
+            {
+                const auto next = PeekOrThrow();
+                const auto scalar = Trim(json.substr(colon + 1, next - colon - 1));
+                if (!scalar.empty())
+                    return Value{ ValueKind::Scalar, scalar };
+
+                switch (json[next])
+                {
+                case '"':
+                    return Value{ ValueKind::String, ReadString() };
+                case '{':
+                case '[':
+                {
+                    std::size_t depth = 0;
+                    std::size_t pos = next;
+                    do
+                    {
+                        pos = NextOrThrow();
+                        const char c = json[pos];
+                        if (c == '{' || c == '[')
+                            ++depth;
+                        else if (c == '}' || c == ']')
+                            --depth;
+                    } while (depth > 0);
+                    return Value{ ValueKind::Composite, json.substr(next, pos - next + 1) };
+                }
+                default:
+                    throw std::runtime_error("ChromeTraceImporter: missing value");
+                }
+            }
+
+            // Calls fn(key, colon) for each member of an object whose '{' was consumed,
+            // fn must consume the value
+            template <typename F>
+            void ForEachMember(F&& fn)
+            {
+                if (json[PeekOrThrow()] == '}')
+                {
+                    (void)scanner.Next();
+                    return;
+                }
+
+                while (true)
+                {
+                    const auto key = ReadString();
+                    const auto colon = NextOrThrow();
+                    if (json[colon] != ':')
+                        throw std::runtime_error("ChromeTraceImporter: expected ':'");
+                    fn(key, colon);
+
+                    const auto separator = NextOrThrow();
+                    if (json[separator] == '}')
+                        return;
+                    if (json[separator] != ',')
+                        throw std::runtime_error("ChromeTraceImporter: expected ',' or '}'");
+                }
+            }
+
+            // Parses the elements of an event array whose '[' was consumed.
+            // A missing closing bracket is tolerated, as traces are often cut short.
+            void ParseEvents()
+            {
+                const auto first = scanner.Peek();
+                if (first == JsonStructuralScanner::npos)
+                    return;
+                if (json[first] == ']')
+                {
+                    (void)scanner.Next();
+                    return;
+                }
+
+                for (std::uint64_t count = 1;; ++count)
+                {
+                    const auto open = scanner.Next();
+                    if (open == JsonStructuralScanner::npos)
+                        return;
+                    if (json[open] != '{')
+                        throw std::runtime_error("ChromeTraceImporter: event is not an object");
+
+                    RawEvent event;
+                    ForEachMember([this, &event](const std::string_view key, const std::size_t colon)
+                        {
+                            const auto value = ReadValue(colon);
+                            if (key == "name")
+                                event.name = value;
+                            else if (key == "ph")
+                                event.phase = value;
+                            else if (key == "ts")
+                                event.ts = value;
+                            else if (key == "dur")
+                                event.dur = value;
+                            else if (key == "pid")
+                                event.pid = value;
+                            else if (key == "tid")
+                                event.tid = value;
+                            else if (key == "args")
+                                event.args = value;
+                            else if (key == "cat")
+                                event.cat = value;
+                            else if (key == "id")
+                                event.id = value;
+                            else if (key == "bp")
+                                event.bp = value;
+                        });
+                    Commit(event);
+                    if (sink != nullptr && out.columns.Size() + out.counters.size() + out.flows.size() >= chunkEvents)
+                        Flush();
+
+                    if (bytesScanned != nullptr && count % 4096 == 0)
+                        bytesScanned->store(scanner.Scanned(), std::memory_order_relaxed);
+
+                    const auto separator = scanner.Next();
+                    if (separator == JsonStructuralScanner::npos || json[separator] == ']')
+                        return;
+                    if (json[separator] != ',')
+                        throw std::runtime_error("ChromeTraceImporter: expected ',' or ']'");
+                }
+            }
+
+            // NoTrack once there are MaxTracks tracks
+            TrackId Track(const Value& pid, const Value& tid)
+            {
+                trackKey.assign(pid.text);
+                trackKey += '\x1f';
+                trackKey += tid.text;
+
+                const auto it = tracks.find(std::string_view{ trackKey });
+                if (it != tracks.end()) [[likely]]
+                    return it->second;
+
+                if (trackInfos.size() >= EventStore::MaxTracks)
+                    return NoTrack;
+                const auto track = static_cast<TrackId>(trackInfos.size());
+                tracks.emplace(trackKey, track);
+                auto& info = trackInfos.emplace_back();
+                info.pid = pid.text;
+                info.tid = tid.text;
+                openSpans.emplace_back();
+                return track;
+            }
+
+            NameId Name(const Value& name)
+            {
+                return out.names.Intern(Unescape(name.text, scratch));
+            }
+
+            // Value of the "name" member of an args object
+            std::string ArgsName(const Value& args)
+            {
+                if (args.kind != ValueKind::Composite || args.text.front() != '{')
+                    return {};
+
+                JsonStructuralScanner argsScanner{ args.text };
+                std::size_t pos = argsScanner.Next();
+                while ((pos = argsScanner.Next()) != JsonStructuralScanner::npos)
+                {
+                    if (args.text[pos] != '"')
+                        continue;
+                    const auto close = argsScanner.Next();
+                    const auto colon = argsScanner.Next();
+                    if (close == JsonStructuralScanner::npos || colon == JsonStructuralScanner::npos || args.text[colon] != ':')
+                        return {};
+                    const auto key = args.text.substr(pos + 1, close - pos - 1);
+                    const auto valueOpen = argsScanner.Next();
+                    if (key == "name" && valueOpen != JsonStructuralScanner::npos && args.text[valueOpen] == '"')
+                    {
+                        const auto valueClose = argsScanner.Next();
+                        if (valueClose == JsonStructuralScanner::npos)
+                            return {};
+                        return std::string{ Unescape(args.text.substr(valueOpen + 1, valueClose - valueOpen - 1), scratch) };
+                    }
+                    // Only flat args objects are searched
+                    if (valueOpen == JsonStructuralScanner::npos || args.text[valueOpen] != '"')
+                        continue;
+                    (void)argsScanner.Next();
+                }
+                return {};
+            }
+
+            // Flattens an args object into the chunk's arena. Arrays become objects
+            // keyed by index. Malformed args and events with more records than
+            // an arena page holds get none.
+            ArgumentRun Arguments(const Value& args)
+            {
+                if (args.kind != ValueKind::Composite || args.text.front() != '{')
+                    return {};
+
+                arguments.clear();
+                JsonStructuralScanner argsScanner{ args.text };
+                if (!ParseMembers(argsScanner, args.text, argsScanner.Next(), 0) || arguments.size() > ArgumentArena::PageRecords)
+                    return {};
+                return ArgumentRun{ out.arguments.Append(arguments), static_cast<std::uint16_t>(arguments.size()) };
+            }
+
+            // Appends the records of the members of the object or array opened at open,
+            // returns false on malformed or too deeply nested input
+            bool ParseMembers(JsonStructuralScanner& argsScanner, const std::string_view text, const std::size_t open, const int depth)
+            {
+                constexpr int MaxDepth = 32;
+                const bool array = text[open] == '[';
+                const char close = array ? ']' : '}';
+                if (depth > MaxDepth)
+                    return false;
+
+                auto before = open; // structural character preceding the next value
+                for (std::uint32_t index = 0;; ++index)
+                {
+                    Argument argument;
+                    if (array)
+                    {
+                        char digits[16];
+                        const auto [end, error] = std::to_chars(std::begin(digits), std::end(digits), index);
+                        argument.key = out.names.Intern(std::string_view{ digits, static_cast<std::size_t>(end - digits) });
+                    }
+                    else
+                    {
+                        const auto quote = argsScanner.Next();
+                        if (quote == JsonStructuralScanner::npos)
+                            return false;
+                        if (index == 0 && text[quote] == close)
+                            return true;
+                        const auto keyEnd = argsScanner.Next();
+                        before = argsScanner.Next();
+                        if (text[quote] != '"' || keyEnd == JsonStructuralScanner::npos || before == JsonStructuralScanner::npos || text[before] != ':')
+                            return false;
+                        argument.key = out.names.Intern(Unescape(text.substr(quote + 1, keyEnd - quote - 1), scratch));
+                    }
+
+                    const auto next = argsScanner.Peek();
+                    if (next == JsonStructuralScanner::npos)
+                        return false;
+                    const auto scalar = Trim(text.substr(before + 1, next - before - 1));
+                    if (!scalar.empty())
+                    {
+                        if (!ParseScalar(scalar, argument))
+                            return false;
+                        arguments.push_back(argument);
+                    }
+                    else if (text[next] == '"')
+                    {
+                        (void)argsScanner.Next();
+                        const auto valueEnd = argsScanner.Next();
+                        if (valueEnd == JsonStructuralScanner::npos)
+                            return false;
+                        argument.type = ArgumentType::String;
+                        argument.text = out.names.Intern(Unescape(text.substr(next + 1, valueEnd - next - 1), scratch));
+                        arguments.push_back(argument);
+                    }
+                    else if (text[next] == '{' || text[next] == '[')
+                    {
+                        (void)argsScanner.Next();
+                        const auto object = arguments.size();
+                        argument.type = ArgumentType::Object;
+                        arguments.push_back(argument);
+                        if (!ParseMembers(argsScanner, text, next, depth + 1))
+                            return false;
+                        arguments[object].size = static_cast<std::uint32_t>(arguments.size() - object - 1);
+                    }
+                    else if (array && index == 0 && text[next] == close)
+                    {
+                        (void)argsScanner.Next();
+                        return true;
+                    }
+                    else
+                    {
+                        return false;
+                    }
+
+                    before = argsScanner.Next();
+                    if (before == JsonStructuralScanner::npos)
+                        return false;
+                    if (text[before] == close)
+                        return true;
+                    if (text[before] != ',')
+                        return false;
+                }
+            }
+
+            void Emit(const Timestamp timestamp, const Duration duration, const NameId name, const TrackId track, const ArgumentRun run)
+            {
+                out.columns.PushBack(Event{ timestamp, duration, name, track, 0, run.offset, run.count });
+                lastTimestamp = std::max(lastTimestamp, timestamp + duration);
+            }
+
+            void Commit(const RawEvent& event)
+            {
+                if (event.phase.kind != ValueKind::String || event.phase.text.size() != 1)
+                {
+                    ++out.malformedRecords;
+                    return;
+                }
+
+                const char phase = event.phase.text.front();
+                if (phase == 'M')
+                {
+                    CommitMetadata(event);
+                    return;
+                }
+                if (phase != 'X' && phase != 'B' && phase != 'E' && phase != 'i' && phase != 'I' && phase != 'n' && phase != 'C'
+                    && phase != 's' && phase != 't' && phase != 'f')
+                    return; // async events are not spans
+
+                Timestamp timestamp = 0;
+                if (event.ts.kind != ValueKind::Scalar || !ParseMicros(event.ts.text, timestamp))
+                {
+                    ++out.malformedRecords;
+                    return;
+                }
+                if (phase == 'C')
+                {
+                    CommitCounter(event, timestamp);
+                    return;
+                }
+                if (phase == 's' || phase == 't' || phase == 'f')
+                {
+                    CommitFlow(event, phase, timestamp);
+                    return;
+                }
+
+                const auto track = Track(event.pid, event.tid);
+                if (track == NoTrack)
+                {
+                    ++out.malformedRecords;
+                    return;
+                }
+                switch (phase)
+                {
+                case 'X':
+                {
+                    Duration duration = 0;
+                    if (event.dur.kind == ValueKind::Scalar && !event.dur.text.empty() && (!ParseMicros(event.dur.text, duration) || duration < 0))
+                    {
+                        ++out.malformedRecords;
+                        return;
+                    }
+                    Emit(timestamp, duration, Name(event.name), track, Arguments(event.args));
+                    break;
+                }
+                case 'B':
+                    openSpans[track].push_back(OpenSpan{ timestamp, Name(event.name), Arguments(event.args) });
+                    break;
+                case 'E':
+                {
+                    auto& open = openSpans[track];
+                    if (open.empty() || open.back().timestamp > timestamp)
+                    {
+                        ++out.malformedRecords;
+                        return;
+                    }
+                    Emit(open.back().timestamp, timestamp - open.back().timestamp, open.back().name, track, open.back().arguments);
+                    open.pop_back();
+                    break;
+                }
+                default: // instant events
+                    Emit(timestamp, 0, Name(event.name), track, Arguments(event.args));
+                    break;
+                }
+            }
+
+            // Every numeric member of args is a sample of the series "name.key",
+            // or of "name" if it is the only member
+            void CommitCounter(const RawEvent& event, const Timestamp timestamp)
+            {
+                arguments.clear();
+                if (event.args.kind != ValueKind::Composite || event.args.text.front() != '{')
+                {
+                    ++out.malformedRecords;
+                    return;
+                }
+                JsonStructuralScanner argsScanner{ event.args.text };
+                if (!ParseMembers(argsScanner, event.args.text, argsScanner.Next(), 0))
+                {
+                    ++out.malformedRecords;
+                    return;
+                }
+
+                std::size_t members = 0;
+                for (std::size_t i = 0; i < arguments.size(); i += arguments[i].type == ArgumentType::Object ? arguments[i].size + 1 : 1)
+                    ++members;
+
+                const std::string name{ Unescape(event.name.text, scratch) };
+                for (std::size_t i = 0; i < arguments.size(); i += arguments[i].type == ArgumentType::Object ? arguments[i].size + 1 : 1)
+                {
+                    const auto& argument = arguments[i];
+                    double value = 0;
+                    if (argument.type == ArgumentType::Int)
+                        value = static_cast<double>(argument.integer);
+                    else if (argument.type == ArgumentType::Double)
+                        value = argument.number;
+                    else
+                        continue;
+
+                    const auto series = members == 1 ? out.names.Intern(name) : out.names.Intern(name + '.' + std::string{ out.names.View(argument.key) });
+                    out.counters.push_back(CounterSample{ series, timestamp, value });
+                }
+            }
+
+            // Flows are matched by category, name and ID. Finish points bind to
+            // the next span unless "bp" is "e", as in chrome://tracing.
+            void CommitFlow(const RawEvent& event, const char phase, const Timestamp timestamp)
+            {
+                if (event.id.kind == ValueKind::Composite || event.id.text.empty())
+                {
+                    ++out.malformedRecords;
+                    return;
+                }
+
+                flowKey.assign(event.cat.text);
+                flowKey += '\x1f';
+                flowKey += event.name.text;
+                flowKey += '\x1f';
+                flowKey += event.id.text;
+                const auto track = Track(event.pid, event.tid);
+                if (track == NoTrack)
+                {
+                    ++out.malformedRecords;
+                    return;
+                }
+                const auto phaseOf = phase == 's' ? FlowPhase::Start : phase == 't' ? FlowPhase::Step : FlowPhase::End;
+                const bool enclosing = event.bp.kind == ValueKind::String && event.bp.text == "e";
+                out.flows.push_back(FlowPoint{ out.flowKeys.Intern(flowKey), timestamp, track, phaseOf, phase == 'f' && !enclosing });
+            }
+
+            void CommitMetadata(const RawEvent& event)
+            {
+                const auto kind = Unescape(event.name.text, scratch);
+                if (kind == "thread_name")
+                {
+                    const auto track = Track(event.pid, event.tid);
+                    if (track != NoTrack)
+                    {
+                        trackInfos[track].threadName = ArgsName(event.args);
+                        trackInfos[track].renamed = true;
+                    }
+                    else
+                    {
+                        ++out.malformedRecords;
+                    }
+                }
+                else if (kind == "process_name")
+                {
+                    processNames[std::string{ event.pid.text }] = ArgsName(event.args);
+                    for (auto& info : trackInfos)
+                        info.renamed |= info.pid == event.pid.text;
+                }
+            }
+
+            // Hands the chunk to the sink, spans still open move to the next chunk
+            void Flush()
+            {
+                AssignDepths();
+                EmitTrackNames();
+
+                ParsedChunk next;
+                std::vector<Argument> moved;
+                for (auto& trackSpans : openSpans)
+                {
+                    for (auto& open : trackSpans)
+                    {
+                        open.name = next.names.Intern(out.names.View(open.name));
+                        const auto run = out.arguments.View(open.arguments.offset, open.arguments.count);
+                        moved.assign(run.begin(), run.end());
+                        for (auto& argument : moved)
+                        {
+                            argument.key = next.names.Intern(out.names.View(argument.key));
+                            if (argument.type == ArgumentType::String)
+                                argument.text = next.names.Intern(out.names.View(argument.text));
+                        }
+                        open.arguments.offset = next.arguments.Append(moved);
+                    }
+                }
+
+                auto full = std::exchange(out, std::move(next));
+                if (!(*sink)(std::move(full)))
+                    throw Cancelled{};
+            }
+
+            void EmitTrackNames()
+            {
+                for (TrackId track = 0; track < trackInfos.size(); ++track)
+                {
+                    auto& info = trackInfos[track];
+                    if (!info.renamed)
+                        continue;
+                    const auto process = processNames.find(info.pid);
+                    std::string name = process != processNames.end() && !process->second.empty() ? process->second : "pid " + info.pid;
+                    name += " / ";
+                    name += info.threadName.empty() ? "tid " + info.tid : info.threadName;
+                    out.trackNames.emplace_back(track, out.names.Intern(name));
+                    info.renamed = false;
+                }
+            }
+
+            void Finish()
+            {
+                if (scanner.UnterminatedString())
+                    throw std::runtime_error("ChromeTraceImporter: unterminated string");
+
+                // Spans still open at the end of the capture last until its end
+                for (TrackId track = 0; track < openSpans.size(); ++track)
+                {
+                    for (const auto& open : openSpans[track])
+                        Emit(open.timestamp, std::max<Duration>(lastTimestamp - open.timestamp, 0), open.name, track, open.arguments);
+                }
+
+                AssignDepths();
+                EmitTrackNames();
+
+                if (bytesScanned != nullptr)
+                    bytesScanned->store(json.size(), std::memory_order_relaxed);
+                if (sink != nullptr)
+                    (void)(*sink)(std::move(out));
+            }
+
+            // Spans enclosing a span on the same track determine its depth,
+            // parents sort before their children as they start earlier or last longer.
+            // Spans of earlier chunks are only known by their ends, a span that
+            // sorts before them makes the depths of its track provisional.
+            void AssignDepths()
+            {
+                auto& columns = out.columns;
+                std::vector<std::uint32_t> order(columns.Size());
+                std::iota(order.begin(), order.end(), 0u);
+                std::sort(order.begin(), order.end(), [&columns](const std::uint32_t lhs, const std::uint32_t rhs)
+                    {
+                        if (columns.tracks[lhs] != columns.tracks[rhs])
+                            return columns.tracks[lhs] < columns.tracks[rhs];
+                        if (columns.timestamps[lhs] != columns.timestamps[rhs])
+                            return columns.timestamps[lhs] < columns.timestamps[rhs];
+                        return columns.durations[lhs] > columns.durations[rhs];
+                    });
+
+                for (const auto i : order)
+                {
+                    const auto timestamp = columns.timestamps[i];
+                    const auto duration = columns.durations[i];
+                    auto& info = trackInfos[columns.tracks[i]];
+                    if (!info.provisional && (timestamp < info.lastStart || (timestamp == info.lastStart && duration > info.lastDuration)))
+                    {
+                        info.provisional = true;
+                        out.provisionalTracks.push_back(columns.tracks[i]);
+                    }
+                    info.lastStart = timestamp;
+                    info.lastDuration = duration;
+
+                    auto& ends = info.ends;
+                    while (!ends.empty() && ends.back() <= timestamp)
+                        ends.pop_back();
+                    columns.depths[i] = static_cast<Depth>(std::min<std::size_t>(ends.size(), std::numeric_limits<Depth>::max()));
+                    ends.push_back(timestamp + duration);
+                }
+            }
+
+            std::string_view                    json;
+            JsonStructuralScanner               scanner;
+            ParsedChunk&                        out;
+            std::atomic<std::uint64_t>*         bytesScanned;
+            std::size_t                         chunkEvents;
+            const ChunkSink*                    sink;
+
+            std::string                         scratch;
+            std::string                         trackKey;
+            std::string                         flowKey;
+            std::vector<Argument>               arguments;
+            StringMap                           tracks;
+            std::vector<TrackInfo>              trackInfos;
+            std::vector<std::vector<OpenSpan>>  openSpans;
+            std::unordered_map<std::string, std::string> processNames;
+            Timestamp                           lastTimestamp = std::numeric_limits<Timestamp>::min();
+        };
+    }
+
+    void ImportChromeTrace(const std::string_view json, ParsedChunk& out, std::atomic<std::uint64_t>* bytesScanned, const JsonScanKernel kernel)
+    {
+        PROFILE_FUNCTION();
+        ChromeImporter{ json, out, bytesScanned, kernel }.Run();
+    }
+
+    void ImportChromeTrace(const std::string_view json, const std::size_t chunkEvents, const ChunkSink& sink,
+                           std::atomic<std::uint64_t>* bytesScanned, const JsonScanKernel kernel)
+    {
+        PROFILE_FUNCTION();
+        ParsedChunk chunk;
+        ChromeImporter{ json, chunk, bytesScanned, kernel, std::max<std::size_t>(chunkEvents, 1), &sink }.Run();
+    }
+
+    bool LooksLikeJson(std::string_view text)
+    {
+        constexpr std::string_view Utf8Bom = "\xEF\xBB\xBF";
+        if (text.starts_with(Utf8Bom))
+            text.remove_prefix(Utf8Bom.size());
+        text = Trim(text.substr(0, std::min<std::size_t>(text.size(), 4096)));
+        return !text.empty() && (text.front() == '{' || text.front() == '[');
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#include "JsonScanner.hpp"
+#include "ParsedChunk.hpp"
+
+namespace tagliatelle
+{
+
+    // Imports the Chrome Trace Event Format, as written by chrome://tracing,
+    // Perfetto and most tracing libraries, without building a DOM.
+    // Both {"traceEvents": [...]} and a bare array of events are accepted.
+    // Supported phases: X (complete), B/E (begin/end), i/I/n (instant),
+    // C (counter, numeric args become samples of the chunk's counters),
+    // s/t/f (flow points) and M (thread_name, process_name).
+    // Every (pid, tid) pair becomes a track,
+    // microsecond timestamps are converted to nanoseconds and depths are
+    // derived from the nesting of spans on each track.
+    // Throws std::runtime_error if the document structure is broken,
+    // events with missing or invalid fields are counted as malformed.
+    void ImportChromeTrace(std::string_view json, ParsedChunk& out,
+                           std::atomic<std::uint64_t>* bytesScanned = nullptr,
+                           JsonScanKernel kernel = JsonScanKernel::Best);
+
+    // Imports in chunks of about chunkEvents events, counter samples and flow
+    // points, handed to the sink as they are completed. Depths are derived
+    // from the spans known so far; tracks where a later span encloses spans
+    // of earlier chunks are listed in the chunk's provisionalTracks.
+    void ImportChromeTrace(std::string_view json, std::size_t chunkEvents, const ChunkSink& sink,
+                           std::atomic<std::uint64_t>* bytesScanned = nullptr,
+                           JsonScanKernel kernel = JsonScanKernel::Best);
+
+    // True if the text starts like a JSON document
+    [[nodiscard]] bool LooksLikeJson(std::string_view text);
+
+} // namespace tagliatelle
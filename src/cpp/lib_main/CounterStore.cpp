@@ -0,0 +1,223 @@
+#include "CounterStore.hpp"
+
+#include <algorithm> // std::is_sorted, std::lower_bound, std::ranges::copy, std::ranges::inplace_merge, std::ranges::stable_sort, std::ranges::upper_bound, std::sort, std::unique
+#include <array>
+#include <cmath>     // std::ceil, std::floor
+#include <limits>
+#include <numeric>   // std::iota
+#include <span>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    SeriesId CounterStore::Series(const NameId name)
+    {
+        const auto [it, inserted] = byName.try_emplace(name, static_cast<SeriesId>(series.size()));
+        if (inserted)
+            series.emplace_back().name = name;
+        return it->second;
+    }
+
+    void CounterStore::Append(const SeriesId id, const Timestamp timestamp, const double value)
+    {
+        auto& data = series[id];
+        ASSERT((data.timestamps.size() < std::numeric_limits<std::uint32_t>::max()), "CounterStore: too many samples in a series");
+        if (data.timestamps.empty() || timestamp >= data.timestamps.back())
+        {
+            data.timestamps.push_back(timestamp);
+            data.values.push_back(value);
+            data.Add(static_cast<std::uint32_t>(data.timestamps.size() - 1));
+        }
+        else
+        {
+            const auto pos = std::ranges::upper_bound(data.timestamps, timestamp) - data.timestamps.begin();
+            data.timestamps.insert(data.timestamps.begin() + pos, timestamp);
+            data.values.insert(data.values.begin() + pos, value);
+            data.Rebuild(static_cast<std::uint32_t>(pos));
+        }
+        ++samples;
+    }
+
+    void CounterStore::AppendBulk(const SeriesId id, const std::span<const CounterPoint> points)
+    {
+        auto& data = series[id];
+        ASSERT((data.timestamps.size() + points.size() < std::numeric_limits<std::uint32_t>::max()), "CounterStore: too many samples in a series");
+        const auto sortedPrefix = data.timestamps.size();
+        for (const auto& point : points)
+        {
+            data.timestamps.push_back(point.timestamp);
+            data.values.push_back(point.value);
+        }
+        samples += points.size();
+
+        if (std::is_sorted(data.timestamps.begin() + static_cast<std::ptrdiff_t>(sortedPrefix == 0 ? 0 : sortedPrefix - 1), data.timestamps.end()))
+        {
+            for (auto i = sortedPrefix; i < data.timestamps.size(); ++i)
+                data.Add(static_cast<std::uint32_t>(i));
+            return;
+        }
+
+        // Stable, so that samples at equal times keep their order
+        const auto n = data.timestamps.size();
+        auto time = [&](const std::uint32_t i) { return data.timestamps[i]; };
+        std::vector<std::uint32_t> batch(n - sortedPrefix);
+        std::iota(batch.begin(), batch.end(), static_cast<std::uint32_t>(sortedPrefix));
+        std::ranges::stable_sort(batch, {}, time);
+
+        // Only the stored samples after the batch's first one take part in the merge
+        const auto prefix = std::span{ data.timestamps }.first(sortedPrefix);
+        const auto first = static_cast<std::size_t>(std::ranges::upper_bound(prefix, time(batch.front())) - prefix.begin());
+        std::vector<std::uint32_t> order(sortedPrefix - first);
+        std::iota(order.begin(), order.end(), static_cast<std::uint32_t>(first));
+        order.insert(order.end(), batch.begin(), batch.end());
+        std::ranges::inplace_merge(order, order.begin() + static_cast<std::ptrdiff_t>(sortedPrefix - first), {}, time);
+
+        std::vector<Timestamp> timestamps;
+        std::vector<double> values;
+        timestamps.reserve(order.size());
+        values.reserve(order.size());
+        for (const auto i : order)
+        {
+            timestamps.push_back(data.timestamps[i]);
+            values.push_back(data.values[i]);
+        }
+        std::ranges::copy(timestamps, data.timestamps.begin() + static_cast<std::ptrdiff_t>(first));
+        std::ranges::copy(values, data.values.begin() + static_cast<std::ptrdiff_t>(first));
+        data.Rebuild(static_cast<std::uint32_t>(first));
+    }
+
+    void CounterStore::Decimate(const SeriesId id, const Viewport& viewport, std::vector<CounterPoint>& out) const
+    {
+        PROFILE_SCOPE("CounterStore::Decimate");
+        out.clear();
+        if (!viewport.Valid())
+            return;
+
+        const auto& data = series[id];
+        const auto& timestamps = data.timestamps;
+        auto point = [&](const std::uint32_t i) { out.push_back(CounterPoint{ timestamps[i], data.values[i] }); };
+
+        const auto first = static_cast<std::uint32_t>(std::ranges::lower_bound(timestamps, viewport.start) - timestamps.begin());
+        const auto last = static_cast<std::uint32_t>(std::ranges::lower_bound(timestamps, viewport.end) - timestamps.begin());
+        if (first > 0)
+            point(first - 1);
+
+        // Only pixels with samples are visited
+        const double pixelWidth = static_cast<double>(viewport.end - viewport.start) / viewport.width;
+        auto pixelOf = [&](const Timestamp time) { return std::floor(static_cast<double>(time - viewport.start) / pixelWidth); };
+        for (auto begin = first; begin < last;)
+        {
+            // First time in the next pixel, the estimate is corrected for rounding
+            const auto pixel = pixelOf(timestamps[begin]);
+            auto boundary = std::max(viewport.start + static_cast<Timestamp>(std::ceil((pixel + 1) * pixelWidth)), timestamps[begin] + 1);
+            while (boundary - 1 > timestamps[begin] && pixelOf(boundary - 1) > pixel)
+                --boundary;
+            while (pixelOf(boundary) <= pixel)
+                ++boundary;
+            const auto end = static_cast<std::uint32_t>(std::lower_bound(timestamps.begin() + begin, timestamps.begin() + last, boundary) - timestamps.begin());
+
+            const auto extremes = data.Range(begin, end);
+            std::array<std::uint32_t, 4> picked{ begin, extremes.min, extremes.max, end - 1 };
+            std::sort(picked.begin(), picked.end());
+            for (auto it = picked.begin(); it != std::unique(picked.begin(), picked.end()); ++it)
+                point(*it);
+            begin = end;
+        }
+
+        if (last < timestamps.size())
+            point(last);
+    }
+
+    void CounterStore::Clear()
+    {
+        series.clear();
+        byName.clear();
+        samples = 0;
+    }
+
+    void CounterStore::SeriesData::Add(const std::uint32_t index)
+    {
+        std::size_t span = Fanout;
+        for (auto& blocks : levels)
+        {
+            const auto block = index / span;
+            if (block == blocks.size())
+            {
+                blocks.push_back(Extremes{ index, index });
+            }
+            else
+            {
+                auto& extremes = blocks[block];
+                if (values[index] < values[extremes.min])
+                    extremes.min = index;
+                if (values[index] > values[extremes.max])
+                    extremes.max = index;
+            }
+            span *= Fanout;
+        }
+
+        // A level starts once its first block is complete
+        if (index + 1 == span)
+        {
+            const auto whole = Range(0, index + 1);
+            levels.emplace_back().push_back(whole);
+        }
+    }
+
+    void CounterStore::SeriesData::Rebuild(const std::uint32_t first)
+    {
+        // Level by level, every block is combined from the Fanout blocks below it
+        const auto n = timestamps.size();
+        std::size_t span = Fanout;
+        for (std::size_t level = 0; n >= span; ++level, span *= Fanout)
+        {
+            if (level == levels.size())
+                levels.emplace_back();
+            auto& blocks = levels[level];
+            blocks.resize(std::min(blocks.size(), first / span));
+            for (auto begin = blocks.size() * span; begin < n; begin += span)
+            {
+                const auto end = std::min(n, begin + span);
+                const auto childSpan = span / Fanout;
+                Extremes extremes{ static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(begin) };
+                for (auto child = begin; child < end; child += childSpan)
+                {
+                    const auto below = level == 0 ? Extremes{ static_cast<std::uint32_t>(child), static_cast<std::uint32_t>(child) }
+                                                   : levels[level - 1][child / childSpan];
+                    if (values[below.min] < values[extremes.min])
+                        extremes.min = below.min;
+                    if (values[below.max] > values[extremes.max])
+                        extremes.max = below.max;
+                }
+                blocks.push_back(extremes);
+            }
+        }
+    }
+
+    CounterStore::Extremes CounterStore::SeriesData::Range(const std::uint32_t first, const std::uint32_t last) const
+    {
+        Extremes result{ first, first };
+        for (auto i = first; i < last;)
+        {
+            // Largest block starting at i that ends within the range
+            std::size_t level = 0;
+            std::size_t span = 1;
+            while (level < levels.size() && i % (span * Fanout) == 0 && i + span * Fanout <= last)
+            {
+                span *= Fanout;
+                ++level;
+            }
+
+            const auto extremes = level == 0 ? Extremes{ i, i } : levels[level - 1][i / span];
+            if (values[extremes.min] < values[result.min])
+                result.min = extremes.min;
+            if (values[extremes.max] > values[result.max])
+                result.max = extremes.max;
+            i += static_cast<std::uint32_t>(span);
+        }
+        return result;
+    }
+
+} // namespace tagliatelle
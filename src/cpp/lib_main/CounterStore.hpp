@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "EventStore.hpp"
+#include "RenderQuery.hpp"
+
+namespace tagliatelle
+{
+
+    using SeriesId = std::uint32_t;
+
+    // Sample of a named counter, as produced by importers
+    struct CounterSample
+    {
+        NameId    series; // name of the counter
+        Timestamp timestamp;
+        double    value;
+    };
+
+    struct CounterPoint
+    {
+        Timestamp timestamp;
+        double    value;
+    };
+
+    // Samples of counters like CPU load or queue depth, one series per counter
+    // in timestamp order. Every series keeps a hierarchy of the positions of the
+    // minimum and maximum of blocks of Fanout samples, Fanout blocks per block
+    // of the next level, updated as samples are appended.
+    // Decimate() reduces a viewport to the first, minimum, maximum and last
+    // sample of every pixel (M4), which draws the same line as all samples.
+    // A pixel costs a binary search and O(Fanout) per level.
+    class CounterStore
+    {
+    public:
+        static constexpr std::size_t Fanout = 16;
+
+        CounterStore() = default;
+
+        MOVE_ONLY(CounterStore);
+
+        // Series of the named counter, created on first use
+        [[nodiscard]] SeriesId Series(NameId name);
+
+        [[nodiscard]] std::size_t SeriesCount() const
+        {
+            return series.size();
+        }
+
+        [[nodiscard]] NameId SeriesName(const SeriesId id) const
+        {
+            return series[id].name;
+        }
+
+        // In timestamp order is O(levels), an older sample moves the later ones
+        // and rebuilds the hierarchy from its position
+        void Append(SeriesId id, Timestamp timestamp, double value);
+
+        // Appends the points in any order. Points older than the last sample are
+        // merged with the later samples, the hierarchy is rebuilt from the first
+        // sample that moved.
+        void AppendBulk(SeriesId id, std::span<const CounterPoint> points);
+
+        [[nodiscard]] std::span<const Timestamp> Timestamps(const SeriesId id) const
+        {
+            return series[id].timestamps;
+        }
+
+        [[nodiscard]] std::span<const double> Values(const SeriesId id) const
+        {
+            return series[id].values;
+        }
+
+        // Total samples of all series
+        [[nodiscard]] std::size_t Size() const
+        {
+            return samples;
+        }
+
+        // Replaces out with the points that draw the series in the viewport,
+        // in timestamp order. The samples just outside the viewport are
+        // included, so that the line can be drawn to its edges.
+        void Decimate(SeriesId id, const Viewport& viewport, std::vector<CounterPoint>& out) const;
+
+        void Clear();
+
+    private:
+        struct Extremes
+        {
+            std::uint32_t min;
+            std::uint32_t max;
+        };
+
+        struct SeriesData
+        {
+            NameId                             name = 0;
+            std::vector<Timestamp>             timestamps;
+            std::vector<double>                values;
+            std::vector<std::vector<Extremes>> levels; // level l has a block per Fanout^(l+1) samples
+
+            void Add(std::uint32_t index);
+
+            // Recomputes the blocks holding samples from first on
+            void Rebuild(std::uint32_t first);
+
+            // Positions of the minimum and maximum in [first, last)
+            [[nodiscard]] Extremes Range(std::uint32_t first, std::uint32_t last) const;
+        };
+
+        std::vector<SeriesData>              series;
+        std::unordered_map<NameId, SeriesId> byName;
+        std::size_t                          samples = 0;
+    };
+
+} // namespace tagliatelle
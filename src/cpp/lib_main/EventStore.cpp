@@ -0,0 +1,697 @@
+#include "EventStore.hpp"
+
+#include <algorithm>   // std::fill_n, std::max, std::min, std::ranges::copy, std::ranges::lower_bound, std::ranges::min, std::ranges::stable_sort, std::inplace_merge
+#include <atomic>
+#include <bit>         // std::bit_width
+#include <cstddef>     // std::byte
+#include <cstring>     // std::memcpy
+#include <limits>
+#include <memory>      // std::unique_ptr
+#include <numeric>     // std::iota
+#include <type_traits> // std::is_signed_v
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        // Rearranges column[first, first + order.size()) so that position first + j holds column[order[j]]
+        template <typename T>
+        void Permute(Column<T>& column, const std::size_t first, const std::vector<std::size_t>& order)
+        {
+            std::vector<T> permuted;
+            permuted.reserve(order.size());
+            for (const auto i : order)
+                permuted.push_back(column[i]);
+            std::ranges::copy(permuted, column.begin() + first);
+        }
+
+        bool Precedes(const Timestamp lhsTime, const Depth lhsDepth, const Timestamp rhsTime, const Depth rhsDepth)
+        {
+            return lhsTime < rhsTime || (lhsTime == rhsTime && lhsDepth < rhsDepth);
+        }
+
+        void Permute(EventColumns& columns, const std::size_t first, const std::vector<std::size_t>& order)
+        {
+            Permute(columns.timestamps, first, order);
+            Permute(columns.durations, first, order);
+            Permute(columns.names, first, order);
+            Permute(columns.tracks, first, order);
+            Permute(columns.depths, first, order);
+            Permute(columns.argOffsets, first, order);
+            Permute(columns.argCounts, first, order);
+        }
+
+        // Stable sort of columns[first, Size()) by (timestamp, depth), returns false if it already was
+        bool SortTail(EventColumns& columns, const std::size_t first)
+        {
+            const auto& ts = columns.timestamps;
+            const auto& depths = columns.depths;
+            auto precedes = [&](const std::size_t lhs, const std::size_t rhs) { return Precedes(ts[lhs], depths[lhs], ts[rhs], depths[rhs]); };
+
+            const auto n = columns.Size();
+            bool sorted = true;
+            for (std::size_t i = first + 1; i < n && sorted; ++i)
+                sorted = !precedes(i, i - 1);
+            if (sorted) [[likely]]
+                return false;
+
+            std::vector<std::size_t> order(n - first);
+            std::iota(order.begin(), order.end(), first);
+            std::ranges::stable_sort(order, precedes);
+            Permute(columns, first, order);
+            return true;
+        }
+
+        // Unsigned form with the same order, signed values are offset by the sign bit
+        template <typename T>
+        std::uint64_t Ordered(const T value)
+        {
+            if constexpr (std::is_signed_v<T>)
+                return static_cast<std::uint64_t>(static_cast<std::int64_t>(value)) ^ (std::uint64_t{ 1 } << 63);
+            else
+                return static_cast<std::uint64_t>(value);
+        }
+
+        template <typename T>
+        T FromOrdered(const std::uint64_t value)
+        {
+            if constexpr (std::is_signed_v<T>)
+                return static_cast<T>(static_cast<std::int64_t>(value ^ (std::uint64_t{ 1 } << 63)));
+            else
+                return static_cast<T>(value);
+        }
+
+        // Appends the values minus their minimum with the fewest bits that hold them all,
+        // returns the minimum and the bits per value
+        template <typename T>
+        std::pair<std::uint64_t, std::uint8_t> Pack(const T* const values, const std::size_t count, Column<std::uint64_t>& words)
+        {
+            auto low = std::numeric_limits<std::uint64_t>::max();
+            std::uint64_t high = 0;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                low = std::min(low, Ordered(values[i]));
+                high = std::max(high, Ordered(values[i]));
+            }
+
+            const auto bits = static_cast<std::uint8_t>(std::bit_width(high - low));
+            if (bits == 0)
+                return { low, bits };
+
+            const auto offset = words.size();
+            words.resize(offset + (count * bits + 63) / 64);
+            std::size_t position = 0;
+            for (std::size_t i = 0; i < count; ++i, position += bits)
+            {
+                const auto packed = Ordered(values[i]) - low;
+                const auto word = offset + position / 64;
+                const auto shift = position % 64;
+                words[word] |= packed << shift;
+                if (shift + bits > 64)
+                    words[word + 1] |= packed >> (64 - shift);
+            }
+            return { low, bits };
+        }
+
+        template <typename T>
+        void Unpack(const std::uint64_t* const words, const std::uint64_t base, const std::uint8_t bits, const std::size_t count, T* const out)
+        {
+            if (bits == 0)
+            {
+                std::fill_n(out, count, FromOrdered<T>(base));
+                return;
+            }
+
+            const auto mask = bits == 64 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << bits) - 1;
+            std::size_t position = 0;
+
+            // Values of up to 57 bits lie within the 8 bytes from the byte they start in,
+            // the words end with padding so that the load never leaves them
+            if (bits <= 57)
+            {
+                const auto* const bytes = reinterpret_cast<const char*>(words);
+                for (std::size_t i = 0; i < count; ++i, position += bits)
+                {
+                    std::uint64_t packed;
+                    std::memcpy(&packed, bytes + position / 8, sizeof(packed));
+                    out[i] = FromOrdered<T>(((packed >> (position % 8)) & mask) + base);
+                }
+                return;
+            }
+
+            for (std::size_t i = 0; i < count; ++i, position += bits)
+            {
+                const auto word = position / 64;
+                const auto shift = position % 64;
+                auto packed = words[word] >> shift;
+                if (shift + bits > 64)
+                    packed |= words[word + 1] << (64 - shift);
+                out[i] = FromOrdered<T>((packed & mask) + base);
+            }
+        }
+
+        std::atomic<std::uint64_t> nextEpoch{ 1 };
+
+        // Column blocks decoded by the thread, least recently used ones are replaced
+        struct DecodedColumn
+        {
+            std::uint64_t                epoch   = 0; // of the ColdBlocks, 0 if unused
+            std::size_t                  block   = 0;
+            std::uint64_t                lastUse = 0;
+            std::unique_ptr<std::byte[]> values;
+        };
+
+        // Every column has its own entries, so reading whole events does not evict the blocks of the other columns
+        struct DecodedCache
+        {
+            std::array<std::array<DecodedColumn, ColdBlocks::CacheBlocks>, ColdBlocks::ColumnCount> columns;
+            std::array<const DecodedColumn*, ColdBlocks::ColumnCount>                              last{}; // most recently used
+            std::uint64_t                                                                           clock = 0;
+        };
+
+        thread_local DecodedCache decodedCache;
+    }
+
+    EventColumns::EventColumns(MemoryBudget* const budget)
+        : timestamps{ BudgetAllocator<Timestamp>{ budget } }
+        , durations{ BudgetAllocator<Duration>{ budget } }
+        , names{ BudgetAllocator<NameId>{ budget } }
+        , tracks{ BudgetAllocator<TrackId>{ budget } }
+        , depths{ BudgetAllocator<Depth>{ budget } }
+        , argOffsets{ BudgetAllocator<ArgumentOffset>{ budget } }
+        , argCounts{ BudgetAllocator<std::uint16_t>{ budget } }
+    {
+    }
+
+    void EventColumns::PushBack(const Event& event)
+    {
+        timestamps.push_back(event.timestamp);
+        durations.push_back(event.duration);
+        names.push_back(event.name);
+        tracks.push_back(event.track);
+        depths.push_back(event.depth);
+        argOffsets.push_back(event.argOffset);
+        argCounts.push_back(event.argCount);
+    }
+
+    void EventColumns::Reserve(const std::size_t count)
+    {
+        timestamps.reserve(count);
+        durations.reserve(count);
+        names.reserve(count);
+        tracks.reserve(count);
+        depths.reserve(count);
+        argOffsets.reserve(count);
+        argCounts.reserve(count);
+    }
+
+    void EventColumns::Append(const EventColumns& other, const std::size_t first, const std::size_t last)
+    {
+        auto append = [&](auto& dst, const auto& src) { dst.insert(dst.end(), src.begin() + first, src.begin() + last); };
+        append(timestamps, other.timestamps);
+        append(durations, other.durations);
+        append(names, other.names);
+        append(tracks, other.tracks);
+        append(depths, other.depths);
+        append(argOffsets, other.argOffsets);
+        append(argCounts, other.argCounts);
+    }
+
+    void EventColumns::Sort()
+    {
+        PROFILE_SCOPE("EventColumns::Sort");
+        SortTail(*this, 0);
+    }
+
+    void EventColumns::Clear()
+    {
+        timestamps.clear();
+        durations.clear();
+        names.clear();
+        tracks.clear();
+        depths.clear();
+        argOffsets.clear();
+        argCounts.clear();
+    }
+
+    std::size_t EventColumns::CapacityBytes() const
+    {
+        auto bytes = [](const auto& column) { return column.capacity() * sizeof(column[0]); };
+        return bytes(timestamps) + bytes(durations) + bytes(names) + bytes(tracks) + bytes(depths) + bytes(argOffsets) + bytes(argCounts);
+    }
+
+    ColdBlocks::ColdBlocks(MemoryBudget* const budget)
+        : words{ BudgetAllocator<std::uint64_t>{ budget } }
+    {
+    }
+
+    void ColdBlocks::Pack(const EventColumns& columns, const std::size_t first)
+    {
+        ASSERT((first + BlockEvents <= columns.Size()), "ColdBlocks: packing a partial block");
+        // Block indices are reused once all blocks were dropped, the thread caches must not mistake them
+        if (blocks.empty())
+            epoch = nextEpoch.fetch_add(1, std::memory_order_relaxed);
+        if (!words.empty())
+            words.pop_back();
+
+        Block block;
+        block.firstTimestamp = columns.timestamps[first];
+        auto pack = [&](const ColumnIndex index, const auto* const values)
+            {
+                const auto offset = words.size();
+                const auto [base, bits] = tagliatelle::Pack(values, BlockEvents, words);
+                block.columns[index] = PackedColumn{ base, offset, bits };
+            };
+
+        // Events are in timestamp order, the deltas are small and non-negative
+        std::array<Timestamp, BlockEvents> deltas;
+        deltas[0] = 0;
+        for (std::size_t i = 1; i < BlockEvents; ++i)
+            deltas[i] = columns.timestamps[first + i] - columns.timestamps[first + i - 1];
+        pack(TimestampColumn, deltas.data());
+        pack(DurationColumn, columns.durations.data() + first);
+        pack(NameColumn, columns.names.data() + first);
+        pack(TrackColumn, columns.tracks.data() + first);
+        pack(DepthColumn, columns.depths.data() + first);
+        pack(ArgOffsetColumn, columns.argOffsets.data() + first);
+        pack(ArgCountColumn, columns.argCounts.data() + first);
+
+        blocks.push_back(block);
+        // Padding for the unaligned loads of Unpack()
+        words.push_back(0);
+    }
+
+    void ColdBlocks::Unpack(const std::size_t block, EventColumns& out)
+    {
+        if (block >= blocks.size())
+            return;
+
+        const auto first = out.Size();
+        const auto count = (blocks.size() - block) * BlockEvents;
+        out.timestamps.resize(first + count);
+        out.durations.resize(first + count);
+        out.names.resize(first + count);
+        out.tracks.resize(first + count);
+        out.depths.resize(first + count);
+        out.argOffsets.resize(first + count);
+        out.argCounts.resize(first + count);
+        for (auto b = block; b < blocks.size(); ++b)
+        {
+            const auto at = first + (b - block) * BlockEvents;
+            Decode(TimestampColumn, b, out.timestamps.data() + at);
+            Decode(DurationColumn, b, out.durations.data() + at);
+            Decode(NameColumn, b, out.names.data() + at);
+            Decode(TrackColumn, b, out.tracks.data() + at);
+            Decode(DepthColumn, b, out.depths.data() + at);
+            Decode(ArgOffsetColumn, b, out.argOffsets.data() + at);
+            Decode(ArgCountColumn, b, out.argCounts.data() + at);
+        }
+
+        // The words of the dropped blocks start with the first one's timestamps
+        words.resize(blocks[block].columns[TimestampColumn].offset);
+        blocks.resize(block);
+        if (blocks.empty())
+            words.clear();
+        else
+            words.push_back(0);
+        epoch = nextEpoch.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void ColdBlocks::Clear()
+    {
+        blocks.clear();
+        words.clear();
+    }
+
+    std::size_t ColdBlocks::LowerBound(const Timestamp time) const
+    {
+        // The first event at or after the time is in the last block starting before it, or starts the next block
+        const auto next = static_cast<std::size_t>(std::ranges::lower_bound(blocks, time, {}, &Block::firstTimestamp) - blocks.begin());
+        if (next == 0)
+            return 0;
+        const auto timestamps = Decoded<Timestamp>(TimestampColumn, next - 1);
+        return (next - 1) * BlockEvents + static_cast<std::size_t>(std::ranges::lower_bound(timestamps, time) - timestamps.begin());
+    }
+
+    std::size_t ColdBlocks::MemoryBytes() const
+    {
+        return words.capacity() * sizeof(std::uint64_t) + blocks.capacity() * sizeof(Block);
+    }
+
+    const void* ColdBlocks::DecodedBlock(const ColumnIndex column, const std::size_t block) const
+    {
+        auto& cache = decodedCache;
+        const auto* const last = cache.last[column];
+        if (last != nullptr && last->epoch == epoch && last->block == block) [[likely]]
+            return last->values.get();
+
+        ++cache.clock;
+        auto& entries = cache.columns[column];
+        auto* victim = &entries.front();
+        for (auto& entry : entries)
+        {
+            if (entry.epoch == epoch && entry.block == block)
+            {
+                entry.lastUse = cache.clock;
+                cache.last[column] = &entry;
+                return entry.values.get();
+            }
+            if (entry.lastUse < victim->lastUse)
+                victim = &entry;
+        }
+
+        if (!victim->values)
+            victim->values = std::make_unique<std::byte[]>(BlockEvents * sizeof(std::uint64_t));
+        victim->epoch = 0;
+        Decode(column, block, victim->values.get());
+        victim->epoch = epoch;
+        victim->block = block;
+        victim->lastUse = cache.clock;
+        cache.last[column] = victim;
+        return victim->values.get();
+    }
+
+    void ColdBlocks::Decode(const ColumnIndex column, const std::size_t block, void* const out) const
+    {
+        const auto& header = blocks[block];
+        const auto& packed = header.columns[column];
+        auto unpack = [&]<typename T>(T* const values) { tagliatelle::Unpack(words.data() + packed.offset, packed.base, packed.bits, BlockEvents, values); };
+        switch (column)
+        {
+        case TimestampColumn:
+        {
+            auto* const timestamps = static_cast<Timestamp*>(out);
+            unpack(timestamps);
+            auto time = header.firstTimestamp;
+            for (std::size_t i = 0; i < BlockEvents; ++i)
+                timestamps[i] = time += timestamps[i];
+            break;
+        }
+        case DurationColumn:  unpack(static_cast<Duration*>(out)); break;
+        case NameColumn:      unpack(static_cast<NameId*>(out)); break;
+        case TrackColumn:     unpack(static_cast<TrackId*>(out)); break;
+        case DepthColumn:     unpack(static_cast<Depth*>(out)); break;
+        case ArgOffsetColumn: unpack(static_cast<ArgumentOffset*>(out)); break;
+        case ArgCountColumn:  unpack(static_cast<std::uint16_t*>(out)); break;
+        case ColumnCount:     break;
+        }
+    }
+
+    EventStore::EventStore(MemoryBudget* const budget)
+        : budget{ budget }
+        , cold{ budget }
+        , columns{ budget }
+        , names{ BudgetAllocator<char>{ budget } }
+        , arguments{ budget }
+    {
+    }
+
+    NameId EventStore::InternName(const std::string_view name)
+    {
+        return names.Intern(name);
+    }
+
+    void EventStore::SetTrackName(const TrackId track, const std::string_view name)
+    {
+        ASSERT((track < MaxTracks), "track out of range");
+        if (track >= trackNames.size())
+            trackNames.resize(std::size_t{ track } + 1, NameTable::InvalidId);
+        trackNames[track] = names.Intern(name);
+    }
+
+    std::string_view EventStore::TrackName(const TrackId track) const
+    {
+        if (track >= trackNames.size() || trackNames[track] == NameTable::InvalidId)
+            return {};
+        return names.View(trackNames[track]);
+    }
+
+    void EventStore::Append(const Event& event)
+    {
+        const auto n = Size();
+        const auto timestamps = Timestamps();
+        const auto depths = Depths();
+        auto pos = n;
+        if (n == 0 || !Precedes(event.timestamp, event.depth, timestamps.back(), depths.back())) [[likely]]
+        {
+            columns.PushBack(event);
+        }
+        else
+        {
+            // Out of order, find the first event that must come after this one
+            pos = LowerBound(event.timestamp);
+            while (pos < n && !Precedes(event.timestamp, event.depth, timestamps[pos], depths[pos]))
+                ++pos;
+            if (pos < cold.Size())
+                Thaw(pos / ColdBlocks::BlockEvents);
+
+            const auto at = pos - cold.Size();
+            columns.timestamps.insert(columns.timestamps.begin() + at, event.timestamp);
+            columns.durations.insert(columns.durations.begin() + at, event.duration);
+            columns.names.insert(columns.names.begin() + at, event.name);
+            columns.tracks.insert(columns.tracks.begin() + at, event.track);
+            columns.depths.insert(columns.depths.begin() + at, event.depth);
+            columns.argOffsets.insert(columns.argOffsets.begin() + at, event.argOffset);
+            columns.argCounts.insert(columns.argCounts.begin() + at, event.argCount);
+        }
+        TrackAppended(event);
+        UpdateReach(pos);
+        Freeze(std::max(hotEvents, ColdBlocks::BlockEvents));
+        if (budget != nullptr)
+            budget->Enforce();
+    }
+
+    void EventStore::AppendBulk(const EventColumns& batch)
+    {
+        PROFILE_SCOPE("EventStore::AppendBulk");
+        // Cold events from the batch's earliest on take part in the merge
+        if (cold.Size() > 0 && batch.Size() > 0)
+        {
+            const auto first = cold.LowerBound(std::ranges::min(batch.timestamps));
+            if (first < cold.Size())
+                Thaw(first / ColdBlocks::BlockEvents);
+        }
+
+        const auto sortedPrefix = columns.Size();
+        columns.Reserve(sortedPrefix + batch.Size());
+        columns.Append(batch, 0, batch.Size());
+        for (std::size_t i = 0; i < batch.Size(); ++i)
+            TrackAppended(batch[i]);
+
+        UpdateReach(cold.Size() + RestoreOrder(sortedPrefix));
+        Freeze(std::max(hotEvents, ColdBlocks::BlockEvents));
+        if (budget != nullptr)
+            budget->Enforce();
+    }
+
+    bool EventStore::Renest(const std::span<const TrackId> tracks)
+    {
+        PROFILE_SCOPE("EventStore::Renest");
+        if (cold.Size() > 0)
+            Thaw(0);
+
+        std::vector<bool> selected(trackNames.size(), false);
+        for (const auto track : tracks)
+        {
+            if (track < selected.size())
+                selected[track] = true;
+        }
+
+        // Parents come first as they start earlier or, at the same time, last longer
+        const auto n = Size();
+        std::vector<std::size_t> order;
+        order.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (selected[columns.tracks[i]])
+                order.push_back(i);
+        }
+        std::ranges::stable_sort(order, [this](const std::size_t lhs, const std::size_t rhs)
+            {
+                if (columns.timestamps[lhs] != columns.timestamps[rhs])
+                    return columns.timestamps[lhs] < columns.timestamps[rhs];
+                return columns.durations[lhs] > columns.durations[rhs];
+            });
+
+        std::vector<std::vector<Timestamp>> ends(trackNames.size());
+        bool changed = false;
+        for (const auto i : order)
+        {
+            auto& trackEnds = ends[columns.tracks[i]];
+            while (!trackEnds.empty() && trackEnds.back() <= columns.timestamps[i])
+                trackEnds.pop_back();
+            const auto depth = static_cast<Depth>(std::min<std::size_t>(trackEnds.size(), std::numeric_limits<Depth>::max()));
+            changed |= columns.depths[i] != depth;
+            columns.depths[i] = depth;
+            trackEnds.push_back(columns.timestamps[i] + columns.durations[i]);
+        }
+        if (changed)
+        {
+            SortTail(columns, 0);
+            UpdateReach(0);
+        }
+        Freeze(ColdBlocks::BlockEvents);
+        return changed;
+    }
+
+    void EventStore::Clear()
+    {
+        cold.Clear();
+        columns.Clear();
+        names.Clear();
+        arguments.Clear();
+        trackNames.clear();
+        maxDuration = 0;
+        reach.clear();
+    }
+
+    void EventStore::SetHotEvents(const std::size_t count)
+    {
+        PROFILE_SCOPE("EventStore::SetHotEvents");
+        hotEvents = count;
+        if (cold.BlockCount() > 0 && columns.Size() < count)
+        {
+            const auto missing = count == AllHot ? cold.BlockCount() : (count - columns.Size() + ColdBlocks::BlockEvents - 1) / ColdBlocks::BlockEvents;
+            Thaw(cold.BlockCount() - std::min(missing, cold.BlockCount()));
+        }
+        Freeze(ColdBlocks::BlockEvents);
+        if (budget != nullptr)
+            budget->Enforce();
+    }
+
+    std::size_t EventStore::LowerBound(const Timestamp time) const
+    {
+        if (cold.Size() > 0 && (columns.Size() == 0 || time <= columns.timestamps.front()))
+            return cold.LowerBound(time);
+        return cold.Size() + (std::ranges::lower_bound(columns.timestamps, time) - columns.timestamps.begin());
+    }
+
+    void EventStore::Touch(const Timestamp start, const Timestamp end) const
+    {
+        if (budget == nullptr)
+            return;
+
+        // Cold blocks are read through the thread caches, only the columns are touched
+        const auto first = std::max(LowerBound(start), cold.Size()) - cold.Size();
+        const auto count = std::max(LowerBound(end), cold.Size()) - cold.Size() - first;
+        auto touch = [&](const auto& column) { budget->Touch(column.data() + first, count * sizeof(column[0])); };
+        touch(columns.timestamps);
+        touch(columns.durations);
+        touch(columns.names);
+        touch(columns.tracks);
+        touch(columns.depths);
+        touch(columns.argOffsets);
+        touch(columns.argCounts);
+        budget->Enforce();
+    }
+
+    void EventStore::TrackAppended(const Event& event)
+    {
+        ASSERT((event.track < MaxTracks), "track out of range");
+        maxDuration = std::max(maxDuration, event.duration);
+        if (event.track >= trackNames.size())
+            trackNames.resize(std::size_t{ event.track } + 1, NameTable::InvalidId);
+    }
+
+    std::size_t EventStore::RestoreOrder(const std::size_t sortedPrefix)
+    {
+        const auto n = columns.Size();
+        if (sortedPrefix == n)
+            return n;
+        SortTail(columns, sortedPrefix);
+
+        // Only the stored events after the batch's first one take part in the merge
+        const auto& ts = columns.timestamps;
+        const auto& depths = columns.depths;
+        auto precedes = [&](const std::size_t lhs, const std::size_t rhs) { return Precedes(ts[lhs], depths[lhs], ts[rhs], depths[rhs]); };
+        if (sortedPrefix == 0 || !precedes(sortedPrefix, sortedPrefix - 1)) [[likely]]
+            return sortedPrefix;
+
+        const auto prefix = std::span{ ts }.first(sortedPrefix);
+        auto first = static_cast<std::size_t>(std::ranges::lower_bound(prefix, ts[sortedPrefix]) - prefix.begin());
+        while (first < sortedPrefix && !precedes(sortedPrefix, first))
+            ++first;
+
+        std::vector<std::size_t> order(n - first);
+        std::iota(order.begin(), order.end(), first);
+        std::inplace_merge(order.begin(), order.begin() + (sortedPrefix - first), order.end(), precedes);
+        Permute(columns, first, order);
+        return first;
+    }
+
+    void EventStore::Thaw(const std::size_t block)
+    {
+        PROFILE_SCOPE("EventStore::Thaw");
+        EventColumns thawed{ budget };
+        thawed.Reserve((cold.BlockCount() - block) * ColdBlocks::BlockEvents + columns.Size());
+        cold.Unpack(block, thawed);
+        thawed.Append(columns, 0, columns.Size());
+        columns = std::move(thawed);
+    }
+
+    void EventStore::Freeze(const std::size_t slack)
+    {
+        if (hotEvents == AllHot || columns.Size() <= hotEvents)
+            return;
+        const auto excess = columns.Size() - hotEvents;
+        if (excess < std::max(slack, ColdBlocks::BlockEvents))
+            return;
+
+        PROFILE_SCOPE("EventStore::Freeze");
+        const auto packed = excess / ColdBlocks::BlockEvents * ColdBlocks::BlockEvents;
+        for (std::size_t first = 0; first < packed; first += ColdBlocks::BlockEvents)
+            cold.Pack(columns, first);
+
+        EventColumns rest{ budget };
+        rest.Reserve(columns.Size() - packed);
+        rest.Append(columns, packed, columns.Size());
+        columns = std::move(rest);
+    }
+
+    void EventStore::UpdateReach(const std::size_t first)
+    {
+        const auto n = Size();
+        const auto blocks = (n + ReachBlockSize - 1) / ReachBlockSize;
+        if (reach.empty())
+            reach.emplace_back();
+
+        const auto ts = Timestamps();
+        const auto durations = Durations();
+        auto from = first / ReachBlockSize;
+        reach[0].resize(blocks);
+        for (auto b = from; b < blocks; ++b)
+        {
+            auto latest = std::numeric_limits<Timestamp>::min();
+            for (auto i = b * ReachBlockSize; i < std::min(n, (b + 1) * ReachBlockSize); ++i)
+                latest = std::max(latest, ts[i] + durations[i]);
+            reach[0][b] = latest;
+        }
+
+        // Each level halves the one below, up to a single root
+        std::size_t level = 0;
+        for (; reach[level].size() > 1; ++level)
+        {
+            if (level + 1 == reach.size())
+                reach.emplace_back();
+            const auto& below = reach[level];
+            auto& above = reach[level + 1];
+            above.resize((below.size() + 1) / 2);
+            from /= 2;
+            for (auto j = from; j < above.size(); ++j)
+                above[j] = 2 * j + 1 < below.size() ? std::max(below[2 * j], below[2 * j + 1]) : below[2 * j];
+        }
+        reach.resize(level + 1);
+    }
+
+    std::size_t EventStore::ReachBytes() const
+    {
+        std::size_t bytes = 0;
+        for (const auto& ends : reach)
+            bytes += ends.capacity() * sizeof(Timestamp);
+        return bytes;
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,544 @@
+#pragma once
+
+#include <algorithm> // std::min, std::max
+#include <array>
+#include <cstddef>   // std::ptrdiff_t
+#include <cstdint>
+#include <iterator>  // std::forward_iterator_tag
+#include <limits>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "ArgumentArena.hpp"
+#include "InternedTextBuffer.hpp"
+#include "MemoryBudget.hpp"
+
+namespace tagliatelle
+{
+
+    using Timestamp = std::int64_t; // nanoseconds
+    using Duration  = std::int64_t; // nanoseconds
+    using NameId    = std::uint32_t;
+    using TrackId   = std::uint32_t;
+    using Depth     = std::uint16_t;
+
+    struct Event
+    {
+        Timestamp timestamp = 0;
+        Duration  duration  = 0;
+        NameId    name      = 0;
+        TrackId   track     = 0;
+        Depth     depth     = 0;
+
+        // Run of the event's arguments in the store's arena
+        ArgumentOffset argOffset = 0;
+        std::uint16_t  argCount  = 0;
+    };
+
+    // Aggregate of all spans with one name
+    struct NameStats
+    {
+        NameId        name;
+        std::uint64_t count;
+        Duration      total;
+        Duration      self;  // total minus the time spent in direct children
+    };
+
+    template <typename T>
+    using Column = std::vector<T, BudgetAllocator<T>>;
+
+    // Struct-of-arrays event storage, one column per field
+    struct EventColumns
+    {
+        EventColumns() = default;
+
+        // Columns allocated from the budget, on the heap if it is null
+        explicit EventColumns(MemoryBudget* budget);
+
+        Column<Timestamp> timestamps;
+        Column<Duration>  durations;
+        Column<NameId>    names;
+        Column<TrackId>   tracks;
+        Column<Depth>     depths;
+
+        Column<ArgumentOffset> argOffsets;
+        Column<std::uint16_t>  argCounts;
+
+        [[nodiscard]] std::size_t Size() const
+        {
+            return timestamps.size();
+        }
+
+        [[nodiscard]] Event operator[](const std::size_t i) const
+        {
+            return Event{ timestamps[i], durations[i], names[i], tracks[i], depths[i], argOffsets[i], argCounts[i] };
+        }
+
+        void PushBack(const Event& event);
+        void Reserve(std::size_t count);
+
+        // Appends the events [first, last) of the other columns
+        void Append(const EventColumns& other, std::size_t first, std::size_t last);
+
+        // Stable sort by (timestamp, depth), so that a batch merges into a store
+        // without sorting it under the store's lock
+        void Sort();
+        void Clear();
+
+        // Bytes allocated by the columns
+        [[nodiscard]] std::size_t CapacityBytes() const;
+    };
+
+    // Event columns kept compressed, in blocks of BlockEvents events in store
+    // order. Every column of a block is bit-packed relative to its minimum in
+    // the block, timestamps as deltas to the previous event, so timestamps,
+    // tracks and depths take a few bits per event.
+    // Readers decode one column of a block at a time into a small cache of
+    // their own thread, so concurrent readers take no lock; a block decoded
+    // once serves the following accesses to it.
+    class ColdBlocks
+    {
+    public:
+        static constexpr std::size_t BlockEvents = 4096;
+        static constexpr std::size_t CacheBlocks = 8;  // decoded blocks per column and thread
+
+        enum ColumnIndex
+        {
+            TimestampColumn,
+            DurationColumn,
+            NameColumn,
+            TrackColumn,
+            DepthColumn,
+            ArgOffsetColumn,
+            ArgCountColumn,
+            ColumnCount,
+        };
+
+        ColdBlocks() = default;
+
+        // Packed words are allocated from the budget, on the heap if it is null
+        explicit ColdBlocks(MemoryBudget* budget);
+
+        MOVE_ONLY(ColdBlocks);
+
+        // Events in the blocks, a multiple of BlockEvents
+        [[nodiscard]] std::size_t Size() const
+        {
+            return blocks.size() * BlockEvents;
+        }
+
+        [[nodiscard]] std::size_t BlockCount() const
+        {
+            return blocks.size();
+        }
+
+        // Packs the BlockEvents events of the columns from first on into a new last block
+        void Pack(const EventColumns& columns, std::size_t first);
+
+        // Appends the events of the blocks from block on to the columns and drops the blocks
+        void Unpack(std::size_t block, EventColumns& out);
+
+        void Clear();
+
+        // Column of a block decoded, valid until the calling thread decodes CacheBlocks others of that column
+        template <typename T>
+        [[nodiscard]] std::span<const T, BlockEvents> Decoded(const ColumnIndex column, const std::size_t block) const
+        {
+            return std::span<const T, BlockEvents>{ static_cast<const T*>(DecodedBlock(column, block)), BlockEvents };
+        }
+
+        // Index of the first event starting at or after the given time, Size() if there is none
+        [[nodiscard]] std::size_t LowerBound(Timestamp time) const;
+
+        // Bytes of the packed words and block headers
+        [[nodiscard]] std::size_t MemoryBytes() const;
+
+    private:
+        struct PackedColumn
+        {
+            std::uint64_t base   = 0; // minimum, order-preserving unsigned form
+            std::size_t   offset = 0; // first word
+            std::uint8_t  bits   = 0; // per value, 0 if all values equal the base
+        };
+
+        struct Block
+        {
+            Timestamp                             firstTimestamp = 0;
+            std::array<PackedColumn, ColumnCount> columns;
+        };
+
+        [[nodiscard]] const void* DecodedBlock(ColumnIndex column, std::size_t block) const;
+
+        // Writes the BlockEvents values of the column of the block to out, typed as in EventColumns
+        void Decode(ColumnIndex column, std::size_t block, void* out) const;
+
+        std::vector<Block>    blocks;
+        Column<std::uint64_t> words;     // ends with a padding word once a block was packed
+        std::uint64_t         epoch = 0; // identifies the blocks in the thread caches, renewed before an index is reused
+    };
+
+    // Read access to a column of a store by event index, like a span.
+    // The values of cold events are decoded through the calling thread's cache.
+    // Valid until the store is modified.
+    template <typename T>
+    class ColumnView
+    {
+    public:
+        // Yields the values in index order
+        class Iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = T;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = void;
+            using reference         = T;
+
+            Iterator() = default;
+
+            Iterator(const ColumnView* const view, const std::size_t i)
+                : view{ view }
+                , i{ i }
+            {
+            }
+
+            T operator*() const
+            {
+                return (*view)[i];
+            }
+
+            Iterator& operator++()
+            {
+                ++i;
+                return *this;
+            }
+
+            Iterator operator++(int)
+            {
+                auto copy = *this;
+                ++i;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const
+            {
+                return i == other.i;
+            }
+
+        private:
+            const ColumnView* view = nullptr;
+            std::size_t       i    = 0;
+        };
+
+        ColumnView(const std::span<const T> hot, const ColdBlocks& cold, const ColdBlocks::ColumnIndex column)
+            : hot{ hot }
+            , cold{ &cold }
+            , coldSize{ cold.Size() }
+            , column{ column }
+        {
+        }
+
+        [[nodiscard]] T operator[](const std::size_t i) const
+        {
+            if (i >= coldSize) [[likely]]
+                return hot[i - coldSize];
+            return cold->Decoded<T>(column, i / ColdBlocks::BlockEvents)[i % ColdBlocks::BlockEvents];
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return coldSize + hot.size();
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return size() == 0;
+        }
+
+        [[nodiscard]] Iterator begin() const
+        {
+            return { this, 0 };
+        }
+
+        [[nodiscard]] Iterator end() const
+        {
+            return { this, size() };
+        }
+
+        [[nodiscard]] T front() const
+        {
+            return (*this)[0];
+        }
+
+        [[nodiscard]] T back() const
+        {
+            return (*this)[size() - 1];
+        }
+
+        // Values of the events that are not compressed, from the store's ColdSize() on
+        [[nodiscard]] std::span<const T> Hot() const
+        {
+            return hot;
+        }
+
+    private:
+        std::span<const T>      hot;
+        const ColdBlocks*       cold;
+        std::size_t             coldSize;
+        ColdBlocks::ColumnIndex column;
+    };
+
+    // Columns of a run of events, see EventStore::ForEachPart()
+    struct EventSpans
+    {
+        std::span<const Timestamp> timestamps;
+        std::span<const Duration>  durations;
+        std::span<const NameId>    names;
+        std::span<const TrackId>   tracks;
+        std::span<const Depth>     depths;
+    };
+
+    // Columnar in-memory store of all events of a trace.
+    // Events are kept sorted by (timestamp, depth) so that time range
+    // queries are binary searches followed by linear scans.
+    // Names are interned, events refer to them by ID.
+    // Event arguments live in an arena, events refer to them by (offset, count).
+    // Optionally all but the latest events are kept compressed in cold
+    // blocks, see SetHotEvents(); readers see one index space either way.
+    class EventStore
+    {
+    public:
+        static constexpr std::size_t TextPageSize = 64 * 1024;
+
+        // Track IDs are below this, it bounds the per-track tables of the trace
+        static constexpr TrackId MaxTracks = 1 << 20;
+
+        // Events per leaf of the tree of latest ends
+        static constexpr std::size_t ReachBlockSize = 64;
+
+        // Keeps every event uncompressed, the default
+        static constexpr std::size_t AllHot = std::numeric_limits<std::size_t>::max();
+
+        using NameTable = InternedTextBuffer<TextPageSize, BudgetAllocator<char>>;
+
+        EventStore() = default;
+
+        // Columns, name and argument pages are allocated from the budget, which must outlive the store
+        explicit EventStore(MemoryBudget* budget);
+
+        MOVE_ONLY(EventStore);
+
+        [[nodiscard]] NameId InternName(std::string_view name);
+
+        [[nodiscard]] std::string_view Name(const NameId id) const
+        {
+            return names.View(id);
+        }
+
+        [[nodiscard]] const NameTable& Names() const
+        {
+            return names;
+        }
+
+        // The track must be below MaxTracks
+        void SetTrackName(TrackId track, std::string_view name);
+
+        // Name of the track, empty if it was never set
+        [[nodiscard]] std::string_view TrackName(TrackId track) const;
+
+        // One past the highest track ID seen so far
+        [[nodiscard]] std::size_t TrackCount() const
+        {
+            return trackNames.size();
+        }
+
+        // Copies an event's arguments to the arena, the returned offset goes into Event::argOffset.
+        // Keys and string values must be IDs of this store's names.
+        [[nodiscard]] ArgumentOffset StoreArguments(const std::span<const Argument> run)
+        {
+            return arguments.Append(run);
+        }
+
+        [[nodiscard]] std::span<const Argument> Arguments(const std::size_t i) const
+        {
+            return arguments.View(ArgOffsets()[i], ArgCounts()[i]);
+        }
+
+        [[nodiscard]] const ArgumentArena& ArgumentStore() const
+        {
+            return arguments;
+        }
+
+        // Appending in timestamp order is O(1), older events are inserted in place.
+        // Tracks must be below MaxTracks.
+        void Append(const Event& event);
+
+        // Appends a batch, then restores the ordering with a single merge of
+        // the batch and the stored events after its first one.
+        // A sorted batch (EventColumns::Sort) is not sorted again.
+        void AppendBulk(const EventColumns& batch);
+
+        // Sets the depth of every event of the tracks to the number of spans of
+        // its track enclosing it, returns false if no depth changed
+        bool Renest(std::span<const TrackId> tracks);
+
+        void Clear();
+
+        // Keeps the events before about the last count ones compressed in cold
+        // blocks, AllHot decompresses them all. Appends compress the events
+        // that became cold in batches, once they add up to count, and inserts
+        // among the cold events decompress the blocks from there on.
+        void SetHotEvents(std::size_t count);
+
+        // Events at the start of the store that are compressed, a multiple of ColdBlocks::BlockEvents
+        [[nodiscard]] std::size_t ColdSize() const
+        {
+            return cold.Size();
+        }
+
+        [[nodiscard]] std::size_t Size() const
+        {
+            return cold.Size() + columns.Size();
+        }
+
+        [[nodiscard]] Event operator[](const std::size_t i) const
+        {
+            if (i >= cold.Size()) [[likely]]
+                return columns[i - cold.Size()];
+            return Event{ Timestamps()[i], Durations()[i], NameIds()[i], Tracks()[i], Depths()[i], ArgOffsets()[i], ArgCounts()[i] };
+        }
+
+        [[nodiscard]] ColumnView<Timestamp> Timestamps() const { return { columns.timestamps, cold, ColdBlocks::TimestampColumn }; }
+        [[nodiscard]] ColumnView<Duration>  Durations()  const { return { columns.durations, cold, ColdBlocks::DurationColumn }; }
+        [[nodiscard]] ColumnView<NameId>    NameIds()    const { return { columns.names, cold, ColdBlocks::NameColumn }; }
+        [[nodiscard]] ColumnView<TrackId>   Tracks()     const { return { columns.tracks, cold, ColdBlocks::TrackColumn }; }
+        [[nodiscard]] ColumnView<Depth>     Depths()     const { return { columns.depths, cold, ColdBlocks::DepthColumn }; }
+        [[nodiscard]] ColumnView<ArgumentOffset> ArgOffsets() const { return { columns.argOffsets, cold, ColdBlocks::ArgOffsetColumn }; }
+        [[nodiscard]] ColumnView<std::uint16_t>  ArgCounts()  const { return { columns.argCounts, cold, ColdBlocks::ArgCountColumn }; }
+
+        // Longest duration of any stored event
+        [[nodiscard]] Duration MaxDuration() const
+        {
+            return maxDuration;
+        }
+
+        // Calls fn(begin, end) for ascending runs of positions before last that
+        // hold an event ending at or after the time, the events of the positions
+        // between the runs all end before it. Finds the long spans reaching into
+        // a window in O(k log n), however long the longest span of the trace.
+        template <typename F>
+        void ForEachRunReaching(Timestamp time, std::size_t last, F&& fn) const;
+
+        // Calls fn(columns, first, last) for consecutive runs of the events
+        // [begin, end), which are [first, last) in the columns: a decoded block
+        // for each cold run, then the uncompressed columns for the hot run.
+        // Scans read spans this way rather than checking every index for cold.
+        // A decoded block stays valid while fn decodes fewer than CacheBlocks others.
+        template <typename F>
+        void ForEachPart(std::size_t begin, std::size_t end, F&& fn) const;
+
+        // Index of the first event starting at or after the given time
+        [[nodiscard]] std::size_t LowerBound(Timestamp time) const;
+
+        [[nodiscard]] MemoryBudget* Budget() const
+        {
+            return budget;
+        }
+
+        // Marks the columns of the events starting in [start, end) as recently used,
+        // so that they are the last to be evicted, and enforces the budget
+        void Touch(Timestamp start, Timestamp end) const;
+
+        // Bytes of the columns, the cold blocks, the name text and the argument pages
+        [[nodiscard]] std::size_t MemoryBytes() const
+        {
+            return columns.CapacityBytes() + cold.MemoryBytes() + names.TextBytes() + arguments.CapacityBytes() + ReachBytes();
+        }
+
+    private:
+        void TrackAppended(const Event& event);
+
+        // Restores the order of the columns from their sortedPrefix on, returns
+        // the first position in the columns whose event moved or was appended
+        std::size_t RestoreOrder(std::size_t sortedPrefix);
+
+        // Decompresses the cold blocks from block on to the front of the columns
+        void Thaw(std::size_t block);
+
+        // Compresses the whole blocks of events before the last hotEvents ones, once they add up to at least slack
+        void Freeze(std::size_t slack);
+
+        // Recomputes the latest ends of the blocks from the one holding first on
+        void UpdateReach(std::size_t first);
+        [[nodiscard]] std::size_t ReachBytes() const;
+
+        MemoryBudget*       budget = nullptr;
+        ColdBlocks          cold;               // events [0, cold.Size())
+        EventColumns        columns;            // events from cold.Size() on
+        std::size_t         hotEvents = AllHot; // see SetHotEvents()
+        NameTable           names;
+        ArgumentArena       arguments;
+        std::vector<NameId> trackNames;
+        Duration            maxDuration = 0;
+
+        // reach[0][b] is the latest end of the events in block b,
+        // reach[k][j] the latest of reach[k - 1][2j] and reach[k - 1][2j + 1]
+        std::vector<std::vector<Timestamp>> reach;
+    };
+
+    template <typename F>
+    void EventStore::ForEachPart(const std::size_t begin, const std::size_t end, F&& fn) const
+    {
+        const auto coldSize = cold.Size();
+        for (auto i = begin; i < std::min(end, coldSize);)
+        {
+            const auto block = i / ColdBlocks::BlockEvents;
+            const auto offset = block * ColdBlocks::BlockEvents;
+            const auto last = std::min(end, offset + ColdBlocks::BlockEvents);
+            fn(EventSpans{ cold.Decoded<Timestamp>(ColdBlocks::TimestampColumn, block), cold.Decoded<Duration>(ColdBlocks::DurationColumn, block),
+                           cold.Decoded<NameId>(ColdBlocks::NameColumn, block), cold.Decoded<TrackId>(ColdBlocks::TrackColumn, block),
+                           cold.Decoded<Depth>(ColdBlocks::DepthColumn, block) },
+               i - offset, last - offset);
+            i = last;
+        }
+        if (end > coldSize && end > begin)
+            fn(EventSpans{ columns.timestamps, columns.durations, columns.names, columns.tracks, columns.depths },
+               std::max(begin, coldSize) - coldSize, end - coldSize);
+    }
+
+    template <typename F>
+    void EventStore::ForEachRunReaching(const Timestamp time, const std::size_t last, F&& fn) const
+    {
+        if (reach.empty() || last == 0)
+            return;
+
+        struct Node
+        {
+            std::size_t index;
+            std::size_t level;
+        };
+        Node stack[2 * std::numeric_limits<std::size_t>::digits];
+        int top = 0;
+        stack[top++] = Node{ 0, reach.size() - 1 };
+
+        while (top > 0)
+        {
+            const auto node = stack[--top];
+            const auto& ends = reach[node.level];
+            const auto begin = (node.index << node.level) * ReachBlockSize;
+            if (node.index >= ends.size() || begin >= last || ends[node.index] < time)
+                continue;
+
+            if (node.level == 0)
+            {
+                fn(begin, std::min(begin + ReachBlockSize, last));
+                continue;
+            }
+            // Right first, so that the left child is visited first
+            stack[top++] = Node{ 2 * node.index + 1, node.level - 1 };
+            stack[top++] = Node{ 2 * node.index, node.level - 1 };
+        }
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,312 @@
+#include "FlowStore.hpp"
+
+#include <algorithm> // std::ranges::equal_range, std::ranges::inplace_merge, std::ranges::merge, std::ranges::sort, std::ranges::stable_sort
+#include <iterator>  // std::back_inserter
+#include <tuple>
+#include <unordered_set>
+#include <utility>   // std::pair
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        // Removes the edges, as many times as they are listed, from edges sorted
+        // by the key and merges the added ones in
+        template <typename Key>
+        void Patch(std::vector<FlowEdge>& edges, std::vector<FlowEdge> removed, std::vector<FlowEdge> added, Key key)
+        {
+            std::ranges::sort(removed, {}, key);
+            std::ranges::sort(added, {}, key);
+            std::vector<FlowEdge> kept;
+            kept.reserve(edges.size() - std::min(removed.size(), edges.size()));
+            auto next = removed.begin();
+            for (const auto& edge : edges)
+            {
+                while (next != removed.end() && key(*next) < key(edge))
+                    ++next;
+                if (next != removed.end() && key(*next) == key(edge))
+                    ++next;
+                else
+                    kept.push_back(edge);
+            }
+            edges.clear();
+            edges.reserve(kept.size() + added.size());
+            std::ranges::merge(kept, added, std::back_inserter(edges), {}, key, key);
+        }
+    }
+
+    void FlowStore::Append(const std::span<const FlowPoint> batch)
+    {
+        points.insert(points.end(), batch.begin(), batch.end());
+    }
+
+    void FlowStore::Build(const EventStore& events, const IntervalIndex& intervals)
+    {
+        Update(events, intervals, 0);
+    }
+
+    void FlowStore::Update(const EventStore& events, const IntervalIndex& intervals, const std::size_t first)
+    {
+        if (first == 0)
+        {
+            order.clear();
+            bound.clear();
+            outgoing.clear();
+            incoming.clear();
+            sources.clear();
+            unbound = 0;
+        }
+        const auto known = bound.size();
+        const bool moved = first < events.Size();
+        if (!moved && known == points.size())
+            return;
+        PROFILE_SCOPE("FlowStore::Update");
+
+        // Chains of equal IDs in time order, a start at the same time as a step
+        // comes first; appended points go after the known ones like in a stable sort
+        auto chainOrder = [this](const std::uint32_t i) { return std::tuple{ points[i].id, points[i].timestamp, points[i].phase }; };
+        const auto middle = static_cast<std::ptrdiff_t>(order.size());
+        for (auto i = known; i < points.size(); ++i)
+            order.push_back(static_cast<std::uint32_t>(i));
+        std::ranges::stable_sort(order.begin() + middle, order.end(), {}, chainOrder);
+        std::ranges::inplace_merge(order, order.begin() + middle, {}, chainOrder);
+
+        // A point bound before the first moved event stays bound to it unless a
+        // span inserted after it contains the point or is its next slice
+        std::vector<std::pair<std::uint32_t, EventIndex>> rebound;
+        std::vector<std::uint64_t> chains;
+        if (moved)
+        {
+            const auto timestamps = events.Timestamps();
+            const auto since = timestamps[first];
+            for (std::size_t i = 0; i < known; ++i)
+            {
+                const auto& point = points[i];
+                const auto previous = bound[i];
+                const bool reached = point.timestamp >= since || point.nextSlice;
+                if (previous == Unbound ? !reached
+                                        : previous < first && point.timestamp < since && (!point.nextSlice || timestamps[previous] < since))
+                    continue;
+                EventIndex event = 0;
+                if (!Resolve(events, intervals, point, event))
+                    event = Unbound;
+                if (event != previous)
+                {
+                    rebound.emplace_back(static_cast<std::uint32_t>(i), event);
+                    chains.push_back(point.id);
+                }
+            }
+        }
+        for (auto i = known; i < points.size(); ++i)
+            chains.push_back(points[i].id);
+        std::ranges::sort(chains);
+        chains.erase(std::ranges::unique(chains).begin(), chains.end());
+
+        auto chain = [this](const std::uint64_t id) { return std::span<const std::uint32_t>{ std::ranges::equal_range(order, id, {}, [this](const std::uint32_t i) { return points[i].id; }) }; };
+        std::vector<FlowEdge> removed;
+        for (const auto id : chains)
+            ChainEdges(chain(id), known, removed);
+
+        for (const auto& [i, event] : rebound)
+            bound[i] = event;
+        bound.resize(points.size(), Unbound);
+        for (auto i = known; i < points.size(); ++i)
+        {
+            EventIndex event = 0;
+            if (Resolve(events, intervals, points[i], event))
+                bound[i] = event;
+        }
+        unbound = static_cast<std::size_t>(std::ranges::count(bound, Unbound));
+
+        std::vector<FlowEdge> added;
+        for (const auto id : chains)
+            ChainEdges(chain(id), points.size(), added);
+        if (removed.empty() && added.empty())
+            return;
+
+        Patch(outgoing, removed, added, [](const FlowEdge& edge) { return std::tuple{ edge.from, edge.departure, edge.to, edge.arrival }; });
+        Patch(incoming, removed, added, [](const FlowEdge& edge) { return std::tuple{ edge.to, edge.arrival, edge.from, edge.departure }; });
+
+        // Sources come out in store order, which is by start
+        const auto timestamps = events.Timestamps();
+        const auto tracks = events.Tracks();
+        sources.clear();
+        for (std::size_t i = 0; i < outgoing.size(); ++i)
+        {
+            const auto from = outgoing[i].from;
+            if (i > 0 && outgoing[i - 1].from == from)
+                continue;
+            if (tracks[from] >= sources.size())
+                sources.resize(std::size_t{ tracks[from] } + 1);
+            sources[tracks[from]].push_back(Source{ timestamps[from], from });
+        }
+    }
+
+    void FlowStore::ChainEdges(const std::span<const std::uint32_t> chain, const std::size_t pointCount, std::vector<FlowEdge>& out) const
+    {
+        bool chained = false; // the previous point of the chain is bound
+        EventIndex previousEvent = 0;
+        Timestamp previousTime = 0;
+        for (const auto i : chain)
+        {
+            if (i >= pointCount)
+                continue;
+            const auto& point = points[i];
+            if (point.phase == FlowPhase::Start)
+                chained = false;
+            if (bound[i] == Unbound)
+            {
+                chained = false;
+                continue;
+            }
+            if (chained && bound[i] != previousEvent)
+                out.push_back(FlowEdge{ previousEvent, bound[i], previousTime, point.timestamp });
+            chained = point.phase != FlowPhase::End;
+            previousEvent = bound[i];
+            previousTime = point.timestamp;
+        }
+    }
+
+    std::size_t FlowStore::MemoryBytes() const
+    {
+        std::size_t bytes = points.capacity() * sizeof(FlowPoint) + order.capacity() * sizeof(std::uint32_t) + bound.capacity() * sizeof(EventIndex)
+                          + (outgoing.capacity() + incoming.capacity()) * sizeof(FlowEdge) + sources.capacity() * sizeof(sources[0]);
+        for (const auto& trackSources : sources)
+            bytes += trackSources.capacity() * sizeof(Source);
+        return bytes;
+    }
+
+    std::span<const FlowEdge> FlowStore::Outgoing(const EventIndex event) const
+    {
+        const auto [first, last] = std::ranges::equal_range(outgoing, event, {}, &FlowEdge::from);
+        return { first, last };
+    }
+
+    std::span<const FlowEdge> FlowStore::Incoming(const EventIndex event) const
+    {
+        const auto [first, last] = std::ranges::equal_range(incoming, event, {}, &FlowEdge::to);
+        return { first, last };
+    }
+
+    void FlowStore::CriticalPath(const EventStore& events, const IntervalIndex& intervals, const EventIndex event, std::vector<EventIndex>& out) const
+    {
+        PROFILE_SCOPE("FlowStore::CriticalPath");
+        out.clear();
+        if (event >= events.Size())
+            return;
+
+        const auto timestamps = events.Timestamps();
+        const auto durations = events.Durations();
+        const auto tracks = events.Tracks();
+        const auto depths = events.Depths();
+        auto end = [&](const EventIndex i) { return timestamps[i] + durations[i]; };
+
+        // The request, and the span of it that ends last
+        std::unordered_set<EventIndex> reached{ event };
+        std::vector<EventIndex> pending{ event };
+        auto sink = event;
+        while (!pending.empty())
+        {
+            const auto span = pending.back();
+            pending.pop_back();
+            if (end(span) > end(sink))
+                sink = span;
+
+            if (tracks[span] >= sources.size())
+                continue;
+            const auto& trackSources = sources[tracks[span]];
+            for (auto it = std::ranges::lower_bound(trackSources, timestamps[span], {}, &Source::timestamp);
+                 it != trackSources.end() && it->timestamp <= end(span); ++it)
+            {
+                // The span itself and the spans nested in it
+                if (it->event != span && (depths[it->event] <= depths[span] || end(it->event) > end(span)))
+                    continue;
+                for (const auto& edge : Outgoing(it->event))
+                {
+                    if (reached.insert(edge.to).second)
+                        pending.push_back(edge.to);
+                }
+            }
+        }
+
+        // Back in time from the end of the request, every edge is followed at most once
+        std::unordered_set<const FlowEdge*> followed;
+        auto current = sink;
+        auto until = end(sink);
+        while (true)
+        {
+            out.push_back(current);
+
+            const FlowEdge* latest = nullptr;
+            for (const auto& edge : Incoming(current))
+            {
+                if (edge.arrival > until)
+                    break;
+                if (!followed.contains(&edge))
+                    latest = &edge;
+            }
+            if (latest != nullptr)
+            {
+                followed.insert(latest);
+                until = latest->departure;
+                current = latest->from;
+                continue;
+            }
+
+            // Nothing arrived, the span was started by its parent
+            if (depths[current] == 0)
+                break;
+            auto parent = current;
+            intervals.ForEachStabbing(tracks[current], timestamps[current], [&](const EventIndex i)
+                {
+                    if (depths[i] + 1 == depths[current] && end(i) >= end(current))
+                        parent = i;
+                });
+            if (parent == current)
+                break;
+            until = timestamps[current];
+            current = parent;
+        }
+        std::ranges::reverse(out);
+    }
+
+    void FlowStore::Clear()
+    {
+        points.clear();
+        order.clear();
+        bound.clear();
+        outgoing.clear();
+        incoming.clear();
+        sources.clear();
+        unbound = 0;
+    }
+
+    bool FlowStore::Resolve(const EventStore& events, const IntervalIndex& intervals, const FlowPoint& point, EventIndex& event) const
+    {
+        const auto timestamps = events.Timestamps();
+        if (point.nextSlice)
+        {
+            const auto trackEvents = intervals.TrackEvents(point.track);
+            const auto next = std::ranges::lower_bound(trackEvents, point.timestamp, {}, [&](const EventIndex i) { return timestamps[i]; });
+            if (next == trackEvents.end())
+                return false;
+            event = *next;
+            return true;
+        }
+
+        // Deepest enclosing span, the latest to start if several are as deep
+        const auto depths = events.Depths();
+        bool found = false;
+        intervals.ForEachStabbing(point.track, point.timestamp, [&](const EventIndex i)
+            {
+                if (!found || depths[i] >= depths[event])
+                    event = i;
+                found = true;
+            });
+        return found;
+    }
+
+} // namespace tagliatelle
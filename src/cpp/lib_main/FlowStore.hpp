@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "EventStore.hpp"
+#include "IntervalIndex.hpp"
+
+namespace tagliatelle
+{
+
+    enum class FlowPhase : std::uint8_t
+    {
+        Start,
+        Step,
+        End,
+    };
+
+    // Point of a flow, like the s/t/f events of the Chrome format.
+    // It binds to the deepest span of its track that contains its time, or
+    // with nextSlice to the first span starting at or after it.
+    struct FlowPoint
+    {
+        std::uint64_t id; // points with equal IDs form a chain in time order
+        Timestamp     timestamp;
+        TrackId       track;
+        FlowPhase     phase     = FlowPhase::Start;
+        bool          nextSlice = false;
+    };
+
+    // Arrow from the span a flow leaves to the span it enters
+    struct FlowEdge
+    {
+        IntervalIndex::EventIndex from;
+        IntervalIndex::EventIndex to;
+        Timestamp                 departure;
+        Timestamp                 arrival;
+    };
+
+    // Flow points of a trace and the edges between spans they resolve to.
+    // Build() binds the points to spans by stabbing the interval index and
+    // sorts the edges by source and by target, so the edges of a span are
+    // found by binary search in O(log edges + degree).
+    // Update() keeps the bindings of the points the change cannot affect and
+    // only regenerates the edges of the chains whose points bound elsewhere
+    // or were appended, merging them into the sorted edges.
+    class FlowStore
+    {
+    public:
+        using EventIndex = IntervalIndex::EventIndex;
+
+        // Set in the IDs of flows matched by key, like those of imported files
+        static constexpr std::uint64_t KeyedId = std::uint64_t{ 1 } << 63;
+
+        FlowStore() = default;
+
+        MOVE_ONLY(FlowStore);
+
+        void Append(std::span<const FlowPoint> batch);
+
+        [[nodiscard]] std::size_t PointCount() const
+        {
+            return points.size();
+        }
+
+        // Resolves the points against the events, the index must be built from them
+        void Build(const EventStore& events, const IntervalIndex& intervals);
+
+        // Like Build(), after events were inserted from first on and points
+        // appended since the last build or update
+        void Update(const EventStore& events, const IntervalIndex& intervals, std::size_t first);
+
+        [[nodiscard]] std::size_t EdgeCount() const
+        {
+            return outgoing.size();
+        }
+
+        // Points of the last build that bound to no span
+        [[nodiscard]] std::size_t UnboundPoints() const
+        {
+            return unbound;
+        }
+
+        // Bytes allocated by the points, their bindings and the edges
+        [[nodiscard]] std::size_t MemoryBytes() const;
+
+        // Edges leaving the span, ordered by departure
+        [[nodiscard]] std::span<const FlowEdge> Outgoing(EventIndex event) const;
+
+        // Edges entering the span, ordered by arrival
+        [[nodiscard]] std::span<const FlowEdge> Incoming(EventIndex event) const;
+
+        // Replaces out with the critical path of the request the span belongs to,
+        // oldest span first. The request is every span reachable from the span
+        // through outgoing flows, including those of nested spans. From the span
+        // of the request that ends last, the path goes back along the latest
+        // flow that arrived before it moved on, or to the enclosing span if no
+        // flow did, until a span with neither.
+        void CriticalPath(const EventStore& events, const IntervalIndex& intervals, EventIndex event, std::vector<EventIndex>& out) const;
+
+        void Clear();
+
+    private:
+        struct Source
+        {
+            Timestamp  timestamp;
+            EventIndex event;
+        };
+
+        static constexpr EventIndex Unbound = ~EventIndex{ 0 };
+
+        [[nodiscard]] bool Resolve(const EventStore& events, const IntervalIndex& intervals, const FlowPoint& point, EventIndex& event) const;
+
+        // Appends the edges of a chain of points in time order, skipping the points from pointCount on
+        void ChainEdges(std::span<const std::uint32_t> chain, std::size_t pointCount, std::vector<FlowEdge>& out) const;
+
+        std::vector<FlowPoint>           points;
+        std::vector<std::uint32_t>       order;    // points by ID, time and phase
+        std::vector<EventIndex>          bound;    // span of each resolved point, Unbound if none
+        std::vector<FlowEdge>            outgoing; // by source, then departure
+        std::vector<FlowEdge>            incoming; // by target, then arrival
+        std::vector<std::vector<Source>> sources;  // spans with outgoing edges of each track, by start
+        std::size_t                      unbound = 0;
+    };
+
+} // namespace tagliatelle
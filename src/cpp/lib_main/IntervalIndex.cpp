@@ -0,0 +1,169 @@
+#include "IntervalIndex.hpp"
+
+#include <algorithm> // std::copy, std::max, std::min, std::ranges::lower_bound
+#include <limits>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    void IntervalIndex::Build(const EventStore& events)
+    {
+        PROFILE_SCOPE("IntervalIndex::Build");
+        const auto trackIds = events.Tracks();
+        const auto timestamps = events.Timestamps();
+        const auto durations = events.Durations();
+
+        std::vector<std::size_t> counts(events.TrackCount(), 0);
+        for (const auto track : trackIds)
+            ++counts[track];
+
+        tracks.clear();
+        tracks.resize(counts.size());
+        for (std::size_t t = 0; t < counts.size(); ++t)
+        {
+            tracks[t].starts.reserve(counts[t]);
+            tracks[t].ends.reserve(counts[t]);
+            tracks[t].events.reserve(counts[t]);
+        }
+
+        // The store is sorted by timestamp, so each track is too
+        for (std::size_t i = 0; i < events.Size(); ++i)
+        {
+            auto& track = tracks[trackIds[i]];
+            track.starts.push_back(timestamps[i]);
+            track.ends.push_back(timestamps[i] + durations[i]);
+            track.events.push_back(static_cast<EventIndex>(i));
+        }
+
+        for (auto& track : tracks)
+            Augment(track);
+    }
+
+    void IntervalIndex::Update(const EventStore& events, const std::size_t first)
+    {
+        if (first == 0)
+        {
+            Build(events);
+            return;
+        }
+        if (first >= events.Size())
+            return;
+
+        PROFILE_SCOPE("IntervalIndex::Update");
+        const auto trackIds = events.Tracks();
+        const auto timestamps = events.Timestamps();
+        const auto durations = events.Durations();
+        if (tracks.size() < events.TrackCount())
+            tracks.resize(events.TrackCount());
+
+        // Events are only ever inserted, so a track with stale positions has
+        // events from first on and is truncated when it is first seen
+        constexpr auto Untouched = std::numeric_limits<std::size_t>::max();
+        std::vector<std::size_t> changedFrom(tracks.size(), Untouched);
+        std::vector<TrackId> touched;
+        for (auto i = first; i < events.Size(); ++i)
+        {
+            const auto t = trackIds[i];
+            auto& track = tracks[t];
+            if (changedFrom[t] == Untouched)
+            {
+                const auto keep = static_cast<std::size_t>(std::ranges::lower_bound(track.events, static_cast<EventIndex>(first)) - track.events.begin());
+                track.starts.resize(keep);
+                track.ends.resize(keep);
+                track.events.resize(keep);
+                changedFrom[t] = keep;
+                touched.push_back(t);
+            }
+            track.starts.push_back(timestamps[i]);
+            track.ends.push_back(timestamps[i] + durations[i]);
+            track.events.push_back(static_cast<EventIndex>(i));
+        }
+
+        for (const auto t : touched)
+            Augment(tracks[t], changedFrom[t]);
+    }
+
+    std::size_t IntervalIndex::MemoryBytes() const
+    {
+        std::size_t bytes = tracks.capacity() * sizeof(Track);
+        for (const auto& track : tracks)
+        {
+            bytes += (track.starts.capacity() + track.ends.capacity() + track.maxEnds.capacity()) * sizeof(Timestamp)
+                   + track.events.capacity() * sizeof(EventIndex);
+        }
+        return bytes;
+    }
+
+    void IntervalIndex::Clear()
+    {
+        tracks.clear();
+    }
+
+    void IntervalIndex::Augment(Track& track, const std::size_t first)
+    {
+        const auto n = track.starts.size();
+        track.maxEnds.resize(n);
+        std::copy(track.ends.begin() + static_cast<std::ptrdiff_t>(std::min(first, n)), track.ends.end(),
+                  track.maxEnds.begin() + static_cast<std::ptrdiff_t>(std::min(first, n)));
+        track.maxLevel = -1;
+        if (n == 0)
+            return;
+
+        // Leaves are the even positions, last tracks the end bound of the
+        // rightmost subtree, whose nodes beyond n do not exist
+        const std::size_t leaf = (n - 1) & ~std::size_t{ 1 };
+        std::size_t lastIndex = leaf;
+        Timestamp last = track.ends[leaf];
+
+        // A node at a level covers the positions up to i + 2x - 1, and those
+        // that end before the first change keep their bounds
+        int level = 1;
+        for (; (std::size_t{ 1 } << level) <= n; ++level)
+        {
+            const auto x = std::size_t{ 1 } << (level - 1);
+            const auto step = x << 2;
+            auto i = (x << 1) - 1;
+            if (first > i + (x << 1) - 1)
+                i += (first - i - (x << 1) + 1 + step - 1) / step * step;
+            for (; i < n; i += step)
+            {
+                const auto left = track.maxEnds[i - x];
+                const auto right = i + x < n ? track.maxEnds[i + x] : last;
+                track.maxEnds[i] = std::max({ track.ends[i], left, right });
+            }
+
+            lastIndex = (lastIndex >> level & 1) ? lastIndex - x : lastIndex + x;
+            if (lastIndex < n)
+                last = std::max(last, track.maxEnds[lastIndex]);
+        }
+        track.maxLevel = level - 1;
+    }
+
+    std::optional<IntervalIndex::EventIndex> IntervalIndex::HitTest(const EventStore& events, const TrackId track, const Depth depth,
+                                                                   const Timestamp time, const Duration tolerance) const
+    {
+        std::optional<EventIndex> best;
+        Duration bestDistance = 0;
+        constexpr auto Min = std::numeric_limits<Timestamp>::min();
+        constexpr auto Max = std::numeric_limits<Timestamp>::max();
+        const auto first = time < Min + tolerance ? Min : time - tolerance;
+        const auto last = time > Max - tolerance ? Max : time + tolerance;
+        ForEachOverlap(track, first, last, [&](const EventIndex index)
+            {
+                if (events.Depths()[index] != depth)
+                    return;
+                const auto start = events.Timestamps()[index];
+                const auto end = start + events.Durations()[index];
+                const auto distance = time < start ? start - time : (time > end ? time - end : 0);
+                if (!best || distance < bestDistance)
+                {
+                    best = index;
+                    bestDistance = distance;
+                }
+            });
+        return best;
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm> // std::min
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "EventStore.hpp"
+
+namespace tagliatelle
+{
+
+    // Per-track implicit augmented interval trees over the events of a store.
+    // The spans of a track are laid out sorted by start, the array itself is
+    // the tree: node i sits at the level given by its trailing one bits and
+    // stores the latest end of its subtree, so a query can skip every subtree
+    // that ends before the window. Overlap and stabbing queries take
+    // O(log n + k) with no pointers and three arrays per track.
+    // Spans are closed intervals [start, start + duration], so zero-length
+    // instants are found at their timestamp.
+    class IntervalIndex
+    {
+    public:
+        using EventIndex = std::uint32_t; // position in the event store
+
+        IntervalIndex() = default;
+
+        MOVE_ONLY(IntervalIndex);
+
+        // Bulk build in O(n), events of a track are already sorted by start in the store
+        void Build(const EventStore& events);
+
+        // Re-indexes the events from first on, those before it must not have
+        // changed since the index was last built or updated. Only the tracks
+        // with events from first on are touched, and of each only the nodes
+        // covering its positions from the first one that changed.
+        void Update(const EventStore& events, std::size_t first);
+        void Clear();
+
+        [[nodiscard]] std::size_t TrackCount() const
+        {
+            return tracks.size();
+        }
+
+        // Bytes allocated by the arrays of the tracks
+        [[nodiscard]] std::size_t MemoryBytes() const;
+
+        // Events of the track ordered by start
+        [[nodiscard]] std::span<const EventIndex> TrackEvents(const TrackId track) const
+        {
+            if (track >= tracks.size())
+                return {};
+            return tracks[track].events;
+        }
+
+        // Calls fn(EventIndex) for every span of the track that overlaps [first, last], ordered by start
+        template <typename F>
+        void ForEachOverlap(TrackId track, Timestamp first, Timestamp last, F&& fn) const;
+
+        // Calls fn(EventIndex) for every span of the track that contains the time
+        template <typename F>
+        void ForEachStabbing(const TrackId track, const Timestamp time, F&& fn) const
+        {
+            ForEachOverlap(track, time, time, fn);
+        }
+
+        // Span at the depth that contains the time, otherwise the closest one
+        // within the tolerance, nullopt if there is none
+        [[nodiscard]] std::optional<EventIndex> HitTest(const EventStore& events, TrackId track, Depth depth,
+                                                        Timestamp time, Duration tolerance) const;
+
+    private:
+        struct Track
+        {
+            std::vector<Timestamp>  starts;
+            std::vector<Timestamp>  ends;
+            std::vector<Timestamp>  maxEnds; // latest end in the subtree of each node
+            std::vector<EventIndex> events;
+            int                     maxLevel = -1;
+        };
+
+        // Recomputes the bounds of the nodes covering positions from first on
+        static void Augment(Track& track, std::size_t first = 0);
+
+        std::vector<Track> tracks;
+    };
+
+    template <typename F>
+    void IntervalIndex::ForEachOverlap(const TrackId track, const Timestamp first, const Timestamp last, F&& fn) const
+    {
+        if (track >= tracks.size() || first > last)
+            return;
+
+        const auto& t = tracks[track];
+        const auto n = t.starts.size();
+        if (n == 0)
+            return;
+
+        // Subtrees of at most 16 nodes are scanned linearly
+        struct Frame
+        {
+            std::size_t x;
+            int         level;
+            bool        leftDone;
+        };
+        Frame stack[64];
+        int top = 0;
+        stack[top++] = Frame{ (std::size_t{ 1 } << t.maxLevel) - 1, t.maxLevel, false };
+
+        while (top > 0)
+        {
+            const auto frame = stack[--top];
+            if (frame.level <= 3)
+            {
+                const auto begin = frame.x >> frame.level << frame.level;
+                const auto end = std::min(begin + (std::size_t{ 1 } << (frame.level + 1)) - 1, n);
+                for (auto i = begin; i < end && t.starts[i] <= last; ++i)
+                {
+                    if (t.ends[i] >= first)
+                        fn(t.events[i]);
+                }
+            }
+            else if (!frame.leftDone)
+            {
+                const auto left = frame.x - (std::size_t{ 1 } << (frame.level - 1));
+                stack[top++] = Frame{ frame.x, frame.level, true };
+                if (left >= n || t.maxEnds[left] >= first)
+                    stack[top++] = Frame{ left, frame.level - 1, false };
+            }
+            else if (frame.x < n && t.starts[frame.x] <= last)
+            {
+                if (t.ends[frame.x] >= first)
+                    fn(t.events[frame.x]);
+                stack[top++] = Frame{ frame.x + (std::size_t{ 1 } << (frame.level - 1)), frame.level - 1, false };
+            }
+        }
+    }
+
+} // namespace tagliatelle
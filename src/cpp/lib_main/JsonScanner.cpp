@@ -0,0 +1,169 @@
+#include "JsonScanner.hpp"
+
+#include <algorithm> // std::copy_n, std::fill_n
+#include <bit>       // std::countr_zero
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define TAGLIATELLE_JSON_AVX2 1
+    #include <immintrin.h>
+#endif
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        JsonBlockMasks ClassifyScalar(const char* block)
+        {
+            JsonBlockMasks masks{};
+            for (std::size_t i = 0; i < 64; ++i)
+            {
+                const auto bit = std::uint64_t{ 1 } << i;
+                switch (block[i])
+                {
+                case '"':  masks.quotes |= bit; break;
+                case '\\': masks.backslashes |= bit; break;
+                case '{': case '}': case '[': case ']': case ':': case ',':
+                    masks.operators |= bit;
+                    break;
+                default:
+                    break;
+                }
+            }
+            return masks;
+        }
+
+#ifdef TAGLIATELLE_JSON_AVX2
+
+        __attribute__((target("avx2")))
+        std::uint64_t Mask64(const __m256i lo, const __m256i hi)
+        {
+            const auto low = static_cast<std::uint32_t>(_mm256_movemask_epi8(lo));
+            const auto high = static_cast<std::uint32_t>(_mm256_movemask_epi8(hi));
+            return low | (std::uint64_t{ high } << 32);
+        }
+
+        __attribute__((target("avx2")))
+        std::uint64_t EqMask(const __m256i lo, const __m256i hi, const char c)
+        {
+            const auto v = _mm256_set1_epi8(c);
+            return Mask64(_mm256_cmpeq_epi8(lo, v), _mm256_cmpeq_epi8(hi, v));
+        }
+
+        __attribute__((target("avx2")))
+        JsonBlockMasks ClassifyAvx2(const char* block)
+        {
+            const auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            const auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+            // Setting bit 5 folds '[' onto '{' and ']' onto '}'
+            const auto bit5 = _mm256_set1_epi8(0x20);
+            const auto foldedLo = _mm256_or_si256(lo, bit5);
+            const auto foldedHi = _mm256_or_si256(hi, bit5);
+
+            return JsonBlockMasks{
+                EqMask(lo, hi, '"'),
+                EqMask(lo, hi, '\\'),
+                EqMask(foldedLo, foldedHi, '{') | EqMask(foldedLo, foldedHi, '}') | EqMask(lo, hi, ':') | EqMask(lo, hi, ','),
+            };
+        }
+
+        bool CpuHasAvx2()
+        {
+            return __builtin_cpu_supports("avx2");
+        }
+
+#else
+
+        bool CpuHasAvx2()
+        {
+            return false;
+        }
+
+#endif
+
+        // Bits of characters escaped by an odd-length backslash run,
+        // carry is 1 if the block ends in the middle of such a run
+        std::uint64_t FindEscaped(const std::uint64_t backslashes, std::uint64_t& carry)
+        {
+            constexpr std::uint64_t EvenBits = 0x5555'5555'5555'5555ull;
+            constexpr std::uint64_t OddBits = ~EvenBits;
+
+            const auto startEdges = backslashes & ~(backslashes << 1);
+            const auto evenStartMask = EvenBits ^ carry;
+            const auto evenStarts = startEdges & evenStartMask;
+            const auto oddStarts = startEdges & ~evenStartMask;
+
+            const auto evenCarries = backslashes + evenStarts;
+            auto oddCarries = backslashes + oddStarts;
+            const bool endsOdd = oddCarries < backslashes;
+            oddCarries |= carry;
+            carry = endsOdd ? 1 : 0;
+
+            const auto evenCarryEnds = evenCarries & ~backslashes;
+            const auto oddCarryEnds = oddCarries & ~backslashes;
+            return (evenCarryEnds & OddBits) | (oddCarryEnds & EvenBits);
+        }
+
+        // Bit i is the parity of the bits 0..i
+        std::uint64_t PrefixXor(std::uint64_t bits)
+        {
+            bits ^= bits << 1;
+            bits ^= bits << 2;
+            bits ^= bits << 4;
+            bits ^= bits << 8;
+            bits ^= bits << 16;
+            bits ^= bits << 32;
+            return bits;
+        }
+    }
+
+    bool JsonScannerHasAvx2()
+    {
+        static const bool hasAvx2 = CpuHasAvx2();
+        return hasAvx2;
+    }
+
+    JsonStructuralScanner::JsonStructuralScanner(const std::string_view json, const JsonScanKernel kernel)
+        : json{ json }
+        , classify{ &ClassifyScalar }
+    {
+#ifdef TAGLIATELLE_JSON_AVX2
+        if (kernel == JsonScanKernel::Best && JsonScannerHasAvx2())
+            classify = &ClassifyAvx2;
+#else
+        (void)kernel;
+#endif
+    }
+
+    bool JsonStructuralScanner::Refill()
+    {
+        head = tail = 0;
+        for (std::size_t b = 0; (b < BlocksPerBatch || tail == 0) && offset < json.size(); ++b, offset += BlockSize)
+        {
+            const char* block = json.data() + offset;
+            std::array<char, BlockSize> padded;
+            if (json.size() - offset < BlockSize) [[unlikely]]
+            {
+                const auto remaining = json.size() - offset;
+                std::copy_n(block, remaining, padded.begin());
+                std::fill_n(padded.begin() + remaining, BlockSize - remaining, ' ');
+                block = padded.data();
+            }
+
+            const auto masks = classify(block);
+            const auto quotes = masks.quotes & ~FindEscaped(masks.backslashes, escapeCarry);
+            const auto inString = PrefixXor(quotes) ^ inStringCarry;
+            inStringCarry = static_cast<std::uint64_t>(static_cast<std::int64_t>(inString) >> 63);
+
+            auto structurals = (masks.operators & ~inString) | quotes;
+            while (structurals != 0)
+            {
+                positions[tail++] = offset + std::countr_zero(structurals);
+                structurals &= structurals - 1;
+            }
+        }
+        return tail > 0;
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    // Structural bitmasks of a 64-byte block, bit i stands for byte i
+    struct JsonBlockMasks
+    {
+        std::uint64_t quotes;     // '"'
+        std::uint64_t backslashes;
+        std::uint64_t operators;  // '{' '}' '[' ']' ':' ','
+    };
+
+    enum class JsonScanKernel
+    {
+        Best,   // AVX2 if the CPU supports it, scalar otherwise
+        Scalar,
+    };
+
+    // True if JsonScanKernel::Best resolves to the AVX2 kernel on this machine
+    [[nodiscard]] bool JsonScannerHasAvx2();
+
+    // Streaming stage 1 of a simdjson-style parser: yields the offsets of
+    // the structural characters of a JSON document, that is operators
+    // outside of strings and unescaped quotes, in document order.
+    // Blocks of 64 bytes are classified into bitmasks with SIMD compares,
+    // escapes and string interiors are resolved with carry-propagating
+    // bit arithmetic, so no byte-at-a-time branching is needed.
+    // Offsets are produced lazily a batch at a time, memory use is constant.
+    class JsonStructuralScanner
+    {
+    public:
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        explicit JsonStructuralScanner(std::string_view json, JsonScanKernel kernel = JsonScanKernel::Best);
+
+        IMMOVABLE(JsonStructuralScanner);
+
+        // Offset of the next structural character, npos at the end of the document
+        [[nodiscard]] std::size_t Next()
+        {
+            if (head == tail && !Refill()) [[unlikely]]
+                return npos;
+            return positions[head++];
+        }
+
+        [[nodiscard]] std::size_t Peek()
+        {
+            if (head == tail && !Refill()) [[unlikely]]
+                return npos;
+            return positions[head];
+        }
+
+        // Bytes classified so far, useful for progress reporting
+        [[nodiscard]] std::size_t Scanned() const
+        {
+            return offset;
+        }
+
+        // True if the document ended inside a string
+        [[nodiscard]] bool UnterminatedString() const
+        {
+            return offset >= json.size() && inStringCarry != 0;
+        }
+
+    private:
+        static constexpr std::size_t BlockSize = 64;
+        static constexpr std::size_t BlocksPerBatch = 16;
+
+        using MaskFn = JsonBlockMasks (*)(const char* block);
+
+        bool Refill();
+
+        std::string_view json;
+        MaskFn           classify;
+        std::size_t      offset = 0;
+
+        std::uint64_t inStringCarry = 0; // all ones if the previous block ended inside a string
+        std::uint64_t escapeCarry   = 0; // 1 if the previous block ended with an odd backslash run
+
+        std::array<std::size_t, BlockSize * BlocksPerBatch> positions;
+        std::size_t head = 0;
+        std::size_t tail = 0;
+    };
+
+} // namespace tagliatelle
@@ -0,0 +1,526 @@
+#include "LiveCapture.hpp"
+
+#include <algorithm> // std::max, std::ranges::find
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>   // std::exchange
+
+#include "LiveProtocol.hpp"
+#include "ProfileMacros.hpp"
+#include "SpscRing.hpp"
+#include "StableTextBuffer.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define TAGLIATELLE_LIVE_CAPTURE 1
+    #include <cerrno>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        constexpr int           PollTimeoutMs = 100;
+        constexpr std::uint32_t Unmapped      = ~std::uint32_t{ 0 }; // local name or track without a trace ID
+
+        // Decoded message as it travels from a receiver to the consumer
+        struct LiveRecord
+        {
+            LiveMessageType  type = LiveMessageType::Event;
+            std::uint32_t    id   = 0;
+            Event            event;
+            std::string_view text; // stored in the connection's text buffer
+        };
+
+#ifdef TAGLIATELLE_LIVE_CAPTURE
+        [[noreturn]] void ThrowErrno(const char* what)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        // Waits until the descriptor is readable, false on timeout or interruption
+        bool WaitReadable(const int fd)
+        {
+            pollfd request{ fd, POLLIN, 0 };
+            return ::poll(&request, 1, PollTimeoutMs) > 0;
+        }
+#endif
+    }
+
+    struct LiveCapture::Connection
+    {
+        Connection(const int fd, std::shared_ptr<PagePool<TextPageSize>> textPages)
+            : fd{ fd }
+            , texts{ std::move(textPages) }
+        {
+        }
+
+        int                                     fd;
+        SpscRing<LiveRecord, RingCapacity>      ring;
+        StableTextBuffer<TextPageSize>          texts;     // receiver only
+        std::uint32_t                           nameCount      = 0; // receiver only
+        std::uint32_t                           trackNameCount = 0; // receiver only
+        std::atomic<bool>                       closed         = false;
+
+        std::vector<NameId>  names;  // consumer only, local to trace IDs
+        std::vector<TrackId> tracks; // consumer only, local to trace tracks
+
+        std::jthread receiver;
+    };
+
+    LiveCapture::LiveCapture(Trace& trace, std::shared_mutex& traceMutex)
+        : trace{ trace }
+        , traceMutex{ traceMutex }
+        , textPages{ std::make_shared<PagePool<TextPageSize>>(PagePoolOptions{ MaxFreePages, true }) }
+    {
+    }
+
+    LiveCapture::~LiveCapture()
+    {
+        Stop();
+    }
+
+    bool LiveCapture::Supported()
+    {
+#ifdef TAGLIATELLE_LIVE_CAPTURE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void LiveCapture::Start(const std::filesystem::path& socketPath)
+    {
+        ASSERT((listenFd < 0), "LiveCapture: already started");
+#ifdef TAGLIATELLE_LIVE_CAPTURE
+        const auto native = socketPath.native();
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (native.size() >= sizeof(address.sun_path))
+            throw std::system_error(std::make_error_code(std::errc::filename_too_long), "LiveCapture: socket path");
+        native.copy(address.sun_path, native.size());
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            ThrowErrno("LiveCapture: socket");
+        ::unlink(native.c_str());
+        if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0)
+        {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "LiveCapture: bind");
+        }
+
+        this->socketPath = socketPath;
+        listenFd = fd;
+        consumer = std::jthread([this](std::stop_token stop) { Consume(stop); });
+        acceptor = std::jthread([this](std::stop_token stop) { Accept(stop); });
+#else
+        (void)socketPath;
+        throw std::system_error(std::make_error_code(std::errc::not_supported), "LiveCapture: Unix domain sockets are not available");
+#endif
+    }
+
+    void LiveCapture::Stop()
+    {
+        if (listenFd < 0)
+            return;
+
+        acceptor = {};
+        {
+            std::scoped_lock lock{ connectionsMutex };
+            for (auto& connection : connections)
+                connection->receiver = {};
+        }
+        // The consumer commits what is left in the rings before exiting
+        consumer = {};
+        connections.clear();
+
+#ifdef TAGLIATELLE_LIVE_CAPTURE
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+#endif
+        listenFd = -1;
+    }
+
+    LiveStats LiveCapture::Stats() const
+    {
+        LiveStats stats;
+        stats.connections = openConnections;
+        stats.eventsReceived = eventsReceived;
+        stats.eventsCommitted = eventsCommitted;
+        stats.eventsDropped = eventsDropped;
+        stats.malformedMessages = malformedMessages;
+        stats.textPages = textPages->Stats();
+        return stats;
+    }
+
+    void LiveCapture::Accept(std::stop_token stop)
+    {
+#ifdef TAGLIATELLE_LIVE_CAPTURE
+        while (!stop.stop_requested())
+        {
+            if (!WaitReadable(listenFd))
+                continue;
+            const int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            if (openConnections >= MaxConnections)
+            {
+                ::close(fd);
+                continue;
+            }
+
+            ++openConnections;
+            auto connection = std::make_unique<Connection>(fd, textPages);
+            connection->receiver = std::jthread([this, &connection = *connection](std::stop_token stop) { Receive(stop, connection); });
+
+            std::scoped_lock lock{ connectionsMutex };
+            connections.push_back(std::move(connection));
+        }
+#else
+        (void)stop;
+#endif
+    }
+
+    void LiveCapture::Receive(std::stop_token stop, Connection& connection)
+    {
+#ifdef TAGLIATELLE_LIVE_CAPTURE
+        std::string buffer;
+        std::array<char, 64 * 1024> chunk;
+        bool handshake = false;
+
+        // Definitions must not be lost, events may be dropped
+        auto push = [&](const LiveRecord& record)
+            {
+                if (record.type == LiveMessageType::Event)
+                {
+                    if (!connection.ring.TryPush(record))
+                        ++eventsDropped;
+                    return;
+                }
+                while (!connection.ring.TryPush(record) && !stop.stop_requested())
+                    std::this_thread::yield();
+            };
+
+        auto dispatch = [&](const LiveMessage& message)
+            {
+                LiveRecord record;
+                record.type = message.type;
+                record.id = message.id;
+                switch (message.type)
+                {
+                case LiveMessageType::Name:
+                    if (message.id >= MaxLocalNames || connection.nameCount >= MaxLocalNames)
+                    {
+                        ++malformedMessages;
+                        return;
+                    }
+                    ++connection.nameCount;
+                    record.text = connection.texts.Store(message.text);
+                    break;
+                case LiveMessageType::TrackName:
+                    if (message.id >= MaxLocalTracks || connection.trackNameCount >= MaxTrackNames)
+                    {
+                        ++malformedMessages;
+                        return;
+                    }
+                    ++connection.trackNameCount;
+                    record.text = connection.texts.Store(message.text);
+                    break;
+                case LiveMessageType::Event:
+                    ++eventsReceived;
+                    record.event = Event{ message.timestamp, message.duration, message.name, message.track, message.depth };
+                    break;
+                }
+                push(record);
+            };
+
+        while (!stop.stop_requested())
+        {
+            if (!WaitReadable(connection.fd))
+                continue;
+            const auto received = ::recv(connection.fd, chunk.data(), chunk.size(), 0);
+            if (received < 0 && errno == EINTR)
+                continue;
+            if (received <= 0)
+                break;
+            buffer.append(chunk.data(), static_cast<std::size_t>(received));
+
+            std::size_t position = 0;
+            if (!handshake)
+            {
+                if (buffer.size() < LiveHandshakeSize)
+                    continue;
+                if (!LiveCheckHandshake(buffer))
+                {
+                    ++malformedMessages;
+                    break;
+                }
+                handshake = true;
+                position = LiveHandshakeSize;
+            }
+
+            LiveMessage message;
+            std::size_t consumed = 0;
+            auto result = LiveDecodeResult::Ok;
+            while ((result = LiveDecode(std::string_view{ buffer }.substr(position), message, consumed)) == LiveDecodeResult::Ok)
+            {
+                dispatch(message);
+                position += consumed;
+            }
+            if (result == LiveDecodeResult::Invalid)
+            {
+                ++malformedMessages;
+                break;
+            }
+            buffer.erase(0, position);
+        }
+
+        ::close(connection.fd);
+        --openConnections;
+#else
+        (void)stop;
+#endif
+        connection.closed.store(true, std::memory_order_release);
+    }
+
+    void LiveCapture::Consume(std::stop_token stop)
+    {
+        using namespace std::chrono_literals;
+
+        while (!stop.stop_requested())
+        {
+            if (!Commit())
+                std::this_thread::sleep_for(1ms);
+        }
+        while (Commit())
+        {
+        }
+    }
+
+    bool LiveCapture::Commit()
+    {
+        std::vector<Connection*> snapshot;
+        {
+            std::scoped_lock lock{ connectionsMutex };
+            for (const auto& connection : connections)
+                snapshot.push_back(connection.get());
+        }
+
+        EventColumns batch;
+        std::array<LiveRecord, 4096> popped;
+        std::unique_lock lock{ traceMutex, std::defer_lock };
+        std::vector<Connection*> finished;
+
+        for (auto* connection : snapshot)
+        {
+            // Closed is set after the receiver's last push
+            const bool closed = connection->closed.load(std::memory_order_acquire);
+
+            std::size_t count = 0;
+            while (batch.Size() < CommitBatch && (count = connection->ring.PopBulk(popped)) > 0)
+            {
+                if (!lock.owns_lock())
+                    lock.lock();
+
+                for (const auto& record : std::span{ popped }.first(count))
+                {
+                    switch (record.type)
+                    {
+                    case LiveMessageType::Name:
+                        if (record.id >= connection->names.size())
+                            connection->names.resize(record.id + 1, Unmapped);
+                        connection->names[record.id] = trace.InternName(record.text);
+                        break;
+                    case LiveMessageType::TrackName:
+                    case LiveMessageType::Event:
+                    {
+                        const auto local = record.type == LiveMessageType::Event ? record.event.track : record.id;
+                        if (local >= MaxLocalTracks || (record.type == LiveMessageType::Event
+                            && (record.event.name >= connection->names.size() || connection->names[record.event.name] == Unmapped || record.event.duration < 0)))
+                        {
+                            ++malformedMessages;
+                            break;
+                        }
+
+                        if (local >= connection->tracks.size())
+                            connection->tracks.resize(local + 1, Unmapped);
+                        auto& track = connection->tracks[local];
+                        if (track == Unmapped)
+                        {
+                            const auto next = std::max<TrackId>(nextTrack, static_cast<TrackId>(trace.Events().TrackCount()));
+                            if (next >= EventStore::MaxTracks)
+                            {
+                                ++malformedMessages;
+                                break;
+                            }
+                            track = next;
+                            nextTrack = track + 1;
+                        }
+
+                        if (record.type == LiveMessageType::TrackName)
+                        {
+                            trace.SetTrackName(track, record.text);
+                        }
+                        else
+                        {
+                            auto event = record.event;
+                            event.name = connection->names[event.name];
+                            event.track = track;
+                            batch.PushBack(event);
+                        }
+                        break;
+                    }
+                    }
+                }
+            }
+
+            if (closed && connection->ring.Empty())
+                finished.push_back(connection);
+        }
+
+        if (batch.Size() > 0)
+        {
+            trace.AppendBulk(batch);
+            eventsCommitted += batch.Size();
+        }
+        const bool committed = lock.owns_lock();
+        if (lock.owns_lock())
+            lock.unlock();
+
+        // Receivers of finished connections have exited, joining them is immediate
+        if (!finished.empty())
+        {
+            std::vector<std::unique_ptr<Connection>> removed;
+            {
+                std::scoped_lock connectionsLock{ connectionsMutex };
+                for (auto it = connections.begin(); it != connections.end();)
+                {
+                    if (std::ranges::find(finished, it->get()) == finished.end())
+                    {
+                        ++it;
+                        continue;
+                    }
+                    removed.push_back(std::move(*it));
+                    it = connections.erase(it);
+                }
+            }
+        }
+        return committed;
+    }
+
+    bool IsLiveStream(const std::string_view data)
+    {
+        return LiveCheckHandshake(data);
+    }
+
+    namespace
+    {
+        // Decodes into out, handing it to the sink whenever it holds chunkEvents events if there is one
+        void DecodeLiveStream(const std::string_view data, ParsedChunk& out, const std::size_t chunkEvents, const ChunkSink* sink,
+                              std::atomic<std::uint64_t>* bytesDecoded)
+        {
+            if (!LiveCheckHandshake(data))
+                throw std::runtime_error("ImportLiveStream: missing handshake");
+
+            // By producer-local ID, names are interned into a chunk when it first refers to them
+            std::vector<std::string_view> texts;
+            std::vector<NameId> names;
+            std::vector<std::uint32_t> interned;
+            auto intern = [&](const std::uint32_t id)
+                {
+                    if (names[id] == Unmapped)
+                    {
+                        names[id] = out.names.Intern(texts[id]);
+                        interned.push_back(id);
+                    }
+                    return names[id];
+                };
+
+            LiveMessage message;
+            std::size_t position = LiveHandshakeSize;
+            std::size_t consumed = 0;
+            auto result = LiveDecodeResult::Ok;
+            while ((result = LiveDecode(data.substr(position), message, consumed)) == LiveDecodeResult::Ok)
+            {
+                position += consumed;
+                switch (message.type)
+                {
+                case LiveMessageType::Name:
+                    if (message.id >= LiveCapture::MaxLocalNames)
+                    {
+                        ++out.malformedRecords;
+                        break;
+                    }
+                    if (message.id >= names.size())
+                    {
+                        names.resize(message.id + 1, Unmapped);
+                        texts.resize(message.id + 1);
+                    }
+                    texts[message.id] = message.text;
+                    names[message.id] = Unmapped;
+                    (void)intern(message.id);
+                    break;
+                case LiveMessageType::TrackName:
+                    if (message.id >= LiveCapture::MaxLocalTracks)
+                    {
+                        ++out.malformedRecords;
+                        break;
+                    }
+                    out.trackNames.emplace_back(message.id, out.names.Intern(message.text));
+                    break;
+                case LiveMessageType::Event:
+                    // Texts of defined names point into the data, even empty ones
+                    if (message.track >= LiveCapture::MaxLocalTracks || message.name >= names.size() || texts[message.name].data() == nullptr
+                        || message.duration < 0)
+                    {
+                        ++out.malformedRecords;
+                        break;
+                    }
+                    out.columns.PushBack(Event{ message.timestamp, message.duration, intern(message.name), message.track, message.depth });
+                    if (sink != nullptr && out.columns.Size() >= chunkEvents)
+                    {
+                        if (bytesDecoded != nullptr)
+                            bytesDecoded->store(position, std::memory_order_relaxed);
+                        if (!(*sink)(std::exchange(out, ParsedChunk{})))
+                            return;
+                        for (const auto id : interned)
+                            names[id] = Unmapped;
+                        interned.clear();
+                    }
+                    break;
+                }
+            }
+            if (position < data.size())
+                ++out.malformedRecords;
+
+            if (bytesDecoded != nullptr)
+                bytesDecoded->store(data.size(), std::memory_order_relaxed);
+            if (sink != nullptr)
+                (void)(*sink)(std::move(out));
+        }
+    }
+
+    void ImportLiveStream(const std::string_view data, ParsedChunk& out, std::atomic<std::uint64_t>* bytesDecoded)
+    {
+        PROFILE_FUNCTION();
+        DecodeLiveStream(data, out, 0, nullptr, bytesDecoded);
+    }
+
+    void ImportLiveStream(const std::string_view data, const std::size_t chunkEvents, const ChunkSink& sink, std::atomic<std::uint64_t>* bytesDecoded)
+    {
+        PROFILE_FUNCTION();
+        ParsedChunk chunk;
+        DecodeLiveStream(data, chunk, std::max<std::size_t>(chunkEvents, 1), &sink, bytesDecoded);
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "PagePool.hpp"
+#include "ParsedChunk.hpp"
+#include "Trace.hpp"
+
+namespace tagliatelle
+{
+
+    struct LiveStats
+    {
+        std::uint64_t connections       = 0; // currently open
+        std::uint64_t eventsReceived    = 0;
+        std::uint64_t eventsCommitted   = 0;
+        std::uint64_t eventsDropped     = 0; // the producer's ring was full
+        std::uint64_t malformedMessages = 0;
+        PagePoolStats textPages;             // shared by the connections' text buffers
+    };
+
+    // Receives events from running programs over a Unix domain socket,
+    // see LiveProtocol.hpp for the wire format.
+    // Every connection has a receiver thread that decodes messages into its
+    // own fixed-size SPSC ring, a single consumer thread drains the rings and
+    // commits the events into the trace in batches under the exclusive lock.
+    // When a ring is full new events are dropped and counted, so memory stays
+    // bounded however far the consumer falls behind.
+    // Names and tracks are local to a connection and mapped onto the trace.
+    // Their texts stay in the connection's buffer until it closes, so the
+    // number of definitions a connection may send is capped.
+    class LiveCapture
+    {
+    public:
+        static constexpr std::size_t   RingCapacity   = 1 << 16;
+        static constexpr std::size_t   MaxConnections = 64;
+        static constexpr std::uint32_t MaxLocalNames  = 1 << 16;
+        static constexpr std::uint32_t MaxLocalTracks = 1 << 12;
+        static constexpr std::uint32_t MaxTrackNames  = 4 * MaxLocalTracks; // renames included
+        static constexpr std::size_t   CommitBatch    = 1 << 16;
+        static constexpr std::size_t   TextPageSize   = 64 * 1024;
+        static constexpr std::size_t   MaxFreePages   = 16; // kept for the next connections
+
+        // The trace is only modified while holding the mutex exclusively
+        LiveCapture(Trace& trace, std::shared_mutex& traceMutex);
+        ~LiveCapture();
+
+        IMMOVABLE(LiveCapture);
+
+        // False on platforms without Unix domain sockets
+        [[nodiscard]] static bool Supported();
+
+        // Listens on the socket path, an existing socket file is replaced.
+        // Throws std::system_error if the socket cannot be set up.
+        void Start(const std::filesystem::path& socketPath);
+
+        // Closes all connections and commits every event received so far
+        void Stop();
+
+        [[nodiscard]] LiveStats Stats() const;
+
+    private:
+        struct Connection;
+
+        void Accept(std::stop_token stop);
+        void Receive(std::stop_token stop, Connection& connection);
+        void Consume(std::stop_token stop);
+
+        // Drains the rings into the trace, returns false if there was nothing to commit
+        bool Commit();
+
+        Trace&             trace;
+        std::shared_mutex& traceMutex;
+
+        std::filesystem::path socketPath;
+        int                   listenFd = -1;
+
+        // Declared before the connections, whose text buffers return pages to it
+        std::shared_ptr<PagePool<TextPageSize>> textPages;
+
+        std::mutex                               connectionsMutex;
+        std::vector<std::unique_ptr<Connection>> connections;
+        TrackId                                  nextTrack = 0; // consumer only
+
+        std::atomic<std::uint64_t> openConnections   = 0;
+        std::atomic<std::uint64_t> eventsReceived    = 0;
+        std::atomic<std::uint64_t> eventsCommitted   = 0;
+        std::atomic<std::uint64_t> eventsDropped     = 0;
+        std::atomic<std::uint64_t> malformedMessages = 0;
+
+        std::jthread acceptor;
+        std::jthread consumer;
+    };
+
+    // True if the data starts with a live protocol handshake, like the files
+    // written by the client's FileSink
+    [[nodiscard]] bool IsLiveStream(std::string_view data);
+
+    // Decodes a recorded live stream, names and tracks are producer-local IDs.
+    // Events with undefined names and a truncated last message count as malformed.
+    // Throws std::runtime_error if the data does not start with a handshake.
+    void ImportLiveStream(std::string_view data, ParsedChunk& out, std::atomic<std::uint64_t>* bytesDecoded = nullptr);
+
+    // Decodes in chunks of chunkEvents events, handed to the sink as they are completed
+    void ImportLiveStream(std::string_view data, std::size_t chunkEvents, const ChunkSink& sink,
+                          std::atomic<std::uint64_t>* bytesDecoded = nullptr);
+
+} // namespace tagliatelle
@@ -0,0 +1,149 @@
+#pragma once
+
+// Wire protocol of live capture. Header-only and free of library
+// dependencies so that instrumented programs can include it directly.
+//
+// A connection starts with the handshake "TGLV" u32 version, followed by
+// messages, all integers little endian:
+//   Name       u8 1, u32 id, u32 length, text     defines a producer-local name ID
+//   TrackName  u8 2, u32 track, u32 length, text  names a producer-local track
+//   Event      u8 3, i64 timestamp, i64 duration, u32 name, u32 track, u16 depth
+// Times are nanoseconds on any clock, as long as a producer uses only one.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tagliatelle
+{
+
+    inline constexpr std::string_view LiveHandshakeMagic  = "TGLV";
+    inline constexpr std::uint32_t    LiveProtocolVersion = 1;
+    inline constexpr std::size_t      LiveHandshakeSize   = 8;
+    inline constexpr std::uint32_t    LiveMaxTextLength   = 4096;
+
+    enum class LiveMessageType : std::uint8_t
+    {
+        Name      = 1,
+        TrackName = 2,
+        Event     = 3,
+    };
+
+    struct LiveMessage
+    {
+        LiveMessageType  type      = LiveMessageType::Event;
+        std::uint32_t    id        = 0; // name ID or track of Name and TrackName
+        std::int64_t     timestamp = 0;
+        std::int64_t     duration  = 0;
+        std::uint32_t    name      = 0;
+        std::uint32_t    track     = 0;
+        std::uint16_t    depth     = 0;
+        std::string_view text;          // points into the decoded buffer
+    };
+
+    enum class LiveDecodeResult
+    {
+        Ok,
+        NeedMore, // the buffer ends inside a message
+        Invalid,  // unknown type or oversized text, the stream cannot be resynchronized
+    };
+
+    namespace live_detail
+    {
+        template <typename T>
+        void Put(std::string& out, const T value)
+        {
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+                out += static_cast<char>(static_cast<std::uint64_t>(value) >> (8 * i));
+        }
+
+        template <typename T>
+        T Get(const char* data)
+        {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+                value |= std::uint64_t{ static_cast<unsigned char>(data[i]) } << (8 * i);
+            return static_cast<T>(value);
+        }
+    }
+
+    inline void LiveEncodeHandshake(std::string& out)
+    {
+        out.append(LiveHandshakeMagic);
+        live_detail::Put(out, LiveProtocolVersion);
+    }
+
+    // True if the buffer starts with a handshake of a supported version
+    [[nodiscard]] inline bool LiveCheckHandshake(const std::string_view buffer)
+    {
+        return buffer.size() >= LiveHandshakeSize
+            && buffer.starts_with(LiveHandshakeMagic)
+            && live_detail::Get<std::uint32_t>(buffer.data() + 4) == LiveProtocolVersion;
+    }
+
+    // Texts longer than LiveMaxTextLength are truncated
+    inline void LiveEncodeText(std::string& out, const LiveMessageType type, const std::uint32_t id, std::string_view text)
+    {
+        text = text.substr(0, LiveMaxTextLength);
+        out += static_cast<char>(type);
+        live_detail::Put(out, id);
+        live_detail::Put(out, static_cast<std::uint32_t>(text.size()));
+        out.append(text);
+    }
+
+    inline void LiveEncodeEvent(std::string& out, const std::int64_t timestamp, const std::int64_t duration,
+                                const std::uint32_t name, const std::uint32_t track, const std::uint16_t depth)
+    {
+        out += static_cast<char>(LiveMessageType::Event);
+        live_detail::Put(out, timestamp);
+        live_detail::Put(out, duration);
+        live_detail::Put(out, name);
+        live_detail::Put(out, track);
+        live_detail::Put(out, depth);
+    }
+
+    // Decodes the message at the start of the buffer, consumed is set on success
+    [[nodiscard]] inline LiveDecodeResult LiveDecode(const std::string_view buffer, LiveMessage& out, std::size_t& consumed)
+    {
+        constexpr std::size_t TextHeaderSize = 9;
+        constexpr std::size_t EventSize = 27;
+
+        if (buffer.empty())
+            return LiveDecodeResult::NeedMore;
+
+        const char* data = buffer.data();
+        out.type = static_cast<LiveMessageType>(data[0]);
+        switch (out.type)
+        {
+        case LiveMessageType::Name:
+        case LiveMessageType::TrackName:
+        {
+            if (buffer.size() < TextHeaderSize)
+                return LiveDecodeResult::NeedMore;
+            const auto length = live_detail::Get<std::uint32_t>(data + 5);
+            if (length > LiveMaxTextLength)
+                return LiveDecodeResult::Invalid;
+            if (buffer.size() < TextHeaderSize + length)
+                return LiveDecodeResult::NeedMore;
+            out.id = live_detail::Get<std::uint32_t>(data + 1);
+            out.text = buffer.substr(TextHeaderSize, length);
+            consumed = TextHeaderSize + length;
+            return LiveDecodeResult::Ok;
+        }
+        case LiveMessageType::Event:
+            if (buffer.size() < EventSize)
+                return LiveDecodeResult::NeedMore;
+            out.timestamp = live_detail::Get<std::int64_t>(data + 1);
+            out.duration = live_detail::Get<std::int64_t>(data + 9);
+            out.name = live_detail::Get<std::uint32_t>(data + 17);
+            out.track = live_detail::Get<std::uint32_t>(data + 21);
+            out.depth = live_detail::Get<std::uint16_t>(data + 25);
+            consumed = EventSize;
+            return LiveDecodeResult::Ok;
+        default:
+            return LiveDecodeResult::Invalid;
+        }
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,106 @@
+#include "LodPyramid.hpp"
+
+#include <bit> // std::bit_width
+
+namespace tagliatelle
+{
+
+    void LodPyramid::Add(const Event& event)
+    {
+        if (event.track >= rows.size())
+            rows.resize(std::size_t{ event.track } + 1);
+        auto& trackRows = rows[event.track];
+        if (event.depth >= trackRows.size())
+        {
+            rowCount += std::size_t{ event.depth } + 1 - trackRows.size();
+            trackRows.resize(std::size_t{ event.depth } + 1);
+        }
+        recordBytes += trackRows[event.depth].Add(event);
+    }
+
+    void LodPyramid::Clear()
+    {
+        rows.clear();
+        rowCount = 0;
+        recordBytes = 0;
+    }
+
+    int LodPyramid::LevelFor(const Viewport& viewport)
+    {
+        const auto nsPerPixel = static_cast<double>(viewport.end - viewport.start) / viewport.width;
+        if (nsPerPixel < static_cast<double>(BaseWidth))
+            return -1;
+        const auto ratio = static_cast<std::uint64_t>(nsPerPixel / BaseWidth);
+        return std::min(static_cast<int>(std::bit_width(ratio)) - 1, LevelCount - 1);
+    }
+
+    int LodPyramid::SpanLevel(const Duration duration)
+    {
+        if (duration < BaseWidth)
+            return -1;
+        const auto ratio = static_cast<std::uint64_t>(duration / BaseWidth);
+        return std::min(static_cast<int>(std::bit_width(ratio)) - 1, LevelCount - 1);
+    }
+
+    std::int64_t LodPyramid::FloorDiv(const Timestamp time, const Duration width)
+    {
+        const auto quotient = time / width;
+        return (time % width < 0) ? quotient - 1 : quotient;
+    }
+
+    std::size_t LodPyramid::Row::Add(const Event& event)
+    {
+        const auto spanLevel = SpanLevel(event.duration);
+        const auto end = event.timestamp + event.duration;
+        std::size_t added = 0;
+
+        if (spanLevel >= 0)
+        {
+            auto& spans = levels[spanLevel].spans;
+            const Span span{ event.timestamp, event.duration, event.name };
+            if (spans.empty() || spans.back().start <= event.timestamp) [[likely]]
+                spans.push_back(span);
+            else
+                spans.insert(std::ranges::upper_bound(spans, event.timestamp, {}, &Span::start), span);
+            added += sizeof(Span);
+        }
+
+        for (int level = spanLevel + 1; level < LevelCount; ++level)
+        {
+            auto& buckets = levels[level].buckets;
+            const auto index = FloorDiv(event.timestamp, Width(level));
+
+            auto bucket = buckets.end();
+            if (buckets.empty() || buckets.back().index < index) [[likely]]
+            {
+                bucket = buckets.end();
+            }
+            else if (buckets.back().index == index)
+            {
+                bucket = buckets.end() - 1;
+            }
+            else
+            {
+                bucket = std::ranges::lower_bound(buckets, index, {}, &Bucket::index);
+            }
+
+            if (bucket == buckets.end() || bucket->index != index)
+            {
+                buckets.insert(bucket, Bucket{ index, event.timestamp, end, event.name, event.duration, 1 });
+                added += sizeof(Bucket);
+                continue;
+            }
+
+            bucket->minStart = std::min(bucket->minStart, event.timestamp);
+            bucket->maxEnd = std::max(bucket->maxEnd, end);
+            ++bucket->count;
+            if (event.duration > bucket->dominantDuration)
+            {
+                bucket->dominant = event.name;
+                bucket->dominantDuration = event.duration;
+            }
+        }
+        return added;
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm> // std::max, std::min, std::ranges::lower_bound
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "EventStore.hpp"
+#include "RenderQuery.hpp"
+
+namespace tagliatelle
+{
+
+    // Render record that may stand for several sub-pixel spans
+    struct LodRecord
+    {
+        float         x;
+        float         width;
+        TrackId       track;
+        std::uint32_t depth;
+        std::uint32_t colorIndex;
+        NameId        label; // longest span of the group
+        std::uint32_t count; // number of spans merged into this record
+    };
+
+    // A record in time, before it is mapped onto the pixels of a viewport
+    struct LodExtent
+    {
+        Timestamp     start;
+        Timestamp     end;
+        TrackId       track;
+        std::uint32_t depth;
+        NameId        label;
+        std::uint32_t count;
+        bool          closed; // also visible in windows starting at its end
+    };
+
+    // Multi-resolution summary of the spans of every (track, depth) row.
+    // Level l covers time in buckets of BaseWidth << l nanoseconds.
+    // A span shorter than a bucket is summarized in that level's buckets,
+    // a longer span is kept individually in the span list of its length
+    // class. A query at level l therefore only touches the buckets in the
+    // window plus the spans that are at least a bucket wide, which is
+    // O(pixels) per row regardless of the number of events.
+    // Updated incrementally on every appended event.
+    class LodPyramid
+    {
+    public:
+        static constexpr Duration BaseWidth  = 1024;
+        static constexpr int      LevelCount = 40;
+
+        LodPyramid() = default;
+
+        MOVE_ONLY(LodPyramid);
+
+        void Add(const Event& event);
+        void Clear();
+
+        // Bytes of the rows and their records, without the unused capacity
+        [[nodiscard]] std::size_t MemoryBytes() const
+        {
+            return rowCount * sizeof(Row) + recordBytes;
+        }
+
+        // Level whose bucket width is at most a pixel, -1 if even the base level is coarser
+        [[nodiscard]] static int LevelFor(const Viewport& viewport);
+
+        // Calls fn(const LodRecord&) for every record visible in the viewport.
+        // Returns false without calling fn if the viewport is too fine for the
+        // pyramid, raw events should be rendered instead.
+        template <typename F>
+        bool ForEachVisible(const Viewport& viewport, F&& fn) const
+        {
+            if (!viewport.Valid())
+                return true;
+
+            const auto level = LevelFor(viewport);
+            if (level < 0)
+                return false;
+
+            const auto scale = viewport.PixelsPerNs();
+            ForEachExtent(level, viewport.start, viewport.end, [&](const LodExtent& extent)
+                {
+                    const auto begin = std::max(extent.start, viewport.start);
+                    const auto end = std::min(extent.end, viewport.end);
+                    const auto x = static_cast<float>((begin - viewport.start) * scale);
+                    const auto width = static_cast<float>((end - begin) * scale);
+                    fn(LodRecord{ x, width, extent.track, extent.depth, ColorIndex(extent.label), extent.label, extent.count });
+                });
+            return true;
+        }
+
+        // Calls fn(const LodExtent&) for every record of the level visible in [first, last)
+        template <typename F>
+        void ForEachExtent(const int level, const Timestamp first, const Timestamp last, F&& fn) const
+        {
+            for (TrackId track = 0; track < rows.size(); ++track)
+            {
+                for (std::uint32_t depth = 0; depth < rows[track].size(); ++depth)
+                    rows[track][depth].ForEachExtent(level, first, last, track, depth, fn);
+            }
+        }
+
+    private:
+        struct Bucket
+        {
+            std::int64_t  index;
+            Timestamp     minStart;
+            Timestamp     maxEnd;
+            NameId        dominant;
+            Duration      dominantDuration;
+            std::uint32_t count;
+        };
+
+        struct Span
+        {
+            Timestamp start;
+            Duration  duration;
+            NameId    name;
+        };
+
+        struct Level
+        {
+            std::vector<Bucket> buckets; // sorted by index, only non-empty buckets
+            std::vector<Span>   spans;   // sorted by start, durations in [width, 2 * width)
+        };
+
+        struct Row
+        {
+            std::array<Level, LevelCount> levels;
+
+            // Returns the bytes of the records it inserted
+            std::size_t Add(const Event& event);
+
+            template <typename F>
+            void ForEachExtent(int level, Timestamp first, Timestamp last, TrackId track, std::uint32_t depth, F& fn) const;
+        };
+
+        static constexpr Duration Width(const int level)
+        {
+            return BaseWidth << level;
+        }
+
+        // Length class of a span, -1 if it is shorter than the base width
+        static int SpanLevel(Duration duration);
+
+        static std::int64_t FloorDiv(Timestamp time, Duration width);
+
+        std::vector<std::vector<Row>> rows; // indexed by track, then depth
+        std::size_t                   rowCount    = 0;
+        std::size_t                   recordBytes = 0;
+    };
+
+    template <typename F>
+    void LodPyramid::Row::ForEachExtent(const int level, const Timestamp first, const Timestamp last, const TrackId track,
+                                        const std::uint32_t depth, F& fn) const
+    {
+        auto emit = [&](const Timestamp start, const Timestamp end, const NameId label, const std::uint32_t count, const bool closed)
+            {
+                if (std::min(end, last) < std::max(start, first))
+                    return;
+                fn(LodExtent{ start, end, track, depth, label, count, closed });
+            };
+
+        // Buckets may extend into the next one by less than a bucket width
+        const auto& buckets = levels[level].buckets;
+        const auto firstIndex = FloorDiv(first, Width(level)) - 1;
+        auto bucket = std::ranges::lower_bound(buckets, firstIndex, {}, &Bucket::index);
+        for (; bucket != buckets.end() && bucket->minStart < last; ++bucket)
+            emit(bucket->minStart, bucket->maxEnd, bucket->dominant, bucket->count, true);
+
+        // Spans of length class l are shorter than 2 * Width(l)
+        for (int l = level; l < LevelCount; ++l)
+        {
+            const auto& spans = levels[l].spans;
+            const auto lookback = l + 1 < LevelCount ? 2 * Width(l) : std::numeric_limits<Duration>::max();
+            const auto from = first < std::numeric_limits<Timestamp>::min() + lookback ? std::numeric_limits<Timestamp>::min() : first - lookback;
+            auto span = std::ranges::lower_bound(spans, from, {}, &Span::start);
+            for (; span != spans.end() && span->start < last; ++span)
+            {
+                if (span->start + span->duration > first)
+                    emit(span->start, span->start + span->duration, span->name, 1, false);
+            }
+        }
+    }
+
+} // namespace tagliatelle
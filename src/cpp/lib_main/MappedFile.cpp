@@ -0,0 +1,99 @@
+#include "MappedFile.hpp"
+
+#include <system_error>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace tagliatelle
+{
+
+#ifdef _WIN32
+
+    MappedFile::MappedFile(const std::filesystem::path& path)
+    {
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateFileW");
+
+        LARGE_INTEGER fileSize{};
+        GetFileSizeEx(file, &fileSize);
+        size = static_cast<std::size_t>(fileSize.QuadPart);
+        if (size == 0)
+            return;
+
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr)
+            data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data == nullptr)
+        {
+            const auto error = static_cast<int>(GetLastError());
+            if (mapping != nullptr)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::system_error(error, std::system_category(), "MapViewOfFile");
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data != nullptr)
+            UnmapViewOfFile(data);
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+        if (file != nullptr && file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        data = nullptr;
+        mapping = file = nullptr;
+    }
+
+#else
+
+    MappedFile::MappedFile(const std::filesystem::path& path)
+    {
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open");
+
+        struct stat info{};
+        if (fstat(fd, &info) != 0)
+        {
+            const auto error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "fstat");
+        }
+
+        size = static_cast<std::size_t>(info.st_size);
+        if (size > 0)
+        {
+            void* const mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                const auto error = errno;
+                close(fd);
+                throw std::system_error(error, std::generic_category(), "mmap");
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapped);
+        }
+
+        // The mapping keeps the file alive
+        close(fd);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data != nullptr)
+            munmap(const_cast<char*>(data), size);
+    }
+
+#endif
+
+} // namespace tagliatelle
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    // Read-only memory mapping of a whole file.
+    // Throws std::system_error if the file cannot be opened or mapped.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+
+        IMMOVABLE(MappedFile);
+
+        [[nodiscard]] std::string_view Data() const
+        {
+            return { data, size };
+        }
+
+        [[nodiscard]] std::size_t Size() const
+        {
+            return size;
+        }
+
+    private:
+        const char* data = nullptr;
+        std::size_t size = 0;
+#ifdef _WIN32
+        void* file    = nullptr;
+        void* mapping = nullptr;
+#endif
+    };
+
+} // namespace tagliatelle
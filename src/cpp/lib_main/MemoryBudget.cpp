@@ -0,0 +1,401 @@
+#include "MemoryBudget.hpp"
+
+#include <algorithm> // std::min, std::ranges::find_if, std::ranges::sort
+#include <bit>       // std::bit_width, std::countr_zero
+#include <iterator>  // std::next, std::prev
+#include <new>       // std::bad_alloc
+#include <string>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define TAGLIATELLE_SPILL 1
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+#ifdef TAGLIATELLE_SPILL
+        std::size_t PageSize()
+        {
+            static const auto size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        void Evict(void* const pointer, const std::size_t bytes, const int fd, const std::uint64_t fileOffset)
+        {
+            // Written back first so that dropping the pages keeps the data in the file
+            ::msync(pointer, bytes, MS_SYNC);
+            ::madvise(pointer, bytes, MADV_DONTNEED);
+#ifdef __linux__
+            // Shared mappings stay in the page cache until it is told to drop them
+            ::posix_fadvise(fd, static_cast<off_t>(fileOffset), static_cast<off_t>(bytes), POSIX_FADV_DONTNEED);
+#else
+            (void)fd;
+            (void)fileOffset;
+#endif
+        }
+#endif
+
+        std::size_t RoundUp(const std::size_t bytes, const std::size_t multiple)
+        {
+            return (bytes + multiple - 1) / multiple * multiple;
+        }
+    }
+
+    MemoryBudget::MemoryBudget(const std::uint64_t budgetBytes, const std::filesystem::path& scratchDirectory)
+        : budget{ budgetBytes }
+    {
+#ifdef TAGLIATELLE_SPILL
+        auto path = (scratchDirectory / "tagliatelle-spill-XXXXXX").string();
+        fd = ::mkstemp(path.data());
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "MemoryBudget: scratch file");
+        // Only the descriptor keeps the file alive, it is gone when the process exits
+        ::unlink(path.c_str());
+#else
+        (void)scratchDirectory;
+        throw std::system_error(std::make_error_code(std::errc::not_supported), "MemoryBudget: file mappings are not available");
+#endif
+    }
+
+    MemoryBudget::~MemoryBudget()
+    {
+        // Storage allocated from the budget must be gone by now, the mappings would outlive the file otherwise
+#ifdef TAGLIATELLE_SPILL
+        ::close(fd);
+#endif
+    }
+
+    bool MemoryBudget::Supported()
+    {
+#ifdef TAGLIATELLE_SPILL
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void* MemoryBudget::Allocate(const std::size_t bytes)
+    {
+        if (bytes < MinSpillBytes)
+        {
+            auto* const pointer = ::operator new(bytes);
+            std::scoped_lock lock{ mutex };
+            heapBytes += bytes;
+            return pointer;
+        }
+
+#ifdef TAGLIATELLE_SPILL
+        std::scoped_lock lock{ mutex };
+        if (bytes <= MaxSlotBytes)
+            return AllocateSlot(bytes);
+
+        const auto region = Map(RoundUp(bytes, PageSize()), 0);
+        residentBound += region->second.bytes;
+        return reinterpret_cast<void*>(region->first);
+#else
+        throw std::bad_alloc{};
+#endif
+    }
+
+    void MemoryBudget::Deallocate(void* const pointer, const std::size_t bytes) noexcept
+    {
+        if (bytes < MinSpillBytes)
+        {
+            ::operator delete(pointer, bytes);
+            std::scoped_lock lock{ mutex };
+            heapBytes -= bytes;
+            return;
+        }
+
+#ifdef TAGLIATELLE_SPILL
+        const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+        std::scoped_lock lock{ mutex };
+        auto it = regions.upper_bound(address);
+        if (it == regions.begin()) [[unlikely]]
+            return;
+        --it;
+        if (it->second.slotBytes != 0)
+            DeallocateSlot(it, address);
+        else if (it->first == address)
+            Unmap(it);
+#endif
+    }
+
+    std::map<std::uintptr_t, MemoryBudget::Region>::iterator MemoryBudget::Map(const std::size_t size, const std::size_t slotBytes)
+    {
+#ifdef TAGLIATELLE_SPILL
+        // First fit among the extents of freed regions, the file grows otherwise
+        std::uint64_t offset = fileSize;
+        const auto extent = std::ranges::find_if(freeExtents, [size](const auto& free) { return free.second >= size; });
+        if (extent != freeExtents.end())
+        {
+            offset = extent->first;
+            if (extent->second > size)
+                freeExtents.emplace(offset + size, extent->second - size);
+            freeExtents.erase(extent);
+        }
+        else if (::ftruncate(fd, static_cast<off_t>(fileSize + size)) != 0)
+        {
+            throw std::bad_alloc{};
+        }
+        else
+        {
+            fileSize += size;
+        }
+
+        void* const pointer = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(offset));
+        if (pointer == MAP_FAILED)
+        {
+            Release(offset, size);
+            throw std::bad_alloc{};
+        }
+
+        // Read-ahead around faults would pull evicted neighbours back into the page cache
+        ::madvise(pointer, size, MADV_RANDOM);
+
+        // New storage is about to be written, it starts out as recently used
+        mappedBytes += size;
+        return regions.emplace(reinterpret_cast<std::uintptr_t>(pointer),
+                               Region{ size, offset, std::vector<std::uint64_t>(RoundUp(size, ChunkSize) / ChunkSize, ++clock), slotBytes, {} }).first;
+#else
+        (void)size;
+        (void)slotBytes;
+        throw std::bad_alloc{};
+#endif
+    }
+
+    void MemoryBudget::Unmap(const std::map<std::uintptr_t, Region>::iterator region)
+    {
+#ifdef TAGLIATELLE_SPILL
+        ::munmap(reinterpret_cast<void*>(region->first), region->second.bytes);
+        Release(region->second.fileOffset, region->second.bytes);
+        mappedBytes -= region->second.bytes;
+        regions.erase(region);
+#else
+        (void)region;
+#endif
+    }
+
+    void* MemoryBudget::AllocateSlot(const std::size_t bytes)
+    {
+        const auto slotClass = static_cast<std::size_t>(std::bit_width((bytes - 1) / MinSpillBytes));
+        const auto slotBytes = MinSpillBytes << slotClass;
+        auto& open = openExtents[slotClass];
+        if (open.empty())
+        {
+            // Deallocation returns extents to the list and must not throw
+            open.reserve(extentCount[slotClass] + 1);
+            const auto extent = Map(ExtentBytes, slotBytes);
+            ++extentCount[slotClass];
+            for (auto slot = static_cast<std::uint32_t>(ExtentBytes / slotBytes); slot-- > 0;)
+                extent->second.freeSlots.push_back(slot);
+            open.push_back(extent->first);
+        }
+
+        const auto begin = open.back();
+        auto& region = regions.find(begin)->second;
+        const auto offset = std::size_t{ region.freeSlots.back() } * slotBytes;
+        region.freeSlots.pop_back();
+        if (region.freeSlots.empty())
+            open.pop_back();
+
+        ++clock;
+        for (auto chunk = offset / ChunkSize; chunk <= (offset + slotBytes - 1) / ChunkSize; ++chunk)
+            region.lastUse[chunk] = clock;
+        residentBound += slotBytes;
+        return reinterpret_cast<void*>(begin + offset);
+    }
+
+    void MemoryBudget::DeallocateSlot(const std::map<std::uintptr_t, Region>::iterator region, const std::uintptr_t address)
+    {
+        auto& extent = region->second;
+        const auto offset = address - region->first;
+        const auto slotClass = static_cast<std::size_t>(std::countr_zero(extent.slotBytes / MinSpillBytes));
+        auto& open = openExtents[slotClass];
+
+        // The contents are dropped rather than written back
+        PunchHole(extent.fileOffset + offset, extent.slotBytes);
+        if (extent.freeSlots.empty())
+            open.push_back(region->first);
+        extent.freeSlots.push_back(static_cast<std::uint32_t>(offset / extent.slotBytes));
+        if (extent.freeSlots.size() == extent.bytes / extent.slotBytes)
+        {
+            std::erase(open, region->first);
+            --extentCount[slotClass];
+            Unmap(region);
+        }
+    }
+
+    void MemoryBudget::Touch(const void* const pointer, const std::size_t bytes)
+    {
+#ifdef TAGLIATELLE_SPILL
+        if (bytes == 0)
+            return;
+
+        const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+        std::scoped_lock lock{ mutex };
+        auto it = regions.upper_bound(address);
+        if (it == regions.begin())
+            return;
+        --it;
+        const auto begin = it->first;
+        auto& region = it->second;
+        if (address >= begin + region.bytes)
+            return;
+
+        const auto end = std::min<std::uintptr_t>(address + bytes, begin + region.bytes);
+        const auto firstChunk = (address - begin) / ChunkSize;
+        const auto lastChunk = (end - 1 - begin) / ChunkSize;
+        ++clock;
+        for (auto chunk = firstChunk; chunk <= lastChunk; ++chunk)
+            region.lastUse[chunk] = clock;
+
+        const auto pageBegin = (address - begin) / PageSize() * PageSize();
+        const auto length = end - begin - pageBegin;
+        ::madvise(reinterpret_cast<void*>(begin + pageBegin), length, MADV_WILLNEED);
+        residentBound += length;
+#else
+        (void)pointer;
+        (void)bytes;
+#endif
+    }
+
+    void MemoryBudget::Enforce()
+    {
+#ifdef TAGLIATELLE_SPILL
+        std::scoped_lock lock{ mutex };
+        // A scan reads the residency of every mapping, so it is throttled even
+        // while over the budget, unless as much as an eighth of the budget was
+        // mapped or touched since the last one. Pages faulted or read back in
+        // are not counted in the bound, so scans are periodic.
+        const auto held = heapBytes + reportedBytes;
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastScan < ScanInterval && (held + residentBound <= budget || residentBound <= scannedBound + budget / 8))
+            return;
+        lastScan = now;
+
+        struct Candidate
+        {
+            std::uint64_t  lastUse;
+            std::uintptr_t begin;
+            const Region*  region;
+            std::size_t    chunk;
+            std::uint32_t  resident;
+        };
+        std::vector<Candidate> candidates;
+        std::vector<std::uint32_t> residency;
+        std::uint64_t resident = 0;
+        for (const auto& [begin, region] : regions)
+        {
+            ScanResidency(begin, region, residency);
+            for (std::size_t chunk = 0; chunk < residency.size(); ++chunk)
+            {
+                if (residency[chunk] == 0)
+                    continue;
+                resident += residency[chunk];
+                candidates.push_back(Candidate{ region.lastUse[chunk], begin, &region, chunk, residency[chunk] });
+            }
+        }
+
+        if (held + resident > budget)
+        {
+            std::ranges::sort(candidates, {}, &Candidate::lastUse);
+            for (const auto& candidate : candidates)
+            {
+                if (held + resident <= budget)
+                    break;
+                const auto offset = candidate.chunk * ChunkSize;
+                const auto length = std::min(ChunkSize, candidate.region->bytes - offset);
+                Evict(reinterpret_cast<void*>(candidate.begin + offset), length, fd, candidate.region->fileOffset + offset);
+                resident -= candidate.resident;
+                evictedBytes += candidate.resident;
+            }
+        }
+        residentBound = resident;
+        scannedBound = resident;
+#endif
+    }
+
+    void MemoryBudget::Report(const std::size_t previousBytes, const std::size_t bytes)
+    {
+        std::scoped_lock lock{ mutex };
+        reportedBytes = reportedBytes - previousBytes + bytes;
+    }
+
+    MemoryStats MemoryBudget::Stats() const
+    {
+        std::scoped_lock lock{ mutex };
+        std::uint64_t resident = heapBytes + reportedBytes;
+        std::vector<std::uint32_t> residency;
+        for (const auto& [begin, region] : regions)
+        {
+            ScanResidency(begin, region, residency);
+            for (const auto bytes : residency)
+                resident += bytes;
+        }
+        return MemoryStats{ budget, mappedBytes + heapBytes + reportedBytes, resident, evictedBytes, reportedBytes };
+    }
+
+    void MemoryBudget::ScanResidency(const std::uintptr_t begin, const Region& region, std::vector<std::uint32_t>& out) const
+    {
+        out.assign(region.lastUse.size(), 0);
+#ifdef TAGLIATELLE_SPILL
+        const auto page = PageSize();
+        residencyScratch.resize(region.bytes / page);
+#ifdef __APPLE__
+        auto* const vector = reinterpret_cast<char*>(residencyScratch.data());
+#else
+        auto* const vector = residencyScratch.data();
+#endif
+        if (::mincore(reinterpret_cast<void*>(begin), region.bytes, vector) != 0)
+            return;
+        for (std::size_t i = 0; i < residencyScratch.size(); ++i)
+        {
+            if (residencyScratch[i] & 1)
+                out[i * page / ChunkSize] += static_cast<std::uint32_t>(page);
+        }
+#else
+        (void)begin;
+#endif
+    }
+
+    void MemoryBudget::PunchHole(const std::uint64_t offset, const std::uint64_t size)
+    {
+#if defined(TAGLIATELLE_SPILL) && defined(__linux__)
+        // The file keeps its size, the blocks of the hole go back to the file system
+        // and the pages of the range leave the page cache and the mappings
+        ::fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), static_cast<off_t>(size));
+#else
+        (void)offset;
+        (void)size;
+#endif
+    }
+
+    void MemoryBudget::Release(const std::uint64_t offset, const std::uint64_t size)
+    {
+        PunchHole(offset, size);
+        // Adjacent free extents are merged so that growing vectors can reuse them
+        auto [it, inserted] = freeExtents.emplace(offset, size);
+        if (const auto next = std::next(it); next != freeExtents.end() && next->first == offset + size)
+        {
+            it->second += next->second;
+            freeExtents.erase(next);
+        }
+        if (it != freeExtents.begin())
+        {
+            if (const auto previous = std::prev(it); previous->first + previous->second == offset)
+            {
+                previous->second += it->second;
+                freeExtents.erase(it);
+            }
+        }
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <array>
+#include <bit>    // std::bit_width
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory> // std::allocator
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    struct MemoryStats
+    {
+        std::uint64_t budget;   // bytes, 0 without a budget
+        std::uint64_t total;    // bytes allocated through the budget
+        std::uint64_t resident; // part of total currently in RAM
+        std::uint64_t evicted;  // bytes written out and dropped so far
+        std::uint64_t reported; // part of total held on the heap by derived structures, always resident
+    };
+
+    // Caps the RAM used by the bulk of a trace: the event columns, the pages
+    // of the name table and of the argument arena. Large allocations are
+    // mapped from an unlinked scratch file; Enforce() writes the chunks that
+    // were touched least recently back to the file and drops them from memory
+    // until the resident size fits the budget. Evicted chunks fault back in
+    // when accessed. Allocations up to MaxSlotBytes are rounded up to a power
+    // of two and carved from shared extents, so that the many pages of a large
+    // name table do not each take a mapping of their own.
+    // Small allocations are served from the heap and always resident, as are
+    // the structures whose size is reported, see ReportedBytes.
+    // Thread-safe, eviction never loses data.
+    class MemoryBudget
+    {
+    public:
+        static constexpr std::size_t ChunkSize     = 256 * 1024; // unit of eviction
+        static constexpr std::size_t MinSpillBytes = 64 * 1024;  // smaller allocations stay on the heap
+        static constexpr std::size_t MaxSlotBytes  = 1024 * 1024;      // larger allocations are mapped on their own
+        static constexpr std::size_t ExtentBytes   = 4 * MaxSlotBytes; // mapping the smaller ones are carved from
+
+        // Minimum time between residency scans, unless an eighth of the budget
+        // was mapped or touched since the last one
+        static constexpr std::chrono::milliseconds ScanInterval{ 100 };
+
+        // Creates the scratch file in the directory, throws std::system_error
+        MemoryBudget(std::uint64_t budgetBytes, const std::filesystem::path& scratchDirectory);
+        ~MemoryBudget();
+
+        IMMOVABLE(MemoryBudget);
+
+        // False on platforms without file mappings that can be paged out
+        [[nodiscard]] static bool Supported();
+
+        // Throws std::bad_alloc if the scratch file cannot grow
+        [[nodiscard]] void* Allocate(std::size_t bytes);
+        void Deallocate(void* pointer, std::size_t bytes) noexcept;
+
+        // Marks the bytes as recently used and starts reading them in if they were evicted.
+        // Bytes outside of the scratch mappings are ignored.
+        void Touch(const void* pointer, std::size_t bytes);
+
+        // Evicts the least recently touched chunks until the resident size fits
+        // the budget. Scans at most once per ScanInterval unless much was mapped
+        // since, so it is cheap to call after every bulk of allocations.
+        void Enforce();
+
+        // Changes the size of heap memory held outside of the budget's allocations
+        void Report(std::size_t previousBytes, std::size_t bytes);
+
+        [[nodiscard]] MemoryStats Stats() const;
+
+    private:
+        static constexpr std::size_t SlotClasses = std::bit_width(MaxSlotBytes / MinSpillBytes);
+
+        struct Region
+        {
+            std::size_t                bytes;          // mapped, a multiple of the page size
+            std::uint64_t              fileOffset;
+            std::vector<std::uint64_t> lastUse;        // per chunk, 0 if never touched
+            std::size_t                slotBytes = 0;  // of the allocations carved from an extent, 0 for a single one
+            std::vector<std::uint32_t> freeSlots;
+        };
+
+        // Maps a range of the scratch file, the caller holds the mutex
+        std::map<std::uintptr_t, Region>::iterator Map(std::size_t size, std::size_t slotBytes);
+        void Unmap(std::map<std::uintptr_t, Region>::iterator region);
+        void* AllocateSlot(std::size_t bytes);
+        void DeallocateSlot(std::map<std::uintptr_t, Region>::iterator region, std::uintptr_t address);
+
+        // Resident bytes per chunk of the region
+        void ScanResidency(std::uintptr_t begin, const Region& region, std::vector<std::uint32_t>& out) const;
+
+        // Returns a range of the scratch file to the free extents
+        void Release(std::uint64_t offset, std::uint64_t size);
+
+        // Drops a range of the scratch file without writing it back
+        void PunchHole(std::uint64_t offset, std::uint64_t size);
+
+        const std::uint64_t budget;
+        int                 fd = -1;
+
+        mutable std::mutex                     mutex;
+        std::map<std::uintptr_t, Region>       regions;     // by start address
+        std::map<std::uint64_t, std::uint64_t> freeExtents; // file offset to size
+        std::array<std::vector<std::uintptr_t>, SlotClasses> openExtents; // with free slots, by slot size
+        std::array<std::size_t, SlotClasses>                 extentCount{}; // open ones fit without allocating
+        std::uint64_t                          fileSize      = 0;
+        std::uint64_t                          mappedBytes   = 0;
+        std::uint64_t                          heapBytes     = 0;
+        std::uint64_t                          reportedBytes = 0;
+        std::uint64_t                          evictedBytes  = 0;
+        std::uint64_t                          clock         = 0;
+        std::uint64_t                          residentBound = 0; // mapped bytes resident at most, since the last scan
+        std::uint64_t                          scannedBound  = 0; // mapped bytes resident after the last scan
+        std::chrono::steady_clock::time_point  lastScan;
+        mutable std::vector<unsigned char>     residencyScratch;
+    };
+
+    // Heap memory of a structure outside of the budget's allocations, like an
+    // index derived from the stored events, reported as it changes so that it
+    // counts towards the budget. Changes below the granularity are held back
+    // until they add up. Does nothing without a budget.
+    class ReportedBytes
+    {
+    public:
+        static constexpr std::size_t Granularity = MemoryBudget::MinSpillBytes;
+
+        ReportedBytes() = default;
+
+        explicit ReportedBytes(MemoryBudget* const budget)
+            : budget{ budget }
+        {
+        }
+
+        ~ReportedBytes()
+        {
+            if (budget != nullptr)
+                budget->Report(reported, 0);
+        }
+
+        IMMOVABLE(ReportedBytes);
+
+        void Update(const std::size_t bytes)
+        {
+            if (budget == nullptr || (bytes != 0 && (bytes > reported ? bytes - reported : reported - bytes) < Granularity))
+                return;
+            budget->Report(reported, bytes);
+            reported = bytes;
+        }
+
+    private:
+        MemoryBudget* budget   = nullptr;
+        std::size_t   reported = 0;
+    };
+
+    // Allocator of storage that counts towards a budget, the heap without one
+    template <typename T>
+    class BudgetAllocator
+    {
+    public:
+        using value_type                             = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap            = std::true_type;
+
+        BudgetAllocator() = default;
+
+        explicit BudgetAllocator(MemoryBudget* budget)
+            : budget{ budget }
+        {
+        }
+
+        template <typename U>
+        BudgetAllocator(const BudgetAllocator<U>& other)
+            : budget{ other.Budget() }
+        {
+        }
+
+        [[nodiscard]] T* allocate(const std::size_t n)
+        {
+            if (budget == nullptr)
+                return std::allocator<T>{}.allocate(n);
+            return static_cast<T*>(budget->Allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T* const pointer, const std::size_t n) noexcept
+        {
+            if (budget == nullptr)
+                std::allocator<T>{}.deallocate(pointer, n);
+            else
+                budget->Deallocate(pointer, n * sizeof(T));
+        }
+
+        [[nodiscard]] MemoryBudget* Budget() const
+        {
+            return budget;
+        }
+
+        template <typename U>
+        bool operator==(const BudgetAllocator<U>& other) const
+        {
+            return budget == other.Budget();
+        }
+
+    private:
+        MemoryBudget* budget = nullptr;
+    };
+
+} // namespace tagliatelle
@@ -0,0 +1,601 @@
+#include "NativeTrace.hpp"
+
+#include <algorithm> // std::max, std::ranges::fill, std::ranges::stable_sort, std::ranges::lower_bound
+#include <bit>       // std::bit_cast
+#include <fstream>
+#include <limits>
+#include <numeric>   // std::iota
+#include <stdexcept>
+#include <string>
+#include <utility>   // std::exchange
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        constexpr std::size_t HeaderSize     = 16;
+        constexpr std::size_t FooterSize     = 32;
+        constexpr std::size_t IndexEntrySize = 36;
+
+        void PutU32(std::string& out, const std::uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+                out += static_cast<char>(value >> (8 * i));
+        }
+
+        void PutU64(std::string& out, const std::uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i)
+                out += static_cast<char>(value >> (8 * i));
+        }
+
+        void PutVarint(std::string& out, std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out += static_cast<char>(value | 0x80);
+                value >>= 7;
+            }
+            out += static_cast<char>(value);
+        }
+
+        void PutArgument(std::string& out, const Argument& argument)
+        {
+            PutVarint(out, argument.key);
+            out += static_cast<char>(argument.type);
+            switch (argument.type)
+            {
+            case ArgumentType::Null:
+                break;
+            case ArgumentType::Bool:
+                PutVarint(out, argument.boolean ? 1 : 0);
+                break;
+            case ArgumentType::Int: // zigzag, small negative values stay short
+                PutVarint(out, (static_cast<std::uint64_t>(argument.integer) << 1) ^ static_cast<std::uint64_t>(argument.integer >> 63));
+                break;
+            case ArgumentType::Double:
+                PutU64(out, std::bit_cast<std::uint64_t>(argument.number));
+                break;
+            case ArgumentType::String:
+                PutVarint(out, argument.text);
+                break;
+            case ArgumentType::Object:
+                PutVarint(out, argument.size);
+                break;
+            }
+        }
+
+        [[noreturn]] void Corrupt(const char* what)
+        {
+            throw std::runtime_error(std::string{ "NativeTrace: " } + what);
+        }
+
+        std::uint64_t GetU64(const std::string_view data, const std::size_t pos)
+        {
+            if (pos > data.size() || data.size() - pos < 8)
+                Corrupt("truncated file");
+            std::uint64_t value = 0;
+            for (int i = 0; i < 8; ++i)
+                value |= std::uint64_t{ static_cast<unsigned char>(data[pos + i]) } << (8 * i);
+            return value;
+        }
+
+        std::uint32_t GetU32(const std::string_view data, const std::size_t pos)
+        {
+            if (pos > data.size() || data.size() - pos < 4)
+                Corrupt("truncated file");
+            std::uint32_t value = 0;
+            for (int i = 0; i < 4; ++i)
+                value |= std::uint32_t{ static_cast<unsigned char>(data[pos + i]) } << (8 * i);
+            return value;
+        }
+
+        std::uint64_t GetVarint(const char*& p, const char* const end)
+        {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64 && p != end; shift += 7)
+            {
+                const auto byte = static_cast<unsigned char>(*p++);
+                value |= std::uint64_t{ byte & 0x7Fu } << shift;
+                if (byte < 0x80)
+                    return value;
+            }
+            Corrupt("invalid varint");
+        }
+
+        // Decodes the records of one event, validating IDs against the string table
+        void GetArguments(const char*& p, const char* const end, const std::span<Argument> out, const std::size_t stringCount)
+        {
+            for (std::size_t i = 0; i < out.size(); ++i)
+            {
+                auto& argument = out[i];
+                const auto key = GetVarint(p, end);
+                if (key >= stringCount || p == end)
+                    Corrupt("invalid argument");
+                argument.key = static_cast<std::uint32_t>(key);
+                argument.type = static_cast<ArgumentType>(*p++);
+                switch (argument.type)
+                {
+                case ArgumentType::Null:
+                    argument.integer = 0;
+                    break;
+                case ArgumentType::Bool:
+                    argument.boolean = GetVarint(p, end) != 0;
+                    break;
+                case ArgumentType::Int:
+                {
+                    const auto zigzag = GetVarint(p, end);
+                    argument.integer = static_cast<std::int64_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+                    break;
+                }
+                case ArgumentType::Double:
+                {
+                    if (end - p < 8)
+                        Corrupt("truncated block");
+                    std::uint64_t bits = 0;
+                    for (int b = 0; b < 8; ++b)
+                        bits |= std::uint64_t{ static_cast<unsigned char>(*p++) } << (8 * b);
+                    argument.number = std::bit_cast<double>(bits);
+                    break;
+                }
+                case ArgumentType::String:
+                {
+                    const auto text = GetVarint(p, end);
+                    if (text >= stringCount)
+                        Corrupt("invalid argument");
+                    argument.text = static_cast<std::uint32_t>(text);
+                    break;
+                }
+                case ArgumentType::Object:
+                {
+                    const auto size = GetVarint(p, end);
+                    if (size >= out.size() - i)
+                        Corrupt("invalid argument");
+                    argument.size = static_cast<std::uint32_t>(size);
+                    break;
+                }
+                default:
+                    Corrupt("invalid argument type");
+                }
+            }
+        }
+
+        // Tracks the bytes written so that sections can be located in the footer
+        class CountingWriter
+        {
+        public:
+            explicit CountingWriter(std::ostream& out)
+                : out{ out }
+            {
+            }
+
+            void Write(const std::string_view bytes)
+            {
+                out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+                written += bytes.size();
+            }
+
+            [[nodiscard]] std::uint64_t Written() const
+            {
+                return written;
+            }
+
+        private:
+            std::ostream& out;
+            std::uint64_t written = 0;
+        };
+
+        void EncodeBlock(const EventStore& events, const std::span<const std::uint32_t> indices, std::string& out, NativeBlock& block)
+        {
+            const auto timestamps = events.Timestamps();
+            const auto durations = events.Durations();
+
+            block.count = static_cast<std::uint32_t>(indices.size());
+            block.firstTimestamp = timestamps[indices.front()];
+            block.maxEnd = std::numeric_limits<Timestamp>::min();
+
+            auto previous = block.firstTimestamp;
+            for (const auto i : indices)
+            {
+                // Timestamps of a track are non-decreasing, deltas are never negative
+                PutVarint(out, static_cast<std::uint64_t>(timestamps[i] - previous));
+                previous = timestamps[i];
+                block.maxEnd = std::max(block.maxEnd, timestamps[i] + durations[i]);
+            }
+            for (const auto i : indices)
+                PutVarint(out, static_cast<std::uint64_t>(durations[i]));
+            for (const auto i : indices)
+                PutVarint(out, events.NameIds()[i]);
+            for (const auto i : indices)
+                PutVarint(out, events.Depths()[i]);
+
+            for (const auto i : indices)
+                PutVarint(out, events.ArgCounts()[i]);
+            for (const auto i : indices)
+            {
+                for (const auto& argument : events.Arguments(i))
+                    PutArgument(out, argument);
+            }
+        }
+    }
+
+    void WriteNativeTrace(const EventStore& events, std::ostream& out)
+    {
+        CountingWriter writer{ out };
+        std::string buffer;
+
+        buffer.append(NativeMagic);
+        PutU32(buffer, NativeVersion);
+        PutU64(buffer, events.Size());
+        writer.Write(buffer);
+
+        // Counting sort of the event indices by track keeps each track in timestamp order
+        const auto tracks = events.Tracks();
+        std::vector<std::uint32_t> trackStarts;
+        for (const auto track : tracks)
+        {
+            if (std::size_t{ track } + 2 > trackStarts.size())
+                trackStarts.resize(std::size_t{ track } + 2, 0);
+            ++trackStarts[track + 1];
+        }
+        for (std::size_t t = 1; t < trackStarts.size(); ++t)
+            trackStarts[t] += trackStarts[t - 1];
+        std::vector<std::uint32_t> order(events.Size());
+        {
+            auto next = trackStarts;
+            for (std::uint32_t i = 0; i < tracks.size(); ++i)
+                order[next[tracks[i]]++] = i;
+        }
+
+        std::vector<NativeBlock> blocks;
+        for (std::size_t t = 0; t + 1 < trackStarts.size(); ++t)
+        {
+            for (auto first = trackStarts[t]; first < trackStarts[t + 1]; first += NativeBlockEvents)
+            {
+                const auto count = std::min<std::size_t>(NativeBlockEvents, trackStarts[t + 1] - first);
+                NativeBlock block{};
+                block.offset = writer.Written();
+                block.track = static_cast<TrackId>(t);
+
+                buffer.clear();
+                EncodeBlock(events, std::span{ order }.subspan(first, count), buffer, block);
+                block.size = static_cast<std::uint32_t>(buffer.size());
+                writer.Write(buffer);
+                blocks.push_back(block);
+            }
+        }
+
+        const auto stringsOffset = writer.Written();
+        const auto names = events.Names().Views();
+        buffer.clear();
+        PutU32(buffer, static_cast<std::uint32_t>(names.size()));
+        std::uint64_t end = 0;
+        for (const auto name : names)
+            PutU64(buffer, end += name.size());
+        writer.Write(buffer);
+        for (const auto name : names)
+            writer.Write(name);
+
+        const auto tracksOffset = writer.Written();
+        buffer.clear();
+        PutU32(buffer, static_cast<std::uint32_t>(events.TrackCount()));
+        for (TrackId track = 0; track < events.TrackCount(); ++track)
+        {
+            const auto name = events.TrackName(track);
+            PutU32(buffer, name.empty() ? NativeNoName : events.Names().Find(name).value_or(NativeNoName));
+        }
+        writer.Write(buffer);
+
+        const auto indexOffset = writer.Written();
+        buffer.clear();
+        for (const auto& block : blocks)
+        {
+            PutU64(buffer, block.offset);
+            PutU32(buffer, block.size);
+            PutU32(buffer, block.track);
+            PutU32(buffer, block.count);
+            PutU64(buffer, static_cast<std::uint64_t>(block.firstTimestamp));
+            PutU64(buffer, static_cast<std::uint64_t>(block.maxEnd));
+        }
+        PutU64(buffer, stringsOffset);
+        PutU64(buffer, tracksOffset);
+        PutU64(buffer, indexOffset);
+        PutU32(buffer, static_cast<std::uint32_t>(blocks.size()));
+        buffer.append(NativeMagic);
+        writer.Write(buffer);
+    }
+
+    void SaveNativeTrace(const EventStore& events, const std::filesystem::path& path)
+    {
+        std::ofstream out;
+        out.exceptions(std::ios::failbit | std::ios::badbit);
+        out.open(path, std::ios::binary | std::ios::trunc);
+        WriteNativeTrace(events, out);
+        out.close();
+    }
+
+    bool IsNativeTrace(const std::string_view data)
+    {
+        return data.starts_with(NativeMagic);
+    }
+
+    NativeTraceReader::NativeTraceReader(const std::string_view data)
+        : data{ data }
+    {
+        if (data.size() < HeaderSize + FooterSize || !IsNativeTrace(data) || !data.ends_with(NativeMagic))
+            Corrupt("not a native trace");
+        version = GetU32(data, 4);
+        if (version == 0 || version > NativeVersion)
+            Corrupt("unsupported version");
+        eventCount = GetU64(data, 8);
+
+        const auto footer = data.size() - FooterSize;
+        const auto stringsOffset = GetU64(data, footer);
+        const auto tracksOffset = GetU64(data, footer + 8);
+        const auto indexOffset = GetU64(data, footer + 16);
+        const auto blockCount = GetU32(data, footer + 24);
+        if (stringsOffset < HeaderSize || stringsOffset > tracksOffset || tracksOffset > indexOffset || indexOffset > footer
+            || (footer - indexOffset) / IndexEntrySize != blockCount)
+            Corrupt("invalid footer");
+
+        stringCount = GetU32(data, stringsOffset);
+        const auto endsOffset = stringsOffset + 4;
+        if ((tracksOffset - endsOffset) / 8 < stringCount)
+            Corrupt("invalid string table");
+        stringEnds = data.substr(endsOffset, stringCount * 8);
+        stringText = data.substr(endsOffset + stringCount * 8, tracksOffset - endsOffset - stringCount * 8);
+        if (stringCount > 0 && GetU64(stringEnds, (stringCount - 1) * 8) > stringText.size())
+            Corrupt("invalid string table");
+
+        const auto trackCount = GetU32(data, tracksOffset);
+        if ((indexOffset - tracksOffset - 4) / 4 < trackCount || trackCount > EventStore::MaxTracks)
+            Corrupt("invalid track table");
+        trackNames.reserve(trackCount);
+        for (std::uint32_t t = 0; t < trackCount; ++t)
+        {
+            const auto name = GetU32(data, tracksOffset + 4 + 4 * std::size_t{ t });
+            if (name != NativeNoName && name >= stringCount)
+                Corrupt("invalid track name");
+            trackNames.push_back(name);
+        }
+
+        std::uint64_t indexedEvents = 0;
+        blocks.reserve(blockCount);
+        for (std::uint32_t b = 0; b < blockCount; ++b)
+        {
+            const auto entry = indexOffset + IndexEntrySize * std::size_t{ b };
+            NativeBlock block{};
+            block.offset = GetU64(data, entry);
+            block.size = GetU32(data, entry + 8);
+            block.track = GetU32(data, entry + 12);
+            block.count = GetU32(data, entry + 16);
+            block.firstTimestamp = static_cast<Timestamp>(GetU64(data, entry + 20));
+            block.maxEnd = static_cast<Timestamp>(GetU64(data, entry + 28));
+            if (block.offset < HeaderSize || block.offset > stringsOffset || stringsOffset - block.offset < block.size || block.count == 0
+                || block.track >= trackCount)
+                Corrupt("invalid block index");
+            indexedEvents += block.count;
+            blocks.push_back(block);
+        }
+        if (indexedEvents != eventCount)
+            Corrupt("event count mismatch");
+
+        blocksByStart.resize(blocks.size());
+        std::iota(blocksByStart.begin(), blocksByStart.end(), std::uint32_t{ 0 });
+        std::ranges::stable_sort(blocksByStart, {}, [&](const std::uint32_t b) { return blocks[b].firstTimestamp; });
+        maxEndPrefix.reserve(blocks.size());
+        for (const auto b : blocksByStart)
+            maxEndPrefix.push_back(maxEndPrefix.empty() ? blocks[b].maxEnd : std::max(maxEndPrefix.back(), blocks[b].maxEnd));
+    }
+
+    std::string_view NativeTraceReader::String(const NameId id) const
+    {
+        ASSERT((id < stringCount), "NativeTraceReader: string ID out of range");
+        const auto begin = id == 0 ? 0 : GetU64(stringEnds, (id - 1) * std::size_t{ 8 });
+        const auto end = GetU64(stringEnds, id * std::size_t{ 8 });
+        if (begin > end || end > stringText.size())
+            Corrupt("invalid string table");
+        return stringText.substr(begin, end - begin);
+    }
+
+    void NativeTraceReader::DecodeBlock(const std::size_t index, EventColumns& out, ArgumentArena* arguments) const
+    {
+        const auto& block = blocks[index];
+        const char* p = data.data() + block.offset;
+        const char* const end = p + block.size;
+
+        const auto first = out.Size();
+        out.timestamps.resize(first + block.count);
+        out.durations.resize(first + block.count);
+        out.names.resize(first + block.count);
+        out.tracks.resize(first + block.count, block.track);
+        out.depths.resize(first + block.count);
+        out.argOffsets.resize(first + block.count, 0);
+        out.argCounts.resize(first + block.count, 0);
+
+        auto timestamp = static_cast<std::uint64_t>(block.firstTimestamp);
+        for (std::size_t i = first; i < out.Size(); ++i)
+            out.timestamps[i] = static_cast<Timestamp>(timestamp += GetVarint(p, end));
+        for (std::size_t i = first; i < out.Size(); ++i)
+        {
+            const auto duration = GetVarint(p, end);
+            if (duration > static_cast<std::uint64_t>(std::numeric_limits<Duration>::max()))
+                Corrupt("invalid duration");
+            out.durations[i] = static_cast<Duration>(duration);
+        }
+        for (std::size_t i = first; i < out.Size(); ++i)
+        {
+            const auto name = GetVarint(p, end);
+            if (name >= stringCount)
+                Corrupt("invalid name ID");
+            out.names[i] = static_cast<NameId>(name);
+        }
+        for (std::size_t i = first; i < out.Size(); ++i)
+        {
+            const auto depth = GetVarint(p, end);
+            if (depth > std::numeric_limits<Depth>::max())
+                Corrupt("invalid depth");
+            out.depths[i] = static_cast<Depth>(depth);
+        }
+
+        if (arguments == nullptr || version < 2)
+            return;
+        for (std::size_t i = first; i < out.Size(); ++i)
+        {
+            const auto count = GetVarint(p, end);
+            if (count > ArgumentArena::PageRecords)
+                Corrupt("invalid argument count");
+            out.argCounts[i] = static_cast<std::uint16_t>(count);
+        }
+        std::vector<Argument> decoded;
+        for (std::size_t i = first; i < out.Size(); ++i)
+        {
+            decoded.resize(out.argCounts[i]);
+            GetArguments(p, end, decoded, stringCount);
+            out.argOffsets[i] = arguments->Append(decoded);
+        }
+    }
+
+    void NativeTraceReader::ReadRange(const Timestamp start, const Timestamp end, EventColumns& out) const
+    {
+        // Blocks starting at or after the end are past the range, and no block
+        // before the first whose running maxEnd reaches the start can overlap it
+        const auto last = static_cast<std::size_t>(std::ranges::partition_point(blocksByStart, [&](const std::uint32_t b) {
+            return blocks[b].firstTimestamp < end;
+        }) - blocksByStart.begin());
+        const auto first = static_cast<std::size_t>(std::ranges::lower_bound(maxEndPrefix, start) - maxEndPrefix.begin());
+
+        EventColumns decoded;
+        for (std::size_t k = first; k < last; ++k)
+        {
+            const auto b = blocksByStart[k];
+            if (blocks[b].maxEnd < start)
+                continue;
+
+            decoded.Clear();
+            DecodeBlock(b, decoded);
+            for (std::size_t i = 0; i < decoded.Size(); ++i)
+            {
+                if (decoded.timestamps[i] < end && decoded.timestamps[i] + decoded.durations[i] >= start)
+                    out.PushBack(decoded[i]);
+            }
+        }
+    }
+
+    void ImportNativeTrace(const std::string_view data, ParsedChunk& out, std::atomic<std::uint64_t>* bytesDecoded)
+    {
+        PROFILE_FUNCTION();
+        const NativeTraceReader reader{ data };
+
+        // Identical strings are merged, IDs are only preserved for tables written from a store
+        std::vector<NameId> remap;
+        remap.reserve(reader.StringCount());
+        for (NameId id = 0; id < reader.StringCount(); ++id)
+            remap.push_back(out.names.Intern(reader.String(id)));
+
+        const auto first = out.columns.Size();
+        out.columns.Reserve(first + reader.EventCount());
+        std::uint64_t decoded = 0;
+        for (std::size_t b = 0; b < reader.Blocks().size(); ++b)
+        {
+            reader.DecodeBlock(b, out.columns, &out.arguments);
+            if (bytesDecoded != nullptr)
+                bytesDecoded->store(decoded += reader.Blocks()[b].size, std::memory_order_relaxed);
+        }
+        for (auto i = first; i < out.columns.Size(); ++i)
+        {
+            out.columns.names[i] = remap[out.columns.names[i]];
+            for (auto& argument : out.arguments.View(out.columns.argOffsets[i], out.columns.argCounts[i]))
+            {
+                argument.key = remap[argument.key];
+                if (argument.type == ArgumentType::String)
+                    argument.text = remap[argument.text];
+            }
+        }
+
+        const auto trackNames = reader.TrackNames();
+        for (TrackId track = 0; track < trackNames.size(); ++track)
+        {
+            if (trackNames[track] != NativeNoName)
+                out.trackNames.emplace_back(track, remap[trackNames[track]]);
+        }
+
+        if (bytesDecoded != nullptr)
+            bytesDecoded->store(data.size(), std::memory_order_relaxed);
+    }
+
+    void ImportNativeTrace(const std::string_view data, const std::size_t chunkEvents, const ChunkSink& sink, std::atomic<std::uint64_t>* bytesDecoded)
+    {
+        PROFILE_FUNCTION();
+        const NativeTraceReader reader{ data };
+        const auto blocks = reader.Blocks();
+
+        // Blocks in time order rather than by track, so that chunks mostly append to the trace
+        const auto order = reader.BlocksByStart();
+
+        // The first chunk interns the whole string table in ID order, like ImportNativeTrace(data, out),
+        // later ones the strings they refer to
+        ParsedChunk chunk;
+        std::vector<NameId> remap;
+        remap.reserve(reader.StringCount());
+        for (NameId id = 0; id < reader.StringCount(); ++id)
+            remap.push_back(chunk.names.Intern(reader.String(id)));
+        const auto trackNames = reader.TrackNames();
+        for (TrackId track = 0; track < trackNames.size(); ++track)
+        {
+            if (trackNames[track] != NativeNoName)
+                chunk.trackNames.emplace_back(track, remap[trackNames[track]]);
+        }
+
+        bool first = true;
+        std::vector<NameId> interned;
+        auto local = [&](const NameId id)
+            {
+                if (remap[id] == NativeNoName)
+                {
+                    remap[id] = chunk.names.Intern(reader.String(id));
+                    interned.push_back(id);
+                }
+                return remap[id];
+            };
+
+        std::uint64_t decoded = 0;
+        for (const auto b : order)
+        {
+            const auto begin = chunk.columns.Size();
+            reader.DecodeBlock(b, chunk.columns, &chunk.arguments);
+            for (auto i = begin; i < chunk.columns.Size(); ++i)
+            {
+                chunk.columns.names[i] = local(chunk.columns.names[i]);
+                for (auto& argument : chunk.arguments.View(chunk.columns.argOffsets[i], chunk.columns.argCounts[i]))
+                {
+                    argument.key = local(argument.key);
+                    if (argument.type == ArgumentType::String)
+                        argument.text = local(argument.text);
+                }
+            }
+            if (bytesDecoded != nullptr)
+                bytesDecoded->store(decoded += blocks[b].size, std::memory_order_relaxed);
+
+            if (chunk.columns.Size() >= std::max<std::size_t>(chunkEvents, 1))
+            {
+                if (!sink(std::exchange(chunk, ParsedChunk{})))
+                    return;
+                if (first)
+                    std::ranges::fill(remap, NativeNoName);
+                for (const auto id : interned)
+                    remap[id] = NativeNoName;
+                interned.clear();
+                first = false;
+            }
+        }
+
+        if (bytesDecoded != nullptr)
+            bytesDecoded->store(data.size(), std::memory_order_relaxed);
+        (void)sink(std::move(chunk));
+    }
+
+} // namespace tagliatelle
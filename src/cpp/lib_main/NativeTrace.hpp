@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "ArgumentArena.hpp"
+#include "EventStore.hpp"
+#include "ParsedChunk.hpp"
+
+namespace tagliatelle
+{
+
+    // Native trace file, all integers little endian:
+    //   header       "TGLT", u32 version, u64 event count
+    //   blocks       events of one track in timestamp order, at most
+    //                NativeBlockEvents per block, stored as columns of
+    //                varints: timestamp deltas, durations, name IDs, depths,
+    //                argument counts, then the argument records of each
+    //                event: key ID, u8 type, value (version 2 and later)
+    //   strings      u32 count, u64 end offset of each string, text
+    //   tracks       u32 count, u32 name ID per track, NativeNoName if unnamed
+    //   block index  one NativeBlock per block, see below
+    //   footer       u64 strings offset, u64 tracks offset, u64 index offset,
+    //                u32 block count, "TGLT"
+    // Name IDs refer to the string table, which is the store's name table
+    // in ID order, so saving and loading into an empty store keeps IDs.
+    // Argument values are varints for bools, string IDs and object sizes,
+    // zigzag varints for ints and 8 raw bytes for doubles; nulls have none.
+    // Version 1 files have no arguments and are still read.
+    inline constexpr std::string_view NativeMagic       = "TGLT";
+    inline constexpr std::uint32_t    NativeVersion     = 2;
+    inline constexpr std::size_t      NativeBlockEvents = 4096;
+    inline constexpr std::uint32_t    NativeNoName      = ~std::uint32_t{ 0 };
+
+    // Block index entry, blocks overlapping a time range are found without decoding
+    struct NativeBlock
+    {
+        std::uint64_t offset;
+        std::uint32_t size;           // encoded bytes
+        TrackId       track;
+        std::uint32_t count;          // events
+        Timestamp     firstTimestamp; // timestamp of the first event, the base of the deltas
+        Timestamp     maxEnd;         // latest end of any event in the block
+    };
+
+    // Writes the events, names and track names of the store.
+    // Throws std::ios_base::failure if the stream cannot be written.
+    void WriteNativeTrace(const EventStore& events, std::ostream& out);
+
+    void SaveNativeTrace(const EventStore& events, const std::filesystem::path& path);
+
+    // True if the data starts with the native magic
+    [[nodiscard]] bool IsNativeTrace(std::string_view data);
+
+    // Random access to a native trace held in memory, usually a MappedFile.
+    // Only the footer, track table and block index are read up front.
+    // Throws std::runtime_error if the data is truncated or corrupt.
+    class NativeTraceReader
+    {
+    public:
+        explicit NativeTraceReader(std::string_view data);
+
+        MOVE_ONLY(NativeTraceReader);
+
+        [[nodiscard]] std::uint64_t EventCount() const
+        {
+            return eventCount;
+        }
+
+        [[nodiscard]] std::size_t StringCount() const
+        {
+            return stringCount;
+        }
+
+        [[nodiscard]] std::string_view String(NameId id) const;
+
+        [[nodiscard]] std::span<const NameId> TrackNames() const
+        {
+            return trackNames;
+        }
+
+        [[nodiscard]] std::span<const NativeBlock> Blocks() const
+        {
+            return blocks;
+        }
+
+        // Block indices stably sorted by first timestamp
+        [[nodiscard]] std::span<const std::uint32_t> BlocksByStart() const
+        {
+            return blocksByStart;
+        }
+
+        // Appends the events of a block, names are string table IDs.
+        // Arguments are decoded into the arena if one is given, with string
+        // table IDs as keys and string values; otherwise events have none.
+        void DecodeBlock(std::size_t index, EventColumns& out, ArgumentArena* arguments = nullptr) const;
+
+        // Appends the events overlapping [start, end) without their arguments,
+        // decoding only the blocks that may contain them
+        void ReadRange(Timestamp start, Timestamp end, EventColumns& out) const;
+
+    private:
+        std::string_view         data;
+        std::uint32_t            version     = 0;
+        std::uint64_t            eventCount  = 0;
+        std::size_t              stringCount = 0;
+        std::string_view         stringEnds;
+        std::string_view         stringText;
+        std::vector<NameId>      trackNames;
+        std::vector<NativeBlock> blocks;
+        std::vector<std::uint32_t> blocksByStart;
+        std::vector<Timestamp>     maxEndPrefix; // running maximum of maxEnd in blocksByStart order
+    };
+
+    // Decodes a whole native trace into a chunk, like ImportChromeTrace
+    void ImportNativeTrace(std::string_view data, ParsedChunk& out, std::atomic<std::uint64_t>* bytesDecoded = nullptr);
+
+    // Decodes in chunks of at least chunkEvents events, whole blocks in order of
+    // their first timestamps, handed to the sink as they are completed
+    void ImportNativeTrace(std::string_view data, std::size_t chunkEvents, const ChunkSink& sink,
+                           std::atomic<std::uint64_t>* bytesDecoded = nullptr);
+
+} // namespace tagliatelle
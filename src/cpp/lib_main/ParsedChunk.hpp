@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "ArgumentArena.hpp"
+#include "CounterStore.hpp"
+#include "EventStore.hpp"
+#include "FlowStore.hpp"
+#include "InternedTextBuffer.hpp"
+
+namespace tagliatelle
+{
+
+    // Events parsed independently of the trace they will be merged into.
+    // Names are interned locally and remapped by Trace::AppendChunk(), so
+    // producers on different threads never share a name table.
+    // Argument keys and string values are local name IDs as well.
+    // Flow IDs are local IDs of flowKeys, Trace::AppendChunk() interns the
+    // keys, so that flows of different chunks with equal keys are one.
+    struct ParsedChunk
+    {
+        static constexpr std::size_t TextPageSize = 16 * 1024;
+
+        EventColumns                            columns;
+        InternedTextBuffer<TextPageSize>        names;
+        ArgumentArena                           arguments;
+        std::vector<std::pair<TrackId, NameId>> trackNames;
+        std::vector<CounterSample>              counters; // series names are local name IDs
+        std::vector<FlowPoint>                  flows;
+        InternedTextBuffer<TextPageSize>        flowKeys;
+        std::vector<TrackId>                    provisionalTracks; // depths to derive again from nesting, see Trace::Renest()
+        std::uint64_t                           malformedRecords = 0;
+
+        void Clear()
+        {
+            columns.Clear();
+            names.Clear();
+            arguments.Clear();
+            trackNames.clear();
+            counters.clear();
+            flows.clear();
+            flowKeys.Clear();
+            provisionalTracks.clear();
+            malformedRecords = 0;
+        }
+    };
+
+    // Receives the chunks of an importer as they are completed, returns false to cancel the import
+    using ChunkSink = std::function<bool(ParsedChunk&& chunk)>;
+
+} // namespace tagliatelle
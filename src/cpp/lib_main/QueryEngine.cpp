@@ -0,0 +1,327 @@
+#include "QueryEngine.hpp"
+
+#include <algorithm> // std::ranges::lower_bound, std::partial_sort
+#include <exception>
+#include <latch>
+#include <limits>
+#include <unordered_map>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        constexpr std::uint32_t NoEvent = std::numeric_limits<std::uint32_t>::max();
+
+        struct Shard
+        {
+            TrackId     track;
+            std::size_t begin; // positions in the track's events
+            std::size_t end;
+        };
+
+        struct Partial
+        {
+            std::unordered_map<NameId, NameStats> names;
+            std::vector<std::uint32_t>            spans;
+        };
+
+        // Longer spans first, ties in event order
+        struct LongerSpan
+        {
+            ColumnView<Duration> durations;
+
+            bool operator()(const std::uint32_t lhs, const std::uint32_t rhs) const
+            {
+                if (durations[lhs] != durations[rhs])
+                    return durations[lhs] > durations[rhs];
+                return lhs < rhs;
+            }
+        };
+
+        void SelfTimeShard(const EventStore& events, const IntervalIndex& intervals, const Shard& shard, const Timestamp first, Partial& partial)
+        {
+            const auto trackEvents = intervals.TrackEvents(shard.track);
+            const auto timestamps = events.Timestamps();
+            const auto durations = events.Durations();
+            const auto depths = events.Depths();
+            const auto names = events.NameIds();
+
+            // Latest span at each depth, the parent of a span is the latest one a level up
+            std::vector<std::uint32_t> ancestors;
+            auto setAncestor = [&](const Depth depth, const std::uint32_t index)
+                {
+                    if (depth >= ancestors.size())
+                        ancestors.resize(depth + 1, NoEvent);
+                    ancestors[depth] = index;
+                };
+
+            // Spans of earlier shards that enclose this one contain its first start
+            const auto firstIndex = trackEvents[shard.begin];
+            intervals.ForEachStabbing(shard.track, timestamps[firstIndex], [&](const std::uint32_t index)
+                {
+                    const auto depth = depths[index];
+                    if (index < firstIndex && (depth >= ancestors.size() || ancestors[depth] == NoEvent || index > ancestors[depth]))
+                        setAncestor(depth, index);
+                });
+
+            auto stats = [&](const NameId name) -> NameStats&
+                {
+                    return partial.names.try_emplace(name, NameStats{ name, 0, 0, 0 }).first->second;
+                };
+
+            for (auto position = shard.begin; position < shard.end; ++position)
+            {
+                const auto index = trackEvents[position];
+                const auto depth = depths[index];
+                const auto duration = durations[index];
+
+                auto& own = stats(names[index]);
+                ++own.count;
+                own.total += duration;
+                own.self += duration;
+
+                // Parents starting before the range are not part of the result
+                if (depth > 0 && depth - 1u < ancestors.size())
+                {
+                    const auto parent = ancestors[depth - 1];
+                    if (parent != NoEvent && timestamps[parent] >= first
+                        && timestamps[parent] + durations[parent] >= timestamps[index] + duration)
+                    {
+                        stats(names[parent]).self -= duration;
+                    }
+                }
+                setAncestor(depth, index);
+            }
+        }
+
+        void LongestSpansShard(const EventStore& events, const IntervalIndex& intervals, const Shard& shard, const std::size_t limit, Partial& partial)
+        {
+            const auto trackEvents = intervals.TrackEvents(shard.track);
+            const LongerSpan longer{ events.Durations() };
+
+            // Heap whose top is the shortest span kept so far
+            auto& heap = partial.spans;
+            for (auto position = shard.begin; position < shard.end; ++position)
+            {
+                const auto index = trackEvents[position];
+                if (heap.size() < limit)
+                {
+                    heap.push_back(index);
+                    std::ranges::push_heap(heap, longer);
+                }
+                else if (longer(index, heap.front()))
+                {
+                    std::ranges::pop_heap(heap, longer);
+                    heap.back() = index;
+                    std::ranges::push_heap(heap, longer);
+                }
+            }
+        }
+    }
+
+    AggregateQuery::AggregateQuery(const AggregateKind kind, const Timestamp first, const Timestamp last, const std::size_t limit, Callback onDone)
+        : kind{ kind }
+        , first{ first }
+        , last{ last }
+        , limit{ limit }
+        , onDone{ std::move(onDone) }
+    {
+    }
+
+    bool AggregateQuery::Done() const
+    {
+        return ready.load(std::memory_order_acquire);
+    }
+
+    bool AggregateQuery::Wait() const
+    {
+        std::unique_lock lock{ stateMutex };
+        finished.wait(lock, [this] { return done; });
+        return error.empty();
+    }
+
+    std::string AggregateQuery::Error() const
+    {
+        std::scoped_lock lock{ stateMutex };
+        return error;
+    }
+
+    void AggregateQuery::Finish(std::string failure)
+    {
+        {
+            std::scoped_lock lock{ stateMutex };
+            error = std::move(failure);
+        }
+        ready.store(true, std::memory_order_release);
+
+        if (onDone)
+            onDone();
+
+        {
+            std::scoped_lock lock{ stateMutex };
+            done = true;
+        }
+        finished.notify_all();
+    }
+
+    QueryEngine::QueryEngine(const Trace& trace, std::shared_mutex& traceMutex, const unsigned threadCount)
+        : trace{ trace }
+        , traceMutex{ traceMutex }
+        , pool{ threadCount }
+    {
+        coordinator = std::jthread([this](std::stop_token stop) { Coordinate(stop); });
+    }
+
+    QueryEngine::~QueryEngine()
+    {
+        coordinator = {};
+        for (const auto& query : queue)
+            query->Finish("cancelled");
+    }
+
+    std::shared_ptr<AggregateQuery> QueryEngine::SelfTime(const Timestamp first, const Timestamp last, AggregateQuery::Callback onDone)
+    {
+        return Enqueue(std::make_shared<AggregateQuery>(AggregateKind::SelfTime, first, last, 0, std::move(onDone)));
+    }
+
+    std::shared_ptr<AggregateQuery> QueryEngine::LongestSpans(const Timestamp first, const Timestamp last, const std::size_t count, AggregateQuery::Callback onDone)
+    {
+        return Enqueue(std::make_shared<AggregateQuery>(AggregateKind::LongestSpans, first, last, count, std::move(onDone)));
+    }
+
+    std::shared_ptr<AggregateQuery> QueryEngine::CriticalPath(const std::uint32_t event, AggregateQuery::Callback onDone)
+    {
+        auto query = std::make_shared<AggregateQuery>(AggregateKind::CriticalPath, 0, 0, 0, std::move(onDone));
+        query->event = event;
+        return Enqueue(std::move(query));
+    }
+
+    std::shared_ptr<AggregateQuery> QueryEngine::Enqueue(std::shared_ptr<AggregateQuery> query)
+    {
+        {
+            std::scoped_lock lock{ queueMutex };
+            queue.push_back(query);
+        }
+        queueChanged.notify_one();
+        return query;
+    }
+
+    void QueryEngine::Coordinate(std::stop_token stop)
+    {
+        while (true)
+        {
+            std::shared_ptr<AggregateQuery> query;
+            {
+                std::unique_lock lock{ queueMutex };
+                queueChanged.wait(lock, stop, [this] { return !queue.empty(); });
+                if (stop.stop_requested())
+                    return;
+                query = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            try
+            {
+                Execute(*query);
+            }
+            catch (const std::exception& e)
+            {
+                query->Finish(e.what());
+                continue;
+            }
+            query->Finish({});
+        }
+    }
+
+    void QueryEngine::Execute(AggregateQuery& query)
+    {
+        PROFILE_SCOPE("QueryEngine::Execute");
+        std::shared_lock lock{ traceMutex };
+        const auto& events = trace.Events();
+        const auto& intervals = trace.Intervals();
+        const auto timestamps = events.Timestamps();
+
+        // A walk along the flows, too sequential to shard
+        if (query.kind == AggregateKind::CriticalPath)
+        {
+            trace.Flows().CriticalPath(events, intervals, query.event, query.spans);
+            return;
+        }
+
+        std::vector<Shard> shards;
+        const auto empty = query.kind == AggregateKind::LongestSpans && query.limit == 0;
+        for (TrackId track = 0; !empty && track < intervals.TrackCount(); ++track)
+        {
+            const auto trackEvents = intervals.TrackEvents(track);
+            auto start = [&](const std::uint32_t index) { return timestamps[index]; };
+            const auto begin = std::ranges::lower_bound(trackEvents, query.first, {}, start) - trackEvents.begin();
+            const auto end = std::ranges::upper_bound(trackEvents, query.last, {}, start) - trackEvents.begin();
+            for (auto position = static_cast<std::size_t>(begin); position < static_cast<std::size_t>(end); position += ShardEvents)
+                shards.push_back(Shard{ track, position, std::min(position + ShardEvents, static_cast<std::size_t>(end)) });
+        }
+
+        std::vector<Partial> partials(shards.size());
+        std::latch remaining{ static_cast<std::ptrdiff_t>(shards.size()) };
+        std::mutex errorMutex;
+        std::exception_ptr shardError;
+
+        for (std::size_t i = 0; i < shards.size(); ++i)
+        {
+            pool.Submit([&, i]
+                {
+                    try
+                    {
+                        if (query.kind == AggregateKind::SelfTime)
+                            SelfTimeShard(events, intervals, shards[i], query.first, partials[i]);
+                        else
+                            LongestSpansShard(events, intervals, shards[i], query.limit, partials[i]);
+                    }
+                    catch (...)
+                    {
+                        std::scoped_lock errorLock{ errorMutex };
+                        shardError = std::current_exception();
+                    }
+                    remaining.count_down();
+                });
+        }
+        remaining.wait();
+
+        if (shardError)
+            std::rethrow_exception(shardError);
+
+        if (query.kind == AggregateKind::SelfTime)
+        {
+            std::unordered_map<NameId, NameStats> merged;
+            for (const auto& partial : partials)
+            {
+                for (const auto& [name, stats] : partial.names)
+                {
+                    auto& total = merged.try_emplace(name, NameStats{ name, 0, 0, 0 }).first->second;
+                    total.count += stats.count;
+                    total.total += stats.total;
+                    total.self += stats.self;
+                }
+            }
+
+            query.names.reserve(merged.size());
+            for (const auto& [name, stats] : merged)
+                query.names.push_back(stats);
+            std::ranges::sort(query.names, [](const NameStats& lhs, const NameStats& rhs)
+                {
+                    return lhs.self != rhs.self ? lhs.self > rhs.self : lhs.name < rhs.name;
+                });
+        }
+        else
+        {
+            for (const auto& partial : partials)
+                query.spans.insert(query.spans.end(), partial.spans.begin(), partial.spans.end());
+            const auto count = std::min(query.limit, query.spans.size());
+            std::partial_sort(query.spans.begin(), query.spans.begin() + static_cast<std::ptrdiff_t>(count), query.spans.end(), LongerSpan{ events.Durations() });
+            query.spans.resize(count);
+        }
+    }
+
+} // namespace tagliatelle
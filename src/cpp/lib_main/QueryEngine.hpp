@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Trace.hpp"
+#include "WorkStealingPool.hpp"
+
+namespace tagliatelle
+{
+
+    enum class AggregateKind
+    {
+        SelfTime,
+        LongestSpans,
+        CriticalPath,
+    };
+
+    // An aggregate query over the spans starting in [first, last], or the
+    // critical path of the request through one span.
+    // Results may be read once Done() returns true, which is already the
+    // case inside the completion callback.
+    class AggregateQuery
+    {
+    public:
+        using Callback = std::function<void()>;
+
+        AggregateQuery(AggregateKind kind, Timestamp first, Timestamp last, std::size_t limit, Callback onDone);
+
+        IMMOVABLE(AggregateQuery);
+
+        [[nodiscard]] AggregateKind Kind() const
+        {
+            return kind;
+        }
+
+        [[nodiscard]] bool Done() const;
+
+        // Blocks until the query has completed, returns false if it failed
+        bool Wait() const;
+
+        // Reason of the failure, empty unless Wait() returned false
+        [[nodiscard]] std::string Error() const;
+
+        // SelfTime results ordered by self time, longest first
+        [[nodiscard]] std::span<const NameStats> Names() const
+        {
+            return names;
+        }
+
+        // LongestSpans results as event indices, longest first,
+        // CriticalPath results oldest first
+        [[nodiscard]] std::span<const std::uint32_t> Spans() const
+        {
+            return spans;
+        }
+
+    private:
+        friend class QueryEngine;
+
+        void Finish(std::string failure);
+
+        const AggregateKind kind;
+        const Timestamp     first;
+        const Timestamp     last;
+        const std::size_t   limit;
+        std::uint32_t       event = 0; // of a CriticalPath query
+        Callback            onDone;
+
+        std::vector<NameStats>     names;
+        std::vector<std::uint32_t> spans;
+
+        // Results are ready before the callback runs, the query is done after it returned
+        std::atomic<bool>               ready = false;
+        mutable std::mutex              stateMutex;
+        mutable std::condition_variable finished;
+        bool                            done = false;
+        std::string                     error;
+    };
+
+    // Runs aggregate queries in parallel.
+    // A query is split into shards of at most ShardEvents consecutive spans
+    // of one track, the shards run on a work-stealing pool and their partial
+    // aggregates are merged once all of them are done. A coordinator thread
+    // takes the queries one at a time and holds the shared lock of the trace
+    // while its shards run, so every shard sees the same events.
+    // Completion callbacks are called on the coordinator thread.
+    class QueryEngine
+    {
+    public:
+        static constexpr std::size_t ShardEvents = 64 * 1024;
+
+        QueryEngine(const Trace& trace, std::shared_mutex& traceMutex,
+                    unsigned threadCount = std::thread::hardware_concurrency());
+
+        // Queued queries fail as cancelled, a running query is completed
+        ~QueryEngine();
+
+        IMMOVABLE(QueryEngine);
+
+        // Total and self time per name, ordered by self time
+        std::shared_ptr<AggregateQuery> SelfTime(Timestamp first, Timestamp last, AggregateQuery::Callback onDone = {});
+
+        // The count longest spans
+        std::shared_ptr<AggregateQuery> LongestSpans(Timestamp first, Timestamp last, std::size_t count, AggregateQuery::Callback onDone = {});
+
+        // The spans along the flows of the request through the event, see FlowStore::CriticalPath()
+        std::shared_ptr<AggregateQuery> CriticalPath(std::uint32_t event, AggregateQuery::Callback onDone = {});
+
+    private:
+        std::shared_ptr<AggregateQuery> Enqueue(std::shared_ptr<AggregateQuery> query);
+        void Coordinate(std::stop_token stop);
+        void Execute(AggregateQuery& query);
+
+        const Trace&       trace;
+        std::shared_mutex& traceMutex;
+        WorkStealingPool   pool;
+
+        std::mutex                                  queueMutex;
+        std::condition_variable_any                 queueChanged;
+        std::deque<std::shared_ptr<AggregateQuery>> queue;
+
+        std::jthread coordinator;
+    };
+
+} // namespace tagliatelle
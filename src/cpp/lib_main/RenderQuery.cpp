@@ -0,0 +1,28 @@
+#include "RenderQuery.hpp"
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    std::size_t FillVisible(const EventStore& events, const Viewport& viewport, std::span<RenderRecord> out)
+    {
+        PROFILE_FUNCTION();
+        std::size_t count = 0;
+        ForEachVisible(events, viewport, [&](const RenderRecord& record)
+            {
+                if (count < out.size())
+                    out[count] = record;
+                ++count;
+            });
+        return count;
+    }
+
+    void CollectVisible(const EventStore& events, const Viewport& viewport, std::vector<RenderRecord>& out)
+    {
+        PROFILE_FUNCTION();
+        out.clear();
+        ForEachVisible(events, viewport, [&out](const RenderRecord& record) { out.push_back(record); });
+    }
+
+} // namespace tagliatelle
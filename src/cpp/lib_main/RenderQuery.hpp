@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm> // std::min, std::max
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "EventStore.hpp"
+
+namespace tagliatelle
+{
+
+    // Visible time window mapped onto a pixel range
+    struct Viewport
+    {
+        Timestamp start = 0;
+        Timestamp end   = 0;
+        float     width = 0; // pixels
+
+        [[nodiscard]] bool Valid() const
+        {
+            return end > start && width > 0;
+        }
+
+        [[nodiscard]] double PixelsPerNs() const
+        {
+            return width / static_cast<double>(end - start);
+        }
+    };
+
+    // Packed, render-ready span, laid out for direct consumption over FFI
+    struct RenderRecord
+    {
+        float         x;     // pixels from the left edge, clipped to the viewport
+        float         width; // pixels, clipped to the viewport
+        TrackId       track;
+        std::uint32_t depth;
+        std::uint32_t colorIndex;
+        NameId        label;
+    };
+
+    // Stable per-name palette slot in [0, 256)
+    [[nodiscard]] inline std::uint32_t ColorIndex(const NameId name)
+    {
+        return (name * 0x9E3779B1u) >> 24;
+    }
+
+    // Calls fn(const RenderRecord&) for every event overlapping the viewport, in timestamp order
+    template <typename F>
+    void ForEachVisible(const EventStore& events, const Viewport& viewport, F&& fn)
+    {
+        if (!viewport.Valid() || events.Size() == 0)
+            return;
+
+        const auto scale = viewport.PixelsPerNs();
+        auto visit = [&](const std::size_t begin, const std::size_t end)
+        {
+            events.ForEachPart(begin, end, [&](const EventSpans& columns, const std::size_t first, const std::size_t last)
+                {
+                    for (auto i = first; i < last; ++i)
+                    {
+                        const auto timestamp = columns.timestamps[i];
+                        const auto duration = columns.durations[i];
+                        const auto visibleFirst = std::max(timestamp, viewport.start);
+                        const auto visibleLast = std::min(timestamp + duration, viewport.end);
+                        if (visibleLast < visibleFirst || (visibleLast == visibleFirst && duration != 0))
+                            continue;
+
+                        const auto x = static_cast<float>((visibleFirst - viewport.start) * scale);
+                        const auto width = static_cast<float>((visibleLast - visibleFirst) * scale);
+                        const auto name = columns.names[i];
+                        fn(RenderRecord{ x, width, columns.tracks[i], columns.depths[i], ColorIndex(name), name });
+                    }
+                });
+        };
+
+        // Of the events starting before the window, only the blocks holding one that reaches into it are scanned
+        const auto first = events.LowerBound(viewport.start);
+        events.ForEachRunReaching(viewport.start, first, visit);
+        visit(first, events.LowerBound(viewport.end));
+    }
+
+    // Fills the buffer with visible records, returns the total number of visible records
+    // which may exceed the capacity of the buffer
+    std::size_t FillVisible(const EventStore& events, const Viewport& viewport, std::span<RenderRecord> out);
+
+    // Replaces the contents of the vector with the visible records
+    void CollectVisible(const EventStore& events, const Viewport& viewport, std::vector<RenderRecord>& out);
+
+} // namespace tagliatelle
@@ -0,0 +1,275 @@
+#include "RenderQueryCache.hpp"
+
+#include <algorithm> // std::max, std::min
+#include <limits>
+#include <new>       // std::bad_alloc
+#include <utility>   // std::move
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        // Same conditions as the pyramid and ForEachVisible() apply
+        bool Visible(const LodExtent& extent, const Timestamp first, const Timestamp last)
+        {
+            return extent.start < last && (extent.end > first || (extent.closed && extent.end == first));
+        }
+
+        // Calls fn(const LodExtent&) for every record of the level visible in [first, last),
+        // events stand for themselves below the base level. Records starting before
+        // minStart may be skipped, which saves the look back for long events.
+        template <typename F>
+        void ForEachExtent(const Trace& trace, const int level, const Timestamp first, const Timestamp last, F&& fn,
+                           const Timestamp minStart = std::numeric_limits<Timestamp>::min())
+        {
+            if (level >= 0)
+            {
+                trace.Lod().ForEachExtent(level, first, last, fn);
+                return;
+            }
+
+            const auto& events = trace.Events();
+            const auto skipped = minStart > first ? events.LowerBound(minStart) : 0; // events before it start before minStart
+            auto visit = [&](const std::size_t begin, const std::size_t end)
+            {
+                events.ForEachPart(std::max(begin, skipped), end, [&](const EventSpans& columns, const std::size_t from, const std::size_t to)
+                    {
+                        for (auto i = from; i < to; ++i)
+                        {
+                            const auto timestamp = columns.timestamps[i];
+                            const auto duration = columns.durations[i];
+                            const LodExtent extent{ timestamp, timestamp + duration, columns.tracks[i], columns.depths[i], columns.names[i], 1, duration == 0 };
+                            if (Visible(extent, first, last))
+                                fn(extent);
+                        }
+                    });
+            };
+
+            const auto begin = events.LowerBound(first);
+            if (minStart < first)
+                events.ForEachRunReaching(first, begin, visit);
+            visit(begin, events.LowerBound(last));
+        }
+    }
+
+    RenderQueryCache::RenderQueryCache(const Trace& trace, std::shared_mutex& traceMutex)
+        : trace{ trace }
+        , traceMutex{ traceMutex }
+    {
+        refiner = std::jthread([this](std::stop_token stop) { Refine(stop); });
+    }
+
+    CachedQueryResult RenderQueryCache::Query(const Viewport& viewport, const std::span<LodRecord> out)
+    {
+        PROFILE_SCOPE("RenderQueryCache::Query");
+        if (!viewport.Valid())
+            return {};
+
+        const auto level = LodPyramid::LevelFor(viewport);
+        const auto generation = trace.Generation();
+
+        std::scoped_lock lock{ mutex };
+        const auto& cached = current.viewport;
+        const bool reusable = current.valid && current.generation == generation;
+        const bool sameScale = viewport.end - viewport.start == cached.end - cached.start && viewport.width == cached.width;
+        bool exact = true;
+        if (reusable && sameScale && viewport.start == cached.start)
+        {
+            ++stats.hits;
+        }
+        else if (reusable && sameScale && viewport.start < current.coveredEnd && viewport.end > current.coveredStart)
+        {
+            ++stats.partialHits;
+            Extend(viewport);
+        }
+        else if (reusable && level < current.level && viewport.start >= current.coveredStart && viewport.end <= current.coveredEnd)
+        {
+            // The cached window is kept as it is, for the records of its level
+            ++stats.staleHits;
+            exact = false;
+            pending = Refinement{ viewport, level, generation };
+            requested.notify_one();
+        }
+        else
+        {
+            ++stats.misses;
+            Recompute(viewport, level, generation);
+        }
+
+        // At the same scale the ratio is 1 and the edges are mapped like the
+        // records, so that records exactly at an edge stay visible or not
+        const auto first = current.Pixel(viewport.start);
+        const auto last = current.Pixel(viewport.end);
+        const auto ratio = exact ? 1.0 : viewport.PixelsPerNs() / current.scale;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < current.records.size(); ++i)
+        {
+            if (!current.Visible(i, first, last))
+                continue;
+            if (count < out.size())
+            {
+                const auto begin = std::max(current.starts[i], first);
+                const auto end = std::min(current.ends[i], last);
+                auto record = current.records[i];
+                record.x = static_cast<float>((begin - first) * ratio);
+                record.width = static_cast<float>((end - begin) * ratio);
+                out[count] = record;
+            }
+            ++count;
+        }
+        if (exact)
+            current.visible = count;
+        return CachedQueryResult{ count, exact };
+    }
+
+    void RenderQueryCache::WaitRefined()
+    {
+        std::unique_lock lock{ mutex };
+        idle.wait(lock, [this] { return !pending && !refining; });
+    }
+
+    RenderCacheStats RenderQueryCache::Stats() const
+    {
+        std::scoped_lock lock{ mutex };
+        return stats;
+    }
+
+    void RenderQueryCache::Recompute(const Viewport& viewport, const int level, const std::uint64_t generation)
+    {
+        current.valid = false;
+        current.Reset(viewport);
+        ForEachExtent(trace, level, viewport.start, viewport.end, [this](const LodExtent& extent) { current.Add(extent); });
+        current.level = level;
+        current.generation = generation;
+        current.valid = true;
+    }
+
+    void RenderQueryCache::Extend(const Viewport& viewport)
+    {
+        // Records of the exposed slices that were visible in the covered range are already cached
+        const auto coveredStart = current.coveredStart;
+        const auto coveredEnd = current.coveredEnd;
+        current.valid = false;
+        auto add = [&](const Timestamp first, const Timestamp last, const Timestamp minStart)
+            {
+                ForEachExtent(trace, current.level, first, last, [&](const LodExtent& extent)
+                    {
+                        if (!Visible(extent, coveredStart, coveredEnd))
+                            current.Add(extent);
+                    }, minStart);
+            };
+        if (viewport.start < coveredStart)
+        {
+            add(viewport.start, coveredStart, std::numeric_limits<Timestamp>::min());
+            current.coveredStart = viewport.start;
+        }
+        // Records starting before the covered end that reach past it were visible
+        if (viewport.end > coveredEnd)
+        {
+            add(coveredEnd, viewport.end, coveredEnd);
+            current.coveredEnd = viewport.end;
+        }
+
+        // Every query passes over the records out of view too, dropping them costs about a query
+        if (current.records.size() > current.visible + current.visible / 8)
+            current.Retain(viewport.start, viewport.end);
+        current.viewport = viewport;
+        current.valid = true;
+    }
+
+    void RenderQueryCache::Refine(std::stop_token stop)
+    {
+        while (true)
+        {
+            Window window;
+            {
+                std::unique_lock lock{ mutex };
+                requested.wait(lock, stop, [this] { return pending.has_value(); });
+                if (stop.stop_requested())
+                    return;
+                window.viewport = pending->viewport;
+                window.level = pending->level;
+                window.generation = pending->generation;
+                pending.reset();
+                refining = true;
+            }
+
+            try
+            {
+                std::shared_lock traceLock{ traceMutex };
+                if (trace.Generation() == window.generation)
+                {
+                    window.Reset(window.viewport);
+                    ForEachExtent(trace, window.level, window.viewport.start, window.viewport.end,
+                                  [&window](const LodExtent& extent) { window.Add(extent); });
+                    window.valid = true;
+                }
+            }
+            catch (const std::bad_alloc&)
+            {
+                window.valid = false;
+            }
+
+            {
+                std::scoped_lock lock{ mutex };
+                refining = false;
+                // Unless the trace changed or a finer window was cached meanwhile
+                if (window.valid && current.valid && window.generation == current.generation && window.level < current.level)
+                {
+                    current = std::move(window);
+                    ++stats.refinements;
+                }
+            }
+            idle.notify_all();
+        }
+    }
+
+    void RenderQueryCache::Window::Reset(const Viewport& viewport)
+    {
+        starts.clear();
+        ends.clear();
+        closed.clear();
+        records.clear();
+        this->viewport = viewport;
+        origin = viewport.start;
+        scale = viewport.PixelsPerNs();
+        coveredStart = viewport.start;
+        coveredEnd = viewport.end;
+        visible = 0;
+    }
+
+    void RenderQueryCache::Window::Add(const LodExtent& extent)
+    {
+        starts.push_back(Pixel(extent.start));
+        ends.push_back(Pixel(extent.end));
+        closed.push_back(extent.closed ? 1 : 0);
+        records.push_back(LodRecord{ 0, 0, extent.track, extent.depth, ColorIndex(extent.label), extent.label, extent.count });
+    }
+
+    void RenderQueryCache::Window::Retain(const Timestamp first, const Timestamp last)
+    {
+        const auto from = Pixel(first);
+        const auto to = Pixel(last);
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < records.size(); ++i)
+        {
+            if (!Visible(i, from, to))
+                continue;
+            starts[kept] = starts[i];
+            ends[kept] = ends[i];
+            closed[kept] = closed[i];
+            records[kept] = records[i];
+            ++kept;
+        }
+        starts.resize(kept);
+        ends.resize(kept);
+        closed.resize(kept);
+        records.resize(kept);
+        coveredStart = first;
+        coveredEnd = last;
+    }
+
+} // namespace tagliatelle
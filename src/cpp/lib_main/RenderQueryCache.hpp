@@ -0,0 +1,126 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "LodPyramid.hpp"
+#include "Trace.hpp"
+
+namespace tagliatelle
+{
+
+    struct RenderCacheStats
+    {
+        std::uint64_t hits        = 0; // same window
+        std::uint64_t partialHits = 0; // overlapping window at the same level, only the exposed slices were queried
+        std::uint64_t staleHits   = 0; // finer level, the coarser records were reused
+        std::uint64_t misses      = 0; // queried in full
+        std::uint64_t refinements = 0; // finer records computed in the background
+    };
+
+    struct CachedQueryResult
+    {
+        std::size_t count = 0;    // total records, may exceed the capacity of the buffer
+        bool        exact = true; // false if the records are of a coarser level than the viewport's
+    };
+
+    // Level-of-detail records of the last viewports, kept unclipped in the
+    // pixels of the scale they were mapped with, so that a pan only shifts
+    // them by the pixel offset.
+    // A viewport at the same scale as the cached one only queries the slices
+    // that no cached viewport covered, and a pan to the right skips the look
+    // back for long events. Records that scrolled out of view are dropped in
+    // one pass once they exceed an eighth of the visible ones.
+    // Zooming in to a finer level within the covered range rescales the
+    // coarser records at once and computes the finer ones on a background
+    // thread, they replace the cached records when they arrive. Any other zoom
+    // is queried in full.
+    // Any modification of the trace invalidates the cache.
+    class RenderQueryCache
+    {
+    public:
+        // The trace must outlive the cache
+        RenderQueryCache(const Trace& trace, std::shared_mutex& traceMutex);
+
+        IMMOVABLE(RenderQueryCache);
+
+        // Fills the buffer with the records visible in the viewport, in no particular order.
+        // The caller holds the trace mutex shared.
+        CachedQueryResult Query(const Viewport& viewport, std::span<LodRecord> out);
+
+        // Blocks until no refinement is pending or running
+        void WaitRefined();
+
+        [[nodiscard]] RenderCacheStats Stats() const;
+
+    private:
+        struct Window
+        {
+            Viewport                 viewport; // of the last query
+            Timestamp                origin       = 0; // at pixel 0
+            double                   scale        = 0; // pixels per nanosecond
+            Timestamp                coveredStart = 0; // every record visible in [coveredStart, coveredEnd) is cached
+            Timestamp                coveredEnd   = 0;
+            int                      level        = 0;
+            std::uint64_t            generation   = 0;
+            std::size_t              visible      = 0; // records in the viewport of the last query
+            bool                     valid        = false;
+
+            // Records in columns, so that a query streams through the pixels.
+            // Pixels from the origin at the window's scale, unclipped.
+            std::vector<double>       starts;
+            std::vector<double>       ends;
+            std::vector<std::uint8_t> closed;  // also visible in windows starting at its end
+            std::vector<LodRecord>    records; // x and width are set by the query
+
+            // Maps onto the viewport's pixels, which the window then covers
+            void Reset(const Viewport& viewport);
+            void Add(const LodExtent& extent);
+
+            // Drops the records outside of [first, last), then covers only that range
+            void Retain(Timestamp first, Timestamp last);
+
+            // Same conditions as the pyramid applies to extents, in pixels
+            [[nodiscard]] bool Visible(const std::size_t i, const double first, const double last) const
+            {
+                return starts[i] < last && (ends[i] > first || (ends[i] == first && closed[i] != 0));
+            }
+
+            [[nodiscard]] double Pixel(const Timestamp time) const
+            {
+                return static_cast<double>(time - origin) * scale;
+            }
+        };
+
+        struct Refinement
+        {
+            Viewport      viewport;
+            int           level;
+            std::uint64_t generation;
+        };
+
+        void Recompute(const Viewport& viewport, int level, std::uint64_t generation);
+        void Extend(const Viewport& viewport);
+        void Refine(std::stop_token stop);
+
+        const Trace&       trace;
+        std::shared_mutex& traceMutex;
+
+        mutable std::mutex          mutex;
+        std::condition_variable_any requested;
+        std::condition_variable     idle;
+        Window                      current;
+        std::optional<Refinement>   pending; // latest request wins
+        bool                        refining = false;
+        RenderCacheStats            stats;
+
+        std::jthread refiner; // last, stopped before the members it uses are destroyed
+    };
+
+} // namespace tagliatelle
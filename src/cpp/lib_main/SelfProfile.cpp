@@ -0,0 +1,52 @@
+#include "SelfProfile.hpp"
+
+#include <algorithm> // std::min
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+#include "NativeTrace.hpp"
+#include "SelfProfiler.hpp"
+
+namespace tagliatelle
+{
+
+    void CollectSelfProfile(EventStore& events)
+    {
+        // A single pass, the rings of exited threads are recycled once read
+        auto origin = std::numeric_limits<std::int64_t>::max();
+
+        // Names are literals, interned once per address
+        std::unordered_map<const char*, NameId> names;
+        EventColumns batch;
+        SelfProfiler::Instance().ForEachRing([&](const ProfileRing& ring) {
+            const auto track = static_cast<TrackId>(ring.Thread());
+            events.SetTrackName(track, "thread " + std::to_string(ring.Thread()));
+            ring.ForEach([&](const char* const name, const std::int64_t start, const std::int64_t end, const std::uint32_t depth) {
+                auto [it, inserted] = names.try_emplace(name, NameId{});
+                if (inserted)
+                    it->second = events.InternName(name);
+
+                origin = std::min(origin, start);
+                batch.timestamps.push_back(start);
+                batch.durations.push_back(end - start);
+                batch.names.push_back(it->second);
+                batch.tracks.push_back(track);
+                batch.depths.push_back(static_cast<Depth>(std::min<std::uint32_t>(depth, std::numeric_limits<Depth>::max())));
+                batch.argOffsets.push_back(0);
+                batch.argCounts.push_back(0);
+            });
+        });
+        for (auto& timestamp : batch.timestamps)
+            timestamp -= origin;
+        events.AppendBulk(batch);
+    }
+
+    void SaveSelfProfile(const std::filesystem::path& path)
+    {
+        EventStore events;
+        CollectSelfProfile(events);
+        SaveNativeTrace(events, path);
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <filesystem>
+
+#include "EventStore.hpp"
+
+namespace tagliatelle
+{
+
+    // Appends the scopes recorded by PROFILE_SCOPE so far, see ProfileMacros.hpp.
+    // Every thread that recorded one gets a track named "thread N", timestamps
+    // start at the earliest scope held. The scopes of exited threads are only
+    // collected once, their rings are then reused by new threads, which take
+    // over their track numbers. Empty unless built with self-profiling.
+    void CollectSelfProfile(EventStore& events);
+
+    // Writes the recorded scopes as a native trace, which tagliatelle opens like any other.
+    // Throws std::ios_base::failure if the file cannot be written.
+    void SaveSelfProfile(const std::filesystem::path& path);
+
+} // namespace tagliatelle
@@ -0,0 +1,186 @@
+#include "SlabAllocator.hpp"
+
+#include <algorithm> // std::max
+#include <new>       // std::bad_alloc, std::align_val_t
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define TAGLIATELLE_SLABS 1
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#ifdef __linux__
+    #include <linux/mempolicy.h> // MPOL_LOCAL
+    #include <sys/syscall.h>
+#endif
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        std::size_t RoundUp(const std::size_t bytes, const std::size_t multiple)
+        {
+            return (bytes + multiple - 1) / multiple * multiple;
+        }
+
+#ifdef TAGLIATELLE_SLABS
+        // Binds the range to the node of the calling thread and faults it in from here
+        void BindLocal(void* const base, const std::size_t bytes)
+        {
+#ifdef __linux__
+            ::syscall(SYS_mbind, base, bytes, MPOL_LOCAL, nullptr, 0, 0);
+#ifdef MADV_POPULATE_WRITE
+            if (::madvise(base, bytes, MADV_POPULATE_WRITE) == 0)
+                return;
+#endif
+            const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            auto* const bytesOut = static_cast<volatile char*>(base);
+            for (std::size_t offset = 0; offset < bytes; offset += page)
+                bytesOut[offset] = 0;
+#else
+            (void)base;
+            (void)bytes;
+#endif
+        }
+#endif
+    }
+
+    SlabArena::SlabArena(const SlabOptions& options)
+        : options{ options }
+        , slabBytes{ RoundUp(options.slabSize, HugePageSize) }
+    {
+    }
+
+    SlabArena::~SlabArena()
+    {
+        for (const auto& slab : slabs)
+            Unmap(slab);
+        for (const auto& [address, mapping] : oversized)
+            Unmap(mapping);
+    }
+
+    bool SlabArena::Supported()
+    {
+#ifdef TAGLIATELLE_SLABS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void* SlabArena::Allocate(const std::size_t bytes)
+    {
+        const auto size = RoundUp(std::max<std::size_t>(bytes, 1), Alignment);
+        if (size > slabBytes / 4)
+        {
+            const auto mapping = Map(size);
+            std::scoped_lock lock{ mutex };
+            try
+            {
+                oversized.emplace(reinterpret_cast<std::uintptr_t>(mapping.base), mapping);
+            }
+            catch (...)
+            {
+                Unmap(mapping);
+                throw;
+            }
+            return mapping.base;
+        }
+
+        std::scoped_lock lock{ mutex };
+        // The list head exists before the block does, so that Deallocate() never allocates
+        void*& head = freeBlocks.try_emplace(size, nullptr).first->second;
+        if (head != nullptr)
+        {
+            void* const block = head;
+            head = *static_cast<void**>(block);
+            return block;
+        }
+
+        if (remaining < size)
+        {
+            slabs.reserve(slabs.size() + 1);
+            const auto slab = Map(slabBytes);
+            slabs.push_back(slab);
+            cursor = static_cast<char*>(slab.base);
+            remaining = slab.bytes;
+        }
+        void* const block = cursor;
+        cursor += size;
+        remaining -= size;
+        return block;
+    }
+
+    void SlabArena::Deallocate(void* const pointer, const std::size_t bytes) noexcept
+    {
+        const auto size = RoundUp(std::max<std::size_t>(bytes, 1), Alignment);
+        std::scoped_lock lock{ mutex };
+        if (size > slabBytes / 4)
+        {
+            const auto it = oversized.find(reinterpret_cast<std::uintptr_t>(pointer));
+            if (it == oversized.end()) [[unlikely]]
+                return;
+            Unmap(it->second);
+            oversized.erase(it);
+            return;
+        }
+
+        void*& head = freeBlocks.find(size)->second;
+        *static_cast<void**>(pointer) = head;
+        head = pointer;
+    }
+
+    std::size_t SlabArena::MappedBytes() const
+    {
+        std::scoped_lock lock{ mutex };
+        std::size_t bytes = 0;
+        for (const auto& slab : slabs)
+            bytes += slab.bytes;
+        for (const auto& [address, mapping] : oversized)
+            bytes += mapping.bytes;
+        return bytes;
+    }
+
+    SlabArena::Mapping SlabArena::Map(const std::size_t bytes) const
+    {
+#ifdef TAGLIATELLE_SLABS
+        // Over-allocated by a huge page and trimmed, so that huge pages line up
+        const auto size = RoundUp(bytes, options.hugePages ? HugePageSize : static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)));
+        const auto padding = options.hugePages ? HugePageSize : 0;
+        void* const raw = ::mmap(nullptr, size + padding, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            throw std::bad_alloc{};
+
+        auto* base = static_cast<char*>(raw);
+        if (padding > 0)
+        {
+            const auto address = reinterpret_cast<std::uintptr_t>(raw);
+            const auto head = RoundUp(address, HugePageSize) - address;
+            base += head;
+            if (head > 0)
+                ::munmap(raw, head);
+            if (padding - head > 0)
+                ::munmap(base + size, padding - head);
+#ifdef MADV_HUGEPAGE
+            ::madvise(base, size, MADV_HUGEPAGE);
+#endif
+        }
+        if (options.nodeLocal)
+            BindLocal(base, size);
+        return Mapping{ base, size };
+#else
+        return Mapping{ ::operator new(bytes, std::align_val_t{ Alignment }), bytes };
+#endif
+    }
+
+    void SlabArena::Unmap(const Mapping& mapping) noexcept
+    {
+#ifdef TAGLIATELLE_SLABS
+        ::munmap(mapping.base, mapping.bytes);
+#else
+        ::operator delete(mapping.base, std::align_val_t{ Alignment });
+#endif
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>      // std::shared_ptr
+#include <mutex>
+#include <type_traits> // std::true_type
+#include <utility>     // std::move
+#include <vector>
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    struct SlabOptions
+    {
+        std::size_t slabSize  = 32 * 1024 * 1024; // rounded up to the huge page size
+        bool        hugePages = true;             // ask for transparent huge pages
+        bool        nodeLocal = false;            // bind slabs to the NUMA node of the allocating thread
+    };
+
+    // Carves small allocations, like the pages of text buffers, out of large
+    // anonymous mappings aligned to the huge page size. Few large mappings
+    // keep TLB misses down on big string tables, and with nodeLocal every
+    // slab is bound to and prefaulted on the node of the thread that needed
+    // it, which suits one arena per ingestion thread.
+    // Freed blocks are kept on a free list per size and only go back to the
+    // OS with the arena. Requests larger than a quarter slab get their own
+    // mapping. Falls back to the heap where mappings are not available.
+    // Thread-safe.
+    class SlabArena
+    {
+    public:
+        static constexpr std::size_t HugePageSize = 2 * 1024 * 1024;
+        static constexpr std::size_t Alignment    = 64;
+
+        explicit SlabArena(const SlabOptions& options = {});
+        ~SlabArena();
+
+        IMMOVABLE(SlabArena);
+
+        // False where slabs are plain heap allocations
+        [[nodiscard]] static bool Supported();
+
+        // Throws std::bad_alloc
+        [[nodiscard]] void* Allocate(std::size_t bytes);
+        void Deallocate(void* pointer, std::size_t bytes) noexcept;
+
+        // Bytes mapped for slabs and oversized blocks
+        [[nodiscard]] std::size_t MappedBytes() const;
+
+    private:
+        struct Mapping
+        {
+            void*       base;
+            std::size_t bytes;
+        };
+
+        [[nodiscard]] Mapping Map(std::size_t bytes) const;
+        static void Unmap(const Mapping& mapping) noexcept;
+
+        const SlabOptions options;
+        const std::size_t slabBytes;
+
+        mutable std::mutex                mutex;
+        std::vector<Mapping>              slabs;
+        std::map<std::uintptr_t, Mapping> oversized;  // by address
+        std::map<std::size_t, void*>      freeBlocks; // by rounded size, linked through the blocks
+        char*                             cursor    = nullptr;
+        std::size_t                       remaining = 0;
+    };
+
+    // Allocator policy for StableTextBuffer, InternedTextBuffer and PagePool
+    // that takes its memory from a shared SlabArena
+    template <typename T>
+    class SlabAllocator
+    {
+    public:
+        using value_type                             = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap            = std::true_type;
+
+        // Every default constructed allocator gets an arena of its own
+        SlabAllocator()
+            : arena{ std::make_shared<SlabArena>() }
+        {
+        }
+
+        explicit SlabAllocator(std::shared_ptr<SlabArena> arena)
+            : arena{ std::move(arena) }
+        {
+        }
+
+        template <typename U>
+        SlabAllocator(const SlabAllocator<U>& other)
+            : arena{ other.Arena() }
+        {
+        }
+
+        [[nodiscard]] T* allocate(const std::size_t n)
+        {
+            return static_cast<T*>(arena->Allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T* const pointer, const std::size_t n) noexcept
+        {
+            arena->Deallocate(pointer, n * sizeof(T));
+        }
+
+        [[nodiscard]] const std::shared_ptr<SlabArena>& Arena() const
+        {
+            return arena;
+        }
+
+        template <typename U>
+        bool operator==(const SlabAllocator<U>& other) const
+        {
+            return arena == other.Arena();
+        }
+
+    private:
+        std::shared_ptr<SlabArena> arena;
+    };
+
+} // namespace tagliatelle
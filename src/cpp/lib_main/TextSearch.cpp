@@ -0,0 +1,242 @@
+#include "TextSearch.hpp"
+
+#include <algorithm> // std::min, std::ranges::any_of, std::ranges::search
+#include <optional>
+#include <regex>
+#include <string>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        char Lower(const char c)
+        {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+        }
+
+        bool IsMeta(const char c)
+        {
+            return std::string_view{ R"(\^$.|?*+()[]{}/)" }.find(c) != std::string_view::npos;
+        }
+
+        // Skips a bracket expression or group starting at i, returns the index of its closing character
+        std::size_t SkipNested(const std::string_view pattern, std::size_t i)
+        {
+            const auto open = pattern[i];
+            const auto close = open == '[' ? ']' : ')';
+            int depth = 0;
+            for (; i < pattern.size(); ++i)
+            {
+                if (pattern[i] == '\\')
+                    ++i;
+                else if (pattern[i] == open && (open == '(' || depth == 0))
+                    ++depth;
+                else if (pattern[i] == close && --depth == 0)
+                    return i;
+            }
+            return pattern.size();
+        }
+
+        // Longest run of characters every match of the regex must contain, empty if there is none.
+        // Conservative: groups, classes and anything before an optional quantifier are left out.
+        std::string RequiredLiteral(const std::string_view pattern)
+        {
+            if (pattern.find('|') != std::string_view::npos)
+                return {};
+
+            std::string best;
+            std::string run;
+            auto endRun = [&]
+                {
+                    if (run.size() > best.size())
+                        best = run;
+                    run.clear();
+                };
+
+            for (std::size_t i = 0; i < pattern.size(); ++i)
+            {
+                const auto c = pattern[i];
+                if (c == '?' || c == '*' || c == '{')
+                {
+                    if (!run.empty())
+                        run.pop_back();
+                    endRun();
+                    if (c == '{')
+                        i = std::min(pattern.find('}', i), pattern.size());
+                }
+                else if (c == '\\' && i + 1 < pattern.size())
+                {
+                    if (IsMeta(pattern[++i]))
+                        run.push_back(pattern[i]);
+                    else
+                        endRun();
+                }
+                else if (c == '[' || c == '(')
+                {
+                    endRun();
+                    i = SkipNested(pattern, i);
+                }
+                else if (IsMeta(c))
+                {
+                    endRun();
+                }
+                else
+                {
+                    run.push_back(c);
+                }
+            }
+            endRun();
+            return best;
+        }
+    }
+
+    TextSearch::TextSearch(const Trace& trace, std::shared_mutex& traceMutex)
+        : trace{ trace }
+        , traceMutex{ traceMutex }
+        , indexBytes{ trace.Events().Budget() }
+    {
+    }
+
+    TextSearch::~TextSearch()
+    {
+        builder = {};
+    }
+
+    void TextSearch::Prepare()
+    {
+        std::scoped_lock lock{ builderMutex };
+        if (building)
+            return;
+
+        {
+            std::shared_lock traceLock{ traceMutex };
+            if (IndexedNames() == trace.Events().Names().Size())
+                return;
+        }
+
+        builder = {};
+        building = true;
+        builder = std::jthread([this](std::stop_token stop) { Build(stop); });
+    }
+
+    std::size_t TextSearch::IndexedNames() const
+    {
+        std::scoped_lock lock{ indexMutex };
+        return index ? index->Size() : 0;
+    }
+
+    void TextSearch::Build(std::stop_token stop)
+    {
+        PROFILE_SCOPE("TextSearch::Build");
+        std::shared_ptr<TrigramIndex> built;
+        {
+            std::scoped_lock lock{ indexMutex };
+            built = std::make_shared<TrigramIndex>(index ? index->Copy() : TrigramIndex{});
+        }
+
+        // Chunked so that writers are never blocked for long, names are append-only
+        for (bool more = true; more && !stop.stop_requested();)
+        {
+            std::shared_lock lock{ traceMutex };
+            const auto names = trace.Events().Names().Views();
+            if (built->Size() > names.size())
+                *built = TrigramIndex{}; // the trace was cleared
+            const auto end = std::min(names.size(), built->Size() + BuildChunk);
+            for (auto id = built->Size(); id < end; ++id)
+                built->Add(names[id]);
+            more = end < names.size();
+        }
+
+        if (!stop.stop_requested())
+        {
+            built->Finish();
+            std::scoped_lock lock{ indexMutex };
+            indexBytes.Update(built->MemoryBytes());
+            index = std::move(built);
+        }
+        building = false;
+    }
+
+    std::vector<std::uint8_t> TextSearch::MatchNames(const std::string_view pattern, const SearchMode mode, const bool ignoreCase) const
+    {
+        PROFILE_SCOPE("TextSearch::MatchNames");
+        std::optional<std::regex> regex;
+        std::string literal{ pattern };
+        if (mode == SearchMode::Regex)
+        {
+            auto flags = std::regex::ECMAScript | std::regex::optimize;
+            if (ignoreCase)
+                flags |= std::regex::icase;
+            regex.emplace(literal, flags);
+            literal = RequiredLiteral(pattern);
+        }
+
+        auto matches = [&](const std::string_view name)
+            {
+                if (regex)
+                    return std::regex_search(name.begin(), name.end(), *regex);
+                if (!ignoreCase)
+                    return name.find(pattern) != std::string_view::npos;
+                return !std::ranges::search(name, pattern, {}, Lower, Lower).empty();
+            };
+
+        std::shared_ptr<const TrigramIndex> snapshot;
+        {
+            std::scoped_lock lock{ indexMutex };
+            snapshot = index;
+        }
+
+        std::shared_lock lock{ traceMutex };
+        const auto names = trace.Events().Names().Views();
+        std::vector<std::uint8_t> matched(names.size(), 0);
+
+        const auto indexed = snapshot ? std::min(snapshot->Size(), names.size()) : 0;
+        const auto candidates = snapshot ? snapshot->Candidates(literal) : std::nullopt;
+        if (candidates)
+        {
+            for (const auto id : *candidates)
+                matched[id] = matches(names[id]);
+        }
+        else
+        {
+            for (std::size_t id = 0; id < indexed; ++id)
+                matched[id] = matches(names[id]);
+        }
+
+        // Names interned after the index was built
+        for (auto id = indexed; id < names.size(); ++id)
+            matched[id] = matches(names[id]);
+        return matched;
+    }
+
+    SearchCursor::SearchCursor(std::vector<std::uint8_t> matchedNames)
+        : matched{ std::move(matchedNames) }
+    {
+    }
+
+    std::size_t SearchCursor::Next(const EventStore& events, const std::span<std::size_t> out)
+    {
+        auto isMatched = [this](const std::uint32_t id) { return id < matched.size() && matched[id] != 0; };
+        auto argumentMatches = [&](const std::size_t i)
+            {
+                return std::ranges::any_of(events.Arguments(i), [&](const Argument& argument)
+                    {
+                        return isMatched(argument.key) || (argument.type == ArgumentType::String && isMatched(argument.text));
+                    });
+            };
+
+        const auto names = events.NameIds();
+        const auto argCounts = events.ArgCounts();
+        std::size_t count = 0;
+        for (; position < names.size() && count < out.size(); ++position)
+        {
+            if (isMatched(names[position]) || (argCounts[position] > 0 && argumentMatches(position)))
+                out[count++] = position;
+        }
+        return count;
+    }
+
+} // namespace tagliatelle
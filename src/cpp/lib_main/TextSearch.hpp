@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Trace.hpp"
+#include "TrigramIndex.hpp"
+
+namespace tagliatelle
+{
+
+    enum class SearchMode
+    {
+        Substring,
+        Regex, // ECMAScript syntax
+    };
+
+    // Finds the names of a trace that match a pattern.
+    // Prepare() builds a trigram index over the string table on a background
+    // thread, later calls extend a copy of it with the names interned since.
+    // Until it is ready, and for names interned after it was built, the
+    // names are scanned one by one, so a search never waits for the index.
+    // Regexes are prefiltered with the longest literal they require.
+    class TextSearch
+    {
+    public:
+        static constexpr std::size_t BuildChunk = 64 * 1024; // names indexed per shared lock
+
+        TextSearch(const Trace& trace, std::shared_mutex& traceMutex);
+        ~TextSearch();
+
+        IMMOVABLE(TextSearch);
+
+        // Starts indexing unless an index of every name is ready or being built
+        void Prepare();
+
+        // Number of names covered by the ready index
+        [[nodiscard]] std::size_t IndexedNames() const;
+
+        // One flag per name ID, set for the names matching the pattern.
+        // Takes the trace lock shared, throws std::regex_error on an invalid regex.
+        [[nodiscard]] std::vector<std::uint8_t> MatchNames(std::string_view pattern, SearchMode mode, bool ignoreCase) const;
+
+    private:
+        void Build(std::stop_token stop);
+
+        const Trace&       trace;
+        std::shared_mutex& traceMutex;
+
+        mutable std::mutex                  indexMutex;
+        std::shared_ptr<const TrigramIndex> index;
+        ReportedBytes                       indexBytes; // to the trace's budget
+
+        std::mutex        builderMutex;
+        std::atomic<bool> building = false;
+        std::jthread      builder;
+    };
+
+    // Streams the events whose name, argument keys or string argument values
+    // matched a search, in store order
+    class SearchCursor
+    {
+    public:
+        explicit SearchCursor(std::vector<std::uint8_t> matchedNames);
+
+        MOVE_ONLY(SearchCursor);
+
+        // Fills out with the indices of the next matching events and returns
+        // how many were written, 0 once every event was visited
+        std::size_t Next(const EventStore& events, std::span<std::size_t> out);
+
+    private:
+        std::vector<std::uint8_t> matched;
+        std::size_t               position = 0;
+    };
+
+} // namespace tagliatelle
@@ -0,0 +1,99 @@
+#include "TextTraceParser.hpp"
+
+#include <algorithm> // std::min
+#include <charconv>  // std::from_chars
+#include <limits>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        bool IsBlank(const char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        std::string_view TrimLeft(std::string_view str)
+        {
+            while (!str.empty() && IsBlank(str.front()))
+                str.remove_prefix(1);
+            return str;
+        }
+
+        std::string_view TrimRight(std::string_view str)
+        {
+            while (!str.empty() && IsBlank(str.back()))
+                str.remove_suffix(1);
+            return str;
+        }
+
+        // Parses a number followed by a blank, consuming both
+        template <typename T>
+        bool ParseField(std::string_view& line, T& value)
+        {
+            line = TrimLeft(line);
+            const auto [end, error] = std::from_chars(line.data(), line.data() + line.size(), value);
+            if (error != std::errc{} || end == line.data() + line.size() || !IsBlank(*end))
+                return false;
+            line.remove_prefix(end - line.data());
+            return true;
+        }
+
+        bool ParseLine(std::string_view line, ParsedChunk& out)
+        {
+            constexpr std::string_view TrackKeyword = "track";
+
+            if (line.starts_with(TrackKeyword) && line.size() > TrackKeyword.size() && IsBlank(line[TrackKeyword.size()]))
+            {
+                line.remove_prefix(TrackKeyword.size());
+                TrackId track = 0;
+                if (!ParseField(line, track) || track >= EventStore::MaxTracks)
+                    return false;
+                out.trackNames.emplace_back(track, out.names.Intern(TrimRight(TrimLeft(line))));
+                return true;
+            }
+
+            Event event;
+            std::uint32_t depth = 0;
+            if (!ParseField(line, event.timestamp) || !ParseField(line, event.duration) || !ParseField(line, event.track) || !ParseField(line, depth))
+                return false;
+            if (event.duration < 0 || event.track >= EventStore::MaxTracks || depth > std::numeric_limits<Depth>::max())
+                return false;
+
+            event.depth = static_cast<Depth>(depth);
+            event.name = out.names.Intern(TrimRight(TrimLeft(line)));
+            out.columns.PushBack(event);
+            return true;
+        }
+    }
+
+    void ParseTextTrace(std::string_view text, ParsedChunk& out)
+    {
+        PROFILE_FUNCTION();
+        while (!text.empty())
+        {
+            const auto newline = text.find('\n');
+            const auto line = TrimLeft(text.substr(0, newline));
+            text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+
+            if (line.empty() || line.front() == '#')
+                continue;
+            if (!ParseLine(line, out))
+                ++out.malformedRecords;
+        }
+    }
+
+    std::size_t NextTextRecord(const std::string_view text, const std::size_t pos)
+    {
+        if (pos == 0 || pos >= text.size())
+            return std::min(pos, text.size());
+        if (text[pos - 1] == '\n')
+            return pos;
+        const auto newline = text.find('\n', pos);
+        return newline == std::string_view::npos ? text.size() : newline + 1;
+    }
+
+} // namespace tagliatelle
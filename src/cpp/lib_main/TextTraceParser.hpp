@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "ParsedChunk.hpp"
+
+namespace tagliatelle
+{
+
+    // Plain-text trace format, one record per line:
+    //   <timestamp ns> <duration ns> <track> <depth> <name>
+    //   track <track> <name>
+    // Fields are separated by spaces or tabs, the name runs to the end of
+    // the line. Blank lines and lines starting with '#' are ignored.
+
+    // Parses all complete lines of the text, malformed lines are counted and skipped
+    void ParseTextTrace(std::string_view text, ParsedChunk& out);
+
+    // Start of the first record at or after pos
+    [[nodiscard]] std::size_t NextTextRecord(std::string_view text, std::size_t pos);
+
+} // namespace tagliatelle
@@ -0,0 +1,155 @@
+#include "Trace.hpp"
+
+#include <algorithm> // std::min, std::ranges::min, std::ranges::stable_sort
+#include <vector>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    void Trace::Append(const Event& event)
+    {
+        const auto last = events.Size() == 0 ? event.timestamp : events.Timestamps().back();
+        Invalidate(event.timestamp > last ? events.Size() : events.LowerBound(event.timestamp));
+        events.Append(event);
+        lod.Add(event);
+        lodBytes.Update(lod.MemoryBytes());
+        ++generation;
+    }
+
+    void Trace::AppendBulk(const EventColumns& batch)
+    {
+        PROFILE_SCOPE("Trace::AppendBulk");
+        // Stored events starting before the batch keep their positions
+        if (batch.Size() > 0)
+            Invalidate(events.LowerBound(std::ranges::min(batch.timestamps)));
+        events.AppendBulk(batch);
+        for (std::size_t i = 0; i < batch.Size(); ++i)
+            lod.Add(batch[i]);
+        lodBytes.Update(lod.MemoryBytes());
+        ++generation;
+    }
+
+    void Trace::Invalidate(const std::size_t first)
+    {
+        intervalsStale = std::min(intervalsStale, first);
+        flowsStale = std::min(flowsStale, first);
+    }
+
+    void Trace::AppendCounter(const SeriesId id, const Timestamp timestamp, const double value)
+    {
+        counters.Append(id, timestamp, value);
+        ++generation;
+    }
+
+    void Trace::AppendFlows(const std::span<const FlowPoint> batch)
+    {
+        flows.Append(batch);
+        ++generation;
+    }
+
+    void Trace::AppendChunk(ParsedChunk&& chunk)
+    {
+        PROFILE_SCOPE("Trace::AppendChunk");
+        std::vector<NameId> remap;
+        remap.reserve(chunk.names.Size());
+        for (const auto name : chunk.names.Views())
+            remap.push_back(events.InternName(name));
+
+        for (auto& name : chunk.columns.names)
+            name = remap[name];
+        auto& columns = chunk.columns;
+        for (std::size_t i = 0; i < columns.Size(); ++i)
+        {
+            const auto arguments = chunk.arguments.View(columns.argOffsets[i], columns.argCounts[i]);
+            for (auto& argument : arguments)
+            {
+                argument.key = remap[argument.key];
+                if (argument.type == ArgumentType::String)
+                    argument.text = remap[argument.text];
+            }
+            columns.argOffsets[i] = events.StoreArguments(arguments);
+        }
+        for (const auto& [track, name] : chunk.trackNames)
+            events.SetTrackName(track, chunk.names.View(name));
+
+        // Grouped by series, so that each series is appended and, if need be, rebuilt once
+        if (!chunk.counters.empty())
+        {
+            std::ranges::stable_sort(chunk.counters, {}, &CounterSample::series);
+            std::vector<CounterPoint> points;
+            for (std::size_t first = 0; first < chunk.counters.size();)
+            {
+                const auto series = chunk.counters[first].series;
+                points.clear();
+                auto last = first;
+                for (; last < chunk.counters.size() && chunk.counters[last].series == series; ++last)
+                    points.push_back(CounterPoint{ chunk.counters[last].timestamp, chunk.counters[last].value });
+                counters.AppendBulk(counters.Series(remap[series]), points);
+                first = last;
+            }
+        }
+
+        if (!chunk.flows.empty())
+        {
+            for (auto& point : chunk.flows)
+                point.id = FlowStore::KeyedId | flowKeys.Intern(chunk.flowKeys.View(static_cast<std::uint32_t>(point.id)));
+            flows.Append(chunk.flows);
+        }
+
+        AppendBulk(chunk.columns);
+    }
+
+    void Trace::Renest(const std::span<const TrackId> tracks)
+    {
+        PROFILE_SCOPE("Trace::Renest");
+        if (!events.Renest(tracks))
+            return;
+        lod.Clear();
+        for (std::size_t i = 0; i < events.Size(); ++i)
+            lod.Add(events[i]);
+        lodBytes.Update(lod.MemoryBytes());
+        Invalidate(0);
+        ++generation;
+    }
+
+    const IntervalIndex& Trace::Intervals() const
+    {
+        std::scoped_lock lock{ intervalsMutex };
+        if (intervalsStale < events.Size())
+        {
+            intervals.Update(events, intervalsStale);
+            intervalsStale = events.Size();
+            intervalsBytes.Update(intervals.MemoryBytes());
+        }
+        return intervals;
+    }
+
+    const FlowStore& Trace::Flows() const
+    {
+        std::scoped_lock lock{ flowsMutex };
+        // Also resolves the points appended since the last update
+        flows.Update(events, Intervals(), flowsStale);
+        flowsStale = events.Size();
+        flowsBytes.Update(flows.MemoryBytes());
+        return flows;
+    }
+
+    void Trace::Clear()
+    {
+        events.Clear();
+        lod.Clear();
+        counters.Clear();
+        flowKeys.Clear();
+        intervals.Clear();
+        flows.Clear();
+        intervalsStale = 0;
+        flowsStale = 0;
+        lodBytes.Update(0);
+        intervalsBytes.Update(0);
+        flowsBytes.Update(0);
+        ++generation;
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+
+#include "CounterStore.hpp"
+#include "EventStore.hpp"
+#include "FlowStore.hpp"
+#include "IntervalIndex.hpp"
+#include "LodPyramid.hpp"
+#include "ParsedChunk.hpp"
+
+namespace tagliatelle
+{
+
+    // An event store together with the derived structures that are kept
+    // in sync with it as events are appended.
+    // The interval index and the flow edges are updated on first use after a
+    // modification, from the first event whose position may have changed.
+    class Trace
+    {
+    public:
+        Trace() = default;
+
+        // Events, names and arguments are kept within the budget, which must
+        // outlive the trace; the derived structures report their size to it
+        explicit Trace(MemoryBudget* const budget)
+            : events{ budget }
+            , lodBytes{ budget }
+            , intervalsBytes{ budget }
+            , flowsBytes{ budget }
+        {
+        }
+
+        IMMOVABLE(Trace);
+
+        [[nodiscard]] NameId InternName(const std::string_view name)
+        {
+            return events.InternName(name);
+        }
+
+        void SetTrackName(const TrackId track, const std::string_view name)
+        {
+            events.SetTrackName(track, name);
+        }
+
+        // Arguments must be stored before the events referring to them are appended
+        [[nodiscard]] ArgumentOffset StoreArguments(const std::span<const Argument> run)
+        {
+            return events.StoreArguments(run);
+        }
+
+        void Append(const Event& event);
+        void AppendBulk(const EventColumns& batch);
+
+        // Series of the named counter, created on first use
+        [[nodiscard]] SeriesId CounterSeries(const std::string_view name)
+        {
+            return counters.Series(events.InternName(name));
+        }
+
+        void AppendCounter(SeriesId id, Timestamp timestamp, double value);
+
+        // Points are bound to spans when the flows are next used, so they may precede their spans
+        void AppendFlows(std::span<const FlowPoint> batch);
+
+        // Remaps the chunk's local names into the trace, moves its arguments
+        // to the trace's arena and appends its events, counter samples and flows
+        void AppendChunk(ParsedChunk&& chunk);
+
+        // Derives the depths of the tracks' spans from the spans enclosing
+        // them, for importers that appended chunks before all were known
+        void Renest(std::span<const TrackId> tracks);
+
+        void Clear();
+
+        [[nodiscard]] const EventStore& Events() const
+        {
+            return events;
+        }
+
+        [[nodiscard]] const LodPyramid& Lod() const
+        {
+            return lod;
+        }
+
+        [[nodiscard]] const CounterStore& Counters() const
+        {
+            return counters;
+        }
+
+        // Safe to call from concurrent readers, the first one after a modification updates the index
+        [[nodiscard]] const IntervalIndex& Intervals() const;
+
+        // Flow edges between the spans, updated like the interval index
+        [[nodiscard]] const FlowStore& Flows() const;
+
+        // Changes with every modification, event indices are only stable within a generation
+        [[nodiscard]] std::uint64_t Generation() const
+        {
+            return generation;
+        }
+
+    private:
+        // Events from first on may have moved, the derived indices are updated from there
+        void Invalidate(std::size_t first);
+
+        EventStore    events;
+        LodPyramid    lod;
+        CounterStore  counters;
+        std::uint64_t generation = 0;
+
+        InternedTextBuffer<EventStore::TextPageSize> flowKeys; // of imported flows
+        ReportedBytes                                lodBytes;
+
+        mutable std::mutex    intervalsMutex;
+        mutable IntervalIndex intervals;
+        mutable std::size_t   intervalsStale = 0; // first event that may have changed since the last update
+        mutable ReportedBytes intervalsBytes;
+
+        mutable std::mutex    flowsMutex;
+        mutable FlowStore     flows;
+        mutable std::size_t   flowsStale = 0;
+        mutable ReportedBytes flowsBytes;
+    };
+
+} // namespace tagliatelle
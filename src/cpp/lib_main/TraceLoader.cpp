@@ -0,0 +1,237 @@
+#include "TraceLoader.hpp"
+
+#include <algorithm> // std::max
+#include <exception>
+#include <optional>
+#include <vector>
+
+#include "ChromeTraceImporter.hpp"
+#include "LiveCapture.hpp"
+#include "MappedFile.hpp"
+#include "NativeTrace.hpp"
+#include "ProfileMacros.hpp"
+#include "TextTraceParser.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        // Rough size of a record of a text trace, decoded formats are merged
+        // in chunks of as many events as a text chunk holds
+        constexpr std::size_t BytesPerEvent = 32;
+    }
+
+    TraceLoader::TraceLoader(Trace& trace, std::shared_mutex& traceMutex)
+        : trace{ trace }
+        , traceMutex{ traceMutex }
+    {
+    }
+
+    TraceLoader::~TraceLoader()
+    {
+        coordinator.request_stop();
+    }
+
+    void TraceLoader::Start(std::filesystem::path path, const unsigned threadCount, const std::size_t chunkSize)
+    {
+        ASSERT((!coordinator.joinable()), "TraceLoader: already started");
+        coordinator = std::jthread([this, path = std::move(path), threadCount, chunkSize](std::stop_token stop)
+            {
+                Run(stop, path, std::max(threadCount, 1u), std::max<std::size_t>(chunkSize, 1));
+            });
+    }
+
+    void TraceLoader::Wait()
+    {
+        if (!coordinator.joinable())
+            return;
+        std::unique_lock lock{ stateMutex };
+        finished.wait(lock, [this] { return done; });
+    }
+
+    LoadProgress TraceLoader::Progress() const
+    {
+        LoadProgress progress;
+        progress.bytesTotal = bytesTotal;
+        progress.bytesParsed = bytesParsed;
+        progress.eventsLoaded = eventsLoaded;
+        progress.malformedRecords = malformedRecords;
+
+        std::scoped_lock lock{ stateMutex };
+        progress.done = done;
+        progress.failed = failed;
+        return progress;
+    }
+
+    std::string TraceLoader::Error() const
+    {
+        std::scoped_lock lock{ stateMutex };
+        return error;
+    }
+
+    void TraceLoader::Run(std::stop_token stop, std::filesystem::path path, const unsigned threadCount, const std::size_t chunkSize)
+    {
+        PROFILE_SCOPE("TraceLoader::Run");
+        try
+        {
+            const MappedFile file{ path };
+            const auto text = file.Data();
+            bytesTotal = text.size();
+
+            // Native, recorded live and JSON traces are decoded by this thread,
+            // each chunk is merged as soon as it is complete
+            if (IsNativeTrace(text) || IsLiveStream(text) || LooksLikeJson(text))
+            {
+                std::vector<TrackId> provisionalTracks;
+                const ChunkSink merge = [&](ParsedChunk&& chunk)
+                    {
+                        if (stop.stop_requested())
+                            return false;
+                        chunk.columns.Sort();
+                        provisionalTracks.insert(provisionalTracks.end(), chunk.provisionalTracks.begin(), chunk.provisionalTracks.end());
+                        Merge(std::move(chunk));
+                        return true;
+                    };
+                const auto chunkEvents = std::max<std::size_t>(chunkSize / BytesPerEvent, 1);
+                if (IsNativeTrace(text))
+                    ImportNativeTrace(text, chunkEvents, merge, &bytesParsed);
+                else if (IsLiveStream(text))
+                    ImportLiveStream(text, chunkEvents, merge, &bytesParsed);
+                else
+                    ImportChromeTrace(text, chunkEvents, merge, &bytesParsed);
+
+                if (!provisionalTracks.empty() && !stop.stop_requested())
+                {
+                    std::unique_lock lock{ traceMutex };
+                    trace.Renest(provisionalTracks);
+                }
+                Finish(stop.stop_requested(), stop.stop_requested() ? "cancelled" : "");
+                return;
+            }
+
+            std::vector<std::size_t> bounds{ 0 };
+            while (bounds.back() < text.size())
+                bounds.push_back(NextTextRecord(text, bounds.back() + chunkSize));
+            const auto chunkCount = bounds.size() - 1;
+
+            // Workers stay at most a few chunks ahead of the merge to bound memory
+            const std::size_t window = 2 * threadCount;
+            std::vector<std::optional<ParsedChunk>> parsed(chunkCount);
+            std::mutex parsedMutex;
+            std::condition_variable_any parsedChanged;
+            std::size_t nextChunk = 0;
+            std::size_t merged = 0;
+            std::exception_ptr workerError;
+            bool abandoned = false;
+
+            auto parse = [&]
+                {
+                    while (true)
+                    {
+                        std::size_t index = 0;
+                        {
+                            std::unique_lock lock{ parsedMutex };
+                            if (!parsedChanged.wait(lock, stop, [&] { return nextChunk >= chunkCount || nextChunk < merged + window || workerError || abandoned; }))
+                                return;
+                            if (nextChunk >= chunkCount || workerError || abandoned)
+                                return;
+                            index = nextChunk++;
+                        }
+
+                        try
+                        {
+                            ParsedChunk chunk;
+                            ParseTextTrace(text.substr(bounds[index], bounds[index + 1] - bounds[index]), chunk);
+                            chunk.columns.Sort(); // here rather than under the trace lock
+                            bytesParsed += bounds[index + 1] - bounds[index];
+
+                            std::scoped_lock lock{ parsedMutex };
+                            parsed[index] = std::move(chunk);
+                        }
+                        catch (...)
+                        {
+                            std::scoped_lock lock{ parsedMutex };
+                            workerError = std::current_exception();
+                        }
+                        parsedChanged.notify_all();
+                    }
+                };
+
+            std::vector<std::jthread> workers;
+            for (unsigned i = 0; i < std::min<std::size_t>(threadCount, chunkCount); ++i)
+                workers.emplace_back(parse);
+
+            // Unblocks workers waiting for the merge to catch up
+            auto abandon = [&]
+                {
+                    {
+                        std::scoped_lock lock{ parsedMutex };
+                        abandoned = true;
+                    }
+                    parsedChanged.notify_all();
+                };
+
+            try
+            {
+                for (std::size_t index = 0; index < chunkCount; ++index)
+                {
+                    ParsedChunk chunk;
+                    {
+                        std::unique_lock lock{ parsedMutex };
+                        if (!parsedChanged.wait(lock, stop, [&] { return parsed[index].has_value() || workerError; }))
+                            break;
+                        if (workerError)
+                            std::rethrow_exception(workerError);
+                        chunk = std::move(*parsed[index]);
+                        parsed[index].reset();
+                    }
+
+                    Merge(std::move(chunk));
+
+                    {
+                        std::scoped_lock lock{ parsedMutex };
+                        merged = index + 1;
+                    }
+                    parsedChanged.notify_all();
+                }
+            }
+            catch (...)
+            {
+                abandon();
+                throw;
+            }
+            abandon();
+        }
+        catch (const std::exception& e)
+        {
+            Finish(true, e.what());
+            return;
+        }
+
+        Finish(stop.stop_requested(), stop.stop_requested() ? "cancelled" : "");
+    }
+
+    void TraceLoader::Merge(ParsedChunk&& chunk)
+    {
+        const auto eventCount = chunk.columns.Size();
+        malformedRecords += chunk.malformedRecords;
+        {
+            std::unique_lock lock{ traceMutex };
+            trace.AppendChunk(std::move(chunk));
+        }
+        eventsLoaded += eventCount;
+    }
+
+    void TraceLoader::Finish(const bool failed, std::string error)
+    {
+        {
+            std::scoped_lock lock{ stateMutex };
+            this->done = true;
+            this->failed = failed;
+            this->error = std::move(error);
+        }
+        finished.notify_all();
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+
+#include "Trace.hpp"
+
+namespace tagliatelle
+{
+
+    struct LoadProgress
+    {
+        std::uint64_t bytesTotal       = 0;
+        std::uint64_t bytesParsed      = 0;
+        std::uint64_t eventsLoaded     = 0;
+        std::uint64_t malformedRecords = 0;
+        bool          done             = false;
+        bool          failed           = false;
+    };
+
+    // Loads a trace file in the background.
+    // The file is memory mapped. Text traces are split into chunks at record
+    // boundaries, which are parsed in parallel into ParsedChunks; native,
+    // recorded live and Chrome JSON traces are detected and decoded into
+    // chunks by a single thread. Either way chunks are merged into the trace
+    // in file order as soon as they are ready, so readers holding the shared
+    // lock see the beginning of the trace while the rest is loading.
+    // Depths that a JSON chunk left provisional are derived once all are merged.
+    // Destroying the loader cancels the load and waits for its threads.
+    class TraceLoader
+    {
+    public:
+        static constexpr std::size_t DefaultChunkSize = 4 * 1024 * 1024;
+
+        // The trace is only modified while holding the mutex exclusively
+        TraceLoader(Trace& trace, std::shared_mutex& traceMutex);
+        ~TraceLoader();
+
+        IMMOVABLE(TraceLoader);
+
+        void Start(std::filesystem::path path,
+                   unsigned threadCount = std::thread::hardware_concurrency(),
+                   std::size_t chunkSize = DefaultChunkSize);
+
+        // Blocks until the load has finished, failed or was cancelled
+        void Wait();
+
+        [[nodiscard]] LoadProgress Progress() const;
+
+        // Reason of the failure, empty unless Progress().failed
+        [[nodiscard]] std::string Error() const;
+
+    private:
+        void Run(std::stop_token stop, std::filesystem::path path, unsigned threadCount, std::size_t chunkSize);
+        void Merge(ParsedChunk&& chunk);
+        void Finish(bool failed, std::string error);
+
+        Trace&             trace;
+        std::shared_mutex& traceMutex;
+
+        std::atomic<std::uint64_t> bytesTotal       = 0;
+        std::atomic<std::uint64_t> bytesParsed      = 0;
+        std::atomic<std::uint64_t> eventsLoaded     = 0;
+        std::atomic<std::uint64_t> malformedRecords = 0;
+
+        mutable std::mutex      stateMutex;
+        std::condition_variable finished;
+        bool                    done   = false;
+        bool                    failed = false;
+        std::string             error;
+
+        std::jthread coordinator;
+    };
+
+} // namespace tagliatelle
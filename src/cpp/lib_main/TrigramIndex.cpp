@@ -0,0 +1,122 @@
+#include "TrigramIndex.hpp"
+
+#include <algorithm> // std::ranges::sort, std::ranges::lower_bound, std::set_intersection
+#include <iterator>  // std::back_inserter
+#include <utility>
+
+#include "ProfileMacros.hpp"
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        std::uint32_t Lower(const char c)
+        {
+            const auto byte = static_cast<unsigned char>(c);
+            return byte >= 'A' && byte <= 'Z' ? byte + ('a' - 'A') : byte;
+        }
+
+        template <typename F>
+        void ForEachTrigram(const std::string_view text, F&& fn)
+        {
+            for (std::size_t i = 2; i < text.size(); ++i)
+                fn(Lower(text[i - 2]) << 16 | Lower(text[i - 1]) << 8 | Lower(text[i]));
+        }
+    }
+
+    TrigramIndex TrigramIndex::Copy() const
+    {
+        TrigramIndex copy;
+        copy.pending = pending;
+        copy.keys = keys;
+        copy.offsets = offsets;
+        copy.postings = postings;
+        copy.count = count;
+        return copy;
+    }
+
+    void TrigramIndex::Add(const std::string_view text)
+    {
+        const auto id = static_cast<std::uint64_t>(count++);
+        ForEachTrigram(text, [&](const std::uint32_t trigram) { pending.push_back(std::uint64_t{ trigram } << 32 | id); });
+    }
+
+    void TrigramIndex::Finish()
+    {
+        PROFILE_SCOPE("TrigramIndex::Finish");
+        std::ranges::sort(pending);
+        const auto [first, last] = std::ranges::unique(pending);
+        pending.erase(first, last);
+
+        // The packed IDs are all lower than the pending ones, so each merged
+        // list is the packed list followed by the pending entries of its key
+        std::vector<std::uint32_t> mergedKeys;
+        std::vector<std::uint32_t> mergedOffsets;
+        std::vector<Id> merged;
+        mergedKeys.reserve(keys.size());
+        mergedOffsets.reserve(keys.size() + 1);
+        merged.reserve(postings.size() + pending.size());
+        auto trigramOf = [](const std::uint64_t entry) { return static_cast<std::uint32_t>(entry >> 32); };
+        std::size_t key = 0;
+        auto next = pending.begin();
+        while (key < keys.size() || next != pending.end())
+        {
+            const auto trigram = next == pending.end() || (key < keys.size() && keys[key] <= trigramOf(*next)) ? keys[key] : trigramOf(*next);
+            mergedKeys.push_back(trigram);
+            mergedOffsets.push_back(static_cast<std::uint32_t>(merged.size()));
+            if (key < keys.size() && keys[key] == trigram)
+            {
+                merged.insert(merged.end(), postings.begin() + offsets[key], postings.begin() + offsets[key + 1]);
+                ++key;
+            }
+            for (; next != pending.end() && trigramOf(*next) == trigram; ++next)
+                merged.push_back(static_cast<Id>(*next));
+        }
+        mergedOffsets.push_back(static_cast<std::uint32_t>(merged.size()));
+
+        keys = std::move(mergedKeys);
+        offsets = std::move(mergedOffsets);
+        postings = std::move(merged);
+
+        pending.clear();
+        pending.shrink_to_fit();
+    }
+
+    std::optional<std::vector<TrigramIndex::Id>> TrigramIndex::Candidates(const std::string_view literal) const
+    {
+        if (literal.size() < 3)
+            return std::nullopt;
+
+        // Intersect starting from the rarest trigram, the result only shrinks
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> lists;
+        bool missing = false;
+        ForEachTrigram(literal, [&](const std::uint32_t trigram)
+            {
+                const auto it = std::ranges::lower_bound(keys, trigram);
+                if (it == keys.end() || *it != trigram)
+                {
+                    missing = true;
+                    return;
+                }
+                const auto key = static_cast<std::size_t>(it - keys.begin());
+                lists.emplace_back(offsets[key], offsets[key + 1]);
+            });
+        if (missing)
+            return std::vector<Id>{};
+
+        std::ranges::sort(lists, {}, [](const auto& list) { return list.second - list.first; });
+        std::vector<Id> result(postings.begin() + lists[0].first, postings.begin() + lists[0].second);
+        std::vector<Id> next;
+        for (std::size_t i = 1; i < lists.size() && !result.empty(); ++i)
+        {
+            next.clear();
+            std::set_intersection(result.begin(), result.end(),
+                                  postings.begin() + lists[i].first, postings.begin() + lists[i].second,
+                                  std::back_inserter(next));
+            result.swap(next);
+        }
+        return result;
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    // Inverted index from the trigrams of strings to the IDs of the strings.
+    // Trigrams are taken from the ASCII-lowercased bytes, so one index serves
+    // both case-sensitive and case-insensitive searches; callers verify the
+    // candidates against the text. The postings of all trigrams are sorted
+    // ID lists packed in one array and found by binary search over the keys.
+    class TrigramIndex
+    {
+    public:
+        using Id = std::uint32_t;
+
+        TrigramIndex() = default;
+
+        MOVE_ONLY(TrigramIndex);
+
+        // Explicit copy, to extend an index that readers still use
+        [[nodiscard]] TrigramIndex Copy() const;
+
+        // Strings are added in ID order starting at 0
+        void Add(std::string_view text);
+
+        // Packs the postings of the strings added since the last call, merging
+        // them into the packed ones; call before Candidates
+        void Finish();
+
+        // Number of strings indexed
+        [[nodiscard]] std::size_t Size() const
+        {
+            return count;
+        }
+
+        // Bytes allocated by the postings and the keys
+        [[nodiscard]] std::size_t MemoryBytes() const
+        {
+            return pending.capacity() * sizeof(std::uint64_t) + (keys.capacity() + offsets.capacity()) * sizeof(std::uint32_t)
+                 + postings.capacity() * sizeof(Id);
+        }
+
+        // IDs of the strings containing every trigram of the literal in ascending order,
+        // nullopt if the literal is too short to have any
+        [[nodiscard]] std::optional<std::vector<Id>> Candidates(std::string_view literal) const;
+
+    private:
+        std::vector<std::uint64_t> pending; // trigram << 32 | ID until Finish
+        std::vector<std::uint32_t> keys;
+        std::vector<std::uint32_t> offsets; // postings of keys[i] are [offsets[i], offsets[i + 1])
+        std::vector<Id>            postings;
+        std::size_t                count = 0;
+    };
+
+} // namespace tagliatelle
@@ -0,0 +1,99 @@
+#include "WorkStealingPool.hpp"
+
+#include <algorithm> // std::max
+
+namespace tagliatelle
+{
+
+    namespace
+    {
+        // Pool and worker index of the calling thread, if it is a worker
+        thread_local const WorkStealingPool* currentPool = nullptr;
+        thread_local unsigned                currentIndex = 0;
+    }
+
+    WorkStealingPool::WorkStealingPool(const unsigned threadCount)
+    {
+        const auto count = std::max(threadCount, 1u);
+        for (unsigned i = 0; i < count; ++i)
+            workers.push_back(std::make_unique<Worker>());
+        for (unsigned i = 0; i < count; ++i)
+            threads.emplace_back([this, i] { Run(i); });
+    }
+
+    WorkStealingPool::~WorkStealingPool()
+    {
+        {
+            std::scoped_lock lock{ sleepMutex };
+            stopping = true;
+        }
+        wake.notify_all();
+        threads.clear();
+    }
+
+    void WorkStealingPool::Submit(Task task)
+    {
+        // Counted first so that whoever takes the task never sees a negative count,
+        // the sleep mutex orders the increment before a worker's predicate check
+        {
+            std::scoped_lock lock{ sleepMutex };
+            ++pending;
+        }
+
+        const auto index = currentPool == this ? currentIndex : nextWorker++ % ThreadCount();
+        {
+            std::scoped_lock lock{ workers[index]->mutex };
+            workers[index]->tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    std::optional<WorkStealingPool::Task> WorkStealingPool::Take(const unsigned index)
+    {
+        {
+            auto& own = *workers[index];
+            std::scoped_lock lock{ own.mutex };
+            if (!own.tasks.empty())
+            {
+                auto task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return task;
+            }
+        }
+
+        for (unsigned offset = 1; offset < ThreadCount(); ++offset)
+        {
+            auto& victim = *workers[(index + offset) % ThreadCount()];
+            std::scoped_lock lock{ victim.mutex };
+            if (!victim.tasks.empty())
+            {
+                auto task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return task;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void WorkStealingPool::Run(const unsigned index)
+    {
+        currentPool = this;
+        currentIndex = index;
+
+        while (true)
+        {
+            if (auto task = Take(index))
+            {
+                --pending;
+                (*task)();
+                continue;
+            }
+
+            std::unique_lock lock{ sleepMutex };
+            wake.wait(lock, [this] { return pending > 0 || stopping; });
+            if (stopping && pending == 0)
+                return;
+        }
+    }
+
+} // namespace tagliatelle
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    // Fixed-size thread pool where every worker owns a deque of tasks.
+    // A worker pops its own newest task first, which keeps the data of
+    // tasks it spawned in its cache, and steals the oldest task of another
+    // worker when it runs dry, so uneven shards even out on their own.
+    // Tasks submitted from outside the pool are dealt out round-robin.
+    // Destroying the pool runs the tasks still queued, then joins.
+    class WorkStealingPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit WorkStealingPool(unsigned threadCount = std::thread::hardware_concurrency());
+        ~WorkStealingPool();
+
+        IMMOVABLE(WorkStealingPool);
+
+        void Submit(Task task);
+
+        [[nodiscard]] unsigned ThreadCount() const
+        {
+            return static_cast<unsigned>(workers.size());
+        }
+
+    private:
+        struct Worker
+        {
+            std::mutex       mutex;
+            std::deque<Task> tasks;
+        };
+
+        void Run(unsigned index);
+        std::optional<Task> Take(unsigned index);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<unsigned>                nextWorker = 0;
+        std::atomic<std::size_t>             pending    = 0;
+
+        std::mutex              sleepMutex;
+        std::condition_variable wake;
+        bool                    stopping = false;
+
+        std::vector<std::jthread> threads;
+    };
+
+} // namespace tagliatelle
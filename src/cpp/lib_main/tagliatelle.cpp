@@ -1,5 +1,223 @@
 #include "tagliatelle.h"
 
+#include <algorithm> // std::copy_n, std::min
+#include <cstddef> // offsetof
+#include <filesystem>
+#include <ios> // std::ios_base::failure
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <regex> // std::regex_error
+#include <system_error>
+#include <shared_mutex>
+#include <span>
+#include <vector>
+
+#include "CallTree.hpp"
+#include "LiveCapture.hpp"
+#include "MemoryBudget.hpp"
+#include "NativeTrace.hpp"
+#include "ProfileMacros.hpp"
+#include "QueryEngine.hpp"
+#include "RenderQuery.hpp"
+#include "RenderQueryCache.hpp"
+#include "SelfProfile.hpp"
+#include "TextSearch.hpp"
+#include "Trace.hpp"
+#include "TraceLoader.hpp"
+
+using namespace tagliatelle;
+
+// Readers hold the mutex shared, anything that modifies the trace holds it exclusively
+struct tagliatelle_store
+{
+    explicit tagliatelle_store(std::unique_ptr<MemoryBudget> memoryBudget = nullptr)
+        : budget{ std::move(memoryBudget) }
+        , trace{ budget.get() }
+        , search{ trace, mutex }
+    {
+    }
+
+    // Destroyed after the trace allocated from it
+    std::unique_ptr<MemoryBudget> budget;
+
+    Trace                     trace;
+    mutable std::shared_mutex mutex;
+
+    std::mutex                pinnedMutex;
+    std::vector<RenderRecord> pinnedRecords;
+
+    TextSearch search;
+
+    // Started by the first aggregate query, destroyed before the trace
+    std::mutex                   engineMutex;
+    std::unique_ptr<QueryEngine> engine;
+
+    QueryEngine& Engine()
+    {
+        std::scoped_lock lock{ engineMutex };
+        if (!engine)
+            engine = std::make_unique<QueryEngine>(trace, mutex);
+        return *engine;
+    }
+
+    // Created by the first cached render query, destroyed before the trace
+    mutable std::mutex                renderCacheMutex;
+    std::unique_ptr<RenderQueryCache> renderCache;
+
+    RenderQueryCache& RenderCache()
+    {
+        std::scoped_lock lock{ renderCacheMutex };
+        if (!renderCache)
+            renderCache = std::make_unique<RenderQueryCache>(trace, mutex);
+        return *renderCache;
+    }
+};
+
+struct tagliatelle_query
+{
+    std::shared_ptr<AggregateQuery> query;
+};
+
+struct tagliatelle_search
+{
+    const tagliatelle_store* store;
+    SearchCursor             cursor;
+};
+
+struct tagliatelle_call_tree
+{
+    const tagliatelle_store* store;
+    std::uint64_t            generation = 0;
+    CallTree                 tree;
+};
+
+struct tagliatelle_live
+{
+    tagliatelle_live(Trace& trace, std::shared_mutex& mutex)
+        : capture{ trace, mutex }
+    {
+    }
+
+    LiveCapture capture;
+};
+
+struct tagliatelle_loader
+{
+    tagliatelle_loader(Trace& trace, std::shared_mutex& mutex)
+        : loader{ trace, mutex }
+    {
+    }
+
+    TraceLoader loader;
+};
+
+// Render records are handed out without conversion
+static_assert(sizeof(RenderRecord) == sizeof(tagliatelle_render_record));
+static_assert(offsetof(RenderRecord, x) == offsetof(tagliatelle_render_record, x));
+static_assert(offsetof(RenderRecord, width) == offsetof(tagliatelle_render_record, width));
+static_assert(offsetof(RenderRecord, track) == offsetof(tagliatelle_render_record, track));
+static_assert(offsetof(RenderRecord, depth) == offsetof(tagliatelle_render_record, depth));
+static_assert(offsetof(RenderRecord, colorIndex) == offsetof(tagliatelle_render_record, color_index));
+static_assert(offsetof(RenderRecord, label) == offsetof(tagliatelle_render_record, label_id));
+
+static_assert(sizeof(FlowEdge) == sizeof(tagliatelle_flow_edge));
+static_assert(offsetof(FlowEdge, from) == offsetof(tagliatelle_flow_edge, from));
+static_assert(offsetof(FlowEdge, to) == offsetof(tagliatelle_flow_edge, to));
+static_assert(offsetof(FlowEdge, departure) == offsetof(tagliatelle_flow_edge, departure));
+static_assert(offsetof(FlowEdge, arrival) == offsetof(tagliatelle_flow_edge, arrival));
+
+static_assert(sizeof(NameStats) == sizeof(tagliatelle_name_stats));
+static_assert(offsetof(NameStats, name) == offsetof(tagliatelle_name_stats, name_id));
+static_assert(offsetof(NameStats, count) == offsetof(tagliatelle_name_stats, count));
+static_assert(offsetof(NameStats, total) == offsetof(tagliatelle_name_stats, total_duration));
+static_assert(offsetof(NameStats, self) == offsetof(tagliatelle_name_stats, self_duration));
+
+static_assert(sizeof(CallTreeNode) == sizeof(tagliatelle_call_tree_node));
+static_assert(offsetof(CallTreeNode, parent) == offsetof(tagliatelle_call_tree_node, parent));
+static_assert(offsetof(CallTreeNode, descendants) == offsetof(tagliatelle_call_tree_node, descendants));
+static_assert(offsetof(CallTreeNode, count) == offsetof(tagliatelle_call_tree_node, count));
+static_assert(offsetof(CallTreeNode, inclusive) == offsetof(tagliatelle_call_tree_node, inclusive_duration));
+static_assert(offsetof(CallTreeNode, self) == offsetof(tagliatelle_call_tree_node, self_duration));
+static_assert(CallTree::NoParent == TAGLIATELLE_NO_PARENT);
+
+static_assert(sizeof(Argument) == sizeof(tagliatelle_arg));
+static_assert(offsetof(Argument, key) == offsetof(tagliatelle_arg, key_id));
+static_assert(offsetof(Argument, type) == offsetof(tagliatelle_arg, type));
+static_assert(offsetof(Argument, integer) == offsetof(tagliatelle_arg, value));
+static_assert(static_cast<int>(ArgumentType::Object) == TAGLIATELLE_ARG_OBJECT);
+static_assert(static_cast<int>(ArgumentOp::Greater) == TAGLIATELLE_ARG_GREATER);
+
+static_assert(EventStore::MaxTracks == TAGLIATELLE_MAX_TRACKS);
+
+static_assert(sizeof(LodRecord) == sizeof(tagliatelle_lod_record));
+static_assert(offsetof(LodRecord, label) == offsetof(tagliatelle_lod_record, label_id));
+static_assert(offsetof(LodRecord, count) == offsetof(tagliatelle_lod_record, count));
+
+namespace
+{
+    // Exceptions must not cross the C boundary
+    template <typename F>
+    tagliatelle_status Guarded(F&& f) noexcept
+    {
+        try
+        {
+            return f();
+        }
+        catch (const std::bad_alloc&)
+        {
+            return TAGLIATELLE_OUT_OF_MEMORY;
+        }
+        catch (...)
+        {
+            return TAGLIATELLE_ERROR;
+        }
+    }
+
+    bool IsValid(const tagliatelle_store& store, const tagliatelle_event& event)
+    {
+        return event.name_id < store.trace.Events().Names().Size()
+            && event.track < EventStore::MaxTracks
+            && event.depth <= std::numeric_limits<Depth>::max()
+            && event.duration >= 0;
+    }
+
+    Event ToEvent(const tagliatelle_event& event)
+    {
+        return Event{ event.timestamp, event.duration, event.name_id, event.track, static_cast<Depth>(event.depth) };
+    }
+
+    tagliatelle_event ToApi(const Event& event)
+    {
+        return tagliatelle_event{ event.timestamp, event.duration, event.name, event.track, event.depth };
+    }
+
+    // Keys and strings must be interned, objects must not extend past the run
+    bool IsValid(const tagliatelle_store& store, const std::span<const tagliatelle_arg> args)
+    {
+        const auto strings = store.trace.Events().Names().Size();
+        if (args.size() > ArgumentArena::PageRecords)
+            return false;
+        for (std::size_t i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            if (arg.key_id >= strings || arg.type > TAGLIATELLE_ARG_OBJECT)
+                return false;
+            if (arg.type == TAGLIATELLE_ARG_STRING && arg.value.string_id >= strings)
+                return false;
+            if (arg.type == TAGLIATELLE_ARG_OBJECT && arg.value.member_count >= args.size() - i)
+                return false;
+        }
+        return true;
+    }
+
+    Viewport ToViewport(const tagliatelle_viewport& viewport)
+    {
+        return Viewport{ viewport.start, viewport.end, viewport.width_px };
+    }
+}
+
 extern "C" {
     int tagliatelle_double_value(int value) {
         return value * 2;
@@ -8,4 +226,751 @@ extern "C" {
     const char* tagliatelle_get_version(void) {
         return "1.0.0";
     }
+
+    tagliatelle_store* tagliatelle_store_create(void) {
+        return new (std::nothrow) tagliatelle_store{};
+    }
+
+    void tagliatelle_store_destroy(tagliatelle_store* store) {
+        delete store;
+    }
+
+    tagliatelle_status tagliatelle_store_create_with_budget(uint64_t budget_bytes, const char* scratch_dir, tagliatelle_store** out_store) {
+        if (!scratch_dir || !out_store)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        if (!MemoryBudget::Supported())
+            return TAGLIATELLE_NOT_SUPPORTED;
+        return Guarded([&] {
+            std::unique_ptr<MemoryBudget> budget;
+            try
+            {
+                budget = std::make_unique<MemoryBudget>(budget_bytes, std::filesystem::path{ std::u8string_view{ reinterpret_cast<const char8_t*>(scratch_dir) } });
+            }
+            catch (const std::system_error&)
+            {
+                return TAGLIATELLE_IO_ERROR;
+            }
+            *out_store = new tagliatelle_store{ std::move(budget) };
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_store_get_memory_stats(const tagliatelle_store* store, tagliatelle_memory_stats* out_stats) {
+        if (!store || !out_stats)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        if (store->budget)
+        {
+            const auto stats = store->budget->Stats();
+            *out_stats = tagliatelle_memory_stats{ stats.budget, stats.total, stats.resident, stats.evicted };
+            return TAGLIATELLE_OK;
+        }
+        std::shared_lock lock{ store->mutex };
+        const auto bytes = store->trace.Events().MemoryBytes();
+        *out_stats = tagliatelle_memory_stats{ 0, bytes, bytes, 0 };
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_store_intern_name(tagliatelle_store* store, const char* name, size_t length, uint32_t* out_id) {
+        if (!store || (!name && length > 0) || !out_id)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::unique_lock lock{ store->mutex };
+            *out_id = store->trace.InternName(std::string_view{ name, length });
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_store_set_track_name(tagliatelle_store* store, uint32_t track, const char* name, size_t length) {
+        if (!store || (!name && length > 0) || track >= EventStore::MaxTracks)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::unique_lock lock{ store->mutex };
+            store->trace.SetTrackName(track, std::string_view{ name, length });
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_store_append(tagliatelle_store* store, const tagliatelle_event* event) {
+        if (!store || !event)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::unique_lock lock{ store->mutex };
+            if (!IsValid(*store, *event))
+                return TAGLIATELLE_INVALID_ARGUMENT;
+            store->trace.Append(ToEvent(*event));
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_store_append_bulk(tagliatelle_store* store, const tagliatelle_event* events, size_t count) {
+        PROFILE_FUNCTION();
+        if (!store || (!events && count > 0))
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::unique_lock lock{ store->mutex };
+            EventColumns batch;
+            batch.Reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (!IsValid(*store, events[i]))
+                    return TAGLIATELLE_INVALID_ARGUMENT;
+                batch.PushBack(ToEvent(events[i]));
+            }
+            store->trace.AppendBulk(batch);
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    size_t tagliatelle_store_event_count(const tagliatelle_store* store) {
+        if (!store)
+            return 0;
+        std::shared_lock lock{ store->mutex };
+        return store->trace.Events().Size();
+    }
+
+    tagliatelle_status tagliatelle_store_get_event(const tagliatelle_store* store, size_t index, tagliatelle_event* out_event) {
+        if (!store || !out_event)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        std::shared_lock lock{ store->mutex };
+        if (index >= store->trace.Events().Size())
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        *out_event = ToApi(store->trace.Events()[index]);
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_store_append_with_args(tagliatelle_store* store, const tagliatelle_event* event,
+                                                          const tagliatelle_arg* args, size_t count) {
+        if (!store || !event || (!args && count > 0))
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::unique_lock lock{ store->mutex };
+            const std::span<const tagliatelle_arg> run{ args, count };
+            if (!IsValid(*store, *event) || !IsValid(*store, run))
+                return TAGLIATELLE_INVALID_ARGUMENT;
+            auto appended = ToEvent(*event);
+            appended.argOffset = store->trace.StoreArguments(std::span{ reinterpret_cast<const Argument*>(args), count });
+            appended.argCount = static_cast<std::uint16_t>(count);
+            store->trace.Append(appended);
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_store_get_event_args(const tagliatelle_store* store, size_t index,
+                                                        const tagliatelle_arg** out_args, size_t* out_count) {
+        if (!store || !out_args || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        std::shared_lock lock{ store->mutex };
+        if (index >= store->trace.Events().Size())
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        const auto arguments = store->trace.Events().Arguments(index);
+        *out_args = reinterpret_cast<const tagliatelle_arg*>(arguments.data());
+        *out_count = arguments.size();
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_store_find_event_arg(const tagliatelle_store* store, size_t index, uint32_t key_id,
+                                                        const tagliatelle_arg** out_arg) {
+        if (!store || !out_arg)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        std::shared_lock lock{ store->mutex };
+        if (index >= store->trace.Events().Size())
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        *out_arg = reinterpret_cast<const tagliatelle_arg*>(FindArgument(store->trace.Events().Arguments(index), key_id));
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_query_arg_filter(const tagliatelle_store* store, int64_t start, int64_t end,
+                                                    const tagliatelle_arg_filter* filter, size_t* out_indices,
+                                                    size_t capacity, size_t* out_count) {
+        PROFILE_FUNCTION();
+        if (!store || !filter || filter->op > TAGLIATELLE_ARG_GREATER || (!out_indices && capacity > 0) || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+
+        ArgumentFilter predicate;
+        predicate.key = filter->value.key_id;
+        predicate.op = static_cast<ArgumentOp>(filter->op);
+        predicate.value = *reinterpret_cast<const Argument*>(&filter->value);
+
+        std::shared_lock lock{ store->mutex };
+        const auto& events = store->trace.Events();
+        size_t count = 0;
+        for (auto i = events.LowerBound(start); i < events.Size() && events.Timestamps()[i] < end; ++i)
+        {
+            if (!predicate.Matches(events.Arguments(i)))
+                continue;
+            if (count < capacity)
+                out_indices[count] = i;
+            ++count;
+        }
+        *out_count = count;
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_query_visible(const tagliatelle_store* store, const tagliatelle_viewport* viewport,
+                                                 tagliatelle_render_record* out_records, size_t capacity, size_t* out_count) {
+        PROFILE_FUNCTION();
+        if (!store || !viewport || (!out_records && capacity > 0) || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        auto* records = reinterpret_cast<RenderRecord*>(out_records);
+        std::shared_lock lock{ store->mutex };
+        store->trace.Events().Touch(viewport->start, viewport->end);
+        *out_count = FillVisible(store->trace.Events(), ToViewport(*viewport), std::span{ records, capacity });
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_query_visible_pinned(tagliatelle_store* store, const tagliatelle_viewport* viewport,
+                                                        const tagliatelle_render_record** out_records, size_t* out_count) {
+        PROFILE_FUNCTION();
+        if (!store || !viewport || !out_records || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::scoped_lock pinnedLock{ store->pinnedMutex };
+            std::shared_lock lock{ store->mutex };
+            store->trace.Events().Touch(viewport->start, viewport->end);
+            CollectVisible(store->trace.Events(), ToViewport(*viewport), store->pinnedRecords);
+            *out_records = reinterpret_cast<const tagliatelle_render_record*>(store->pinnedRecords.data());
+            *out_count = store->pinnedRecords.size();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    size_t tagliatelle_store_string_count(const tagliatelle_store* store) {
+        if (!store)
+            return 0;
+        std::shared_lock lock{ store->mutex };
+        return store->trace.Events().Names().Size();
+    }
+
+    tagliatelle_status tagliatelle_store_get_strings(const tagliatelle_store* store, uint32_t first_id, size_t count, tagliatelle_string* out_strings) {
+        if (!store || (!out_strings && count > 0))
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        std::shared_lock lock{ store->mutex };
+        const auto views = store->trace.Events().Names().Views();
+        if (first_id > views.size() || count > views.size() - first_id)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        auto* const budget = store->trace.Events().Budget();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto view = views[first_id + i];
+            if (budget)
+                budget->Touch(view.data(), view.size());
+            out_strings[i] = tagliatelle_string{ view.empty() ? "" : view.data(), view.size() };
+        }
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_query_lod(const tagliatelle_store* store, const tagliatelle_viewport* viewport,
+                                             tagliatelle_lod_record* out_records, size_t capacity, size_t* out_count) {
+        PROFILE_FUNCTION();
+        if (!store || !viewport || (!out_records && capacity > 0) || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+
+        auto* records = reinterpret_cast<LodRecord*>(out_records);
+        size_t count = 0;
+        auto collect = [&](const LodRecord& record)
+            {
+                if (count < capacity)
+                    records[count] = record;
+                ++count;
+            };
+
+        std::shared_lock lock{ store->mutex };
+        const auto& trace = store->trace;
+        if (!trace.Lod().ForEachVisible(ToViewport(*viewport), collect))
+        {
+            ForEachVisible(trace.Events(), ToViewport(*viewport), [&](const RenderRecord& r)
+                {
+                    collect(LodRecord{ r.x, r.width, r.track, r.depth, r.colorIndex, r.label, 1 });
+                });
+        }
+        *out_count = count;
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_query_lod_cached(tagliatelle_store* store, const tagliatelle_viewport* viewport,
+                                                    tagliatelle_lod_record* out_records, size_t capacity, size_t* out_count,
+                                                    int32_t* out_exact) {
+        PROFILE_FUNCTION();
+        if (!store || !viewport || (!out_records && capacity > 0) || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            auto& cache = store->RenderCache();
+            std::shared_lock lock{ store->mutex };
+            const auto result = cache.Query(ToViewport(*viewport), std::span{ reinterpret_cast<LodRecord*>(out_records), capacity });
+            *out_count = result.count;
+            if (out_exact)
+                *out_exact = result.exact ? 1 : 0;
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_store_get_render_cache_stats(const tagliatelle_store* store, tagliatelle_render_cache_stats* out_stats) {
+        if (!store || !out_stats)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        std::scoped_lock lock{ store->renderCacheMutex };
+        RenderCacheStats stats;
+        if (store->renderCache)
+            stats = store->renderCache->Stats();
+        *out_stats = tagliatelle_render_cache_stats{ stats.hits, stats.partialHits, stats.staleHits, stats.misses, stats.refinements };
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_store_counter_series(tagliatelle_store* store, const char* name, size_t length, uint32_t* out_series) {
+        if (!store || (!name && length > 0) || !out_series)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::unique_lock lock{ store->mutex };
+            *out_series = store->trace.CounterSeries(std::string_view{ name, length });
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_store_append_counter(tagliatelle_store* store, uint32_t series, int64_t timestamp, double value) {
+        if (!store)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::unique_lock lock{ store->mutex };
+            if (series >= store->trace.Counters().SeriesCount())
+                return TAGLIATELLE_INVALID_ARGUMENT;
+            store->trace.AppendCounter(series, timestamp, value);
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    size_t tagliatelle_store_counter_count(const tagliatelle_store* store) {
+        if (!store)
+            return 0;
+        std::shared_lock lock{ store->mutex };
+        return store->trace.Counters().SeriesCount();
+    }
+
+    tagliatelle_status tagliatelle_store_get_counter_name(const tagliatelle_store* store, uint32_t series, uint32_t* out_name_id) {
+        if (!store || !out_name_id)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        std::shared_lock lock{ store->mutex };
+        if (series >= store->trace.Counters().SeriesCount())
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        *out_name_id = store->trace.Counters().SeriesName(series);
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_query_counter(const tagliatelle_store* store, uint32_t series, const tagliatelle_viewport* viewport,
+                                                 float* out_points, size_t capacity, size_t* out_count) {
+        PROFILE_FUNCTION();
+        if (!store || !viewport || (!out_points && capacity > 0) || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            const auto view = ToViewport(*viewport);
+            std::vector<CounterPoint> points;
+            {
+                std::shared_lock lock{ store->mutex };
+                if (series >= store->trace.Counters().SeriesCount())
+                    return TAGLIATELLE_INVALID_ARGUMENT;
+                store->trace.Counters().Decimate(series, view, points);
+            }
+
+            const double scale = view.Valid() ? view.width / static_cast<double>(view.end - view.start) : 0.0;
+            const auto count = std::min(points.size(), capacity);
+            for (size_t i = 0; i < count; ++i)
+            {
+                out_points[2 * i] = static_cast<float>(static_cast<double>(points[i].timestamp - view.start) * scale);
+                out_points[2 * i + 1] = static_cast<float>(points[i].value);
+            }
+            *out_count = points.size();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_query_overlap(const tagliatelle_store* store, uint32_t track, int64_t first, int64_t last,
+                                                 size_t* out_indices, size_t capacity, size_t* out_count) {
+        PROFILE_FUNCTION();
+        if (!store || (!out_indices && capacity > 0) || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            size_t count = 0;
+            std::shared_lock lock{ store->mutex };
+            store->trace.Intervals().ForEachOverlap(track, first, last, [&](const IntervalIndex::EventIndex index)
+                {
+                    if (count < capacity)
+                        out_indices[count] = index;
+                    ++count;
+                });
+            *out_count = count;
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_query_stabbing(const tagliatelle_store* store, uint32_t track, int64_t time,
+                                                  size_t* out_indices, size_t capacity, size_t* out_count) {
+        return tagliatelle_query_overlap(store, track, time, time, out_indices, capacity, out_count);
+    }
+
+    tagliatelle_status tagliatelle_hit_test(const tagliatelle_store* store, uint32_t track, uint32_t depth, int64_t time,
+                                            int64_t tolerance, size_t* out_index) {
+        PROFILE_FUNCTION();
+        if (!store || !out_index || tolerance < 0)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        if (depth > std::numeric_limits<Depth>::max())
+        {
+            *out_index = TAGLIATELLE_NO_EVENT;
+            return TAGLIATELLE_OK;
+        }
+        return Guarded([&] {
+            std::shared_lock lock{ store->mutex };
+            const auto& trace = store->trace;
+            const auto hit = trace.Intervals().HitTest(trace.Events(), track, static_cast<Depth>(depth), time, tolerance);
+            *out_index = hit ? *hit : TAGLIATELLE_NO_EVENT;
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_store_append_flows(tagliatelle_store* store, const tagliatelle_flow_point* points, size_t count) {
+        if (!store || (!points && count > 0))
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::vector<FlowPoint> batch;
+            batch.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (points[i].phase > TAGLIATELLE_FLOW_END || (points[i].id & FlowStore::KeyedId) != 0)
+                    return TAGLIATELLE_INVALID_ARGUMENT;
+                batch.push_back(FlowPoint{ points[i].id, points[i].timestamp, points[i].track, static_cast<FlowPhase>(points[i].phase) });
+            }
+            std::unique_lock lock{ store->mutex };
+            store->trace.AppendFlows(batch);
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_query_flows(const tagliatelle_store* store, size_t index,
+                                               tagliatelle_flow_edge* out_incoming, tagliatelle_flow_edge* out_outgoing, size_t capacity,
+                                               size_t* out_incoming_count, size_t* out_outgoing_count) {
+        PROFILE_FUNCTION();
+        if (!store || ((!out_incoming || !out_outgoing) && capacity > 0) || !out_incoming_count || !out_outgoing_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::shared_lock lock{ store->mutex };
+            if (index >= store->trace.Events().Size())
+                return TAGLIATELLE_INVALID_ARGUMENT;
+            const auto& flows = store->trace.Flows();
+            const auto event = static_cast<FlowStore::EventIndex>(index);
+            const auto incoming = flows.Incoming(event);
+            const auto outgoing = flows.Outgoing(event);
+            std::copy_n(incoming.begin(), std::min(incoming.size(), capacity), reinterpret_cast<FlowEdge*>(out_incoming));
+            std::copy_n(outgoing.begin(), std::min(outgoing.size(), capacity), reinterpret_cast<FlowEdge*>(out_outgoing));
+            *out_incoming_count = incoming.size();
+            *out_outgoing_count = outgoing.size();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_query_self_time_async(tagliatelle_store* store, int64_t first, int64_t last,
+                                                         tagliatelle_query_callback callback, void* user_data,
+                                                         tagliatelle_query** out_query) {
+        if (!store || !out_query)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            // The handle must exist before the callback can run
+            auto handle = std::make_unique<tagliatelle_query>();
+            AggregateQuery::Callback onDone;
+            if (callback)
+                onDone = [callback, user_data, query = handle.get()] { callback(query, user_data); };
+            handle->query = store->Engine().SelfTime(first, last, std::move(onDone));
+            *out_query = handle.release();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_query_longest_spans_async(tagliatelle_store* store, int64_t first, int64_t last, size_t count,
+                                                             tagliatelle_query_callback callback, void* user_data,
+                                                             tagliatelle_query** out_query) {
+        if (!store || !out_query)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            auto handle = std::make_unique<tagliatelle_query>();
+            AggregateQuery::Callback onDone;
+            if (callback)
+                onDone = [callback, user_data, query = handle.get()] { callback(query, user_data); };
+            handle->query = store->Engine().LongestSpans(first, last, count, std::move(onDone));
+            *out_query = handle.release();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_query_critical_path_async(tagliatelle_store* store, size_t index,
+                                                            tagliatelle_query_callback callback, void* user_data,
+                                                            tagliatelle_query** out_query) {
+        if (!store || !out_query)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            {
+                std::shared_lock lock{ store->mutex };
+                if (index >= store->trace.Events().Size())
+                    return TAGLIATELLE_INVALID_ARGUMENT;
+            }
+            auto handle = std::make_unique<tagliatelle_query>();
+            AggregateQuery::Callback onDone;
+            if (callback)
+                onDone = [callback, user_data, query = handle.get()] { callback(query, user_data); };
+            handle->query = store->Engine().CriticalPath(static_cast<std::uint32_t>(index), std::move(onDone));
+            *out_query = handle.release();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_query_wait(tagliatelle_query* query) {
+        if (!query)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return query->query->Wait() ? TAGLIATELLE_OK : TAGLIATELLE_ERROR;
+    }
+
+    tagliatelle_status tagliatelle_query_get_name_stats(const tagliatelle_query* query,
+                                                        const tagliatelle_name_stats** out_stats, size_t* out_count) {
+        if (!query || !out_stats || !out_count || !query->query->Done() || query->query->Kind() != AggregateKind::SelfTime)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        if (!query->query->Error().empty())
+            return TAGLIATELLE_ERROR;
+        const auto names = query->query->Names();
+        *out_stats = reinterpret_cast<const tagliatelle_name_stats*>(names.data());
+        *out_count = names.size();
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_query_get_spans(const tagliatelle_query* query,
+                                                   const uint32_t** out_indices, size_t* out_count) {
+        if (!query || !out_indices || !out_count || !query->query->Done() || query->query->Kind() == AggregateKind::SelfTime)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        if (!query->query->Error().empty())
+            return TAGLIATELLE_ERROR;
+        const auto spans = query->query->Spans();
+        *out_indices = spans.data();
+        *out_count = spans.size();
+        return TAGLIATELLE_OK;
+    }
+
+    void tagliatelle_query_destroy(tagliatelle_query* query) {
+        if (!query)
+            return;
+        query->query->Wait();
+        delete query;
+    }
+
+    tagliatelle_status tagliatelle_call_tree_create(const tagliatelle_store* store, tagliatelle_call_tree** out_tree) {
+        PROFILE_FUNCTION();
+        if (!store || !out_tree)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            auto tree = std::make_unique<tagliatelle_call_tree>();
+            tree->store = store;
+            std::shared_lock lock{ store->mutex };
+            tree->tree.Build(store->trace.Events());
+            tree->generation = store->trace.Generation();
+            *out_tree = tree.release();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_call_tree_select(tagliatelle_call_tree* tree, int64_t first, int64_t last) {
+        PROFILE_FUNCTION();
+        if (!tree)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::shared_lock lock{ tree->store->mutex };
+            const auto& trace = tree->store->trace;
+            if (tree->generation != trace.Generation())
+            {
+                tree->tree.Build(trace.Events());
+                tree->generation = trace.Generation();
+            }
+            tree->tree.Select(trace.Events(), trace.Intervals(), first, last);
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_call_tree_get_nodes(const tagliatelle_call_tree* tree,
+                                                       const tagliatelle_call_tree_node** out_nodes, size_t* out_count) {
+        if (!tree || !out_nodes || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        const auto nodes = tree->tree.Nodes();
+        *out_nodes = reinterpret_cast<const tagliatelle_call_tree_node*>(nodes.data());
+        *out_count = nodes.size();
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_call_tree_top_self(const tagliatelle_call_tree* tree, tagliatelle_name_stats* out_stats,
+                                                      size_t capacity, size_t* out_count) {
+        if (!tree || (!out_stats && capacity > 0) || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            const auto names = tree->tree.SelfTimeByName();
+            const auto copied = std::min(capacity, names.size());
+            std::copy_n(names.begin(), copied, reinterpret_cast<NameStats*>(out_stats));
+            *out_count = names.size();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    void tagliatelle_call_tree_destroy(tagliatelle_call_tree* tree) {
+        delete tree;
+    }
+
+    tagliatelle_status tagliatelle_search_prepare(tagliatelle_store* store) {
+        PROFILE_FUNCTION();
+        if (!store)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            store->search.Prepare();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_search_start(tagliatelle_store* store, const char* pattern, size_t length, uint32_t flags,
+                                                tagliatelle_search** out_search) {
+        PROFILE_FUNCTION();
+        if (!store || (!pattern && length > 0) || !out_search)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        const auto mode = flags & TAGLIATELLE_SEARCH_REGEX ? SearchMode::Regex : SearchMode::Substring;
+        const auto ignoreCase = (flags & TAGLIATELLE_SEARCH_IGNORE_CASE) != 0;
+        return Guarded([&] {
+            store->search.Prepare();
+            std::vector<std::uint8_t> matched;
+            try
+            {
+                matched = store->search.MatchNames(std::string_view{ pattern, length }, mode, ignoreCase);
+            }
+            catch (const std::regex_error&)
+            {
+                return TAGLIATELLE_INVALID_ARGUMENT;
+            }
+            *out_search = new tagliatelle_search{ store, SearchCursor{ std::move(matched) } };
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_search_next(tagliatelle_search* search, size_t* out_indices, size_t capacity, size_t* out_count) {
+        PROFILE_FUNCTION();
+        if (!search || (!out_indices && capacity > 0) || !out_count)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        std::shared_lock lock{ search->store->mutex };
+        *out_count = search->cursor.Next(search->store->trace.Events(), std::span{ out_indices, capacity });
+        return TAGLIATELLE_OK;
+    }
+
+    void tagliatelle_search_destroy(tagliatelle_search* search) {
+        delete search;
+    }
+
+    tagliatelle_status tagliatelle_store_save(const tagliatelle_store* store, const char* path) {
+        PROFILE_FUNCTION();
+        if (!store || !path)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            std::shared_lock lock{ store->mutex };
+            try
+            {
+                SaveNativeTrace(store->trace.Events(), std::filesystem::path{ std::u8string_view{ reinterpret_cast<const char8_t*>(path) } });
+            }
+            catch (const std::ios_base::failure&)
+            {
+                return TAGLIATELLE_IO_ERROR;
+            }
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_load_start(tagliatelle_store* store, const char* path, tagliatelle_loader** out_loader) {
+        PROFILE_FUNCTION();
+        if (!store || !path || !out_loader)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        return Guarded([&] {
+            auto loader = std::make_unique<tagliatelle_loader>(store->trace, store->mutex);
+            loader->loader.Start(std::filesystem::path{ std::u8string_view{ reinterpret_cast<const char8_t*>(path) } });
+            *out_loader = loader.release();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_load_get_progress(const tagliatelle_loader* loader, tagliatelle_load_progress* out_progress) {
+        if (!loader || !out_progress)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        const auto progress = loader->loader.Progress();
+        *out_progress = tagliatelle_load_progress{
+            progress.bytesTotal,
+            progress.bytesParsed,
+            progress.eventsLoaded,
+            progress.malformedRecords,
+            progress.done ? 1 : 0,
+            progress.failed ? TAGLIATELLE_IO_ERROR : TAGLIATELLE_OK,
+        };
+        return TAGLIATELLE_OK;
+    }
+
+    tagliatelle_status tagliatelle_load_wait(tagliatelle_loader* loader) {
+        if (!loader)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        loader->loader.Wait();
+        return loader->loader.Progress().failed ? TAGLIATELLE_IO_ERROR : TAGLIATELLE_OK;
+    }
+
+    void tagliatelle_load_destroy(tagliatelle_loader* loader) {
+        delete loader;
+    }
+
+    tagliatelle_status tagliatelle_live_start(tagliatelle_store* store, const char* socket_path, tagliatelle_live** out_live) {
+        if (!store || !socket_path || !out_live)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        if (!LiveCapture::Supported())
+            return TAGLIATELLE_NOT_SUPPORTED;
+        return Guarded([&] {
+            auto live = std::make_unique<tagliatelle_live>(store->trace, store->mutex);
+            try
+            {
+                live->capture.Start(std::filesystem::path{ std::u8string_view{ reinterpret_cast<const char8_t*>(socket_path) } });
+            }
+            catch (const std::system_error&)
+            {
+                return TAGLIATELLE_IO_ERROR;
+            }
+            *out_live = live.release();
+            return TAGLIATELLE_OK;
+        });
+    }
+
+    tagliatelle_status tagliatelle_live_get_stats(const tagliatelle_live* live, tagliatelle_live_stats* out_stats) {
+        if (!live || !out_stats)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+        const auto stats = live->capture.Stats();
+        *out_stats = tagliatelle_live_stats{
+            stats.connections,
+            stats.eventsReceived,
+            stats.eventsCommitted,
+            stats.eventsDropped,
+            stats.malformedMessages,
+        };
+        return TAGLIATELLE_OK;
+    }
+
+    void tagliatelle_live_stop(tagliatelle_live* live) {
+        delete live;
+    }
+
+    tagliatelle_status tagliatelle_profile_save(const char* path) {
+        if (!path)
+            return TAGLIATELLE_INVALID_ARGUMENT;
+#ifdef ENABLE_PROFILE_MACROS
+        return Guarded([&] {
+            try
+            {
+                SaveSelfProfile(std::filesystem::path{ std::u8string_view{ reinterpret_cast<const char8_t*>(path) } });
+            }
+            catch (const std::ios_base::failure&)
+            {
+                return TAGLIATELLE_IO_ERROR;
+            }
+            return TAGLIATELLE_OK;
+        });
+#else
+        return TAGLIATELLE_NOT_SUPPORTED;
+#endif
+    }
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef _WIN32
     #ifdef TAGLIATELLE_EXPORTS
         #define TAGLIATELLE_API __declspec(dllexport)
@@ -14,6 +17,128 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Result of fallible API calls
+ */
+typedef enum tagliatelle_status {
+    TAGLIATELLE_OK = 0,
+    TAGLIATELLE_INVALID_ARGUMENT = 1,
+    TAGLIATELLE_OUT_OF_MEMORY = 2,
+    TAGLIATELLE_ERROR = 3,
+    TAGLIATELLE_IO_ERROR = 4,
+    TAGLIATELLE_NOT_SUPPORTED = 5
+} tagliatelle_status;
+
+/**
+ * @brief Opaque handle to an in-memory trace
+ */
+typedef struct tagliatelle_store tagliatelle_store;
+
+/**
+ * @brief Opaque handle to a background file load
+ */
+typedef struct tagliatelle_loader tagliatelle_loader;
+
+/**
+ * @brief Opaque handle to a live capture session
+ */
+typedef struct tagliatelle_live tagliatelle_live;
+
+/**
+ * @brief Track IDs must be below this
+ */
+#define TAGLIATELLE_MAX_TRACKS ((uint32_t)1 << 20)
+
+/**
+ * @brief A single span, times are in nanoseconds, tracks are dense indices below TAGLIATELLE_MAX_TRACKS
+ */
+typedef struct tagliatelle_event {
+    int64_t  timestamp;
+    int64_t  duration;
+    uint32_t name_id;
+    uint32_t track;
+    uint32_t depth;
+} tagliatelle_event;
+
+/**
+ * @brief Time window mapped onto a pixel range
+ */
+typedef struct tagliatelle_viewport {
+    int64_t start;
+    int64_t end;
+    float   width_px;
+} tagliatelle_viewport;
+
+/**
+ * @brief Packed render-ready span, positions are in pixels clipped to the viewport
+ */
+typedef struct tagliatelle_render_record {
+    float    x;
+    float    width;
+    uint32_t track;
+    uint32_t depth;
+    uint32_t color_index;
+    uint32_t label_id;
+} tagliatelle_render_record;
+
+/**
+ * @brief Render record standing for one or more spans of a track row
+ *
+ * When zoomed out, spans narrower than a pixel are merged, label_id is the
+ * longest of the merged spans and count is the number of merged spans.
+ */
+typedef struct tagliatelle_lod_record {
+    float    x;
+    float    width;
+    uint32_t track;
+    uint32_t depth;
+    uint32_t color_index;
+    uint32_t label_id;
+    uint32_t count;
+} tagliatelle_lod_record;
+
+/**
+ * @brief View of an interned string, not null-terminated
+ */
+typedef struct tagliatelle_string {
+    const char* data;
+    size_t      length;
+} tagliatelle_string;
+
+/**
+ * @brief Snapshot of the progress of a background load
+ */
+typedef struct tagliatelle_load_progress {
+    uint64_t           bytes_total;
+    uint64_t           bytes_parsed;
+    uint64_t           events_loaded;
+    uint64_t           malformed_records;
+    int32_t            done;
+    tagliatelle_status status;
+} tagliatelle_load_progress;
+
+/**
+ * @brief Counters of a live capture session
+ */
+typedef struct tagliatelle_live_stats {
+    uint64_t connections;
+    uint64_t events_received;
+    uint64_t events_committed;
+    uint64_t events_dropped;
+    uint64_t malformed_messages;
+} tagliatelle_live_stats;
+
+/**
+ * @brief Memory held by the event columns, the string table and the arguments of a store,
+ *        and with a budget by the derived indices
+ */
+typedef struct tagliatelle_memory_stats {
+    uint64_t budget_bytes;   /* 0 if the store has no budget */
+    uint64_t total_bytes;
+    uint64_t resident_bytes; /* part of total_bytes in RAM, the rest is in the scratch file */
+    uint64_t evicted_bytes;  /* written to the scratch file so far */
+} tagliatelle_memory_stats;
+
 /**
  * @brief A simple example function for the dynamic library
  * @param value An integer value
@@ -27,6 +152,782 @@ TAGLIATELLE_API int tagliatelle_double_value(int value);
  */
 TAGLIATELLE_API const char* tagliatelle_get_version(void);
 
+/**
+ * @brief Create an empty event store
+ * @return Store handle, NULL if out of memory
+ */
+TAGLIATELLE_API tagliatelle_store* tagliatelle_store_create(void);
+
+/**
+ * @brief Destroy a store and everything it owns
+ * @param store Store handle, may be NULL
+ */
+TAGLIATELLE_API void tagliatelle_store_destroy(tagliatelle_store* store);
+
+/**
+ * @brief Create an empty event store that keeps its memory use within a budget
+ *
+ * The event columns, string and argument pages live in a scratch file mapped
+ * into memory. Parts that were not viewed recently are written out and dropped
+ * from RAM when the budget is exceeded, and are read back when a viewport
+ * reaches them. Small allocations and derived indices stay on the heap and
+ * count towards the budget.
+ * @param budget_bytes Resident size to stay within
+ * @param scratch_dir UTF-8 directory of the scratch file, which is deleted with the store
+ * @param out_store Receives the store handle
+ * @return Status code, TAGLIATELLE_IO_ERROR if the scratch file cannot be created,
+ *         TAGLIATELLE_NOT_SUPPORTED on platforms without file mappings
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_create_with_budget(uint64_t budget_bytes, const char* scratch_dir,
+                                                                        tagliatelle_store** out_store);
+
+/**
+ * @brief Report the resident and total bytes of a store
+ *
+ * Without a budget everything is resident.
+ * @param store Store handle
+ * @param out_stats Receives the statistics
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_get_memory_stats(const tagliatelle_store* store, tagliatelle_memory_stats* out_stats);
+
+/**
+ * @brief Intern an event name
+ * @param store Store handle
+ * @param name Name bytes, need not be null-terminated
+ * @param length Length of the name in bytes
+ * @param out_id Receives the name ID, equal names get equal IDs
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_intern_name(tagliatelle_store* store, const char* name, size_t length, uint32_t* out_id);
+
+/**
+ * @brief Set the display name of a track
+ * @param store Store handle
+ * @param track Track ID, below TAGLIATELLE_MAX_TRACKS
+ * @param name Name bytes, need not be null-terminated
+ * @param length Length of the name in bytes
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_set_track_name(tagliatelle_store* store, uint32_t track, const char* name, size_t length);
+
+/**
+ * @brief Append a single event
+ * @param store Store handle
+ * @param event Event whose name_id was returned by tagliatelle_store_intern_name
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_append(tagliatelle_store* store, const tagliatelle_event* event);
+
+/**
+ * @brief Append a batch of events in any order
+ * @param store Store handle
+ * @param events Array of events
+ * @param count Number of events in the array
+ * @return Status code, nothing is appended on failure
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_append_bulk(tagliatelle_store* store, const tagliatelle_event* events, size_t count);
+
+/**
+ * @brief Number of events in the store
+ * @param store Store handle
+ * @return Event count
+ */
+TAGLIATELLE_API size_t tagliatelle_store_event_count(const tagliatelle_store* store);
+
+/**
+ * @brief Read an event, events are ordered by timestamp
+ * @param store Store handle
+ * @param index Event index, less than the event count
+ * @param out_event Receives the event
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_get_event(const tagliatelle_store* store, size_t index, tagliatelle_event* out_event);
+
+/**
+ * @brief Type of an event argument value
+ */
+typedef enum tagliatelle_arg_type {
+    TAGLIATELLE_ARG_NULL = 0,
+    TAGLIATELLE_ARG_BOOL = 1,
+    TAGLIATELLE_ARG_INT = 2,
+    TAGLIATELLE_ARG_DOUBLE = 3,
+    TAGLIATELLE_ARG_STRING = 4,
+    TAGLIATELLE_ARG_OBJECT = 5
+} tagliatelle_arg_type;
+
+/**
+ * @brief One key/value argument of an event, keys and string values are string IDs
+ *
+ * Nested objects are flattened: an object is followed by the member_count
+ * arguments of its members, including nested ones. Arrays are objects keyed "0", "1", ...
+ */
+typedef struct tagliatelle_arg {
+    uint32_t key_id;
+    uint8_t  type;        /* tagliatelle_arg_type */
+    uint8_t  reserved[3];
+    union {
+        uint8_t  bool_value;
+        int64_t  int_value;
+        double   double_value;
+        uint32_t string_id;
+        uint32_t member_count;
+    } value;
+} tagliatelle_arg;
+
+/**
+ * @brief Comparison applied by tagliatelle_query_arg_filter
+ */
+typedef enum tagliatelle_arg_op {
+    TAGLIATELLE_ARG_EXISTS = 0,
+    TAGLIATELLE_ARG_EQUAL = 1,
+    TAGLIATELLE_ARG_NOT_EQUAL = 2, /* also matches events without the key */
+    TAGLIATELLE_ARG_LESS = 3,      /* numbers only */
+    TAGLIATELLE_ARG_GREATER = 4    /* numbers only */
+} tagliatelle_arg_op;
+
+/**
+ * @brief Predicate on the top-level argument with key value.key_id
+ */
+typedef struct tagliatelle_arg_filter {
+    uint32_t        op; /* tagliatelle_arg_op */
+    tagliatelle_arg value;
+} tagliatelle_arg_filter;
+
+/**
+ * @brief Append a single event with its arguments
+ * @param store Store handle
+ * @param event Event whose name_id was returned by tagliatelle_store_intern_name
+ * @param args Arguments whose keys and string values were returned by tagliatelle_store_intern_name
+ * @param count Number of arguments, at most 4096
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_append_with_args(tagliatelle_store* store, const tagliatelle_event* event,
+                                                                      const tagliatelle_arg* args, size_t count);
+
+/**
+ * @brief Read the arguments of an event without copying
+ * @param store Store handle
+ * @param index Event index, less than the event count
+ * @param out_args Receives a pointer to the arguments, valid until the store is cleared or destroyed
+ * @param out_count Receives the number of arguments, including members of nested objects
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_get_event_args(const tagliatelle_store* store, size_t index,
+                                                                    const tagliatelle_arg** out_args, size_t* out_count);
+
+/**
+ * @brief Find a top-level argument of an event by key without copying
+ * @param store Store handle
+ * @param index Event index, less than the event count
+ * @param key_id String ID of the key
+ * @param out_arg Receives a pointer to the argument, or NULL if the event has no such argument
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_find_event_arg(const tagliatelle_store* store, size_t index, uint32_t key_id,
+                                                                    const tagliatelle_arg** out_arg);
+
+/**
+ * @brief Fill a caller-provided buffer with the indices of the events starting in [start, end) whose arguments match a filter
+ * @param store Store handle
+ * @param start Start of the time window, inclusive
+ * @param end End of the time window, exclusive
+ * @param filter Predicate on one argument
+ * @param out_indices Buffer receiving at most capacity event indices in store order, may be NULL if capacity is 0
+ * @param capacity Capacity of the buffer
+ * @param out_count Receives the total number of matching events, which may exceed capacity
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_arg_filter(const tagliatelle_store* store, int64_t start, int64_t end,
+                                                                const tagliatelle_arg_filter* filter, size_t* out_indices,
+                                                                size_t capacity, size_t* out_count);
+
+/**
+ * @brief Fill a caller-provided buffer with the spans visible in a viewport
+ * @param store Store handle
+ * @param viewport Visible time window and its width in pixels
+ * @param out_records Buffer receiving at most capacity records, may be NULL if capacity is 0
+ * @param capacity Capacity of the buffer in records
+ * @param out_count Receives the total number of visible spans, which may exceed capacity
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_visible(const tagliatelle_store* store, const tagliatelle_viewport* viewport,
+                                                             tagliatelle_render_record* out_records, size_t capacity, size_t* out_count);
+
+/**
+ * @brief Collect the spans visible in a viewport into a library-owned buffer
+ * @param store Store handle
+ * @param viewport Visible time window and its width in pixels
+ * @param out_records Receives a pointer to the records, valid until the next call on this store or its destruction
+ * @param out_count Receives the number of records
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_visible_pinned(tagliatelle_store* store, const tagliatelle_viewport* viewport,
+                                                                    const tagliatelle_render_record** out_records, size_t* out_count);
+
+/**
+ * @brief Fill a caller-provided buffer with level-of-detail records for a viewport
+ *
+ * Costs O(pixels) per track row regardless of the number of events, sub-pixel
+ * spans are merged using a pyramid that is updated as events are appended.
+ * @param store Store handle
+ * @param viewport Visible time window and its width in pixels
+ * @param out_records Buffer receiving at most capacity records, may be NULL if capacity is 0
+ * @param capacity Capacity of the buffer in records
+ * @param out_count Receives the total number of records, which may exceed capacity
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_lod(const tagliatelle_store* store, const tagliatelle_viewport* viewport,
+                                                         tagliatelle_lod_record* out_records, size_t capacity, size_t* out_count);
+
+/**
+ * @brief Counters of the render query cache of a store
+ */
+typedef struct tagliatelle_render_cache_stats {
+    uint64_t hits;         /* same window as the previous query */
+    uint64_t partial_hits; /* overlapping window at the same detail level, only newly exposed slices were queried */
+    uint64_t stale_hits;   /* zoomed in, the previous coarser records were returned */
+    uint64_t misses;       /* queried in full */
+    uint64_t refinements;  /* finer records computed in the background after a stale hit */
+} tagliatelle_render_cache_stats;
+
+/**
+ * @brief Fill a caller-provided buffer with level-of-detail records for a viewport, reusing the previous query
+ *
+ * Returns the same records as tagliatelle_query_lod, in no particular order.
+ * The records of the previous viewport are kept: panning only queries the
+ * newly exposed slices, zooming in returns the previous coarser records until
+ * the finer ones have been computed in the background. Meant for a single
+ * viewer calling once per frame.
+ * @param store Store handle
+ * @param viewport Visible time window and its width in pixels
+ * @param out_records Buffer receiving at most capacity records, may be NULL if capacity is 0
+ * @param capacity Capacity of the buffer in records
+ * @param out_count Receives the total number of records, which may exceed capacity
+ * @param out_exact Receives 0 if coarser records were returned and the query should be repeated on a later frame, may be NULL
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_lod_cached(tagliatelle_store* store, const tagliatelle_viewport* viewport,
+                                                                tagliatelle_lod_record* out_records, size_t capacity, size_t* out_count,
+                                                                int32_t* out_exact);
+
+/**
+ * @brief Read the counters of the render query cache
+ * @param store Store handle
+ * @param out_stats Receives the counters, all 0 before the first cached query
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_get_render_cache_stats(const tagliatelle_store* store, tagliatelle_render_cache_stats* out_stats);
+
+/**
+ * @brief Get the series of a named counter, creating it on first use
+ * @param store Store handle
+ * @param name Name bytes, need not be null-terminated
+ * @param length Length of the name in bytes
+ * @param out_series Receives the series ID, series are numbered densely from 0
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_counter_series(tagliatelle_store* store, const char* name, size_t length,
+                                                                    uint32_t* out_series);
+
+/**
+ * @brief Append a sample to a counter series, in timestamp order for constant cost
+ * @param store Store handle
+ * @param series Series ID returned by tagliatelle_store_counter_series
+ * @param timestamp Time of the sample in nanoseconds
+ * @param value Value of the counter from this time on
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_append_counter(tagliatelle_store* store, uint32_t series, int64_t timestamp, double value);
+
+/**
+ * @brief Number of counter series in the store, including those of imported traces
+ * @param store Store handle
+ * @return Series count
+ */
+TAGLIATELLE_API size_t tagliatelle_store_counter_count(const tagliatelle_store* store);
+
+/**
+ * @brief Get the name of a counter series
+ * @param store Store handle
+ * @param series Series ID, less than the series count
+ * @param out_name_id Receives the string ID of the name
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_get_counter_name(const tagliatelle_store* store, uint32_t series, uint32_t* out_name_id);
+
+/**
+ * @brief Fill a caller-provided buffer with the points of a counter's line in a viewport
+ *
+ * Keeps the first, minimum, maximum and last sample of every pixel, which
+ * draws the same line as all samples in at most 4 points per pixel.
+ * The samples just outside the viewport are included so that the line reaches its edges.
+ * @param store Store handle
+ * @param series Series ID
+ * @param viewport Visible time window and its width in pixels
+ * @param out_points Buffer receiving at most capacity points as interleaved x, value pairs of floats,
+ *                   x in pixels from the start of the viewport, may be NULL if capacity is 0
+ * @param capacity Capacity of the buffer in points
+ * @param out_count Receives the total number of points, which may exceed capacity
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_counter(const tagliatelle_store* store, uint32_t series, const tagliatelle_viewport* viewport,
+                                                             float* out_points, size_t capacity, size_t* out_count);
+
+/**
+ * @brief Index returned by tagliatelle_hit_test when no span is hit
+ */
+#define TAGLIATELLE_NO_EVENT ((size_t)-1)
+
+/**
+ * @brief Fill a caller-provided buffer with the indices of the spans of a track overlapping [first, last]
+ *
+ * Answered in O(log n + k) by a per-track interval index, which is updated
+ * on the first query after the store was modified, from the first event that moved.
+ * @param store Store handle
+ * @param track Track to search
+ * @param first Start of the time window, inclusive
+ * @param last End of the time window, inclusive
+ * @param out_indices Buffer receiving at most capacity event indices ordered by start, may be NULL if capacity is 0
+ * @param capacity Capacity of the buffer
+ * @param out_count Receives the total number of overlapping spans, which may exceed capacity
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_overlap(const tagliatelle_store* store, uint32_t track, int64_t first, int64_t last,
+                                                             size_t* out_indices, size_t capacity, size_t* out_count);
+
+/**
+ * @brief Fill a caller-provided buffer with the indices of the spans of a track that contain a time
+ * @param store Store handle
+ * @param track Track to search
+ * @param time Time in nanoseconds
+ * @param out_indices Buffer receiving at most capacity event indices ordered by start, may be NULL if capacity is 0
+ * @param capacity Capacity of the buffer
+ * @param out_count Receives the total number of spans containing the time, which may exceed capacity
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_stabbing(const tagliatelle_store* store, uint32_t track, int64_t time,
+                                                              size_t* out_indices, size_t capacity, size_t* out_count);
+
+/**
+ * @brief Find the span under the cursor
+ * @param store Store handle
+ * @param track Track of the row under the cursor
+ * @param depth Depth of the row under the cursor
+ * @param time Time under the cursor
+ * @param tolerance Spans at most this far from the time are hit if none contains it, usually a pixel or two
+ * @param out_index Receives the event index, or TAGLIATELLE_NO_EVENT
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_hit_test(const tagliatelle_store* store, uint32_t track, uint32_t depth, int64_t time,
+                                                        int64_t tolerance, size_t* out_index);
+
+/**
+ * @brief Position of a point within its flow
+ */
+typedef enum tagliatelle_flow_phase {
+    TAGLIATELLE_FLOW_START = 0,
+    TAGLIATELLE_FLOW_STEP = 1,
+    TAGLIATELLE_FLOW_END = 2
+} tagliatelle_flow_phase;
+
+/**
+ * @brief Point of a flow between spans, bound to the deepest span of its track containing its time
+ */
+typedef struct tagliatelle_flow_point {
+    uint64_t id;        /* points with equal IDs are chained in time order, below 2^63 */
+    int64_t  timestamp;
+    uint32_t track;
+    uint32_t phase;     /* tagliatelle_flow_phase */
+} tagliatelle_flow_point;
+
+/**
+ * @brief Flow edge from the span a flow leaves to the span it enters
+ */
+typedef struct tagliatelle_flow_edge {
+    uint32_t from;      /* event index */
+    uint32_t to;        /* event index */
+    int64_t  departure;
+    int64_t  arrival;
+} tagliatelle_flow_edge;
+
+/**
+ * @brief Append flow points, they are bound to spans when flows are next queried
+ * @param store Store handle
+ * @param points Array of points
+ * @param count Number of points in the array
+ * @return Status code, nothing is appended on failure. IDs of 2^63 and above are
+ *         reserved for flows imported from files and are invalid arguments.
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_append_flows(tagliatelle_store* store, const tagliatelle_flow_point* points, size_t count);
+
+/**
+ * @brief Fill caller-provided buffers with the flow edges entering and leaving a span
+ *
+ * The first query after a modification binds the flow points to spans.
+ * @param store Store handle
+ * @param index Event index
+ * @param out_incoming Buffer receiving at most capacity incoming edges ordered by arrival, may be NULL if capacity is 0
+ * @param out_outgoing Buffer receiving at most capacity outgoing edges ordered by departure, may be NULL if capacity is 0
+ * @param capacity Capacity of each buffer in edges
+ * @param out_incoming_count Receives the total number of incoming edges, which may exceed capacity
+ * @param out_outgoing_count Receives the total number of outgoing edges, which may exceed capacity
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_flows(const tagliatelle_store* store, size_t index,
+                                                           tagliatelle_flow_edge* out_incoming, tagliatelle_flow_edge* out_outgoing, size_t capacity,
+                                                           size_t* out_incoming_count, size_t* out_outgoing_count);
+
+/**
+ * @brief Opaque handle to an aggregate query running in the background
+ */
+typedef struct tagliatelle_query tagliatelle_query;
+
+/**
+ * @brief Called once when a query has completed or failed
+ *
+ * Runs on a background thread. The results of the query may already be read,
+ * but the query must not be destroyed from within the callback.
+ */
+typedef void (*tagliatelle_query_callback)(tagliatelle_query* query, void* user_data);
+
+/**
+ * @brief Total and self time of all spans with one name
+ */
+typedef struct tagliatelle_name_stats {
+    uint32_t name_id;
+    uint32_t reserved;
+    uint64_t count;
+    int64_t  total_duration;
+    int64_t  self_duration; /* total minus the time spent in direct children */
+} tagliatelle_name_stats;
+
+/**
+ * @brief Start computing the total and self time per name of the spans starting in [first, last]
+ *
+ * The spans are split into shards per track and time block which run on a
+ * work-stealing thread pool, queries run one after another.
+ * @param store Store handle
+ * @param first Start of the time window, inclusive
+ * @param last End of the time window, inclusive
+ * @param callback Called on completion, may be NULL
+ * @param user_data Passed to the callback
+ * @param out_query Receives the query handle, destroy with tagliatelle_query_destroy
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_self_time_async(tagliatelle_store* store, int64_t first, int64_t last,
+                                                                     tagliatelle_query_callback callback, void* user_data,
+                                                                     tagliatelle_query** out_query);
+
+/**
+ * @brief Start finding the longest spans starting in [first, last]
+ * @param store Store handle
+ * @param first Start of the time window, inclusive
+ * @param last End of the time window, inclusive
+ * @param count Maximum number of spans to return
+ * @param callback Called on completion, may be NULL
+ * @param user_data Passed to the callback
+ * @param out_query Receives the query handle, destroy with tagliatelle_query_destroy
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_longest_spans_async(tagliatelle_store* store, int64_t first, int64_t last, size_t count,
+                                                                         tagliatelle_query_callback callback, void* user_data,
+                                                                         tagliatelle_query** out_query);
+
+/**
+ * @brief Start finding the critical path of the request a span belongs to
+ *
+ * The request is every span reachable from the span through outgoing flows,
+ * including flows of the spans nested in it. From the span of the request
+ * that ends last, the path follows the latest flow that arrived before each
+ * span moved on, or the enclosing span where no flow did.
+ * Read the result with tagliatelle_query_get_spans.
+ * @param store Store handle
+ * @param index Event index of a span of the request
+ * @param callback Called on completion, may be NULL
+ * @param user_data Passed to the callback
+ * @param out_query Receives the query handle, destroy with tagliatelle_query_destroy
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_critical_path_async(tagliatelle_store* store, size_t index,
+                                                                        tagliatelle_query_callback callback, void* user_data,
+                                                                        tagliatelle_query** out_query);
+
+/**
+ * @brief Block until a query has completed
+ * @param query Query handle
+ * @return TAGLIATELLE_OK, or TAGLIATELLE_ERROR if the query failed or was cancelled
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_wait(tagliatelle_query* query);
+
+/**
+ * @brief Read the result of a self time query, ordered by self time, longest first
+ *
+ * The stats stay valid until the query is destroyed.
+ * @param query Query handle
+ * @param out_stats Receives a pointer to the stats
+ * @param out_count Receives the number of names
+ * @return Status code, TAGLIATELLE_INVALID_ARGUMENT if the query has not completed or is of another kind
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_get_name_stats(const tagliatelle_query* query,
+                                                                    const tagliatelle_name_stats** out_stats, size_t* out_count);
+
+/**
+ * @brief Read the result of a longest spans query as event indices, longest first,
+ *        or of a critical path query, oldest first
+ *
+ * The indices stay valid until the query is destroyed.
+ * @param query Query handle
+ * @param out_indices Receives a pointer to the event indices
+ * @param out_count Receives the number of spans
+ * @return Status code, TAGLIATELLE_INVALID_ARGUMENT if the query has not completed or is of another kind
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_query_get_spans(const tagliatelle_query* query,
+                                                               const uint32_t** out_indices, size_t* out_count);
+
+/**
+ * @brief Wait for a query to complete and release it
+ * @param query Query handle
+ */
+TAGLIATELLE_API void tagliatelle_query_destroy(tagliatelle_query* query);
+
+/**
+ * @brief Opaque handle to a running text search
+ */
+typedef struct tagliatelle_search tagliatelle_search;
+
+/**
+ * @brief Options of tagliatelle_search_start, combined with bitwise or
+ */
+typedef enum tagliatelle_search_flags {
+    TAGLIATELLE_SEARCH_SUBSTRING = 0,
+    TAGLIATELLE_SEARCH_REGEX = 1,      /* ECMAScript syntax */
+    TAGLIATELLE_SEARCH_IGNORE_CASE = 2
+} tagliatelle_search_flags;
+
+/**
+ * @brief Start indexing the string table for search on a background thread
+ *
+ * Call once the first frame is on screen. Searches never wait for the index,
+ * they scan the strings it does not cover yet. Calling it again after more
+ * events were loaded indexes the new strings.
+ * @param store Store handle
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_search_prepare(tagliatelle_store* store);
+
+/**
+ * @brief Find the events whose name contains a substring or matches a regex
+ *
+ * The names are matched up front through a trigram index, matching events
+ * are then read in batches with tagliatelle_search_next. Events also match
+ * through the keys and string values of their arguments.
+ * @param store Store handle
+ * @param pattern UTF-8 pattern, not null-terminated
+ * @param length Length of the pattern in bytes
+ * @param flags Combination of tagliatelle_search_flags
+ * @param out_search Receives the search handle, destroy with tagliatelle_search_destroy before the store
+ * @return Status code, TAGLIATELLE_INVALID_ARGUMENT for an invalid regex
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_search_start(tagliatelle_store* store, const char* pattern, size_t length, uint32_t flags,
+                                                            tagliatelle_search** out_search);
+
+/**
+ * @brief Fill a caller-provided buffer with the indices of the next matching events, in store order
+ * @param search Search handle
+ * @param out_indices Buffer receiving at most capacity event indices
+ * @param capacity Capacity of the buffer
+ * @param out_count Receives the number of indices written, 0 once the search is complete
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_search_next(tagliatelle_search* search, size_t* out_indices, size_t capacity,
+                                                           size_t* out_count);
+
+/**
+ * @brief Release a search
+ * @param search Search handle
+ */
+TAGLIATELLE_API void tagliatelle_search_destroy(tagliatelle_search* search);
+
+/**
+ * @brief Opaque handle to the merged call tree of a store
+ */
+typedef struct tagliatelle_call_tree tagliatelle_call_tree;
+
+/**
+ * @brief Parent of the top-level nodes of a call tree
+ */
+#define TAGLIATELLE_NO_PARENT ((uint32_t)-1)
+
+/**
+ * @brief A call stack of the merged tree with the weights of the selected spans
+ */
+typedef struct tagliatelle_call_tree_node {
+    uint32_t name_id;
+    uint32_t parent;      /* index of the parent node or TAGLIATELLE_NO_PARENT */
+    uint32_t depth;
+    uint32_t descendants; /* the subtree is made of the next descendants nodes */
+    uint64_t count;
+    int64_t  inclusive_duration;
+    int64_t  self_duration;
+} tagliatelle_call_tree_node;
+
+/**
+ * @brief Build the merged call tree of the nested spans of all tracks, the data behind a flame graph
+ *
+ * The tree must be destroyed before the store and must not be used from several threads at once.
+ * @param store Store handle
+ * @param out_tree Receives the call tree handle
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_call_tree_create(const tagliatelle_store* store, tagliatelle_call_tree** out_tree);
+
+/**
+ * @brief Select the spans overlapping [first, last], an empty window when first > last
+ *
+ * Moving the selection only visits the spans that enter or leave it, so it
+ * is cheap to call on every step of a drag. The tree is rebuilt first if the
+ * store was modified since it was built.
+ * @param tree Call tree handle
+ * @param first Start of the time window, inclusive
+ * @param last End of the time window, inclusive
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_call_tree_select(tagliatelle_call_tree* tree, int64_t first, int64_t last);
+
+/**
+ * @brief Read the nodes of the call tree in preorder without copying
+ *
+ * Nodes without selected spans have a count of 0. The layout only changes
+ * when the tree is rebuilt, the pointer stays valid until the next call on the tree.
+ * @param tree Call tree handle
+ * @param out_nodes Receives a pointer to the nodes
+ * @param out_count Receives the number of nodes
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_call_tree_get_nodes(const tagliatelle_call_tree* tree,
+                                                                   const tagliatelle_call_tree_node** out_nodes, size_t* out_count);
+
+/**
+ * @brief Fill a caller-provided buffer with the selected time per name, ordered by self time
+ *
+ * Frames of a name nested in frames of the same name count once towards its total.
+ * @param tree Call tree handle
+ * @param out_stats Buffer receiving at most capacity entries, may be NULL if capacity is 0
+ * @param capacity Capacity of the buffer
+ * @param out_count Receives the total number of names, which may exceed capacity
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_call_tree_top_self(const tagliatelle_call_tree* tree, tagliatelle_name_stats* out_stats,
+                                                                  size_t capacity, size_t* out_count);
+
+/**
+ * @brief Release a call tree
+ * @param tree Call tree handle
+ */
+TAGLIATELLE_API void tagliatelle_call_tree_destroy(tagliatelle_call_tree* tree);
+
+/**
+ * @brief Number of interned strings, label IDs are below this value
+ * @param store Store handle
+ * @return String count
+ */
+TAGLIATELLE_API size_t tagliatelle_store_string_count(const tagliatelle_store* store);
+
+/**
+ * @brief Read a range of the string table without copying the text
+ * @param store Store handle
+ * @param first_id ID of the first string to read
+ * @param count Number of strings to read
+ * @param out_strings Receives count views, the text stays valid until the store is destroyed
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_get_strings(const tagliatelle_store* store, uint32_t first_id, size_t count, tagliatelle_string* out_strings);
+
+/**
+ * @brief Save the store in the native trace format
+ *
+ * Native files load without parsing and are detected by tagliatelle_load_start.
+ * @param store Store handle
+ * @param path UTF-8 file path, an existing file is replaced
+ * @return Status code, TAGLIATELLE_IO_ERROR if the file cannot be written
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_store_save(const tagliatelle_store* store, const char* path);
+
+/**
+ * @brief Start loading a trace file in the background
+ *
+ * The file is memory mapped and parsed in parallel, events become visible
+ * to queries in file order while the load is in progress.
+ * Native, recorded live streams and Chrome Trace Event JSON files are detected and imported in one pass.
+ * @param store Store handle, must outlive the loader
+ * @param path UTF-8 file path
+ * @param out_loader Receives the loader handle
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_load_start(tagliatelle_store* store, const char* path, tagliatelle_loader** out_loader);
+
+/**
+ * @brief Poll the progress of a load without blocking
+ * @param loader Loader handle
+ * @param out_progress Receives the progress, status is TAGLIATELLE_IO_ERROR if the load failed
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_load_get_progress(const tagliatelle_loader* loader, tagliatelle_load_progress* out_progress);
+
+/**
+ * @brief Block until a load has finished
+ * @param loader Loader handle
+ * @return TAGLIATELLE_OK if the whole file was loaded
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_load_wait(tagliatelle_loader* loader);
+
+/**
+ * @brief Cancel a load if it is still running and release the loader
+ * @param loader Loader handle, may be NULL
+ */
+TAGLIATELLE_API void tagliatelle_load_destroy(tagliatelle_loader* loader);
+
+/**
+ * @brief Start accepting live events on a Unix domain socket
+ *
+ * Programs connect to the socket and stream events in the live protocol,
+ * the events are committed to the store in batches as they arrive.
+ * Each connection buffers a bounded number of events, further events are
+ * dropped and counted while the store falls behind.
+ * @param store Store handle, must outlive the session
+ * @param socket_path UTF-8 path of the socket, an existing socket file is replaced
+ * @param out_live Receives the session handle
+ * @return Status code, TAGLIATELLE_NOT_SUPPORTED without Unix domain sockets
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_live_start(tagliatelle_store* store, const char* socket_path, tagliatelle_live** out_live);
+
+/**
+ * @brief Read the counters of a live capture session
+ * @param live Session handle
+ * @param out_stats Receives the counters
+ * @return Status code
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_live_get_stats(const tagliatelle_live* live, tagliatelle_live_stats* out_stats);
+
+/**
+ * @brief Close all connections, commit the received events and release the session
+ * @param live Session handle, may be NULL
+ */
+TAGLIATELLE_API void tagliatelle_live_stop(tagliatelle_live* live);
+
+/**
+ * @brief Save the library's own profile in the native trace format
+ *
+ * Builds configured with TAGLIATELLE_SELF_PROFILE time ingestion, indexing,
+ * queries and API calls into per-thread ring buffers holding the most recent
+ * scopes. The file has a track per thread and opens like any other trace.
+ * @param path UTF-8 file path, an existing file is replaced
+ * @return Status code, TAGLIATELLE_IO_ERROR if the file cannot be written,
+ *         TAGLIATELLE_NOT_SUPPORTED if self-profiling was not compiled in
+ */
+TAGLIATELLE_API tagliatelle_status tagliatelle_profile_save(const char* path);
+
 #ifdef __cplusplus
 }
 #endif
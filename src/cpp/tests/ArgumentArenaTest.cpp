@@ -0,0 +1,203 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ArgumentArena.hpp"
+#include "Trace.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    Argument Int(const std::uint32_t key, const std::int64_t value)
+    {
+        Argument argument;
+        argument.key = key;
+        argument.type = ArgumentType::Int;
+        argument.integer = value;
+        return argument;
+    }
+
+    Argument Double(const std::uint32_t key, const double value)
+    {
+        Argument argument;
+        argument.key = key;
+        argument.type = ArgumentType::Double;
+        argument.number = value;
+        return argument;
+    }
+
+    Argument String(const std::uint32_t key, const std::uint32_t text)
+    {
+        Argument argument;
+        argument.key = key;
+        argument.type = ArgumentType::String;
+        argument.text = text;
+        return argument;
+    }
+
+    Argument Object(const std::uint32_t key, const std::uint32_t size)
+    {
+        Argument argument;
+        argument.key = key;
+        argument.type = ArgumentType::Object;
+        argument.size = size;
+        return argument;
+    }
+}
+
+TEST_CASE( "Argument runs are contiguous and never move", "[ArgumentArena]" ) {
+    std::mt19937 random{ 15 };
+    ArgumentArena arena;
+    REQUIRE( arena.Append({}) == 0 );
+    REQUIRE( arena.Size() == 0 );
+
+    struct Run
+    {
+        ArgumentOffset        offset;
+        std::vector<Argument> arguments;
+        const Argument*       address;
+    };
+    std::vector<Run> runs;
+    for (int i = 0; i < 5000; ++i)
+    {
+        std::vector<Argument> arguments(random() % 12);
+        for (auto& argument : arguments)
+            argument = Int(static_cast<std::uint32_t>(random() % 100), static_cast<std::int64_t>(random()));
+        const auto offset = arena.Append(arguments);
+        const auto view = arena.View(offset, arguments.size());
+        runs.push_back(Run{ offset, arguments, view.data() });
+    }
+    // A run that does not fit the rest of a page starts a new one
+    std::vector<Argument> full(ArgumentArena::PageRecords, Int(1, 2));
+    const auto fullOffset = arena.Append(full);
+    REQUIRE( fullOffset % ArgumentArena::PageRecords == 0 );
+    REQUIRE( arena.View(fullOffset, full.size()).back().integer == 2 );
+
+    for (const auto& run : runs)
+    {
+        const auto view = arena.View(run.offset, run.arguments.size());
+        REQUIRE( view.size() == run.arguments.size() );
+        if (!run.arguments.empty())
+            REQUIRE( view.data() == run.address );
+        for (std::size_t i = 0; i < view.size(); ++i)
+        {
+            REQUIRE( view[i].key == run.arguments[i].key );
+            REQUIRE( view[i].integer == run.arguments[i].integer );
+        }
+    }
+
+    arena.Clear();
+    REQUIRE( arena.Size() == 0 );
+}
+
+TEST_CASE( "Lookups skip nested objects and filters compare by value", "[ArgumentArena]" ) {
+    // {"a": 3, "nested": {"a": 1, "b": {"c": "x"}}, "b": 2.5, "s": "x"}
+    const std::vector<Argument> arguments = {
+        Int(1, 3),
+        Object(10, 3),
+            Int(1, 1),
+            Object(2, 1),
+                String(3, 20),
+        Double(2, 2.5),
+        String(4, 20),
+    };
+
+    REQUIRE( FindArgument(arguments, 1)->integer == 3 );
+    REQUIRE( FindArgument(arguments, 2)->number == 2.5 );
+    REQUIRE( FindArgument(arguments, 3) == nullptr );
+    REQUIRE( FindArgument({}, 1) == nullptr );
+
+    const auto members = ObjectMembers(*FindArgument(arguments, 10));
+    REQUIRE( members.size() == 3 );
+    REQUIRE( FindArgument(members, 1)->integer == 1 );
+    REQUIRE( FindArgument(ObjectMembers(*FindArgument(members, 2)), 3)->text == 20 );
+
+    auto filter = [](const std::uint32_t key, const ArgumentOp op, const Argument value)
+        {
+            ArgumentFilter result;
+            result.key = key;
+            result.op = op;
+            result.value = value;
+            return result;
+        };
+    REQUIRE( filter(1, ArgumentOp::Exists, {}).Matches(arguments) );
+    REQUIRE_FALSE( filter(3, ArgumentOp::Exists, {}).Matches(arguments) );
+    REQUIRE( filter(1, ArgumentOp::Equal, Double(0, 3.0)).Matches(arguments) );
+    REQUIRE( filter(1, ArgumentOp::Greater, Int(0, 2)).Matches(arguments) );
+    REQUIRE_FALSE( filter(1, ArgumentOp::Less, Int(0, 3)).Matches(arguments) );
+    REQUIRE( filter(2, ArgumentOp::Less, Int(0, 3)).Matches(arguments) );
+    REQUIRE( filter(4, ArgumentOp::Equal, String(0, 20)).Matches(arguments) );
+    REQUIRE_FALSE( filter(4, ArgumentOp::Greater, String(0, 10)).Matches(arguments) );
+    REQUIRE( filter(4, ArgumentOp::NotEqual, Int(0, 20)).Matches(arguments) );
+    REQUIRE( filter(3, ArgumentOp::NotEqual, Int(0, 0)).Matches(arguments) );
+    REQUIRE_FALSE( filter(10, ArgumentOp::Equal, Object(0, 3)).Matches(arguments) );
+}
+
+TEST_CASE( "Arguments stay attached to their events", "[ArgumentArena]" ) {
+    std::mt19937 random{ 16 };
+    Trace trace;
+    const auto key = trace.InternName("id");
+
+    // Out of order appends insert in place, bulk appends are merged
+    for (int i = 0; i < 2000; ++i)
+    {
+        const auto timestamp = static_cast<Timestamp>(random() % 100'000);
+        const Argument argument = Int(key, timestamp);
+        Event event{ timestamp, 10, key, 0, 0 };
+        event.argOffset = trace.StoreArguments({ &argument, 1 });
+        event.argCount = 1;
+        trace.Append(event);
+    }
+    EventColumns batch;
+    for (int i = 0; i < 2000; ++i)
+    {
+        const auto timestamp = static_cast<Timestamp>(random() % 100'000);
+        const Argument argument = Int(key, timestamp);
+        Event event{ timestamp, 10, key, 1, 0 };
+        if (i % 3 != 0)
+        {
+            event.argOffset = trace.StoreArguments({ &argument, 1 });
+            event.argCount = 1;
+        }
+        batch.PushBack(event);
+    }
+    trace.AppendBulk(batch);
+
+    // Chunk names and arguments are remapped into the trace
+    ParsedChunk chunk;
+    const auto chunkText = chunk.names.Intern("chunk text");
+    const auto chunkKey = chunk.names.Intern("id");
+    for (int i = 0; i < 2000; ++i)
+    {
+        const auto timestamp = static_cast<Timestamp>(random() % 100'000);
+        const Argument arguments[] = { Int(chunkKey, timestamp), String(chunkText, chunkText) };
+        Event event{ timestamp, 10, chunkText, 2, 0 };
+        event.argOffset = chunk.arguments.Append(arguments);
+        event.argCount = 2;
+        chunk.columns.PushBack(event);
+    }
+    trace.AppendChunk(std::move(chunk));
+
+    const auto& events = trace.Events();
+    const auto text = trace.InternName("chunk text");
+    std::size_t withArguments = 0;
+    for (std::size_t i = 0; i < events.Size(); ++i)
+    {
+        const auto arguments = events.Arguments(i);
+        if (arguments.empty())
+            continue;
+        ++withArguments;
+        const auto* id = FindArgument(arguments, key);
+        REQUIRE( id != nullptr );
+        REQUIRE( id->integer == events[i].timestamp );
+        if (events[i].track == 2)
+            REQUIRE( FindArgument(arguments, text)->text == text );
+    }
+    REQUIRE( withArguments == 2000 + 1333 + 2000 );
+
+    trace.Clear();
+    REQUIRE( trace.Events().ArgumentStore().Size() == 0 );
+}
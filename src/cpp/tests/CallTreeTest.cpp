@@ -0,0 +1,158 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "CallTree.hpp"
+#include "Trace.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    bool SameWeights(std::span<const CallTreeNode> lhs, std::span<const CallTreeNode> rhs)
+    {
+        return std::ranges::equal(lhs, rhs, [](const CallTreeNode& a, const CallTreeNode& b)
+            {
+                return a.name == b.name && a.parent == b.parent && a.count == b.count && a.inclusive == b.inclusive && a.self == b.self;
+            });
+    }
+}
+
+TEST_CASE( "Identical stacks merge into one node", "[CallTree]" ) {
+    Trace trace;
+    const auto frame = trace.InternName("frame");
+    const auto update = trace.InternName("update");
+    const auto draw = trace.InternName("draw");
+    trace.Append(Event{ 0, 100, frame, 0, 0 });
+    trace.Append(Event{ 10, 30, update, 0, 1 });
+    trace.Append(Event{ 50, 40, draw, 0, 1 });
+    trace.Append(Event{ 200, 100, frame, 0, 0 });
+    trace.Append(Event{ 210, 60, draw, 0, 1 });
+    trace.Append(Event{ 0, 500, draw, 1, 0 });
+
+    CallTree tree;
+    tree.Build(trace.Events());
+    tree.Select(trace.Events(), trace.Intervals(), 0, 1000);
+
+    // Preorder in order of appearance: frame, frame/update, frame/draw, draw
+    const auto nodes = tree.Nodes();
+    REQUIRE( nodes.size() == 4 );
+    REQUIRE( nodes[0].name == frame );
+    REQUIRE( nodes[0].parent == CallTree::NoParent );
+    REQUIRE( nodes[0].descendants == 2 );
+    REQUIRE( nodes[0].count == 2 );
+    REQUIRE( nodes[0].inclusive == 200 );
+    REQUIRE( nodes[0].self == 200 - 30 - 40 - 60 );
+    REQUIRE( nodes[1].name == update );
+    REQUIRE( nodes[1].parent == 0 );
+    REQUIRE( nodes[1].depth == 1 );
+    REQUIRE( nodes[2].name == draw );
+    REQUIRE( nodes[2].count == 2 );
+    REQUIRE( nodes[2].inclusive == 100 );
+    REQUIRE( nodes[3].name == draw );
+    REQUIRE( nodes[3].parent == CallTree::NoParent );
+    REQUIRE( nodes[3].self == 500 );
+
+    // Only the second frame and the long draw overlap
+    tree.Select(trace.Events(), trace.Intervals(), 150, 205);
+    REQUIRE( nodes[0].count == 1 );
+    REQUIRE( nodes[0].inclusive == 100 );
+    REQUIRE( nodes[2].count == 0 );
+    REQUIRE( nodes[3].count == 1 );
+
+    const auto byName = tree.SelfTimeByName();
+    REQUIRE( byName.size() == 2 );
+    REQUIRE( byName[0].name == draw );
+    REQUIRE( byName[0].self == 500 );
+    REQUIRE( byName[1].self == 40 );
+
+    tree.ClearSelection();
+    REQUIRE( std::ranges::all_of(nodes, [](const CallTreeNode& node) { return node.count == 0 && node.inclusive == 0; }) );
+}
+
+TEST_CASE( "Recursive frames count once towards the total of their name", "[CallTree]" ) {
+    Trace trace;
+    const auto walk = trace.InternName("walk");
+    trace.Append(Event{ 0, 100, walk, 0, 0 });
+    trace.Append(Event{ 10, 50, walk, 0, 1 });
+    trace.Append(Event{ 20, 10, walk, 0, 2 });
+
+    CallTree tree;
+    tree.Build(trace.Events());
+    tree.Select(trace.Events(), trace.Intervals(), 0, 100);
+
+    const auto byName = tree.SelfTimeByName();
+    REQUIRE( byName.size() == 1 );
+    REQUIRE( byName[0].count == 3 );
+    REQUIRE( byName[0].total == 100 );
+    REQUIRE( byName[0].self == 100 );
+}
+
+TEST_CASE( "Dragging the selection matches selecting from scratch", "[CallTree]" ) {
+    std::mt19937 random{ 13 };
+    Trace trace;
+    std::vector<NameId> names;
+    for (const auto text : { "a", "b", "c", "d" })
+        names.push_back(trace.InternName(text));
+
+    EventColumns batch;
+    for (TrackId track = 0; track < 4; ++track)
+    {
+        Timestamp cursor = 0;
+        for (int root = 0; root < 500; ++root)
+        {
+            // A root with a chain of nested children, some sharing a name
+            const auto duration = static_cast<Duration>(50 + random() % 500);
+            Timestamp start = cursor;
+            Duration length = duration;
+            for (Depth depth = 0; depth < 5 && length > 4; ++depth)
+            {
+                batch.PushBack(Event{ start, length, names[random() % names.size()], track, depth });
+                start += static_cast<Duration>(random() % (length / 4));
+                length = length / 2;
+            }
+            cursor += duration + static_cast<Duration>(random() % 20);
+        }
+    }
+    trace.AppendBulk(batch);
+
+    CallTree dragged;
+    dragged.Build(trace.Events());
+    Timestamp first = 1000;
+    Timestamp last = 20'000;
+    std::uniform_int_distribution<Timestamp> step{ -3000, 3000 };
+    int selected = 0;
+    for (int i = 0; i < 200; ++i)
+    {
+        // Pans, resizes, the occasional jump and empty windows
+        if (i % 50 == 49)
+        {
+            const Timestamp jump = i % 100 == 49 ? 50'000 : -40'000;
+            first += jump;
+            last += jump;
+        }
+        else if (i % 2 == 0)
+        {
+            const auto shift = step(random);
+            first += shift;
+            last += shift;
+        }
+        else
+        {
+            first += step(random);
+            last = i % 9 == 1 ? first - 1 : std::max(first, last + step(random));
+        }
+
+        dragged.Select(trace.Events(), trace.Intervals(), first, last);
+
+        CallTree fresh;
+        fresh.Build(trace.Events());
+        fresh.Select(trace.Events(), trace.Intervals(), first, last);
+        REQUIRE( SameWeights(dragged.Nodes(), fresh.Nodes()) );
+        if (std::ranges::any_of(fresh.Nodes(), [](const CallTreeNode& node) { return node.count > 0; }))
+            ++selected;
+    }
+    REQUIRE( selected > 150 );
+}
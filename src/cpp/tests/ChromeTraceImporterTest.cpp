@@ -0,0 +1,381 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "ChromeTraceImporter.hpp"
+#include "JsonScanner.hpp"
+#include "Trace.hpp"
+#include "TraceLoader.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    // Byte-at-a-time reference for the structural scanner
+    std::vector<std::size_t> ReferenceStructurals(const std::string& json)
+    {
+        std::vector<std::size_t> result;
+        bool inString = false;
+        for (std::size_t i = 0; i < json.size(); ++i)
+        {
+            const char c = json[i];
+            if (c == '\\')
+            {
+                ++i;
+            }
+            else if (c == '"')
+            {
+                inString = !inString;
+                result.push_back(i);
+            }
+            else if (!inString && (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ','))
+            {
+                result.push_back(i);
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::size_t> Scan(const std::string& json, const JsonScanKernel kernel)
+    {
+        std::vector<std::size_t> result;
+        JsonStructuralScanner scanner{ json, kernel };
+        for (auto pos = scanner.Next(); pos != JsonStructuralScanner::npos; pos = scanner.Next())
+            result.push_back(pos);
+        return result;
+    }
+}
+
+TEST_CASE( "Structural scanner matches a byte-at-a-time reference", "[JsonScanner]" ) {
+    std::mt19937 random{ 42 };
+    const std::string alphabet = "{}[]:,\"\\ ab";
+    std::uniform_int_distribution<std::size_t> pick{ 0, alphabet.size() - 1 };
+    std::uniform_int_distribution<std::size_t> length{ 0, 300 };
+
+    for (int round = 0; round < 2000; ++round)
+    {
+        // Backslashes only occur in strings in valid JSON
+        std::string json;
+        bool inString = false;
+        for (auto n = length(random); json.size() < n;)
+        {
+            const char c = alphabet[pick(random)];
+            if (c == '\\' && !inString)
+                continue;
+            if (c == '\\')
+            {
+                json += c;
+                json += alphabet[pick(random)];
+                continue;
+            }
+            if (c == '"')
+                inString = !inString;
+            json += c;
+        }
+
+        const auto expected = ReferenceStructurals(json);
+        REQUIRE( Scan(json, JsonScanKernel::Scalar) == expected );
+        REQUIRE( Scan(json, JsonScanKernel::Best) == expected );
+    }
+}
+
+TEST_CASE( "Chrome trace events become spans on per-thread tracks", "[ChromeTraceImporter]" ) {
+    const std::string json = R"({
+        "displayTimeUnit": "ns",
+        "metadata": { "nested": [1, {"a": "}"}] },
+        "traceEvents": [
+            {"name": "thread_name", "ph": "M", "pid": 1, "tid": 7, "args": {"name": "Main \"UI\""}},
+            {"name": "process_name", "ph": "M", "pid": 1, "args": {"name": "Browser"}},
+            {"name": "frame", "ph": "X", "ts": 10, "dur": 100.5, "pid": 1, "tid": 7},
+            {"ph": "B", "name": "layout", "pid": 1, "tid": 7, "ts": 20.25},
+            {"ph": "E", "pid": 1, "tid": 7, "ts": 50},
+            {"name": "tické😀", "ph": "i", "ts": 30, "pid": 1, "tid": 7, "s": "t"},
+            {"name": "other", "ph": "X", "ts": 1.5e1, "dur": 1, "pid": "gpu", "tid": 2},
+            {"name": "counter", "ph": "C", "ts": 5, "pid": 1, "tid": 7, "args": {"value": 3}},
+            {"name": "broken", "ph": "X", "pid": 1, "tid": 7},
+            {"ph": "E", "pid": 1, "tid": 8, "ts": 60},
+            {"name": "unfinished", "ph": "B", "pid": 1, "tid": 9, "ts": 80}
+        ]
+    })";
+
+    ParsedChunk chunk;
+    ImportChromeTrace(json, chunk);
+
+    REQUIRE( chunk.malformedRecords == 2 );
+    REQUIRE( chunk.columns.Size() == 5 );
+
+    auto find = [&](const std::string_view name)
+        {
+            for (std::size_t i = 0; i < chunk.columns.Size(); ++i)
+            {
+                if (chunk.names.View(chunk.columns.names[i]) == name)
+                    return chunk.columns[i];
+            }
+            FAIL( "event not found" );
+            return Event{};
+        };
+
+    const auto frame = find("frame");
+    REQUIRE( frame.timestamp == 10'000 );
+    REQUIRE( frame.duration == 100'500 );
+    REQUIRE( frame.depth == 0 );
+
+    const auto layout = find("layout");
+    REQUIRE( layout.timestamp == 20'250 );
+    REQUIRE( layout.duration == 29'750 );
+    REQUIRE( layout.track == frame.track );
+    REQUIRE( layout.depth == 1 );
+
+    const auto tick = find("tick\xC3\xA9\xF0\x9F\x98\x80");
+    REQUIRE( tick.duration == 0 );
+    REQUIRE( tick.depth == 2 );
+
+    const auto other = find("other");
+    REQUIRE( other.timestamp == 15'000 );
+    REQUIRE( other.track != frame.track );
+
+    // Open spans last until the end of the capture
+    const auto unfinished = find("unfinished");
+    REQUIRE( unfinished.duration == 30'500 );
+
+    std::vector<std::string> trackNames;
+    for (const auto& [track, name] : chunk.trackNames)
+        trackNames.emplace_back(chunk.names.View(name));
+    REQUIRE( trackNames[frame.track] == "Browser / Main \"UI\"" );
+    REQUIRE( trackNames[other.track] == "pid gpu / tid 2" );
+}
+
+TEST_CASE( "Bare and truncated event arrays are accepted", "[ChromeTraceImporter]" ) {
+    ParsedChunk chunk;
+    ImportChromeTrace("[{\"name\":\"a\",\"ph\":\"X\",\"ts\":1,\"dur\":2,\"pid\":0,\"tid\":0},\n"
+                      " {\"name\":\"b\",\"ph\":\"X\",\"ts\":2,\"dur\":1,\"pid\":0,\"tid\":0},\n", chunk);
+    REQUIRE( chunk.columns.Size() == 2 );
+    REQUIRE( chunk.columns[1].depth == 1 );
+
+    ParsedChunk empty;
+    ImportChromeTrace("{\"traceEvents\": []}", empty);
+    REQUIRE( empty.columns.Size() == 0 );
+
+    ParsedChunk broken;
+    REQUIRE_THROWS( ImportChromeTrace("[{\"name\" \"a\"}]", broken) );
+    REQUIRE_THROWS( ImportChromeTrace("[{\"name\": \"a", broken) );
+    REQUIRE_THROWS( ImportChromeTrace("", broken) );
+
+    REQUIRE( LooksLikeJson("\xEF\xBB\xBF \n [") );
+    REQUIRE( !LooksLikeJson("100 20 1 0 frame") );
+}
+
+TEST_CASE( "Event args are flattened into typed arguments", "[ChromeTraceImporter]" ) {
+    const std::string json = R"([
+        {"name": "a", "ph": "X", "ts": 1, "dur": 5, "pid": 0, "tid": 0,
+         "args": {"count": -42, "ratio": 0.5, "big": 1e30, "ok": true, "none": null, "url": "http:\/\/x",
+                  "nested": {"list": [1, "two", {}], "empty": []}, "after": 7}},
+        {"name": "b", "ph": "B", "ts": 2, "pid": 0, "tid": 0, "args": {"phase": "begin"}},
+        {"ph": "E", "ts": 3, "pid": 0, "tid": 0},
+        {"name": "c", "ph": "i", "ts": 4, "pid": 0, "tid": 0, "args": {"bad": tru}},
+        {"name": "d", "ph": "X", "ts": 5, "dur": 1, "pid": 0, "tid": 0, "args": {}}
+    ])";
+
+    ParsedChunk chunk;
+    ImportChromeTrace(json, chunk);
+    REQUIRE( chunk.columns.Size() == 4 );
+
+    auto key = [&](const std::string_view name) { return *chunk.names.Find(name); };
+    auto arguments = [&](const std::size_t i) { return chunk.arguments.View(chunk.columns.argOffsets[i], chunk.columns.argCounts[i]); };
+
+    const auto a = arguments(0);
+    REQUIRE( a.size() == 13 );
+    REQUIRE( FindArgument(a, key("count"))->integer == -42 );
+    REQUIRE( FindArgument(a, key("ratio"))->number == 0.5 );
+    REQUIRE( FindArgument(a, key("big"))->type == ArgumentType::Double );
+    REQUIRE( FindArgument(a, key("ok"))->boolean );
+    REQUIRE( FindArgument(a, key("none"))->type == ArgumentType::Null );
+    REQUIRE( chunk.names.View(FindArgument(a, key("url"))->text) == "http://x" );
+    REQUIRE( FindArgument(a, key("after"))->integer == 7 );
+
+    const auto nested = ObjectMembers(*FindArgument(a, key("nested")));
+    REQUIRE( nested.size() == 5 );
+    const auto list = ObjectMembers(*FindArgument(nested, key("list")));
+    REQUIRE( list.size() == 3 );
+    REQUIRE( FindArgument(list, key("0"))->integer == 1 );
+    REQUIRE( chunk.names.View(FindArgument(list, key("1"))->text) == "two" );
+    REQUIRE( FindArgument(list, key("2"))->size == 0 );
+    REQUIRE( FindArgument(nested, key("empty"))->size == 0 );
+
+    // Begin args are kept for the span closed by the end event
+    const auto b = arguments(1);
+    REQUIRE( b.size() == 1 );
+    REQUIRE( chunk.names.View(b[0].text) == "begin" );
+
+    // Malformed args are dropped, the event is kept
+    REQUIRE( arguments(2).empty() );
+    REQUIRE( arguments(3).empty() );
+}
+
+TEST_CASE( "Counter events become samples of named series", "[ChromeTraceImporter]" ) {
+    const std::string json = R"([
+        {"name": "cpu", "ph": "C", "ts": 2, "pid": 0, "tid": 0, "args": {"load": 0.75}},
+        {"name": "heap", "ph": "C", "ts": 1, "pid": 0, "tid": 0, "args": {"used": 100, "free": 28, "label": "x"}},
+        {"name": "cpu", "ph": "C", "ts": 1, "pid": 0, "tid": 0, "args": {"load": 0.5}},
+        {"name": "cpu", "ph": "C", "ts": 3, "pid": 0, "tid": 0},
+        {"name": "a", "ph": "X", "ts": 1, "dur": 1, "pid": 0, "tid": 0}
+    ])";
+    ParsedChunk chunk;
+    ImportChromeTrace(json, chunk);
+    REQUIRE( chunk.columns.Size() == 1 );
+    REQUIRE( chunk.counters.size() == 4 );
+    REQUIRE( chunk.malformedRecords == 1 );
+    REQUIRE( chunk.names.View(chunk.counters[0].series) == "cpu" );
+    REQUIRE( chunk.counters[0].timestamp == 2'000 );
+    REQUIRE( chunk.counters[0].value == 0.75 );
+    REQUIRE( chunk.names.View(chunk.counters[1].series) == "heap.used" );
+    REQUIRE( chunk.names.View(chunk.counters[2].series) == "heap.free" );
+    REQUIRE( chunk.counters[2].value == 28.0 );
+
+    // Series are sorted by time as they are added to a trace
+    Trace trace;
+    trace.AppendChunk(std::move(chunk));
+    const auto& counters = trace.Counters();
+    REQUIRE( counters.SeriesCount() == 3 );
+    REQUIRE( counters.Size() == 4 );
+    REQUIRE( trace.Events().Name(counters.SeriesName(0)) == "cpu" );
+    REQUIRE( counters.Timestamps(0).size() == 2 );
+    REQUIRE( counters.Timestamps(0)[0] == 1'000 );
+    REQUIRE( counters.Values(0)[1] == 0.75 );
+    REQUIRE( trace.CounterSeries("heap.free") == 2 );
+}
+
+TEST_CASE( "Flow events link spans across threads", "[ChromeTraceImporter]" ) {
+    const std::string json = R"([
+        {"name": "send", "ph": "X", "ts": 0, "dur": 10, "pid": 1, "tid": 1},
+        {"name": "recv", "ph": "X", "ts": 20, "dur": 10, "pid": 1, "tid": 2},
+        {"name": "done", "ph": "X", "ts": 50, "dur": 10, "pid": 2, "tid": 1},
+        {"name": "req", "cat": "rpc", "ph": "s", "id": "0x1", "ts": 5, "pid": 1, "tid": 1},
+        {"name": "req", "cat": "rpc", "ph": "t", "id": "0x1", "ts": 25, "pid": 1, "tid": 2},
+        {"name": "req", "cat": "rpc", "ph": "f", "id": "0x1", "ts": 45, "pid": 2, "tid": 1},
+        {"name": "req", "cat": "rpc", "ph": "s", "id": 2, "ts": 6, "pid": 1, "tid": 1},
+        {"name": "req", "cat": "rpc", "ph": "f", "bp": "e", "id": 2, "ts": 21, "pid": 1, "tid": 2},
+        {"name": "req", "cat": "rpc", "ph": "f", "id": {"local": 3}, "ts": 6, "pid": 1, "tid": 1}
+    ])";
+    ParsedChunk chunk;
+    ImportChromeTrace(json, chunk);
+    REQUIRE( chunk.columns.Size() == 3 );
+    REQUIRE( chunk.flows.size() == 5 );
+    REQUIRE( chunk.malformedRecords == 1 );
+    REQUIRE( chunk.flows[0].id == chunk.flows[2].id );
+    REQUIRE( chunk.flows[0].id != chunk.flows[3].id );
+    REQUIRE( chunk.flows[1].phase == FlowPhase::Step );
+    REQUIRE( chunk.flows[2].nextSlice );
+    REQUIRE( !chunk.flows[4].nextSlice );
+
+    Trace trace;
+    trace.AppendChunk(std::move(chunk));
+    const auto& flows = trace.Flows();
+    REQUIRE( flows.EdgeCount() == 3 );
+    REQUIRE( flows.UnboundPoints() == 0 );
+    REQUIRE( flows.Outgoing(0).size() == 2 );
+    REQUIRE( flows.Incoming(1).size() == 2 );
+    REQUIRE( flows.Outgoing(1).size() == 1 );
+    REQUIRE( flows.Outgoing(1)[0].to == 2 );
+}
+
+TEST_CASE( "Chunked imports match a single chunk once depths are derived again", "[ChromeTraceImporter]" ) {
+    // Complete events written when they end, children before their parents
+    const std::string json = R"([
+        {"name": "thread_name", "ph": "M", "pid": 1, "tid": 1, "args": {"name": "main"}},
+        {"name": "leaf", "ph": "X", "ts": 2, "dur": 1, "pid": 1, "tid": 1, "args": {"k": "v"}},
+        {"name": "send", "cat": "rpc", "ph": "s", "id": 1, "ts": 2, "pid": 1, "tid": 1},
+        {"name": "child", "ph": "X", "ts": 1, "dur": 5, "pid": 1, "tid": 1},
+        {"ph": "B", "name": "open", "pid": 1, "tid": 2, "ts": 3, "args": {"n": 1}},
+        {"name": "root", "ph": "X", "ts": 0, "dur": 10, "pid": 1, "tid": 1},
+        {"name": "inner", "ph": "X", "ts": 4, "dur": 1, "pid": 1, "tid": 2},
+        {"ph": "E", "pid": 1, "tid": 2, "ts": 8},
+        {"name": "send", "cat": "rpc", "ph": "f", "id": 1, "ts": 3, "pid": 1, "tid": 2},
+        {"name": "late", "ph": "X", "ts": 20, "dur": 1, "pid": 1, "tid": 1}
+    ])";
+
+    Trace whole;
+    ParsedChunk chunk;
+    ImportChromeTrace(json, chunk);
+    whole.AppendChunk(std::move(chunk));
+
+    Trace chunked;
+    std::size_t chunks = 0;
+    std::vector<TrackId> provisional;
+    ImportChromeTrace(json, 1, [&](ParsedChunk&& part)
+        {
+            ++chunks;
+            part.columns.Sort();
+            provisional.insert(provisional.end(), part.provisionalTracks.begin(), part.provisionalTracks.end());
+            chunked.AppendChunk(std::move(part));
+            return true;
+        });
+    REQUIRE( chunks > 5 );
+    REQUIRE( !provisional.empty() );
+    chunked.Renest(provisional);
+
+    const auto& a = whole.Events();
+    const auto& b = chunked.Events();
+    REQUIRE( a.Size() == 6 );
+    REQUIRE( b.Size() == a.Size() );
+    bool same = true;
+    for (std::size_t i = 0; i < a.Size(); ++i)
+    {
+        same &= a[i].timestamp == b[i].timestamp && a[i].duration == b[i].duration && a[i].track == b[i].track
+            && a[i].depth == b[i].depth && a.Name(a[i].name) == b.Name(b[i].name) && a[i].argCount == b[i].argCount;
+        if (a[i].argCount > 0)
+            same &= b.Name(b.Arguments(i)[0].key) == a.Name(a.Arguments(i)[0].key);
+    }
+    REQUIRE( same );
+    REQUIRE( a.Name(a[2].name) == "leaf" );
+    REQUIRE( a[2].depth == 2 );
+    REQUIRE( b.TrackName(0) == a.TrackName(0) );
+    REQUIRE( chunked.Flows().EdgeCount() == 1 );
+    REQUIRE( whole.Flows().EdgeCount() == 1 );
+
+    // The sink cancels the import
+    chunks = 0;
+    ImportChromeTrace(json, 1, [&](ParsedChunk&&) { return ++chunks < 2; });
+    REQUIRE( chunks == 2 );
+}
+
+TEST_CASE( "JSON files are detected by the loader", "[ChromeTraceImporter]" ) {
+    std::string contents = "{\"traceEvents\": [";
+    for (int i = 0; i < 10'000; ++i)
+        contents += std::string{ i > 0 ? "," : "" } + "{\"name\":\"task_" + std::to_string(i % 5) + "\",\"ph\":\"X\",\"ts\":" + std::to_string(i) + ",\"dur\":0.5,\"pid\":1,\"tid\":" + std::to_string(i % 3) + "}\n";
+    contents += "]}";
+    const auto path = std::filesystem::temp_directory_path() / "tagliatelle_loader_test.json";
+    std::ofstream{ path, std::ios::binary } << contents;
+
+    Trace trace;
+    std::shared_mutex mutex;
+    TraceLoader loader{ trace, mutex };
+    loader.Start(path);
+    loader.Wait();
+
+    const auto progress = loader.Progress();
+    REQUIRE( !progress.failed );
+    REQUIRE( progress.bytesParsed == contents.size() );
+    REQUIRE( progress.eventsLoaded == 10'000 );
+    REQUIRE( trace.Events().Size() == 10'000 );
+    REQUIRE( trace.Events().TrackCount() == 3 );
+    REQUIRE( trace.Events().TrackName(1) == "pid 1 / tid 1" );
+    REQUIRE( trace.Events().Timestamps()[9'999] == 9'999'000 );
+
+    // In chunks of a few hundred events
+    Trace chunked;
+    TraceLoader chunkedLoader{ chunked, mutex };
+    chunkedLoader.Start(path, 1, 8192);
+    chunkedLoader.Wait();
+    REQUIRE( chunkedLoader.Progress().eventsLoaded == 10'000 );
+    REQUIRE( chunked.Events().Size() == 10'000 );
+    REQUIRE( chunked.Events().TrackName(1) == "pid 1 / tid 1" );
+    REQUIRE( chunked.Events().Timestamps()[9'999] == 9'999'000 );
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,111 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+
+#include "LiveCapture.hpp"
+#include "Trace.hpp"
+#include "TraceLoader.hpp"
+#include "tagliatelle_client.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    std::size_t CountNamed(const EventStore& events, const std::string_view name)
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < events.Size(); ++i)
+            count += events.Name(events.NameIds()[i]) == name;
+        return count;
+    }
+}
+
+TEST_CASE( "Client scopes written to a file load as a trace", "[Client]" ) {
+    const auto path = std::filesystem::temp_directory_path() / "tagliatelle_client_test.tglv";
+    auto& collector = client::Collector::Instance();
+
+    {
+        TAG_SCOPE("before start"); // not recorded
+    }
+
+    collector.Start(client::FileSink::Create(path));
+    std::thread worker{ [] {
+        TAG_THREAD_NAME("worker");
+        for (int i = 0; i < 100; ++i)
+        {
+            TAG_SCOPE("outer");
+            TAG_SCOPE("inner");
+        }
+    } };
+    worker.join();
+    {
+        TAG_SCOPE("main");
+    }
+    collector.Stop();
+
+    const auto stats = collector.Stats();
+    REQUIRE( stats.eventsWritten == 201 );
+    REQUIRE( stats.eventsDropped == 0 );
+    REQUIRE( !stats.failed );
+    REQUIRE( stats.bytesWritten == std::filesystem::file_size(path) );
+
+    Trace trace;
+    std::shared_mutex mutex;
+    TraceLoader loader{ trace, mutex };
+    loader.Start(path);
+    loader.Wait();
+    REQUIRE( !loader.Progress().failed );
+    REQUIRE( loader.Progress().malformedRecords == 0 );
+
+    const auto& events = trace.Events();
+    REQUIRE( events.Size() == 201 );
+    REQUIRE( CountNamed(events, "outer") == 100 );
+    REQUIRE( CountNamed(events, "inner") == 100 );
+    REQUIRE( CountNamed(events, "before start") == 0 );
+
+    bool nested = true;
+    for (std::size_t i = 0; i < events.Size(); ++i)
+    {
+        const auto name = events.Name(events.NameIds()[i]);
+        if (name == "inner")
+            nested &= events.Depths()[i] == 1 && events.TrackName(events.Tracks()[i]) == "worker";
+        else if (name == "outer")
+            nested &= events.Depths()[i] == 0;
+    }
+    REQUIRE( nested );
+    std::filesystem::remove(path);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+TEST_CASE( "Client scopes stream to a live capture", "[Client]" ) {
+    const auto path = std::filesystem::temp_directory_path() / "tagliatelle_client_test.sock";
+    Trace trace;
+    std::shared_mutex mutex;
+    LiveCapture capture{ trace, mutex };
+    capture.Start(path);
+
+    auto& collector = client::Collector::Instance();
+    collector.Start(client::SocketSink::Connect(path));
+    for (int i = 0; i < 1000; ++i)
+    {
+        TAG_SCOPE("frame");
+    }
+    collector.Stop();
+    REQUIRE( collector.Stats().eventsWritten == 1000 );
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (capture.Stats().eventsCommitted < 1000 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    capture.Stop();
+
+    REQUIRE( capture.Stats().malformedMessages == 0 );
+    REQUIRE( trace.Events().Size() == 1000 );
+    REQUIRE( CountNamed(trace.Events(), "frame") == 1000 );
+}
+
+#endif
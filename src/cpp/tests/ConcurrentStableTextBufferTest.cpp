@@ -0,0 +1,65 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentStableTextBuffer.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Single threaded stores are stable", "[ConcurrentStableTextBuffer]" ) {
+    ConcurrentStableTextBuffer<16> buffer;
+
+    const auto hello = buffer.Store("hello");
+    const auto world = buffer.Store("world!");
+    const auto spill = buffer.Store("does not fit");
+
+    REQUIRE( hello == "hello" );
+    REQUIRE( world == "world!" );
+    REQUIRE( spill == "does not fit" );
+    REQUIRE( world.data() == hello.data() + hello.size() );
+    REQUIRE( buffer.Store("").empty() );
+}
+
+TEST_CASE( "Many writers never corrupt each other", "[ConcurrentStableTextBuffer]" ) {
+    constexpr int WriterCount = 16;
+    constexpr int StoresPerWriter = 20'000;
+
+    ConcurrentStableTextBuffer<256> buffer;
+    std::vector<std::vector<std::string_view>> views(WriterCount);
+
+    {
+        std::vector<std::jthread> writers;
+        for (int w = 0; w < WriterCount; ++w)
+        {
+            writers.emplace_back([&buffer, &out = views[w], w]
+                {
+                    out.reserve(StoresPerWriter);
+                    for (int i = 0; i < StoresPerWriter; ++i)
+                        out.push_back(buffer.Store(std::to_string(w) + ':' + std::string(i % 37, 'x') + std::to_string(i)));
+                });
+        }
+    }
+
+    for (int w = 0; w < WriterCount; ++w)
+    {
+        REQUIRE( views[w].size() == StoresPerWriter );
+        for (int i = 0; i < StoresPerWriter; ++i)
+            REQUIRE( views[w][i] == std::to_string(w) + ':' + std::string(i % 37, 'x') + std::to_string(i) );
+    }
+}
+
+TEST_CASE( "Oversized strings are stored concurrently", "[ConcurrentStableTextBuffer]" ) {
+    ConcurrentStableTextBuffer<32> buffer;
+    std::vector<std::string_view> views(8);
+
+    {
+        std::vector<std::jthread> writers;
+        for (std::size_t w = 0; w < views.size(); ++w)
+            writers.emplace_back([&buffer, &out = views[w], w] { out = buffer.Store(std::string(100 + w, 'a' + static_cast<char>(w))); });
+    }
+
+    for (std::size_t w = 0; w < views.size(); ++w)
+        REQUIRE( views[w] == std::string(100 + w, 'a' + static_cast<char>(w)) );
+}
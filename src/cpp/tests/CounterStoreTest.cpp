@@ -0,0 +1,186 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "CounterStore.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    // First, minimum, maximum and last sample of every pixel, by scanning all samples
+    std::vector<CounterPoint> ReferenceDecimate(const std::vector<CounterPoint>& samples, const Viewport& viewport)
+    {
+        std::vector<CounterPoint> result;
+        const double pixelWidth = static_cast<double>(viewport.end - viewport.start) / viewport.width;
+        std::size_t i = 0;
+        while (i < samples.size() && samples[i].timestamp < viewport.start)
+            ++i;
+        if (i > 0)
+            result.push_back(samples[i - 1]);
+        while (i < samples.size() && samples[i].timestamp < viewport.end)
+        {
+            const auto pixel = std::floor(static_cast<double>(samples[i].timestamp - viewport.start) / pixelWidth);
+            auto first = i, min = i, max = i, last = i;
+            for (; last < samples.size() && samples[last].timestamp < viewport.end
+                   && std::floor(static_cast<double>(samples[last].timestamp - viewport.start) / pixelWidth) == pixel; ++last)
+            {
+                if (samples[last].value < samples[min].value)
+                    min = last;
+                if (samples[last].value > samples[max].value)
+                    max = last;
+            }
+            std::vector<std::size_t> picked{ first, min, max, last - 1 };
+            std::sort(picked.begin(), picked.end());
+            picked.erase(std::unique(picked.begin(), picked.end()), picked.end());
+            for (const auto index : picked)
+                result.push_back(samples[index]);
+            i = last;
+        }
+        if (i < samples.size())
+            result.push_back(samples[i]);
+        return result;
+    }
+
+    bool Same(const std::vector<CounterPoint>& a, const std::vector<CounterPoint>& b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const CounterPoint& x, const CounterPoint& y)
+            {
+                return x.timestamp == y.timestamp && x.value == y.value;
+            });
+    }
+}
+
+TEST_CASE( "Decimation keeps the first, minimum, maximum and last sample of every pixel", "[CounterStore]" ) {
+    std::mt19937 random{ 3 };
+    std::uniform_real_distribution<double> noise{ -1.0, 1.0 };
+    std::vector<CounterPoint> samples;
+    Timestamp time = 0;
+    for (int i = 0; i < 100'000; ++i)
+    {
+        time += static_cast<Timestamp>(random() % 50); // bursts share timestamps
+        samples.push_back(CounterPoint{ time, std::sin(i * 0.001) * 100.0 + noise(random) });
+    }
+
+    CounterStore store;
+    const auto series = store.Series(7);
+    REQUIRE( store.Series(7) == series );
+    REQUIRE( store.SeriesName(series) == 7 );
+    for (const auto& sample : samples)
+        store.Append(series, sample.timestamp, sample.value);
+    REQUIRE( store.Size() == samples.size() );
+
+    std::vector<CounterPoint> points;
+    bool same = true;
+    std::size_t bounded = 0;
+    for (int i = 0; i < 200; ++i)
+    {
+        const auto a = static_cast<Timestamp>(random() % static_cast<std::uint64_t>(time + 1000)) - 500;
+        const auto b = static_cast<Timestamp>(random() % static_cast<std::uint64_t>(time + 1000)) - 500;
+        const Viewport viewport{ std::min(a, b), std::max(a, b) + 1, static_cast<float>(1 + random() % 2000) };
+        store.Decimate(series, viewport, points);
+        same &= Same(points, ReferenceDecimate(samples, viewport));
+        bounded += points.size() <= 4 * static_cast<std::size_t>(viewport.width) + 6;
+    }
+    REQUIRE( same );
+    REQUIRE( bounded == 200 );
+
+    const Viewport whole{ 0, time + 1, 1000.0f };
+    store.Decimate(series, whole, points);
+    REQUIRE( points.size() <= 4000 );
+    REQUIRE( points.front().timestamp == samples.front().timestamp );
+    REQUIRE( points.back().value == samples.back().value );
+
+    store.Decimate(series, Viewport{ 0, 0, 1000.0f }, points);
+    REQUIRE( points.empty() );
+    store.Decimate(store.Series(8), whole, points);
+    REQUIRE( points.empty() );
+}
+
+TEST_CASE( "Counter samples may be appended out of order", "[CounterStore]" ) {
+    std::mt19937 random{ 11 };
+    std::vector<CounterPoint> samples;
+    for (int i = 0; i < 5'000; ++i)
+        samples.push_back(CounterPoint{ static_cast<Timestamp>(i) * 10, static_cast<double>(random() % 1000) });
+    std::vector<CounterPoint> shuffled = samples;
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+
+    CounterStore store;
+    const auto single = store.Series(1);
+    const auto bulk = store.Series(2);
+    for (std::size_t i = 0; i < 500; ++i)
+        store.Append(single, shuffled[i].timestamp, shuffled[i].value);
+    store.AppendBulk(single, std::span<const CounterPoint>{ shuffled }.subspan(500));
+    store.AppendBulk(bulk, std::span<const CounterPoint>{ samples }.first(2'000));
+    store.AppendBulk(bulk, std::span<const CounterPoint>{ samples }.subspan(2'000));
+    REQUIRE( store.Size() == 2 * samples.size() );
+    REQUIRE( std::ranges::is_sorted(store.Timestamps(single)) );
+
+    std::vector<CounterPoint> points;
+    bool same = true;
+    for (const auto width : { 1.0f, 7.0f, 300.0f, 20'000.0f })
+    {
+        const Viewport viewport{ 1'234, 43'210, width };
+        const auto expected = ReferenceDecimate(samples, viewport);
+        store.Decimate(single, viewport, points);
+        same &= Same(points, expected);
+        store.Decimate(bulk, viewport, points);
+        same &= Same(points, expected);
+    }
+    REQUIRE( same );
+
+    store.Clear();
+    REQUIRE( store.SeriesCount() == 0 );
+    REQUIRE( store.Size() == 0 );
+}
+
+TEST_CASE( "Late counter samples merge into the tail of a series", "[CounterStore]" ) {
+    std::mt19937 random{ 23 };
+    std::vector<CounterPoint> appended; // in the order they were appended
+    CounterStore store;
+    const auto series = store.Series(1);
+    auto append = [&](const CounterPoint point) {
+        store.Append(series, point.timestamp, point.value);
+        appended.push_back(point);
+    };
+    auto appendBulk = [&](const std::vector<CounterPoint>& points) {
+        store.AppendBulk(series, points);
+        appended.insert(appended.end(), points.begin(), points.end());
+    };
+
+    // Timestamps repeat, so that the order of equal samples shows
+    for (int i = 0; i < 20'000; ++i)
+        append(CounterPoint{ static_cast<Timestamp>(i / 2) * 10, static_cast<double>(random() % 1000) });
+    bool intact = true;
+    std::vector<CounterPoint> points;
+    for (int round = 0; round < 20; ++round)
+    {
+        const auto end = appended.back().timestamp;
+        append(CounterPoint{ end - static_cast<Timestamp>(random() % 5'000), static_cast<double>(random() % 1000) });
+
+        std::vector<CounterPoint> batch;
+        for (int i = 0; i < 300; ++i)
+            batch.push_back(CounterPoint{ end - 2'000 + static_cast<Timestamp>(random() % 4'000), static_cast<double>(random() % 1000) });
+        appendBulk(batch);
+
+        // Later samples go after the stored ones at the same time
+        auto expected = appended;
+        std::ranges::stable_sort(expected, {}, &CounterPoint::timestamp);
+        bool sameSamples = store.Timestamps(series).size() == expected.size();
+        for (std::size_t i = 0; sameSamples && i < expected.size(); ++i)
+            sameSamples = store.Timestamps(series)[i] == expected[i].timestamp && store.Values(series)[i] == expected[i].value;
+        intact &= sameSamples;
+
+        for (const auto width : { 1.0f, 13.0f, 900.0f })
+        {
+            const Viewport viewport{ static_cast<Timestamp>(random() % 50'000), expected.back().timestamp + 1, width };
+            store.Decimate(series, viewport, points);
+            intact &= Same(points, ReferenceDecimate(expected, viewport));
+        }
+    }
+    REQUIRE( intact );
+    REQUIRE( store.Size() == appended.size() );
+}
@@ -0,0 +1,204 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+
+#include "EventStore.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Appended events stay sorted", "[EventStore]" ) {
+    EventStore store;
+    const auto a = store.InternName("a");
+    const auto b = store.InternName("b");
+    REQUIRE( store.InternName("a") == a );
+
+    store.Append({ 10, 5, a, 0, 0 });
+    store.Append({ 30, 5, b, 1, 0 });
+    store.Append({ 20, 1, b, 0, 1 });
+    store.Append({ 10, 2, b, 0, 1 });
+
+    REQUIRE( store.Size() == 4 );
+    const auto ts = store.Timestamps();
+    REQUIRE( ts[0] == 10 );
+    REQUIRE( store[0].depth == 0 );
+    REQUIRE( store[1].depth == 1 );
+    REQUIRE( ts[2] == 20 );
+    REQUIRE( ts[3] == 30 );
+    REQUIRE( store[3].track == 1 );
+    REQUIRE( store.TrackCount() == 2 );
+    REQUIRE( store.MaxDuration() == 5 );
+    REQUIRE( store.LowerBound(15) == 2 );
+}
+
+TEST_CASE( "Bulk append merges out of order batches", "[EventStore]" ) {
+    EventStore store;
+    const auto name = store.InternName("span");
+
+    EventColumns first;
+    for (Timestamp t = 0; t < 100; t += 2)
+        first.PushBack({ t, 1, name, 0, 0 });
+    store.AppendBulk(first);
+
+    EventColumns second;
+    for (Timestamp t = 99; t > 0; t -= 2)
+        second.PushBack({ t, 1, name, 1, 0 });
+    store.AppendBulk(second);
+
+    REQUIRE( store.Size() == 100 );
+    for (std::size_t i = 0; i < store.Size(); ++i)
+    {
+        REQUIRE( store.Timestamps()[i] == static_cast<Timestamp>(i) );
+        REQUIRE( store.Tracks()[i] == i % 2 );
+    }
+}
+
+TEST_CASE( "Sorted batches merge into the overlapping tail, stored events first", "[EventStore]" ) {
+    EventStore store;
+    const auto name = store.InternName("span");
+
+    EventColumns first;
+    for (Timestamp t = 0; t < 100; ++t)
+        first.PushBack({ t, 1, name, 0, 0 });
+    store.AppendBulk(first);
+
+    // Equal events keep their order within the batch
+    EventColumns second;
+    for (Timestamp t = 109; t >= 90; --t)
+        second.PushBack({ t, 1, name, 1, 0 });
+    second.PushBack({ 95, 1, name, 2, 0 });
+    second.Sort();
+    REQUIRE( second.timestamps.front() == 90 );
+    REQUIRE( second.tracks[5] == 1 );
+    REQUIRE( second.tracks[6] == 2 );
+    store.AppendBulk(second);
+
+    REQUIRE( store.Size() == 121 );
+    bool sorted = true;
+    for (std::size_t i = 1; i < store.Size(); ++i)
+        sorted &= store.Timestamps()[i - 1] <= store.Timestamps()[i];
+    REQUIRE( sorted );
+    REQUIRE( store.LowerBound(95) == 100 );
+    REQUIRE( store.Tracks()[100] == 0 );
+    REQUIRE( store.Tracks()[101] == 1 );
+    REQUIRE( store.Tracks()[102] == 2 );
+}
+
+TEST_CASE( "Track names are optional", "[EventStore]" ) {
+    EventStore store;
+    store.SetTrackName(2, "render");
+
+    REQUIRE( store.TrackCount() == 3 );
+    REQUIRE( store.TrackName(2) == "render" );
+    REQUIRE( store.TrackName(0).empty() );
+    REQUIRE( store.TrackName(7).empty() );
+}
+
+TEST_CASE( "Only the blocks of spans reaching a time are scanned back", "[EventStore]" ) {
+    EventStore store;
+    const auto name = store.InternName("span");
+
+    EventColumns batch;
+    for (Timestamp t = 1; t < 10000; ++t)
+        batch.PushBack({ t * 10, 5, name, 0, 1 });
+    store.AppendBulk(batch);
+    store.Append({ 0, 1'000'000, name, 0, 0 });   // moves every event by one
+    store.Append({ 50'000, 20'000, name, 1, 0 });
+
+    auto reaching = [&](const Timestamp time)
+    {
+        std::vector<std::size_t> found;
+        std::size_t scanned = 0;
+        store.ForEachRunReaching(time, store.LowerBound(time), [&](const std::size_t begin, const std::size_t end)
+            {
+                scanned += end - begin;
+                for (auto i = begin; i < end; ++i)
+                {
+                    if (store.Timestamps()[i] + store.Durations()[i] >= time)
+                        found.push_back(i);
+                }
+            });
+        REQUIRE( scanned <= 3 * EventStore::ReachBlockSize );
+        return found;
+    };
+
+    auto found = reaching(60'003);
+    REQUIRE( found.size() == 3 );
+    REQUIRE( found[0] == 0 );
+    REQUIRE( store.Timestamps()[found[1]] == 50'000 );
+    REQUIRE( store.Timestamps()[found[2]] == 60'000 );
+
+    found = reaching(90'002);
+    REQUIRE( found.size() == 2 );
+    REQUIRE( found[0] == 0 );
+    REQUIRE( store.Timestamps()[found[1]] == 90'000 );
+    REQUIRE( reaching(2'000'000).empty() );
+}
+
+TEST_CASE( "Cold blocks read like the uncompressed columns", "[EventStore]" ) {
+    EventStore plain;
+    EventStore packed;
+    packed.SetHotEvents(1000);
+
+    std::mt19937 random{ 31 };
+    auto append = [&](const EventColumns& batch)
+    {
+        plain.AppendBulk(batch);
+        packed.AppendBulk(batch);
+    };
+    auto same = [&]
+    {
+        bool equal = plain.Size() == packed.Size();
+        for (std::size_t i = 0; equal && i < plain.Size(); ++i)
+        {
+            const auto a = plain[i];
+            const auto b = packed[i];
+            equal = a.timestamp == b.timestamp && a.duration == b.duration && a.name == b.name && a.track == b.track
+                && a.depth == b.depth && a.argOffset == b.argOffset && a.argCount == b.argCount
+                && plain.Durations()[i] == packed.Durations()[i] && plain.Depths()[i] == packed.Depths()[i];
+        }
+        for (Timestamp t = -10; equal && t < 2'100'000; t += 997)
+            equal = plain.LowerBound(t) == packed.LowerBound(t);
+
+        // Runs across the cold and hot events
+        auto index = std::size_t{ 3000 };
+        packed.ForEachPart(index, packed.Size() - 5, [&](const EventSpans& columns, const std::size_t first, const std::size_t last)
+            {
+                for (auto i = first; i < last; ++i, ++index)
+                    equal = equal && columns.timestamps[i] == plain.Timestamps()[index] && columns.durations[i] == plain.Durations()[index]
+                        && columns.names[i] == plain.NameIds()[index] && columns.tracks[i] == plain.Tracks()[index]
+                        && columns.depths[i] == plain.Depths()[index];
+            });
+        return equal && index == packed.Size() - 5;
+    };
+
+    // In order, then batches and single events reaching back among the cold events
+    for (int chunk = 0; chunk < 10; ++chunk)
+    {
+        EventColumns batch;
+        for (int i = 0; i < 5000; ++i)
+            batch.PushBack({ chunk * 200'000 + i * 40 + static_cast<Timestamp>(random() % 30), static_cast<Duration>(random() % 100'000),
+                             static_cast<NameId>(random() % 50), static_cast<TrackId>(random() % 8), static_cast<Depth>(random() % 4),
+                             static_cast<ArgumentOffset>(i), static_cast<std::uint16_t>(i % 3) });
+        batch.Sort();
+        append(batch);
+    }
+    REQUIRE( packed.ColdSize() > 0 );
+    REQUIRE( packed.MemoryBytes() * 3 < plain.MemoryBytes() );
+    REQUIRE( same() );
+
+    EventColumns late;
+    for (int i = 0; i < 100; ++i)
+        late.PushBack({ 1'500'000 + i * 7, 5, 1, 2, 0 });
+    append(late);
+    plain.Append({ 300'001, 9, 3, 1, 1 });
+    packed.Append({ 300'001, 9, 3, 1, 1 });
+    REQUIRE( same() );
+
+    packed.SetHotEvents(0);
+    REQUIRE( packed.ColdSize() == packed.Size() / ColdBlocks::BlockEvents * ColdBlocks::BlockEvents );
+    REQUIRE( same() );
+
+    packed.SetHotEvents(EventStore::AllHot);
+    REQUIRE( packed.ColdSize() == 0 );
+    REQUIRE( same() );
+}
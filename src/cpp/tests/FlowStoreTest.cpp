@@ -0,0 +1,156 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm> // std::max, std::ranges::equal
+#include <random>
+#include <span>
+#include <vector>
+
+#include "FlowStore.hpp"
+#include "Trace.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Flow points bind to the spans enclosing them", "[FlowStore]" ) {
+    Trace trace;
+    const auto name = trace.InternName("span");
+    trace.Append(Event{ 0, 100, name, 0, 0 });  // 0: request
+    trace.Append(Event{ 10, 20, name, 0, 1 });  // 1: nested in the request, sends
+    trace.Append(Event{ 40, 50, name, 1, 0 });  // 2: worker
+    trace.Append(Event{ 95, 105, name, 2, 0 }); // 3: reply
+
+    const std::vector<FlowPoint> points{
+        FlowPoint{ 1, 20, 0, FlowPhase::Start },
+        FlowPoint{ 1, 50, 1, FlowPhase::End },
+        FlowPoint{ 2, 80, 1, FlowPhase::Start },
+        FlowPoint{ 2, 92, 2, FlowPhase::End, true }, // binds to the next span
+        FlowPoint{ 3, 500, 0, FlowPhase::Start },    // outside any span
+    };
+    trace.AppendFlows(points);
+
+    const auto& flows = trace.Flows();
+    REQUIRE( flows.PointCount() == 5 );
+    REQUIRE( flows.EdgeCount() == 2 );
+    REQUIRE( flows.UnboundPoints() == 1 );
+    REQUIRE( flows.Outgoing(0).empty() );
+    REQUIRE( flows.Outgoing(1).size() == 1 );
+    REQUIRE( flows.Outgoing(1)[0].to == 2 );
+    REQUIRE( flows.Outgoing(1)[0].departure == 20 );
+    REQUIRE( flows.Outgoing(1)[0].arrival == 50 );
+    REQUIRE( flows.Incoming(2).size() == 1 );
+    REQUIRE( flows.Incoming(3).size() == 1 );
+    REQUIRE( flows.Incoming(3)[0].from == 2 );
+
+    // The request starts at the span, passes its nested sender and the worker and ends with the reply
+    std::vector<FlowStore::EventIndex> path;
+    flows.CriticalPath(trace.Events(), trace.Intervals(), 0, path);
+    REQUIRE( path == std::vector<FlowStore::EventIndex>{ 0, 1, 2, 3 } );
+    flows.CriticalPath(trace.Events(), trace.Intervals(), 2, path);
+    REQUIRE( path == std::vector<FlowStore::EventIndex>{ 0, 1, 2, 3 } );
+
+    // Appending events rebinds the points
+    trace.Append(Event{ 450, 100, name, 0, 0 });
+    REQUIRE( trace.Flows().UnboundPoints() == 0 );
+    REQUIRE( trace.Flows().EdgeCount() == 2 );
+}
+
+TEST_CASE( "Critical paths follow long chains across tracks", "[FlowStore]" ) {
+    constexpr std::uint32_t Hops = 2000;
+    constexpr TrackId Tracks = 8;
+    Trace trace;
+    const auto name = trace.InternName("hop");
+    std::vector<FlowPoint> points;
+    for (std::uint32_t i = 0; i < Hops; ++i)
+    {
+        const auto start = static_cast<Timestamp>(i) * 10;
+        trace.Append(Event{ start, 15, name, i % Tracks, 0 });
+        if (i + 1 < Hops)
+        {
+            points.push_back(FlowPoint{ i, start + 5, i % Tracks, FlowPhase::Start });
+            points.push_back(FlowPoint{ i, start + 11, (i + 1) % Tracks, FlowPhase::End });
+        }
+    }
+    trace.AppendFlows(points);
+
+    // Spans before the selected one that led to it are part of the path
+    std::vector<FlowStore::EventIndex> path;
+    trace.Flows().CriticalPath(trace.Events(), trace.Intervals(), Hops / 2, path);
+    bool chain = path.size() == Hops;
+    for (std::uint32_t i = 0; chain && i < Hops; ++i)
+        chain = path[i] == i;
+    REQUIRE( chain );
+    REQUIRE( trace.Flows().EdgeCount() == Hops - 1 );
+
+    // A branch that ends last is the critical path
+    trace.Append(Event{ 1'000'000, 1, name, Tracks, 0 });
+    const std::vector<FlowPoint> branch{ FlowPoint{ Hops, 7, 0, FlowPhase::Start }, FlowPoint{ Hops, 1'000'000, Tracks, FlowPhase::End } };
+    trace.AppendFlows(branch);
+    trace.Flows().CriticalPath(trace.Events(), trace.Intervals(), 0, path);
+    REQUIRE( path == std::vector<FlowStore::EventIndex>{ 0, Hops } );
+
+    trace.Clear();
+    REQUIRE( trace.Flows().PointCount() == 0 );
+    REQUIRE( trace.Flows().EdgeCount() == 0 );
+}
+
+TEST_CASE( "Updated flows match a fresh build as events and points arrive", "[FlowStore]" ) {
+    std::mt19937 random{ 9 };
+    std::uniform_int_distribution<Duration> length{ 1, 300 };
+    std::uniform_int_distribution<int> track{ 0, 3 };
+    std::uniform_int_distribution<int> coin{ 0, 3 };
+    std::uniform_int_distribution<std::uint64_t> chain{ 0, 40 };
+
+    Trace trace;
+    const auto name = trace.InternName("span");
+    Timestamp now = 0;
+    std::vector<FlowPoint> all;
+    auto sameEdges = [](std::span<const FlowEdge> a, std::span<const FlowEdge> b)
+        {
+            return std::ranges::equal(a, b, [](const FlowEdge& x, const FlowEdge& y)
+                {
+                    return x.from == y.from && x.to == y.to && x.departure == y.departure && x.arrival == y.arrival;
+                });
+        };
+
+    bool same = true;
+    for (int round = 0; round < 30; ++round)
+    {
+        // Points may precede their spans, batches sometimes reach back into the stored events
+        const auto from = coin(random) == 0 ? now / 2 : now;
+        std::uniform_int_distribution<Timestamp> start{ from, from + 1000 };
+        EventColumns batch;
+        for (int i = 0; i < 50; ++i)
+            batch.PushBack(Event{ start(random), length(random), name, static_cast<TrackId>(track(random)), 0 });
+        std::vector<FlowPoint> points;
+        for (int i = 0; i < 20; ++i)
+        {
+            const auto phase = static_cast<FlowPhase>(coin(random) % 3);
+            points.push_back(FlowPoint{ chain(random), start(random) + 500, static_cast<TrackId>(track(random)), phase, coin(random) == 0 });
+        }
+        now = std::max(now, from + 1000);
+        all.insert(all.end(), points.begin(), points.end());
+
+        if (round % 2 == 0)
+            trace.AppendFlows(points);
+        trace.AppendBulk(batch);
+        if (round % 2 == 1)
+            trace.AppendFlows(points);
+        if (round % 3 == 2)
+            continue; // several changes between updates
+
+        const auto& updated = trace.Flows();
+        IntervalIndex intervals;
+        intervals.Build(trace.Events());
+        FlowStore fresh;
+        fresh.Append(all);
+        fresh.Build(trace.Events(), intervals);
+
+        same = same && updated.EdgeCount() == fresh.EdgeCount() && updated.UnboundPoints() == fresh.UnboundPoints();
+        for (std::size_t i = 0; i < trace.Events().Size(); ++i)
+        {
+            const auto event = static_cast<FlowStore::EventIndex>(i);
+            same = same && sameEdges(updated.Outgoing(event), fresh.Outgoing(event)) && sameEdges(updated.Incoming(event), fresh.Incoming(event));
+        }
+    }
+    REQUIRE( same );
+    REQUIRE( trace.Flows().EdgeCount() > 0 );
+}
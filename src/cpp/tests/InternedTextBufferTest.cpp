@@ -0,0 +1,52 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include "InternedTextBuffer.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Repeated strings share one ID", "[InternedTextBuffer]" ) {
+    InternedTextBuffer<64> buffer;
+
+    const auto foo = buffer.Intern("foo");
+    const auto bar = buffer.Intern("bar");
+
+    REQUIRE( foo != bar );
+    REQUIRE( buffer.Intern(std::string("foo")) == foo );
+    REQUIRE( buffer.Intern("bar") == bar );
+    REQUIRE( buffer.Size() == 2 );
+    REQUIRE( buffer.View(foo) == "foo" );
+    REQUIRE( buffer.View(bar) == "bar" );
+}
+
+TEST_CASE( "Views and IDs survive growth", "[InternedTextBuffer]" ) {
+    InternedTextBuffer<32> buffer;
+
+    const auto first = buffer.Intern("first");
+    const auto firstView = buffer.View(first);
+
+    for (int i = 0; i < 10'000; ++i)
+        REQUIRE( buffer.Intern("name_" + std::to_string(i)) == static_cast<InternedTextBuffer<32>::Id>(i + 1) );
+
+    REQUIRE( buffer.View(first).data() == firstView.data() );
+    REQUIRE( buffer.Intern("first") == first );
+    for (int i = 0; i < 10'000; i += 997)
+        REQUIRE( buffer.View(i + 1) == "name_" + std::to_string(i) );
+}
+
+TEST_CASE( "Find does not insert", "[InternedTextBuffer]" ) {
+    InternedTextBuffer<64> buffer;
+
+    REQUIRE( !buffer.Find("missing").has_value() );
+
+    const auto empty = buffer.Intern("");
+    REQUIRE( buffer.Find("") == empty );
+    REQUIRE( buffer.View(empty).empty() );
+    REQUIRE( !buffer.Find("missing").has_value() );
+    REQUIRE( buffer.Size() == 1 );
+
+    buffer.Clear();
+    REQUIRE( buffer.Size() == 0 );
+    REQUIRE( !buffer.Find("").has_value() );
+}
@@ -0,0 +1,119 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm> // std::max, std::ranges::equal
+#include <random>
+#include <vector>
+
+#include "IntervalIndex.hpp"
+#include "Trace.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Overlap queries match a linear scan", "[IntervalIndex]" ) {
+    std::mt19937 random{ 11 };
+    std::uniform_int_distribution<Timestamp> start{ 0, 100'000 };
+    std::uniform_int_distribution<Duration> shortLength{ 0, 100 };
+    std::uniform_int_distribution<Duration> longLength{ 0, 20'000 };
+    std::uniform_int_distribution<int> coin{ 0, 9 };
+
+    EventStore store;
+    const auto name = store.InternName("span");
+    EventColumns batch;
+    for (int i = 0; i < 5000; ++i)
+        batch.PushBack(Event{ start(random), coin(random) == 0 ? longLength(random) : shortLength(random), name, static_cast<TrackId>(i % 3), 0 });
+    store.AppendBulk(batch);
+
+    IntervalIndex index;
+    index.Build(store);
+    REQUIRE( index.TrackCount() == 3 );
+
+    for (int query = 0; query < 500; ++query)
+    {
+        const TrackId track = query % 3;
+        const auto first = start(random);
+        const auto last = first + shortLength(random) * (coin(random) == 0 ? 100 : 1);
+
+        std::vector<IntervalIndex::EventIndex> expected;
+        for (std::size_t i = 0; i < store.Size(); ++i)
+        {
+            if (store[i].track == track && store[i].timestamp <= last && store[i].timestamp + store[i].duration >= first)
+                expected.push_back(static_cast<IntervalIndex::EventIndex>(i));
+        }
+
+        std::vector<IntervalIndex::EventIndex> found;
+        index.ForEachOverlap(track, first, last, [&](const IntervalIndex::EventIndex i) { found.push_back(i); });
+        REQUIRE( found == expected );
+    }
+}
+
+TEST_CASE( "Stabbing and hit tests find nested spans", "[IntervalIndex]" ) {
+    Trace trace;
+    const auto name = trace.InternName("span");
+    trace.Append(Event{ 0, 100, name, 0, 0 });
+    trace.Append(Event{ 10, 20, name, 0, 1 });
+    trace.Append(Event{ 50, 0, name, 0, 1 });
+    trace.Append(Event{ 60, 10, name, 0, 1 });
+    trace.Append(Event{ 5, 100, name, 1, 0 });
+
+    std::vector<IntervalIndex::EventIndex> found;
+    trace.Intervals().ForEachStabbing(0, 50, [&](const IntervalIndex::EventIndex i) { found.push_back(i); });
+    REQUIRE( found.size() == 2 );
+    REQUIRE( trace.Events()[found[0]].timestamp == 0 );
+    REQUIRE( trace.Events()[found[1]].timestamp == 50 );
+
+    const auto& events = trace.Events();
+    const auto hit = trace.Intervals().HitTest(events, 0, 1, 15, 0);
+    REQUIRE( hit.has_value() );
+    REQUIRE( events[*hit].timestamp == 10 );
+    REQUIRE( !trace.Intervals().HitTest(events, 0, 1, 40, 5).has_value() );
+    REQUIRE( events[*trace.Intervals().HitTest(events, 0, 1, 57, 5)].timestamp == 60 );
+
+    // Appending invalidates the index
+    trace.Append(Event{ 40, 1, name, 0, 1 });
+    REQUIRE( events[*trace.Intervals().HitTest(events, 0, 1, 40, 5)].timestamp == 40 );
+}
+
+TEST_CASE( "Updates after appends match a fresh build", "[IntervalIndex]" ) {
+    std::mt19937 random{ 5 };
+    std::uniform_int_distribution<Duration> length{ 0, 500 };
+    std::uniform_int_distribution<int> track{ 0, 7 };
+    std::uniform_int_distribution<int> coin{ 0, 3 };
+
+    Trace trace;
+    const auto name = trace.InternName("span");
+    Timestamp now = 0;
+    bool same = true;
+    for (int round = 0; round < 40; ++round)
+    {
+        // Mostly appended tails, sometimes a batch reaching back into the stored events
+        EventColumns batch;
+        const auto from = coin(random) == 0 ? now / 2 : now;
+        std::uniform_int_distribution<Timestamp> start{ from, from + 2000 };
+        for (int i = 0; i < 200; ++i)
+            batch.PushBack(Event{ start(random), length(random), name, static_cast<TrackId>(track(random) + round / 10), 0 });
+        now = std::max(now, from + 2000);
+        if (round % 5 == 4)
+            trace.Append(batch[0]);
+        else
+            trace.AppendBulk(batch);
+
+        const auto& updated = trace.Intervals();
+        IntervalIndex fresh;
+        fresh.Build(trace.Events());
+        same = same && updated.TrackCount() == fresh.TrackCount();
+        for (TrackId t = 0; t < fresh.TrackCount(); ++t)
+        {
+            const auto a = updated.TrackEvents(t);
+            const auto b = fresh.TrackEvents(t);
+            same = same && std::ranges::equal(a, b);
+
+            const auto first = start(random);
+            std::vector<IntervalIndex::EventIndex> expected;
+            std::vector<IntervalIndex::EventIndex> found;
+            fresh.ForEachOverlap(t, first, first + 300, [&](const IntervalIndex::EventIndex i) { expected.push_back(i); });
+            updated.ForEachOverlap(t, first, first + 300, [&](const IntervalIndex::EventIndex i) { found.push_back(i); });
+            same = same && found == expected;
+        }
+    }
+    REQUIRE( same );
+}
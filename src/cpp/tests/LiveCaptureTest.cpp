@@ -0,0 +1,152 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LiveCapture.hpp"
+#include "LiveProtocol.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+using namespace tagliatelle;
+
+TEST_CASE( "Live messages decode across partial buffers", "[LiveProtocol]" ) {
+    std::string stream;
+    LiveEncodeHandshake(stream);
+    LiveEncodeText(stream, LiveMessageType::Name, 3, "frame");
+    LiveEncodeEvent(stream, -5, 20, 3, 1, 2);
+    REQUIRE( LiveCheckHandshake(stream) );
+
+    const auto messages = std::string_view{ stream }.substr(LiveHandshakeSize);
+    LiveMessage message;
+    std::size_t consumed = 0;
+    REQUIRE( LiveDecode(messages.substr(0, 10), message, consumed) == LiveDecodeResult::NeedMore );
+    REQUIRE( LiveDecode(messages, message, consumed) == LiveDecodeResult::Ok );
+    REQUIRE( message.type == LiveMessageType::Name );
+    REQUIRE( message.id == 3 );
+    REQUIRE( message.text == "frame" );
+
+    const auto event = messages.substr(consumed);
+    REQUIRE( LiveDecode(event.substr(0, event.size() - 1), message, consumed) == LiveDecodeResult::NeedMore );
+    REQUIRE( LiveDecode(event, message, consumed) == LiveDecodeResult::Ok );
+    REQUIRE( consumed == event.size() );
+    REQUIRE( message.timestamp == -5 );
+    REQUIRE( message.duration == 20 );
+    REQUIRE( message.track == 1 );
+    REQUIRE( message.depth == 2 );
+
+    REQUIRE( LiveDecode("\x7F", message, consumed) == LiveDecodeResult::Invalid );
+}
+
+TEST_CASE( "Recorded live streams are imported like traces", "[LiveProtocol]" ) {
+    std::string stream;
+    LiveEncodeHandshake(stream);
+    LiveEncodeText(stream, LiveMessageType::Name, 2, "frame");
+    LiveEncodeText(stream, LiveMessageType::TrackName, 5, "render");
+    LiveEncodeEvent(stream, 100, 20, 2, 5, 0);
+    LiveEncodeEvent(stream, 110, 5, 2, 5, 1);
+    LiveEncodeEvent(stream, 120, 5, 3, 5, 1); // undefined name
+    LiveEncodeEvent(stream, 130, 5, 2, 5, 1);
+    stream.pop_back();                           // truncated
+
+    REQUIRE( IsLiveStream(stream) );
+    ParsedChunk chunk;
+    ImportLiveStream(stream, chunk);
+    REQUIRE( chunk.columns.Size() == 2 );
+    REQUIRE( chunk.malformedRecords == 2 );
+    REQUIRE( chunk.names.View(chunk.columns.names[1]) == "frame" );
+    REQUIRE( chunk.columns.tracks[1] == 5 );
+    REQUIRE( chunk.columns.depths[1] == 1 );
+    REQUIRE( chunk.trackNames.size() == 1 );
+    REQUIRE( chunk.names.View(chunk.trackNames[0].second) == "render" );
+
+    // Every chunk interns the names it refers to
+    std::vector<ParsedChunk> chunks;
+    ImportLiveStream(stream, 1, [&](ParsedChunk&& part) { chunks.push_back(std::move(part)); return true; });
+    REQUIRE( chunks.size() == 3 );
+    REQUIRE( chunks[1].columns.Size() == 1 );
+    REQUIRE( chunks[1].names.View(chunks[1].columns.names[0]) == "frame" );
+    REQUIRE( chunks[0].trackNames.size() == 1 );
+
+    REQUIRE( !IsLiveStream("TGLT") );
+    REQUIRE_THROWS( ImportLiveStream("{}", chunk) );
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+TEST_CASE( "Events streamed over a socket are committed to the trace", "[LiveCapture]" ) {
+    const auto path = std::filesystem::temp_directory_path() / "tagliatelle_live_test.sock";
+
+    Trace trace;
+    std::shared_mutex mutex;
+    LiveCapture capture{ trace, mutex };
+    capture.Start(path);
+
+    auto connect = [&]
+        {
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            path.native().copy(address.sun_path, path.native().size());
+            REQUIRE( ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 );
+            return fd;
+        };
+
+    // Two producers with overlapping local IDs
+    for (int producer = 0; producer < 2; ++producer)
+    {
+        std::string stream;
+        LiveEncodeHandshake(stream);
+        LiveEncodeText(stream, LiveMessageType::Name, 0, producer == 0 ? "render" : "upload");
+        LiveEncodeText(stream, LiveMessageType::TrackName, 0, "thread " + std::to_string(producer));
+        if (producer == 1)
+        {
+            // Renames past the cap are rejected, the track keeps its last accepted name
+            for (std::uint32_t i = 0; i < LiveCapture::MaxTrackNames; ++i)
+                LiveEncodeText(stream, LiveMessageType::TrackName, 0, "thread 1");
+        }
+        for (int i = 0; i < 1000; ++i)
+            LiveEncodeEvent(stream, i * 100 + producer, 50, 0, 0, 0);
+        LiveEncodeEvent(stream, 0, 1, 7, 0, 0); // undefined name
+
+        const int fd = connect();
+        REQUIRE( ::send(fd, stream.data(), stream.size(), 0) == static_cast<ssize_t>(stream.size()) );
+        ::close(fd);
+    }
+
+    // Closed connections are drained and removed by the consumer
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (capture.Stats().eventsCommitted < 2000 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    capture.Stop();
+
+    const auto stats = capture.Stats();
+    REQUIRE( stats.eventsReceived == 2002 );
+    REQUIRE( stats.eventsCommitted + stats.eventsDropped == 2000 );
+    REQUIRE( stats.eventsCommitted == 2000 );
+    REQUIRE( stats.malformedMessages == 3 );
+    REQUIRE( stats.connections == 0 );
+    // Closed connections hand their text pages back for the next ones
+    REQUIRE( stats.textPages.inUse == 0 );
+    REQUIRE( stats.textPages.free > 0 );
+
+    const auto& events = trace.Events();
+    REQUIRE( events.Size() == 2000 );
+    REQUIRE( events.TrackCount() == 2 );
+    for (std::size_t i = 0; i < events.Size(); ++i)
+    {
+        const auto expected = events.TrackName(events.Tracks()[i]) == "thread 0" ? "render" : "upload";
+        REQUIRE( events.Name(events.NameIds()[i]) == expected );
+    }
+    REQUIRE( !std::filesystem::exists(path) );
+}
+
+#endif
@@ -0,0 +1,76 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include "LodPyramid.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    std::vector<LodRecord> Query(const LodPyramid& lod, const Viewport& viewport)
+    {
+        std::vector<LodRecord> records;
+        REQUIRE( lod.ForEachVisible(viewport, [&](const LodRecord& r) { records.push_back(r); }) );
+        return records;
+    }
+}
+
+TEST_CASE( "Sub-pixel spans are merged per pixel", "[LodPyramid]" ) {
+    LodPyramid lod;
+    constexpr Timestamp Second = 1'000'000'000;
+
+    // 100k spans of 100ns, one every 10us
+    for (Timestamp t = 0; t < Second; t += 10'000)
+        lod.Add({ t, 100, static_cast<NameId>(t % 3), 0, 0 });
+    // One long span that must stay individual
+    lod.Add({ Second / 2, Second / 4, 7, 0, 1 });
+
+    const auto records = Query(lod, { 0, Second, 1000.0f });
+    REQUIRE( records.size() <= 2 * 1000 + 1 );
+
+    std::uint64_t total = 0;
+    bool foundLong = false;
+    for (const auto& r : records)
+    {
+        total += r.count;
+        if (r.depth == 1)
+        {
+            foundLong = true;
+            REQUIRE( r.count == 1 );
+            REQUIRE( r.label == 7 );
+            REQUIRE( r.x == 500.0f );
+            REQUIRE( r.width == 250.0f );
+        }
+    }
+    REQUIRE( foundLong );
+    REQUIRE( total == 100'001 );
+}
+
+TEST_CASE( "Windowed queries only see overlapping records", "[LodPyramid]" ) {
+    LodPyramid lod;
+    for (Timestamp t = 0; t < 1'000'000; t += 1'000)
+        lod.Add({ t, 10, 0, 2, 0 });
+
+    const auto records = Query(lod, { 500'000, 600'000, 10.0f });
+    std::uint64_t total = 0;
+    for (const auto& r : records)
+    {
+        REQUIRE( r.track == 2 );
+        REQUIRE( r.x >= 0.0f );
+        REQUIRE( r.x + r.width <= 10.0f );
+        total += r.count;
+    }
+    // Edge buckets may include a few spans just outside the window
+    REQUIRE( total >= 100 );
+    REQUIRE( total <= 100 + 2 * 10'000 / 1'000 );
+}
+
+TEST_CASE( "Fine viewports fall back to raw events", "[LodPyramid]" ) {
+    LodPyramid lod;
+    lod.Add({ 0, 10, 0, 0, 0 });
+
+    REQUIRE( LodPyramid::LevelFor({ 0, 1000, 1000.0f }) == -1 );
+    REQUIRE( LodPyramid::LevelFor({ 0, 2048 * 1000, 1000.0f }) == 1 );
+    REQUIRE( !lod.ForEachVisible(Viewport{ 0, 1000, 1000.0f }, [](const LodRecord&) {}) );
+}
@@ -0,0 +1,168 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventStore.hpp"
+#include "MemoryBudget.hpp"
+#include "Trace.hpp"
+
+#ifdef __linux__
+    #include <fstream>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+using namespace tagliatelle;
+
+namespace
+{
+    constexpr std::uint64_t MiB = 1024 * 1024;
+
+    // Scratch files go next to the test binary, temporary directories are often in RAM
+    std::filesystem::path ScratchDirectory()
+    {
+        return std::filesystem::current_path();
+    }
+
+#ifdef __linux__
+    double ResidentFraction(const void* data, const std::size_t bytes)
+    {
+        const auto page = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+        const auto begin = reinterpret_cast<std::uintptr_t>(data) / page * page;
+        const auto end = reinterpret_cast<std::uintptr_t>(data) + bytes;
+        std::vector<unsigned char> pages((end - begin + page - 1) / page);
+        REQUIRE( ::mincore(reinterpret_cast<void*>(begin), end - begin, pages.data()) == 0 );
+        std::size_t resident = 0;
+        for (const auto flags : pages)
+            resident += flags & 1;
+        return static_cast<double>(resident) / static_cast<double>(pages.size());
+    }
+
+    std::size_t MappingCount()
+    {
+        std::ifstream maps{ "/proc/self/maps" };
+        std::size_t count = 0;
+        for (std::string line; std::getline(maps, line);)
+            ++count;
+        return count;
+    }
+#endif
+}
+
+TEST_CASE( "Spilled storage keeps its contents", "[MemoryBudget]" ) {
+    if (!MemoryBudget::Supported())
+        return;
+
+    MemoryBudget budget{ 2 * MiB, ScratchDirectory() };
+    {
+        std::vector<std::uint64_t, BudgetAllocator<std::uint64_t>> values{ BudgetAllocator<std::uint64_t>{ &budget } };
+        for (std::uint64_t i = 0; i < 4'000'000; ++i)
+            values.push_back(i * i);
+        std::vector<int, BudgetAllocator<int>> small(16, 7, BudgetAllocator<int>{ &budget });
+
+        budget.Enforce();
+        const auto stats = budget.Stats();
+        REQUIRE( stats.budget == 2 * MiB );
+        REQUIRE( stats.total >= values.size() * sizeof(std::uint64_t) + small.size() * sizeof(int) );
+        REQUIRE( stats.resident <= stats.total );
+        REQUIRE( stats.evicted > 0 );
+
+        bool intact = true;
+        for (std::uint64_t i = 0; i < values.size(); ++i)
+            intact &= values[i] == i * i;
+        REQUIRE( intact );
+        REQUIRE( small[15] == 7 );
+    }
+    REQUIRE( budget.Stats().total == 0 );
+}
+
+TEST_CASE( "Viewed time ranges are evicted last", "[MemoryBudget]" ) {
+    if (!MemoryBudget::Supported())
+        return;
+
+    MemoryBudget budget{ 8 * MiB, ScratchDirectory() };
+    {
+        EventStore store{ &budget };
+        EventColumns batch;
+        for (std::uint32_t i = 0; i < 2'000'000; ++i)
+            batch.PushBack(Event{ static_cast<Timestamp>(i) * 100, 50, store.InternName("name " + std::to_string(i % 1000)), i % 4, 0 });
+        store.AppendBulk(batch);
+
+        // The last viewed range is kept, everything else goes over the budget
+        const auto first = store.LowerBound(1'000'000);
+        const auto last = store.LowerBound(11'000'000);
+        store.Touch(1'000'000, 11'000'000);
+        // The touched range is read in asynchronously, rescan once it has arrived
+        std::this_thread::sleep_for(2 * MemoryBudget::ScanInterval);
+        budget.Enforce();
+        const auto stats = budget.Stats();
+        REQUIRE( stats.total > 40 * MiB );
+        REQUIRE( stats.evicted > 0 );
+#ifdef __linux__
+        REQUIRE( stats.resident <= stats.budget );
+        REQUIRE( ResidentFraction(store.Timestamps().Hot().data() + first, (last - first) * sizeof(Timestamp)) > 0.9 );
+        REQUIRE( ResidentFraction(store.Timestamps().Hot().data() + store.Size() / 2, MiB) < 0.1 );
+#endif
+
+        // Evicted events read back unchanged
+        bool intact = true;
+        for (std::size_t i = 0; i < store.Size(); ++i)
+            intact &= store.Timestamps()[i] == static_cast<Timestamp>(i) * 100 && store.Name(store.NameIds()[i]) == "name " + std::to_string(i % 1000);
+        REQUIRE( intact );
+    }
+    REQUIRE( budget.Stats().total == 0 );
+}
+
+TEST_CASE( "Pages share mappings, arguments and reported indices count", "[MemoryBudget]" ) {
+    if (!MemoryBudget::Supported())
+        return;
+
+    MemoryBudget budget{ 64 * MiB, ScratchDirectory() };
+    {
+#ifdef __linux__
+        const auto before = MappingCount();
+#endif
+        std::vector<void*> pages;
+        for (int i = 0; i < 1000; ++i)
+        {
+            pages.push_back(budget.Allocate(MemoryBudget::MinSpillBytes));
+            static_cast<char*>(pages.back())[MemoryBudget::MinSpillBytes - 1] = static_cast<char>(i);
+        }
+#ifdef __linux__
+        REQUIRE( MappingCount() - before < 100 );
+#endif
+        bool intact = true;
+        for (int i = 0; i < 1000; ++i)
+            intact &= static_cast<char*>(pages[i])[MemoryBudget::MinSpillBytes - 1] == static_cast<char>(i);
+        REQUIRE( intact );
+        for (auto* page : pages)
+            budget.Deallocate(page, MemoryBudget::MinSpillBytes);
+        REQUIRE( budget.Stats().total == 0 );
+
+        Trace trace{ &budget };
+        const auto name = trace.InternName("span");
+        Argument argument;
+        argument.key = name;
+        EventColumns batch;
+        for (std::uint32_t i = 0; i < 100'000; ++i)
+        {
+            auto event = Event{ static_cast<Timestamp>(i) * 10, 5, name, i % 16, 0 };
+            event.argOffset = trace.StoreArguments(std::span{ &argument, 1 });
+            event.argCount = 1;
+            batch.PushBack(event);
+        }
+        trace.AppendBulk(batch);
+        static_cast<void>(trace.Intervals());
+
+        const auto stats = budget.Stats();
+        REQUIRE( stats.total >= trace.Events().MemoryBytes() + stats.reported );
+        REQUIRE( stats.reported >= trace.Intervals().MemoryBytes() );
+    }
+    REQUIRE( budget.Stats().total == 0 );
+    REQUIRE( budget.Stats().reported == 0 );
+}
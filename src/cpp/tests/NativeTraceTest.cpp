@@ -0,0 +1,225 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "NativeTrace.hpp"
+#include "Trace.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    void FillStore(EventStore& store, const std::size_t count)
+    {
+        std::mt19937 random{ 7 };
+        std::uniform_int_distribution<Timestamp> gap{ 0, 5000 };
+        std::uniform_int_distribution<Duration> length{ 0, 1'000'000 };
+
+        for (int n = 0; n < 50; ++n)
+            (void)store.InternName("name_" + std::to_string(n));
+        store.SetTrackName(0, "main");
+        store.SetTrackName(2, "worker");
+
+        EventColumns batch;
+        Timestamp time = 1'000'000'000'000;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            time += gap(random);
+            batch.PushBack(Event{ time, length(random), static_cast<NameId>(i % 50), static_cast<TrackId>(i % 3), static_cast<Depth>(i % 5) });
+        }
+        store.AppendBulk(batch);
+    }
+
+    std::string Serialize(const EventStore& store)
+    {
+        std::ostringstream out;
+        WriteNativeTrace(store, out);
+        return std::move(out).str();
+    }
+}
+
+TEST_CASE( "Native traces round-trip through a chunk", "[NativeTrace]" ) {
+    EventStore store;
+    FillStore(store, 20'000);
+    const auto data = Serialize(store);
+
+    REQUIRE( IsNativeTrace(data) );
+    // Delta encoded timestamps and small IDs take a few bytes per event
+    REQUIRE( data.size() < store.Size() * 10 );
+
+    ParsedChunk chunk;
+    ImportNativeTrace(data, chunk);
+    REQUIRE( chunk.columns.Size() == store.Size() );
+    REQUIRE( chunk.names.Size() == store.Names().Size() );
+    REQUIRE( chunk.trackNames.size() == 2 );
+    REQUIRE( chunk.names.View(chunk.trackNames[1].second) == "worker" );
+
+    EventStore loaded;
+    loaded.AppendBulk(chunk.columns);
+    for (std::size_t i = 0; i < store.Size(); ++i)
+    {
+        REQUIRE( loaded[i].timestamp == store[i].timestamp );
+        REQUIRE( loaded[i].duration == store[i].duration );
+        REQUIRE( loaded[i].track == store[i].track );
+        REQUIRE( loaded[i].depth == store[i].depth );
+        REQUIRE( chunk.names.View(loaded[i].name) == store.Name(store[i].name) );
+    }
+}
+
+TEST_CASE( "Native traces are decoded in chunks of blocks in time order", "[NativeTrace]" ) {
+    EventStore store;
+    FillStore(store, 20'000);
+    const auto data = Serialize(store);
+
+    Trace trace;
+    std::size_t chunks = 0;
+    bool ordered = true;
+    Timestamp previous = std::numeric_limits<Timestamp>::min();
+    ImportNativeTrace(data, 5000, [&](ParsedChunk&& chunk)
+        {
+            ++chunks;
+            chunk.columns.Sort();
+            if (chunk.columns.Size() > 0)
+            {
+                ordered &= chunk.columns.timestamps.front() >= previous;
+                previous = chunk.columns.timestamps.front();
+            }
+            trace.AppendChunk(std::move(chunk));
+            return true;
+        });
+    REQUIRE( chunks >= 4 );
+    REQUIRE( ordered );
+
+    // Loaded into an empty trace, string IDs are kept
+    const auto& loaded = trace.Events();
+    REQUIRE( loaded.Size() == store.Size() );
+    REQUIRE( loaded.Names().Size() == store.Names().Size() );
+    REQUIRE( loaded.TrackName(2) == "worker" );
+    bool same = true;
+    for (std::size_t i = 0; i < store.Size(); ++i)
+    {
+        same &= loaded[i].timestamp == store[i].timestamp && loaded[i].duration == store[i].duration && loaded[i].track == store[i].track
+            && loaded[i].depth == store[i].depth && loaded[i].name == store[i].name;
+    }
+    REQUIRE( same );
+}
+
+TEST_CASE( "Time ranges only decode overlapping blocks", "[NativeTrace]" ) {
+    EventStore store;
+    FillStore(store, 50'000);
+    const auto data = Serialize(store);
+    const NativeTraceReader reader{ data };
+
+    REQUIRE( reader.EventCount() == store.Size() );
+    REQUIRE( reader.Blocks().size() > 3 );
+    REQUIRE( reader.String(3) == "name_3" );
+
+    const auto start = store[20'000].timestamp;
+    const auto end = store[21'000].timestamp;
+    EventColumns range;
+    reader.ReadRange(start, end, range);
+
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < store.Size(); ++i)
+    {
+        if (store[i].timestamp < end && store[i].timestamp + store[i].duration >= start)
+            ++expected;
+    }
+    REQUIRE( range.Size() == expected );
+    for (std::size_t i = 0; i < range.Size(); ++i)
+        REQUIRE( (range.timestamps[i] < end && range.timestamps[i] + range.durations[i] >= start) );
+}
+
+TEST_CASE( "Corrupt native traces are rejected", "[NativeTrace]" ) {
+    EventStore store;
+    FillStore(store, 100);
+    const auto data = Serialize(store);
+
+    REQUIRE_THROWS( NativeTraceReader{ data.substr(0, data.size() - 1) } );
+    REQUIRE_THROWS( NativeTraceReader{ "TGLT" } );
+
+    auto truncatedBlock = data;
+    truncatedBlock.replace(16, 64, 64, '\xFF');
+    ParsedChunk chunk;
+    REQUIRE_THROWS( ImportNativeTrace(truncatedBlock, chunk) );
+
+    // Track of the first block index entry past the track table
+    std::uint64_t indexOffset = 0;
+    for (std::size_t i = 0; i < 8; ++i)
+        indexOffset |= std::uint64_t{ static_cast<unsigned char>(data[data.size() - 16 + i]) } << (8 * i);
+    auto invalidTrack = data;
+    invalidTrack.replace(indexOffset + 12, 4, 4, '\xFF');
+    REQUIRE_THROWS( NativeTraceReader{ invalidTrack } );
+
+    EventStore empty;
+    const auto emptyData = Serialize(empty);
+    ParsedChunk emptyChunk;
+    ImportNativeTrace(emptyData, emptyChunk);
+    REQUIRE( emptyChunk.columns.Size() == 0 );
+}
+
+TEST_CASE( "Arguments round-trip, version 1 files have none", "[NativeTrace]" ) {
+    EventStore store;
+    FillStore(store, 10'000);
+    const auto key = store.InternName("key");
+    const auto value = store.InternName("value");
+
+    EventColumns batch;
+    for (std::size_t i = 0; i < 5000; ++i)
+    {
+        Argument arguments[3];
+        arguments[0].key = key;
+        arguments[0].type = ArgumentType::Int;
+        arguments[0].integer = static_cast<std::int64_t>(i) - 2500;
+        arguments[1].key = value;
+        arguments[1].type = ArgumentType::Object;
+        arguments[1].size = 1;
+        arguments[2].key = key;
+        arguments[2].type = i % 2 == 0 ? ArgumentType::String : ArgumentType::Double;
+        if (i % 2 == 0)
+            arguments[2].text = value;
+        else
+            arguments[2].number = 0.25 * static_cast<double>(i);
+
+        Event event{ static_cast<Timestamp>(i * 1000), 10, key, 5, 0 };
+        event.argCount = i % 4 == 3 ? 1 : 3;
+        event.argOffset = store.StoreArguments(std::span{ arguments, event.argCount });
+        batch.PushBack(event);
+    }
+    store.AppendBulk(batch);
+
+    auto data = Serialize(store);
+    ParsedChunk chunk;
+    ImportNativeTrace(data, chunk);
+    Trace loaded;
+    loaded.AppendChunk(std::move(chunk));
+    REQUIRE( loaded.Events().Size() == store.Size() );
+
+    std::size_t checked = 0;
+    for (std::size_t i = 0; i < store.Size(); ++i)
+    {
+        const auto expected = store.Arguments(i);
+        const auto actual = loaded.Events().Arguments(i);
+        REQUIRE( actual.size() == expected.size() );
+        for (std::size_t a = 0; a < actual.size(); ++a, ++checked)
+        {
+            REQUIRE( loaded.Events().Name(actual[a].key) == store.Name(expected[a].key) );
+            REQUIRE( actual[a].type == expected[a].type );
+            if (actual[a].type == ArgumentType::String)
+                REQUIRE( loaded.Events().Name(actual[a].text) == store.Name(expected[a].text) );
+            else
+                REQUIRE( actual[a].integer == expected[a].integer ); // same bits for doubles and sizes
+        }
+    }
+    REQUIRE( checked == 12'500 );
+
+    // Readers of version 1 never look past the depths of a block
+    data[4] = 1;
+    ParsedChunk old;
+    ImportNativeTrace(data, old);
+    REQUIRE( old.columns.Size() == store.Size() );
+    REQUIRE( old.arguments.Size() == 0 );
+}
@@ -0,0 +1,125 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PagePool.hpp"
+#include "StableTextBuffer.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Released pages are reused up to the free limit", "[PagePool]" ) {
+    PagePool<4096> pool{ PagePoolOptions{ 2, false } };
+
+    std::vector<char*> pages;
+    for (int i = 0; i < 4; ++i)
+        pages.push_back(pool.Acquire());
+    REQUIRE( pool.Stats().inUse == 4 );
+    REQUIRE( pool.Stats().allocated == 4 );
+
+    for (char* page : pages)
+        pool.Release(page);
+    auto stats = pool.Stats();
+    REQUIRE( stats.inUse == 0 );
+    REQUIRE( stats.free == 2 );
+
+    // The most recently released page comes back first
+    REQUIRE( pool.Acquire() == pages[1] );
+    REQUIRE( pool.Acquire() == pages[0] );
+    char* fresh = pool.Acquire();
+    stats = pool.Stats();
+    REQUIRE( stats.inUse == 3 );
+    REQUIRE( stats.free == 0 );
+    REQUIRE( stats.allocated == 5 );
+
+    pool.Release(fresh);
+    pool.Release(pages[0]);
+    pool.Release(pages[1]);
+    pool.Trim(1);
+    REQUIRE( pool.Stats().free == 1 );
+    pool.Trim();
+    REQUIRE( pool.Stats().free == 0 );
+}
+
+TEST_CASE( "Pruning returns empty pages wherever they are", "[PagePool]" ) {
+    auto pool = std::make_shared<PagePool<16>>(PagePoolOptions{ 100, false });
+    StableTextBuffer<16> buffer{ pool };
+
+    for (int i = 0; i < 10; ++i)
+        REQUIRE( buffer.Store(std::string(10, 'a' + i)) == std::string(10, 'a' + i) );
+    REQUIRE( pool->Stats().inUse == 10 );
+
+    // Recycled pages fill up in order, the rest stay empty until pruned
+    buffer.Recycle();
+    const auto first = buffer.Store("0123456789");
+    const auto second = buffer.Store("0123456789");
+    REQUIRE( second.data() != first.data() + first.size() );
+    buffer.Prune();
+    REQUIRE( pool->Stats().inUse == 2 );
+    REQUIRE( pool->Stats().free == 8 );
+    REQUIRE( first == "0123456789" );
+    REQUIRE( second == "0123456789" );
+
+    // Stores continue in the last kept page, then take pages from the pool
+    const auto third = buffer.Store("abc");
+    REQUIRE( third.data() == second.data() + second.size() );
+    REQUIRE( buffer.Store("0123456789") == "0123456789" );
+    REQUIRE( pool->Stats().inUse == 3 );
+    REQUIRE( pool->Stats().allocated == 10 );
+
+    buffer.Clear();
+    REQUIRE( pool->Stats().inUse == 0 );
+    REQUIRE( buffer.AllocatedBytes() == 0 );
+}
+
+TEST_CASE( "Buffers hand their pages to each other through a shared pool", "[PagePool]" ) {
+    auto pool = std::make_shared<PagePool<256>>(PagePoolOptions{ 1024, false });
+
+    // Catch assertions are not thread-safe, every thread reports a flag
+    std::vector<char> intact(4, 1);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&pool, &intact, t]
+            {
+                for (int round = 0; round < 50; ++round)
+                {
+                    StableTextBuffer<256> buffer{ pool };
+                    std::vector<std::string_view> views;
+                    for (int i = 0; i < 100; ++i)
+                        views.push_back(buffer.Store(std::to_string(t) + ":" + std::to_string(i)));
+
+                    StableTextBuffer<256> moved = std::move(buffer);
+                    intact[t] &= moved.Store("moved") == "moved";
+                    for (int i = 0; i < 100; ++i)
+                        intact[t] &= views[i] == std::to_string(t) + ":" + std::to_string(i);
+                }
+            });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    REQUIRE( std::ranges::count(intact, 1) == 4 );
+
+    const auto stats = pool->Stats();
+    REQUIRE( stats.inUse == 0 );
+    REQUIRE( stats.free == stats.allocated );
+    REQUIRE( stats.allocated <= 4 * 8 );
+}
+
+TEST_CASE( "Advised pages give their memory back", "[PagePool]" ) {
+    constexpr std::size_t Size = 64 * 1024;
+    PagePool<Size> pool{ PagePoolOptions{ 1, true } };
+
+    char* page = pool.Acquire();
+    std::fill_n(page, Size, 'x');
+    pool.Release(page);
+    REQUIRE( pool.Acquire() == page );
+#ifdef __linux__
+    // Whole OS pages inside the page come back zeroed, the edges are untouched
+    REQUIRE( std::count(page, page + Size, 0) >= static_cast<std::ptrdiff_t>(Size / 2) );
+#endif
+    pool.Release(page);
+}
@@ -0,0 +1,205 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <random>
+#include <shared_mutex>
+#include <vector>
+
+#include "QueryEngine.hpp"
+#include "WorkStealingPool.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    // Appends a span and its random children, preorder keeps the store sorted by start
+    void AppendTree(EventColumns& batch, std::mt19937& random, const NameId name, const TrackId track, const Depth depth,
+                    const Timestamp start, const Duration duration)
+    {
+        batch.PushBack(Event{ start, duration, name + static_cast<NameId>(random() % 5), track, depth });
+        if (depth == 6 || duration < 8)
+            return;
+
+        auto cursor = start;
+        const auto end = start + duration;
+        while (random() % 4 != 0)
+        {
+            cursor += static_cast<Duration>(random() % 4);
+            const auto length = std::min<Duration>(static_cast<Duration>(random() % (duration / 2 + 1)), end - cursor);
+            if (length <= 0)
+                break;
+            AppendTree(batch, random, name, track, depth + 1, cursor, length);
+            cursor += length;
+        }
+    }
+
+    void MakeTrace(Trace& trace, const int roots)
+    {
+        std::mt19937 random{ 12 };
+        const auto name = trace.InternName("a");
+        for (const auto text : { "b", "c", "d", "e" })
+            static_cast<void>(trace.InternName(text));
+
+        EventColumns batch;
+        for (TrackId track = 0; track < 3; ++track)
+        {
+            Timestamp cursor = 0;
+            for (int i = 0; i < roots; ++i)
+            {
+                const auto duration = static_cast<Duration>(random() % 2000);
+                AppendTree(batch, random, name, track, 0, cursor, duration);
+                cursor += duration + static_cast<Duration>(random() % 10);
+            }
+        }
+        trace.AppendBulk(batch);
+    }
+}
+
+TEST_CASE( "Every submitted task runs once", "[QueryEngine]" ) {
+    std::atomic<int> total = 0;
+    {
+        WorkStealingPool pool{ 4 };
+        REQUIRE( pool.ThreadCount() == 4 );
+
+        // Tasks spawning tasks land on the deque of their worker and get stolen from there
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.Submit([&]
+                {
+                    for (int j = 0; j < 100; ++j)
+                        pool.Submit([&] { ++total; });
+                });
+        }
+    }
+    REQUIRE( total == 100 * 100 );
+}
+
+TEST_CASE( "Self time matches a sequential sweep", "[QueryEngine]" ) {
+    Trace trace;
+    MakeTrace(trace, 6000);
+    std::shared_mutex mutex;
+    QueryEngine engine{ trace, mutex, 4 };
+
+    const auto& events = trace.Events();
+    REQUIRE( events.Size() > 3 * QueryEngine::ShardEvents );
+
+    for (const auto& [first, last] : { std::pair<Timestamp, Timestamp>{ 0, 100'000'000 }, { 1'000'000, 2'500'000 }, { 500, 400 } })
+    {
+        std::map<NameId, NameStats> expected;
+        std::vector<std::vector<std::size_t>> open(3, std::vector<std::size_t>(8));
+        for (std::size_t i = 0; i < events.Size(); ++i)
+        {
+            const auto event = events[i];
+            open[event.track][event.depth] = i;
+            if (event.timestamp < first || event.timestamp > last)
+                continue;
+
+            auto& own = expected.try_emplace(event.name, NameStats{ event.name, 0, 0, 0 }).first->second;
+            ++own.count;
+            own.total += event.duration;
+            own.self += event.duration;
+            if (event.depth > 0)
+            {
+                const auto parent = events[open[event.track][event.depth - 1]];
+                if (parent.timestamp >= first)
+                    expected.try_emplace(parent.name, NameStats{ parent.name, 0, 0, 0 }).first->second.self -= event.duration;
+            }
+        }
+
+        const auto query = engine.SelfTime(first, last);
+        REQUIRE( query->Wait() );
+        REQUIRE( query->Done() );
+        REQUIRE( query->Kind() == AggregateKind::SelfTime );
+        REQUIRE( query->Names().size() == expected.size() );
+        for (const auto& stats : query->Names())
+        {
+            const auto& want = expected.at(stats.name);
+            REQUIRE( stats.count == want.count );
+            REQUIRE( stats.total == want.total );
+            REQUIRE( stats.self == want.self );
+        }
+        REQUIRE( std::ranges::is_sorted(query->Names(), std::ranges::greater{}, &NameStats::self) );
+    }
+}
+
+TEST_CASE( "Longest spans match a full sort", "[QueryEngine]" ) {
+    Trace trace;
+    MakeTrace(trace, 6000);
+    std::shared_mutex mutex;
+    QueryEngine engine{ trace, mutex, 3 };
+
+    const auto& events = trace.Events();
+    const Timestamp first = 100'000;
+    const Timestamp last = 5'000'000;
+    std::vector<std::uint32_t> expected;
+    for (std::uint32_t i = 0; i < events.Size(); ++i)
+    {
+        if (events[i].timestamp >= first && events[i].timestamp <= last)
+            expected.push_back(i);
+    }
+    std::ranges::sort(expected, [&](const std::uint32_t lhs, const std::uint32_t rhs)
+        {
+            return events[lhs].duration != events[rhs].duration ? events[lhs].duration > events[rhs].duration : lhs < rhs;
+        });
+    expected.resize(100);
+
+    const auto query = engine.LongestSpans(first, last, 100);
+    REQUIRE( query->Wait() );
+    REQUIRE( std::ranges::equal(query->Spans(), expected) );
+
+    const auto none = engine.LongestSpans(first, last, 0);
+    REQUIRE( none->Wait() );
+    REQUIRE( none->Spans().empty() );
+}
+
+TEST_CASE( "Completion callbacks see the results", "[QueryEngine]" ) {
+    Trace trace;
+    MakeTrace(trace, 100);
+    std::shared_mutex mutex;
+
+    std::atomic<int> calls = 0;
+    std::vector<std::shared_ptr<AggregateQuery>> queries(20);
+    {
+        QueryEngine engine{ trace, mutex, 2 };
+        {
+            // Holding the trace keeps the queries queued until all handles are stored
+            std::unique_lock hold{ mutex };
+            for (std::size_t i = 0; i < queries.size(); ++i)
+            {
+                queries[i] = engine.LongestSpans(0, 1'000'000, 5, [&calls, &queries, i]
+                    {
+                        // Results are readable before Wait() returns
+                        if (queries[i]->Done() && queries[i]->Spans().size() == 5)
+                            ++calls;
+                    });
+            }
+        }
+        REQUIRE( queries.back()->Wait() );
+    }
+
+    REQUIRE( calls == 20 );
+    for (const auto& query : queries)
+        REQUIRE( query->Error().empty() );
+}
+
+TEST_CASE( "Destroying the engine cancels queued queries", "[QueryEngine]" ) {
+    Trace trace;
+    MakeTrace(trace, 2000);
+    std::shared_mutex mutex;
+
+    std::vector<std::shared_ptr<AggregateQuery>> queries;
+    {
+        QueryEngine engine{ trace, mutex, 2 };
+        for (int i = 0; i < 50; ++i)
+            queries.push_back(engine.SelfTime(0, 100'000'000));
+    }
+
+    // Every query completes, either with results or as cancelled
+    for (const auto& query : queries)
+    {
+        if (!query->Wait())
+            REQUIRE( query->Error() == "cancelled" );
+    }
+}
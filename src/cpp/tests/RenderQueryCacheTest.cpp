@@ -0,0 +1,179 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <shared_mutex>
+#include <tuple>
+#include <vector>
+
+#include "RenderQueryCache.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    // Spans from nanoseconds to milliseconds on a few rows
+    void FillTrace(Trace& trace, const std::size_t count)
+    {
+        const auto names = std::vector{ trace.InternName("a"), trace.InternName("b"), trace.InternName("c") };
+        std::mt19937 random{ 17 };
+        EventColumns batch;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto duration = static_cast<Duration>(random() % 4 == 0 ? random() % 2'000'000 : random() % 3'000);
+            batch.PushBack(Event{ static_cast<Timestamp>(random() % 1'000'000'000), duration, names[random() % 3],
+                                  static_cast<TrackId>(random() % 4), static_cast<Depth>(random() % 3) });
+        }
+        trace.AppendBulk(batch);
+    }
+
+    // What tagliatelle_query_lod returns, sorted for comparison
+    std::vector<LodRecord> Reference(const Trace& trace, const Viewport& viewport)
+    {
+        std::vector<LodRecord> records;
+        auto collect = [&](const LodRecord& record) { records.push_back(record); };
+        if (!trace.Lod().ForEachVisible(viewport, collect))
+        {
+            ForEachVisible(trace.Events(), viewport, [&](const RenderRecord& r)
+                {
+                    collect(LodRecord{ r.x, r.width, r.track, r.depth, r.colorIndex, r.label, 1 });
+                });
+        }
+        return records;
+    }
+
+    // Pans shift cached records in pixels, so positions may differ by rounding
+    bool SameRecords(std::vector<LodRecord> a, std::vector<LodRecord> b)
+    {
+        auto key = [](const LodRecord& r) { return std::tuple{ r.track, r.depth, r.label, r.count, r.x, r.width }; };
+        auto near = [](const float x, const float y) { return std::abs(x - y) <= 1e-3f; };
+        std::ranges::sort(a, {}, key);
+        std::ranges::sort(b, {}, key);
+        return std::ranges::equal(a, b, [&](const LodRecord& x, const LodRecord& y)
+            {
+                return std::tie(x.track, x.depth, x.label, x.count, x.colorIndex) == std::tie(y.track, y.depth, y.label, y.count, y.colorIndex)
+                    && near(x.x, y.x) && near(x.width, y.width);
+            });
+    }
+
+    std::vector<LodRecord> Cached(RenderQueryCache& cache, std::shared_mutex& mutex, const Viewport& viewport, bool& exact)
+    {
+        std::shared_lock lock{ mutex };
+        const auto size = cache.Query(viewport, {}).count;
+        std::vector<LodRecord> records(size);
+        const auto result = cache.Query(viewport, records);
+        exact = result.exact;
+        records.resize(std::min(records.size(), result.count));
+        return records;
+    }
+}
+
+TEST_CASE( "Pans query only the exposed slices and match uncached queries", "[RenderQueryCache]" ) {
+    Trace trace;
+    std::shared_mutex mutex;
+    FillTrace(trace, 200'000);
+    RenderQueryCache cache{ trace, mutex };
+
+    bool same = true;
+    bool exact = false;
+    for (const Timestamp window : { Timestamp{ 100'000 }, Timestamp{ 5'000'000 }, Timestamp{ 300'000'000 } })
+    {
+        // Panning right, left and by more than a window at a constant zoom
+        Timestamp start = 200'000'000;
+        for (const Timestamp step : { window / 7, window / 3, -window / 5, window / 2, -2 * window, window / 11 })
+        {
+            start += step;
+            const Viewport viewport{ start, start + window, 1000.0f };
+            same &= SameRecords(Cached(cache, mutex, viewport, exact), Reference(trace, viewport)) && exact;
+        }
+    }
+    REQUIRE( same );
+
+    const auto stats = cache.Stats();
+    REQUIRE( stats.partialHits >= 12 );
+    REQUIRE( stats.misses >= 3 );
+    REQUIRE( stats.staleHits == 0 );
+    REQUIRE( stats.hits == stats.partialHits + stats.misses ); // the second call of every frame
+
+    // A modification invalidates the cache
+    trace.Append(Event{ 1, 2, 0, 0, 0 });
+    Cached(cache, mutex, Viewport{ 0, 100, 10.0f }, exact);
+    REQUIRE( cache.Stats().misses == stats.misses + 1 );
+}
+
+TEST_CASE( "Zooming in reuses coarser records until the refined ones arrive", "[RenderQueryCache]" ) {
+    Trace trace;
+    std::shared_mutex mutex;
+    FillTrace(trace, 200'000);
+    RenderQueryCache cache{ trace, mutex };
+
+    bool exact = false;
+    const Viewport wide{ 0, 1'000'000'000, 1000.0f };
+    REQUIRE( SameRecords(Cached(cache, mutex, wide, exact), Reference(trace, wide)) );
+    REQUIRE( exact );
+
+    std::mt19937 random{ 23 };
+    bool same = true;
+    for (int zoom = 0; zoom < 20; ++zoom)
+    {
+        const auto window = Timestamp{ 1'000'000'000 } >> (1 + random() % 20);
+        const auto start = static_cast<Timestamp>(random() % static_cast<std::uint64_t>(1'000'000'000 - window));
+        const Viewport viewport{ start, start + window, 1000.0f };
+        Cached(cache, mutex, viewport, exact);
+        cache.WaitRefined();
+        same &= SameRecords(Cached(cache, mutex, viewport, exact), Reference(trace, viewport)) && exact;
+        Cached(cache, mutex, wide, exact); // zooming out is exact at once
+        same &= exact;
+    }
+    REQUIRE( same );
+
+    const auto stats = cache.Stats();
+    // Both calls of a frame may be stale hits before the refinement arrives
+    REQUIRE( stats.refinements > 0 );
+    REQUIRE( stats.refinements <= stats.staleHits );
+}
+
+TEST_CASE( "Long pans keep matching uncached queries as records scroll out of view", "[RenderQueryCache]" ) {
+    Trace trace;
+    std::shared_mutex mutex;
+    FillTrace(trace, 200'000);
+    RenderQueryCache cache{ trace, mutex };
+
+    // Far enough in both directions that the cache drops records and covers new ground several times
+    bool same = true;
+    bool exact = false;
+    const Timestamp window = 20'000'000;
+    Timestamp start = 500'000'000;
+    for (int frame = 0; frame < 300; ++frame)
+    {
+        start += frame < 200 ? window / 40 : -window / 15;
+        const Viewport viewport{ start, start + window, 1920.0f };
+        same &= SameRecords(Cached(cache, mutex, viewport, exact), Reference(trace, viewport)) && exact;
+    }
+    REQUIRE( same );
+    REQUIRE( cache.Stats().misses == 1 );
+}
+
+TEST_CASE( "Zooming in outside of the cached range is queried in full", "[RenderQueryCache]" ) {
+    Trace trace;
+    std::shared_mutex mutex;
+    FillTrace(trace, 200'000);
+    RenderQueryCache cache{ trace, mutex };
+
+    bool exact = false;
+    const Viewport left{ 0, 400'000'000, 1000.0f };
+    Cached(cache, mutex, left, exact);
+
+    // A finer level, none of it covered by the cached window
+    const Viewport zoomed{ 700'000'000, 701'000'000, 1000.0f };
+    REQUIRE( LodPyramid::LevelFor(zoomed) < LodPyramid::LevelFor(left) );
+    const auto records = Cached(cache, mutex, zoomed, exact);
+    REQUIRE( exact );
+    REQUIRE( !records.empty() );
+    REQUIRE( SameRecords(records, Reference(trace, zoomed)) );
+
+    const auto stats = cache.Stats();
+    REQUIRE( stats.staleHits == 0 );
+    REQUIRE( stats.misses == 2 );
+}
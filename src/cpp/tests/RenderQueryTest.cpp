@@ -0,0 +1,41 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "RenderQuery.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Visible spans are clipped to the viewport", "[RenderQuery]" ) {
+    EventStore store;
+    const auto name = store.InternName("work");
+    store.Append({ 0, 1000, name, 0, 0 });   // starts before, ends inside
+    store.Append({ 500, 100, name, 1, 0 });  // fully inside
+    store.Append({ 900, 500, name, 0, 1 });  // ends after
+    store.Append({ 1500, 10, name, 0, 0 });  // after the window
+
+    const Viewport viewport{ 500, 1000, 100.0f };
+    std::vector<RenderRecord> records;
+    CollectVisible(store, viewport, records);
+
+    REQUIRE( records.size() == 3 );
+    REQUIRE( records[0].x == 0.0f );
+    REQUIRE( records[0].width == 100.0f );
+    REQUIRE( records[1].track == 1 );
+    REQUIRE( records[1].width == 20.0f );
+    REQUIRE( records[2].x == 80.0f );
+    REQUIRE( records[2].width == 20.0f );
+    REQUIRE( records[2].depth == 1 );
+    REQUIRE( records[2].label == name );
+    REQUIRE( records[2].colorIndex == ColorIndex(name) );
+}
+
+TEST_CASE( "Short buffers report the full count", "[RenderQuery]" ) {
+    EventStore store;
+    const auto name = store.InternName("tick");
+    for (Timestamp t = 0; t < 100; ++t)
+        store.Append({ t, 1, name, 0, 0 });
+
+    std::vector<RenderRecord> buffer(10);
+    REQUIRE( FillVisible(store, { 0, 100, 1000.0f }, buffer) == 100 );
+    REQUIRE( buffer[9].x == 90.0f );
+    REQUIRE( FillVisible(store, { 100, 0, 1000.0f }, buffer) == 0 );
+}
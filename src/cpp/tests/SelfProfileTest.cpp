@@ -0,0 +1,108 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "EventStore.hpp"
+#include "SelfProfile.hpp"
+#include "SelfProfiler.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Profile rings keep the most recent scopes", "[SelfProfile]" ) {
+    ProfileRing ring{ 7 };
+    const auto pushed = ProfileRing::Capacity + 10;
+    for (std::size_t i = 0; i < pushed; ++i)
+        ring.Push("scope", static_cast<std::int64_t>(i), static_cast<std::int64_t>(i) + 1, 0);
+
+    std::vector<std::int64_t> starts;
+    ring.ForEach([&](const char*, const std::int64_t start, std::int64_t, std::uint32_t) { starts.push_back(start); });
+    REQUIRE( ring.Thread() == 7 );
+    REQUIRE( starts.size() == ProfileRing::Capacity - 1 );
+    REQUIRE( starts.front() == 11 );
+    REQUIRE( starts.back() == static_cast<std::int64_t>(pushed - 1) );
+}
+
+TEST_CASE( "Profile scopes are collected with a track per thread", "[SelfProfile]" ) {
+    constexpr std::string_view outerName = "SelfProfileTest outer";
+    constexpr std::string_view innerName = "SelfProfileTest inner";
+
+    std::thread worker{ [&] {
+        const ProfileScope outer{ outerName.data() };
+        for (int i = 0; i < 3; ++i)
+            const ProfileScope inner{ innerName.data() };
+    } };
+    worker.join();
+    {
+        const ProfileScope outer{ outerName.data() };
+    }
+
+    EventStore events;
+    CollectSelfProfile(events);
+
+    std::vector<Event> outers;
+    std::vector<Event> inners;
+    for (std::size_t i = 0; i < events.Size(); ++i)
+    {
+        const auto event = events[i];
+        if (events.Name(event.name) == outerName)
+            outers.push_back(event);
+        else if (events.Name(event.name) == innerName)
+            inners.push_back(event);
+    }
+    REQUIRE( outers.size() == 2 );
+    REQUIRE( inners.size() == 3 );
+
+    // The worker's scope comes first, its inner scopes nest below it on the same track
+    const auto& outer = outers[0];
+    REQUIRE( outer.track != outers[1].track );
+    REQUIRE( events.TrackName(outer.track).starts_with("thread ") );
+    for (const auto& inner : inners)
+    {
+        REQUIRE( inner.track == outer.track );
+        REQUIRE( inner.depth == outer.depth + 1 );
+        REQUIRE( inner.timestamp >= outer.timestamp );
+        REQUIRE( inner.timestamp + inner.duration <= outer.timestamp + outer.duration );
+    }
+}
+
+TEST_CASE( "Rings of exited threads are reused once collected", "[SelfProfile]" ) {
+    constexpr std::string_view scopeName = "SelfProfileTest exited";
+    auto record = [&] {
+        std::thread{ [&] { const ProfileScope scope{ scopeName.data() }; } }.join();
+    };
+    auto collected = [&] {
+        EventStore events;
+        CollectSelfProfile(events);
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < events.Size(); ++i)
+            count += events.Name(events[i].name) == scopeName;
+        return count;
+    };
+
+    record();
+    REQUIRE( collected() == 1 );
+    const auto rings = SelfProfiler::Instance().RingCount();
+
+    // Each thread takes over the ring of the one before, without its scopes
+    bool reused = true;
+    for (int i = 0; i < 32; ++i)
+    {
+        record();
+        reused &= collected() == 1;
+    }
+    REQUIRE( reused );
+    REQUIRE( SelfProfiler::Instance().RingCount() <= rings );
+    REQUIRE( collected() == 0 );
+
+    // Rings of threads that exit together are freed beyond the spares
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < 2 * SelfProfiler::SpareRings; ++i)
+        workers.emplace_back([&] { const ProfileScope scope{ scopeName.data() }; });
+    for (auto& worker : workers)
+        worker.join();
+    REQUIRE( collected() == 2 * SelfProfiler::SpareRings );
+    REQUIRE( SelfProfiler::Instance().RingCount() <= rings + SelfProfiler::SpareRings );
+}
@@ -0,0 +1,73 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "InternedTextBuffer.hpp"
+#include "SlabAllocator.hpp"
+#include "StableTextBuffer.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Slab blocks are aligned, distinct and reused by size", "[SlabAllocator]" ) {
+    if (!SlabArena::Supported())
+        return;
+
+    SlabArena arena{ SlabOptions{ 4 * 1024 * 1024, true, false } };
+
+    std::set<void*> blocks;
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto* const block = static_cast<char*>(arena.Allocate(16 * 1024));
+        REQUIRE( reinterpret_cast<std::uintptr_t>(block) % SlabArena::Alignment == 0 );
+        block[0] = 'a';
+        block[16 * 1024 - 1] = 'z';
+        blocks.insert(block);
+    }
+    REQUIRE( blocks.size() == 1000 );
+    // 16 MB of blocks in 4 MB slabs
+    REQUIRE( arena.MappedBytes() == 16 * 1024 * 1024 );
+
+    void* const freed = *blocks.begin();
+    arena.Deallocate(freed, 16 * 1024);
+    REQUIRE( arena.Allocate(16 * 1024) == freed );
+    REQUIRE( arena.Allocate(100) != freed );
+
+    // Oversized blocks get a mapping of their own and give it back
+    void* const large = arena.Allocate(3 * 1024 * 1024);
+    REQUIRE( reinterpret_cast<std::uintptr_t>(large) % SlabArena::HugePageSize == 0 );
+    REQUIRE( arena.MappedBytes() == 20 * 1024 * 1024 );
+    arena.Deallocate(large, 3 * 1024 * 1024);
+    REQUIRE( arena.MappedBytes() == 16 * 1024 * 1024 );
+}
+
+TEST_CASE( "Text buffers store into slab pages", "[SlabAllocator]" ) {
+    auto arena = std::make_shared<SlabArena>(SlabOptions{ 2 * 1024 * 1024, true, true });
+    const SlabAllocator<char> allocator{ arena };
+
+    InternedTextBuffer<4096, SlabAllocator<char>> names{ allocator };
+    std::vector<InternedTextBuffer<4096, SlabAllocator<char>>::Id> ids;
+    for (int i = 0; i < 100'000; ++i)
+        ids.push_back(names.Intern("name_" + std::to_string(i % 50'000)));
+    REQUIRE( names.Size() == 50'000 );
+    REQUIRE( arena->MappedBytes() >= names.TextBytes() );
+
+    bool intact = true;
+    for (int i = 0; i < 100'000; ++i)
+        intact &= names.View(ids[i]) == "name_" + std::to_string(i % 50'000);
+    REQUIRE( intact );
+
+    // Pages released by one buffer are picked up by the next through the pool
+    auto pool = std::make_shared<PagePool<4096, SlabAllocator<char>>>(PagePoolOptions{ 64, false }, allocator);
+    const char* first = nullptr;
+    {
+        StableTextBuffer<4096, SlabAllocator<char>> buffer{ pool };
+        first = buffer.Store("first").data();
+    }
+    StableTextBuffer<4096, SlabAllocator<char>> buffer{ pool };
+    REQUIRE( buffer.Store("second").data() == first );
+    REQUIRE( pool->Stats().allocated == 1 );
+}
@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstdint>
+#include <thread>
+
+#include "SpscRing.hpp"
+
+using namespace tagliatelle;
+
+TEST_CASE( "Full rings reject pushes until popped", "[SpscRing]" ) {
+    SpscRing<int, 4> ring;
+    REQUIRE( ring.Empty() );
+    for (int i = 0; i < 4; ++i)
+        REQUIRE( ring.TryPush(i) );
+    REQUIRE( !ring.TryPush(4) );
+
+    std::array<int, 3> out{};
+    REQUIRE( ring.PopBulk(out) == 3 );
+    REQUIRE( out == std::array<int, 3>{ 0, 1, 2 } );
+    REQUIRE( ring.TryPush(4) );
+    REQUIRE( ring.PopBulk(out) == 2 );
+    REQUIRE( out[0] == 3 );
+    REQUIRE( out[1] == 4 );
+    REQUIRE( ring.PopBulk(out) == 0 );
+}
+
+TEST_CASE( "Items cross threads in order", "[SpscRing]" ) {
+    constexpr std::uint64_t Count = 1'000'000;
+    SpscRing<std::uint64_t, 1024> ring;
+
+    std::jthread producer{ [&]
+        {
+            for (std::uint64_t i = 0; i < Count;)
+            {
+                if (ring.TryPush(i))
+                    ++i;
+            }
+        } };
+
+    std::array<std::uint64_t, 100> out{};
+    std::uint64_t expected = 0;
+    bool ordered = true;
+    while (expected < Count)
+    {
+        const auto popped = ring.PopBulk(out);
+        for (std::size_t i = 0; i < popped; ++i)
+            ordered = ordered && out[i] == expected++;
+    }
+    REQUIRE( ordered );
+}
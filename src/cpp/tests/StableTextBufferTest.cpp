@@ -1,6 +1,11 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include <cstdint>
+#include <string>
+
+#include "StableTextBuffer.hpp"
+
+using namespace tagliatelle;
 
 uint32_t factorial( uint32_t number ) {
     return number <= 1 ? number : factorial(number-1) * number;
@@ -12,3 +17,36 @@ TEST_CASE( "Factorials are computed", "[factorial]" ) {
     REQUIRE( factorial( 3) == 6 );
     REQUIRE( factorial(10) == 3'628'800 );
 }
+
+TEST_CASE( "Oversized strings get their own block", "[StableTextBuffer]" ) {
+    StableTextBuffer<16> buffer;
+
+    const std::string big(1000, 'b');
+    const auto small = buffer.Store("small");
+    const auto large = buffer.Store(big);
+    const auto after = buffer.Store("after");
+
+    REQUIRE( small == "small" );
+    REQUIRE( large == big );
+    REQUIRE( large.data() != big.data() );
+    // Small strings keep filling the current page
+    REQUIRE( after.data() == small.data() + small.size() );
+}
+
+TEST_CASE( "Recycled large blocks are reused until pruned", "[StableTextBuffer]" ) {
+    StableTextBuffer<16> buffer;
+
+    const auto first = buffer.Store(std::string(100, 'a'));
+    buffer.Recycle();
+
+    const auto reused = buffer.Store(std::string(80, 'c'));
+    REQUIRE( reused.data() == first.data() );
+    REQUIRE( reused == std::string(80, 'c') );
+
+    buffer.Recycle();
+    buffer.Prune();
+    REQUIRE( buffer.Store(std::string(64, 'd')) == std::string(64, 'd') );
+
+    buffer.Clear();
+    REQUIRE( buffer.Store(std::string(17, 'e')) == std::string(17, 'e') );
+}
@@ -0,0 +1,552 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "tagliatelle.h"
+
+TEST_CASE( "Events round-trip through the C API", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+    REQUIRE( store != nullptr );
+
+    uint32_t frame = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "frame", std::strlen("frame"), &frame) == TAGLIATELLE_OK );
+
+    const tagliatelle_event events[] = {
+        { 200, 10, frame, 0, 0 },
+        { 100, 10, frame, 0, 0 },
+    };
+    REQUIRE( tagliatelle_store_append_bulk(store, events, 2) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_event_count(store) == 2 );
+
+    tagliatelle_event first{};
+    REQUIRE( tagliatelle_store_get_event(store, 0, &first) == TAGLIATELLE_OK );
+    REQUIRE( first.timestamp == 100 );
+    REQUIRE( first.name_id == frame );
+
+    const tagliatelle_event unknownName{ 0, 1, frame + 1, 0, 0 };
+    REQUIRE( tagliatelle_store_append(store, &unknownName) == TAGLIATELLE_INVALID_ARGUMENT );
+    REQUIRE( tagliatelle_store_get_event(store, 2, &first) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    const tagliatelle_event farTrack{ 0, 1, frame, TAGLIATELLE_MAX_TRACKS, 0 };
+    REQUIRE( tagliatelle_store_append(store, &farTrack) == TAGLIATELLE_INVALID_ARGUMENT );
+    REQUIRE( tagliatelle_store_set_track_name(store, UINT32_MAX, "x", 1) == TAGLIATELLE_INVALID_ARGUMENT );
+    REQUIRE( tagliatelle_store_set_track_name(store, TAGLIATELLE_MAX_TRACKS - 1, "x", 1) == TAGLIATELLE_OK );
+
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Visible spans and labels are readable without copies", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+
+    uint32_t ids[2] = {};
+    REQUIRE( tagliatelle_store_intern_name(store, "outer", 5, &ids[0]) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_intern_name(store, "inner", 5, &ids[1]) == TAGLIATELLE_OK );
+
+    const tagliatelle_event events[] = {
+        { 0, 100, ids[0], 0, 0 },
+        { 10, 20, ids[1], 0, 1 },
+    };
+    REQUIRE( tagliatelle_store_append_bulk(store, events, 2) == TAGLIATELLE_OK );
+
+    const tagliatelle_viewport viewport{ 0, 100, 200.0f };
+    tagliatelle_render_record records[1];
+    size_t count = 0;
+    REQUIRE( tagliatelle_query_visible(store, &viewport, records, 1, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 );
+    REQUIRE( records[0].width == 200.0f );
+
+    const tagliatelle_render_record* pinned = nullptr;
+    REQUIRE( tagliatelle_query_visible_pinned(store, &viewport, &pinned, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 );
+    REQUIRE( pinned[1].x == 20.0f );
+    REQUIRE( pinned[1].depth == 1 );
+
+    REQUIRE( tagliatelle_store_string_count(store) == 2 );
+    tagliatelle_string label{};
+    REQUIRE( tagliatelle_store_get_strings(store, pinned[1].label_id, 1, &label) == TAGLIATELLE_OK );
+    REQUIRE( std::string_view(label.data, label.length) == "inner" );
+    REQUIRE( tagliatelle_store_get_strings(store, 1, 2, &label) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Zoomed out queries merge sub-pixel spans", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+
+    uint32_t tick = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "tick", 4, &tick) == TAGLIATELLE_OK );
+    for (int64_t t = 0; t < 10'000'000; t += 1'000)
+    {
+        const tagliatelle_event event{ t, 10, tick, 0, 0 };
+        REQUIRE( tagliatelle_store_append(store, &event) == TAGLIATELLE_OK );
+    }
+
+    size_t count = 0;
+    const tagliatelle_viewport zoomedOut{ 0, 10'000'000, 100.0f };
+    REQUIRE( tagliatelle_query_lod(store, &zoomedOut, nullptr, 0, &count) == TAGLIATELLE_OK );
+    REQUIRE( count <= 200 );
+
+    const tagliatelle_viewport zoomedIn{ 0, 10'000, 100.0f };
+    tagliatelle_lod_record records[16];
+    REQUIRE( tagliatelle_query_lod(store, &zoomedIn, records, 16, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 10 );
+    REQUIRE( records[0].count == 1 );
+
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Trace files load in the background", "[api]" ) {
+    const auto path = std::filesystem::temp_directory_path() / "tagliatelle_api_load_test.txt";
+    std::ofstream{ path } << "0 10 0 0 main\n5 2 0 1 child\nbroken line\n";
+
+    tagliatelle_store* store = tagliatelle_store_create();
+    tagliatelle_loader* loader = nullptr;
+    REQUIRE( tagliatelle_load_start(store, path.string().c_str(), &loader) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_load_wait(loader) == TAGLIATELLE_OK );
+
+    tagliatelle_load_progress progress{};
+    REQUIRE( tagliatelle_load_get_progress(loader, &progress) == TAGLIATELLE_OK );
+    REQUIRE( progress.done == 1 );
+    REQUIRE( progress.events_loaded == 2 );
+    REQUIRE( progress.malformed_records == 1 );
+    REQUIRE( tagliatelle_store_event_count(store) == 2 );
+    tagliatelle_load_destroy(loader);
+
+    REQUIRE( tagliatelle_load_start(store, "/nonexistent/trace.txt", &loader) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_load_wait(loader) == TAGLIATELLE_IO_ERROR );
+    tagliatelle_load_destroy(loader);
+
+    tagliatelle_store_destroy(store);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Saved stores load back from the native format", "[api]" ) {
+    const auto path = std::filesystem::temp_directory_path() / "tagliatelle_api_save_test.tglt";
+
+    tagliatelle_store* store = tagliatelle_store_create();
+    uint32_t frame = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "frame", std::strlen("frame"), &frame) == TAGLIATELLE_OK );
+    const tagliatelle_event events[] = {
+        { 100, 50, frame, 0, 0 },
+        { 120, 10, frame, 1, 1 },
+    };
+    REQUIRE( tagliatelle_store_append_bulk(store, events, 2) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_save(store, path.string().c_str()) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_save(store, "/nonexistent/trace.tglt") == TAGLIATELLE_IO_ERROR );
+
+    tagliatelle_store* loaded = tagliatelle_store_create();
+    tagliatelle_loader* loader = nullptr;
+    REQUIRE( tagliatelle_load_start(loaded, path.string().c_str(), &loader) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_load_wait(loader) == TAGLIATELLE_OK );
+    tagliatelle_load_destroy(loader);
+
+    REQUIRE( tagliatelle_store_event_count(loaded) == 2 );
+    tagliatelle_event second{};
+    REQUIRE( tagliatelle_store_get_event(loaded, 1, &second) == TAGLIATELLE_OK );
+    REQUIRE( second.timestamp == 120 );
+    REQUIRE( second.track == 1 );
+    REQUIRE( second.depth == 1 );
+    REQUIRE( second.name_id == frame );
+
+    tagliatelle_store_destroy(loaded);
+    tagliatelle_store_destroy(store);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Spans under the cursor are found through the C API", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+    uint32_t frame = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "frame", std::strlen("frame"), &frame) == TAGLIATELLE_OK );
+    const tagliatelle_event events[] = {
+        { 0, 100, frame, 0, 0 },
+        { 10, 20, frame, 0, 1 },
+        { 200, 10, frame, 0, 0 },
+    };
+    REQUIRE( tagliatelle_store_append_bulk(store, events, 3) == TAGLIATELLE_OK );
+
+    size_t indices[4] = {};
+    size_t count = 0;
+    REQUIRE( tagliatelle_query_overlap(store, 0, 90, 205, indices, 4, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 );
+    REQUIRE( tagliatelle_query_stabbing(store, 0, 15, indices, 1, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 );
+    REQUIRE( indices[0] == 0 );
+
+    size_t hit = 0;
+    REQUIRE( tagliatelle_hit_test(store, 0, 1, 25, 0, &hit) == TAGLIATELLE_OK );
+    REQUIRE( hit == 1 );
+    REQUIRE( tagliatelle_hit_test(store, 0, 1, 50, 5, &hit) == TAGLIATELLE_OK );
+    REQUIRE( hit == TAGLIATELLE_NO_EVENT );
+
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Aggregate queries run in the background", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+    uint32_t frame = 0;
+    uint32_t draw = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "frame", std::strlen("frame"), &frame) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_intern_name(store, "draw", std::strlen("draw"), &draw) == TAGLIATELLE_OK );
+    const tagliatelle_event events[] = {
+        { 0, 100, frame, 0, 0 },
+        { 10, 20, draw, 0, 1 },
+        { 40, 30, draw, 0, 1 },
+        { 200, 50, frame, 1, 0 },
+    };
+    REQUIRE( tagliatelle_store_append_bulk(store, events, 4) == TAGLIATELLE_OK );
+
+    std::atomic<int> calls = 0;
+    const auto callback = [](tagliatelle_query*, void* user_data) { ++*static_cast<std::atomic<int>*>(user_data); };
+
+    tagliatelle_query* selfTime = nullptr;
+    REQUIRE( tagliatelle_query_self_time_async(store, 0, 1000, callback, &calls, &selfTime) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_query_wait(selfTime) == TAGLIATELLE_OK );
+
+    const tagliatelle_name_stats* stats = nullptr;
+    size_t count = 0;
+    REQUIRE( tagliatelle_query_get_name_stats(selfTime, &stats, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 );
+    REQUIRE( stats[0].name_id == frame );
+    REQUIRE( stats[0].count == 2 );
+    REQUIRE( stats[0].total_duration == 150 );
+    REQUIRE( stats[0].self_duration == 100 );
+    REQUIRE( stats[1].self_duration == 50 );
+
+    const uint32_t* spans = nullptr;
+    REQUIRE( tagliatelle_query_get_spans(selfTime, &spans, &count) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    tagliatelle_query* longest = nullptr;
+    REQUIRE( tagliatelle_query_longest_spans_async(store, 0, 1000, 2, nullptr, nullptr, &longest) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_query_wait(longest) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_query_get_spans(longest, &spans, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 );
+    REQUIRE( spans[0] == 0 );
+    REQUIRE( spans[1] == 3 );
+
+    REQUIRE( calls == 1 );
+    tagliatelle_query_destroy(longest);
+    tagliatelle_query_destroy(selfTime);
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Call trees follow the selection and the store", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+    uint32_t frame = 0;
+    uint32_t draw = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "frame", std::strlen("frame"), &frame) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_intern_name(store, "draw", std::strlen("draw"), &draw) == TAGLIATELLE_OK );
+    const tagliatelle_event events[] = {
+        { 0, 100, frame, 0, 0 },
+        { 10, 20, draw, 0, 1 },
+        { 200, 50, frame, 0, 0 },
+    };
+    REQUIRE( tagliatelle_store_append_bulk(store, events, 3) == TAGLIATELLE_OK );
+
+    tagliatelle_call_tree* tree = nullptr;
+    REQUIRE( tagliatelle_call_tree_create(store, &tree) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_call_tree_select(tree, 0, 150) == TAGLIATELLE_OK );
+
+    const tagliatelle_call_tree_node* nodes = nullptr;
+    size_t count = 0;
+    REQUIRE( tagliatelle_call_tree_get_nodes(tree, &nodes, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 );
+    REQUIRE( nodes[0].name_id == frame );
+    REQUIRE( nodes[0].parent == TAGLIATELLE_NO_PARENT );
+    REQUIRE( nodes[0].inclusive_duration == 100 );
+    REQUIRE( nodes[0].self_duration == 80 );
+    REQUIRE( nodes[1].parent == 0 );
+
+    REQUIRE( tagliatelle_call_tree_select(tree, 0, 1000) == TAGLIATELLE_OK );
+    tagliatelle_name_stats stats[2] = {};
+    REQUIRE( tagliatelle_call_tree_top_self(tree, stats, 2, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 );
+    REQUIRE( stats[0].name_id == frame );
+    REQUIRE( stats[0].self_duration == 130 );
+
+    // Appending rebuilds the tree on the next selection
+    const tagliatelle_event more = { 300, 10, draw, 0, 0 };
+    REQUIRE( tagliatelle_store_append(store, &more) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_call_tree_select(tree, 0, 1000) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_call_tree_get_nodes(tree, &nodes, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 3 );
+    REQUIRE( nodes[2].name_id == draw );
+    REQUIRE( nodes[2].count == 1 );
+
+    tagliatelle_call_tree_destroy(tree);
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Event names are searchable in batches", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+    uint32_t order = 0;
+    uint32_t frame = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "handle order_id=1234", std::strlen("handle order_id=1234"), &order) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_intern_name(store, "frame", std::strlen("frame"), &frame) == TAGLIATELLE_OK );
+    const tagliatelle_event events[] = {
+        { 0, 10, frame, 0, 0 },
+        { 20, 10, order, 0, 0 },
+        { 40, 10, frame, 0, 0 },
+        { 60, 10, order, 1, 0 },
+    };
+    REQUIRE( tagliatelle_store_append_bulk(store, events, 4) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_search_prepare(store) == TAGLIATELLE_OK );
+
+    const std::string_view pattern = "ORDER_ID=\\d+";
+    tagliatelle_search* search = nullptr;
+    REQUIRE( tagliatelle_search_start(store, pattern.data(), pattern.size(),
+                                      TAGLIATELLE_SEARCH_REGEX | TAGLIATELLE_SEARCH_IGNORE_CASE, &search) == TAGLIATELLE_OK );
+    size_t indices[1] = {};
+    size_t count = 0;
+    REQUIRE( tagliatelle_search_next(search, indices, 1, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 1 );
+    REQUIRE( indices[0] == 1 );
+    REQUIRE( tagliatelle_search_next(search, indices, 1, &count) == TAGLIATELLE_OK );
+    REQUIRE( indices[0] == 3 );
+    REQUIRE( tagliatelle_search_next(search, indices, 1, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 0 );
+    tagliatelle_search_destroy(search);
+
+    REQUIRE( tagliatelle_search_start(store, "[", 1, TAGLIATELLE_SEARCH_REGEX, &search) == TAGLIATELLE_INVALID_ARGUMENT );
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Event arguments are read and filtered without copies", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+    uint32_t frame = 0;
+    uint32_t id = 0;
+    uint32_t url = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "frame", 5, &frame) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_intern_name(store, "id", 2, &id) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_intern_name(store, "url", 3, &url) == TAGLIATELLE_OK );
+
+    for (int64_t i = 0; i < 10; ++i)
+    {
+        tagliatelle_arg args[3] = {};
+        args[0].key_id = url;
+        args[0].type = TAGLIATELLE_ARG_OBJECT;
+        args[0].value.member_count = 1;
+        args[1].key_id = id;
+        args[1].type = TAGLIATELLE_ARG_STRING;
+        args[1].value.string_id = frame;
+        args[2].key_id = id;
+        args[2].type = TAGLIATELLE_ARG_INT;
+        args[2].value.int_value = i;
+        const tagliatelle_event event{ 100 - i * 10, 5, frame, 0, 0 };
+        REQUIRE( tagliatelle_store_append_with_args(store, &event, args, 3) == TAGLIATELLE_OK );
+    }
+
+    const tagliatelle_arg* args = nullptr;
+    size_t count = 0;
+    REQUIRE( tagliatelle_store_get_event_args(store, 0, &args, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 3 );
+    REQUIRE( args[2].value.int_value == 9 );
+
+    const tagliatelle_arg* found = nullptr;
+    REQUIRE( tagliatelle_store_find_event_arg(store, 0, id, &found) == TAGLIATELLE_OK );
+    REQUIRE( found == args + 2 );
+    REQUIRE( tagliatelle_store_find_event_arg(store, 0, frame, &found) == TAGLIATELLE_OK );
+    REQUIRE( found == nullptr );
+
+    tagliatelle_arg_filter filter = {};
+    filter.op = TAGLIATELLE_ARG_LESS;
+    filter.value.key_id = id;
+    filter.value.type = TAGLIATELLE_ARG_DOUBLE;
+    filter.value.value.double_value = 3.5;
+    size_t indices[2] = {};
+    REQUIRE( tagliatelle_query_arg_filter(store, 0, 1000, &filter, indices, 2, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 4 );
+    REQUIRE( indices[0] == 6 );
+    REQUIRE( indices[1] == 7 );
+
+    // Arguments must refer to interned strings and nest within the run
+    tagliatelle_arg bad = {};
+    bad.key_id = 1000;
+    const tagliatelle_event event{ 0, 1, frame, 0, 0 };
+    REQUIRE( tagliatelle_store_append_with_args(store, &event, &bad, 1) == TAGLIATELLE_INVALID_ARGUMENT );
+    bad.key_id = id;
+    bad.type = TAGLIATELLE_ARG_OBJECT;
+    bad.value.member_count = 1;
+    REQUIRE( tagliatelle_store_append_with_args(store, &event, &bad, 1) == TAGLIATELLE_INVALID_ARGUMENT );
+    REQUIRE( tagliatelle_store_event_count(store) == 10 );
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "API stores report resident and total bytes", "[api]" ) {
+    tagliatelle_memory_stats stats = {};
+    tagliatelle_store* plain = tagliatelle_store_create();
+    REQUIRE( tagliatelle_store_get_memory_stats(plain, &stats) == TAGLIATELLE_OK );
+    REQUIRE( stats.budget_bytes == 0 );
+    REQUIRE( stats.resident_bytes == stats.total_bytes );
+    tagliatelle_store_destroy(plain);
+
+    tagliatelle_store* store = nullptr;
+    REQUIRE( tagliatelle_store_create_with_budget(1 << 20, nullptr, &store) == TAGLIATELLE_INVALID_ARGUMENT );
+    const auto status = tagliatelle_store_create_with_budget(1 << 20, "./", &store);
+    if (status == TAGLIATELLE_NOT_SUPPORTED)
+        return;
+    REQUIRE( status == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_create_with_budget(1 << 20, "missing/directory", &plain) == TAGLIATELLE_IO_ERROR );
+
+    uint32_t name = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "spilled", 7, &name) == TAGLIATELLE_OK );
+    bool appended = true;
+    for (int64_t i = 0; i < 500'000; ++i)
+    {
+        const tagliatelle_event event{ i * 10, 5, name, static_cast<uint32_t>(i % 8), 0 };
+        appended &= tagliatelle_store_append(store, &event) == TAGLIATELLE_OK;
+    }
+    REQUIRE( appended );
+    REQUIRE( tagliatelle_store_get_memory_stats(store, &stats) == TAGLIATELLE_OK );
+    REQUIRE( stats.budget_bytes == 1 << 20 );
+    REQUIRE( stats.total_bytes > 500'000 * sizeof(int64_t) );
+    REQUIRE( stats.resident_bytes <= stats.total_bytes );
+    REQUIRE( stats.evicted_bytes > 0 );
+    REQUIRE( tagliatelle_store_event_count(store) == 500'000 );
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Counter series are queried as packed points", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+
+    uint32_t load = 0;
+    REQUIRE( tagliatelle_store_counter_series(store, "cpu load", 8, &load) == TAGLIATELLE_OK );
+    uint32_t again = 1;
+    REQUIRE( tagliatelle_store_counter_series(store, "cpu load", 8, &again) == TAGLIATELLE_OK );
+    REQUIRE( again == load );
+    REQUIRE( tagliatelle_store_counter_count(store) == 1 );
+    REQUIRE( tagliatelle_store_append_counter(store, 1, 0, 0.0) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    // A sawtooth with ten samples per pixel
+    for (int64_t t = 0; t < 10'000; t += 10)
+        REQUIRE( tagliatelle_store_append_counter(store, load, t, static_cast<double>(t % 100)) == TAGLIATELLE_OK );
+
+    uint32_t name = 0;
+    tagliatelle_string text{};
+    REQUIRE( tagliatelle_store_get_counter_name(store, load, &name) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_store_get_strings(store, name, 1, &text) == TAGLIATELLE_OK );
+    REQUIRE( std::string_view(text.data, text.length) == "cpu load" );
+
+    size_t count = 0;
+    const tagliatelle_viewport viewport{ 1'000, 2'000, 10.0f };
+    REQUIRE( tagliatelle_query_counter(store, load, &viewport, nullptr, 0, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 2 + 10 * 2 ); // the neighbours and the first (minimum) and last (maximum) of each pixel
+
+    std::vector<float> points(2 * count);
+    REQUIRE( tagliatelle_query_counter(store, load, &viewport, points.data(), count, &count) == TAGLIATELLE_OK );
+    REQUIRE( points[0] == -0.1f );
+    REQUIRE( points[1] == 90.0f );
+    REQUIRE( points[2] == 0.0f );
+    REQUIRE( points[3] == 0.0f );
+    REQUIRE( points[4] == 0.9f );
+    REQUIRE( points[5] == 90.0f );
+    REQUIRE( points[2 * count - 2] == 10.0f );
+    REQUIRE( tagliatelle_query_counter(store, 5, &viewport, nullptr, 0, &count) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Flows are queried per span and followed in the background", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+
+    uint32_t hop = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "hop", 3, &hop) == TAGLIATELLE_OK );
+    std::vector<tagliatelle_flow_point> points;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        const tagliatelle_event event{ static_cast<int64_t>(i) * 10, 15, hop, i % 4, 0 };
+        REQUIRE( tagliatelle_store_append(store, &event) == TAGLIATELLE_OK );
+        points.push_back(tagliatelle_flow_point{ i, static_cast<int64_t>(i) * 10 + 5, i % 4, TAGLIATELLE_FLOW_START });
+        points.push_back(tagliatelle_flow_point{ i, static_cast<int64_t>(i + 1) * 10 + 1, (i + 1) % 4, TAGLIATELLE_FLOW_END });
+    }
+    points.pop_back();
+    points.pop_back();
+    REQUIRE( tagliatelle_store_append_flows(store, points.data(), points.size()) == TAGLIATELLE_OK );
+    const tagliatelle_flow_point invalid{ 0, 0, 0, 7 };
+    REQUIRE( tagliatelle_store_append_flows(store, &invalid, 1) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    tagliatelle_flow_edge incoming[2];
+    tagliatelle_flow_edge outgoing[2];
+    size_t incomingCount = 0;
+    size_t outgoingCount = 0;
+    REQUIRE( tagliatelle_query_flows(store, 500, incoming, outgoing, 2, &incomingCount, &outgoingCount) == TAGLIATELLE_OK );
+    REQUIRE( incomingCount == 1 );
+    REQUIRE( outgoingCount == 1 );
+    REQUIRE( incoming[0].from == 499 );
+    REQUIRE( incoming[0].arrival == 5'001 );
+    REQUIRE( outgoing[0].to == 501 );
+    REQUIRE( tagliatelle_query_flows(store, 1000, nullptr, nullptr, 0, &incomingCount, &outgoingCount) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    tagliatelle_query* query = nullptr;
+    REQUIRE( tagliatelle_query_critical_path_async(store, 1000, nullptr, nullptr, &query) == TAGLIATELLE_INVALID_ARGUMENT );
+    REQUIRE( tagliatelle_query_critical_path_async(store, 0, nullptr, nullptr, &query) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_query_wait(query) == TAGLIATELLE_OK );
+    const uint32_t* path = nullptr;
+    size_t count = 0;
+    REQUIRE( tagliatelle_query_get_spans(query, &path, &count) == TAGLIATELLE_OK );
+    REQUIRE( count == 1000 );
+    REQUIRE( path[0] == 0 );
+    REQUIRE( path[999] == 999 );
+    const tagliatelle_name_stats* stats = nullptr;
+    REQUIRE( tagliatelle_query_get_name_stats(query, &stats, &count) == TAGLIATELLE_INVALID_ARGUMENT );
+    tagliatelle_query_destroy(query);
+
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "Cached render queries count their hits", "[api]" ) {
+    tagliatelle_store* store = tagliatelle_store_create();
+    tagliatelle_render_cache_stats stats{};
+    REQUIRE( tagliatelle_store_get_render_cache_stats(store, &stats) == TAGLIATELLE_OK );
+    REQUIRE( stats.misses == 0 );
+
+    uint32_t tick = 0;
+    REQUIRE( tagliatelle_store_intern_name(store, "tick", 4, &tick) == TAGLIATELLE_OK );
+    std::vector<tagliatelle_event> events;
+    for (int64_t t = 0; t < 10'000'000; t += 1'000)
+        events.push_back(tagliatelle_event{ t, 10, tick, 0, 0 });
+    REQUIRE( tagliatelle_store_append_bulk(store, events.data(), events.size()) == TAGLIATELLE_OK );
+
+    size_t count = 0;
+    size_t cachedCount = 0;
+    int32_t exact = 0;
+    std::vector<tagliatelle_lod_record> records(4096);
+    for (int64_t start = 0; start < 1'000'000; start += 50'000)
+    {
+        const tagliatelle_viewport viewport{ start, start + 2'000'000, 100.0f };
+        REQUIRE( tagliatelle_query_lod(store, &viewport, nullptr, 0, &count) == TAGLIATELLE_OK );
+        REQUIRE( tagliatelle_query_lod_cached(store, &viewport, records.data(), records.size(), &cachedCount, &exact) == TAGLIATELLE_OK );
+        REQUIRE( cachedCount == count );
+        REQUIRE( exact == 1 );
+    }
+    REQUIRE( tagliatelle_query_lod_cached(store, nullptr, nullptr, 0, &count, nullptr) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    REQUIRE( tagliatelle_store_get_render_cache_stats(store, &stats) == TAGLIATELLE_OK );
+    REQUIRE( stats.misses == 1 );
+    REQUIRE( stats.partial_hits == 19 );
+    tagliatelle_store_destroy(store);
+}
+
+TEST_CASE( "The self profile is saved as a native trace when compiled in", "[api]" ) {
+    REQUIRE( tagliatelle_profile_save(nullptr) == TAGLIATELLE_INVALID_ARGUMENT );
+
+    const auto path = std::filesystem::temp_directory_path() / "tagliatelle_self_profile.tglt";
+    const auto status = tagliatelle_profile_save(path.string().c_str());
+    if (status == TAGLIATELLE_NOT_SUPPORTED)
+        return;
+    REQUIRE( status == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_profile_save("/nonexistent/profile.tglt") == TAGLIATELLE_IO_ERROR );
+
+    // The load of the profile is profiled in turn
+    tagliatelle_store* store = tagliatelle_store_create();
+    tagliatelle_loader* loader = nullptr;
+    REQUIRE( tagliatelle_load_start(store, path.string().c_str(), &loader) == TAGLIATELLE_OK );
+    REQUIRE( tagliatelle_load_wait(loader) == TAGLIATELLE_OK );
+    tagliatelle_load_destroy(loader);
+    tagliatelle_store_destroy(store);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,195 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <random>
+#include <regex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TextSearch.hpp"
+#include "TrigramIndex.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    std::string RandomName(std::mt19937& random)
+    {
+        static constexpr std::string_view Words[] = { "order_id=", "Frame", "draw", "update", "GC", "io::read", "1234", "42", "ab", "abc" };
+        std::string name;
+        const auto words = 1 + random() % 4;
+        for (std::size_t i = 0; i < words; ++i)
+            name += Words[random() % std::size(Words)];
+        return name;
+    }
+
+    std::string Lowered(const std::string_view text)
+    {
+        std::string lower{ text };
+        std::ranges::transform(lower, lower.begin(), [](const char c) { return static_cast<char>(std::tolower(c)); });
+        return lower;
+    }
+
+    void WaitForIndex(const TextSearch& search, const std::size_t names)
+    {
+        while (search.IndexedNames() < names)
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+    }
+}
+
+TEST_CASE( "Trigram candidates contain every match", "[TextSearch]" ) {
+    std::mt19937 random{ 14 };
+    std::vector<std::string> names;
+    TrigramIndex index;
+    for (int i = 0; i < 2000; ++i)
+    {
+        names.push_back(RandomName(random));
+        index.Add(names.back());
+    }
+    index.Finish();
+    REQUIRE( index.Size() == names.size() );
+    REQUIRE_FALSE( index.Candidates("ab").has_value() );
+
+    for (const auto literal : { "order_id=1234", "FRAME", "draw42", "io::", "missing", "3ab" })
+    {
+        const auto candidates = index.Candidates(literal);
+        REQUIRE( candidates.has_value() );
+        REQUIRE( std::ranges::is_sorted(*candidates) );
+
+        for (std::size_t id = 0; id < names.size(); ++id)
+        {
+            if (Lowered(names[id]).find(Lowered(literal)) != std::string::npos)
+                REQUIRE( std::ranges::binary_search(*candidates, static_cast<TrigramIndex::Id>(id)) );
+        }
+    }
+    REQUIRE( index.Candidates("missing")->empty() );
+
+    // Extending a copy gives the postings of a single build
+    TrigramIndex half;
+    for (std::size_t id = 0; id < names.size() / 2; ++id)
+        half.Add(names[id]);
+    half.Finish();
+    auto extended = half.Copy();
+    for (auto id = names.size() / 2; id < names.size(); ++id)
+        extended.Add(names[id]);
+    extended.Finish();
+    REQUIRE( extended.Size() == names.size() );
+    REQUIRE( half.Size() == names.size() / 2 );
+    bool same = true;
+    for (const auto literal : { "order_id=1234", "FRAME", "draw42", "io::", "missing", "3ab" })
+        same = same && extended.Candidates(literal) == index.Candidates(literal);
+    REQUIRE( same );
+}
+
+TEST_CASE( "Searches give the same names with and without the index", "[TextSearch]" ) {
+    std::mt19937 random{ 15 };
+    Trace trace;
+    std::shared_mutex mutex;
+    std::vector<std::string> names;
+    while (names.size() < 3000)
+    {
+        auto name = RandomName(random);
+        if (trace.InternName(name) == names.size())
+            names.push_back(std::move(name));
+    }
+
+    struct Query
+    {
+        std::string_view pattern;
+        SearchMode       mode;
+        bool             ignoreCase;
+    };
+    const Query queries[] = {
+        { "order_id=1234", SearchMode::Substring, false },
+        { "frame", SearchMode::Substring, true },
+        { "frame", SearchMode::Substring, false },
+        { "", SearchMode::Substring, false },
+        { R"(order_id=\d+draw)", SearchMode::Regex, false },
+        { "up(date|GC)42", SearchMode::Regex, false },
+        { "abc?42", SearchMode::Regex, false },
+        { "GC{0,2}io::read", SearchMode::Regex, false },
+        { "^FRAME.*1234$", SearchMode::Regex, true },
+        { R"(io::read\.?)", SearchMode::Regex, false },
+    };
+
+    TextSearch search{ trace, mutex };
+    std::vector<std::vector<std::uint8_t>> scanned;
+    for (const auto& query : queries)
+        scanned.push_back(search.MatchNames(query.pattern, query.mode, query.ignoreCase));
+
+    search.Prepare();
+    WaitForIndex(search, names.size());
+
+    // Names interned after the index was built are scanned
+    names.push_back("late order_id=1234");
+    static_cast<void>(trace.InternName(names.back()));
+
+    for (std::size_t q = 0; q < std::size(queries); ++q)
+    {
+        const auto& query = queries[q];
+        const auto indexed = search.MatchNames(query.pattern, query.mode, query.ignoreCase);
+        REQUIRE( indexed.size() == names.size() );
+        REQUIRE( std::ranges::equal(std::span{ indexed }.first(scanned[q].size()), scanned[q]) );
+
+        auto flags = std::regex::ECMAScript;
+        if (query.ignoreCase)
+            flags |= std::regex::icase;
+        const std::regex regex{ std::string{ query.mode == SearchMode::Regex ? query.pattern : "" }, flags };
+        for (std::size_t id = 0; id < names.size(); ++id)
+        {
+            const auto expected = query.mode == SearchMode::Regex ? std::regex_search(names[id], regex)
+                                : query.ignoreCase                ? Lowered(names[id]).find(Lowered(query.pattern)) != std::string::npos
+                                                                  : names[id].find(query.pattern) != std::string::npos;
+            REQUIRE( indexed[id] == expected );
+        }
+    }
+
+    REQUIRE_THROWS_AS( search.MatchNames("(unclosed", SearchMode::Regex, false), std::regex_error );
+}
+
+TEST_CASE( "Matching events are streamed in batches", "[TextSearch]" ) {
+    Trace trace;
+    std::shared_mutex mutex;
+    const auto hit = trace.InternName("order_id=1234");
+    const auto miss = trace.InternName("frame");
+    for (int i = 0; i < 1000; ++i)
+        trace.Append(Event{ i, 1, i % 3 == 0 ? hit : miss, 0, 0 });
+
+    TextSearch search{ trace, mutex };
+    SearchCursor cursor{ search.MatchNames("id=12", SearchMode::Substring, false) };
+    std::vector<std::size_t> found;
+    std::size_t batch[64];
+    while (const auto count = cursor.Next(trace.Events(), batch))
+    {
+        REQUIRE( count <= std::size(batch) );
+        found.insert(found.end(), batch, batch + count);
+    }
+    REQUIRE( found.size() == 334 );
+    REQUIRE( std::ranges::all_of(found, [&](const std::size_t i) { return trace.Events()[i].name == hit; }) );
+    REQUIRE( std::ranges::is_sorted(found) );
+
+    // Argument keys and string values match too
+    Argument arguments[2];
+    arguments[0].key = trace.InternName("user");
+    arguments[0].type = ArgumentType::String;
+    arguments[0].text = trace.InternName("customer order_id=1299");
+    arguments[1].key = trace.InternName("order_id=12 retries");
+    arguments[1].type = ArgumentType::Int;
+    for (std::size_t i = 0; i < 2; ++i)
+        trace.Append(Event{ 2000 + static_cast<Timestamp>(i), 1, miss, 0, 0, trace.StoreArguments(std::span{ arguments + i, 1 }), 1 });
+    trace.Append(Event{ 2002, 1, miss, 0, 0 });
+
+    search.Prepare();
+    WaitForIndex(search, trace.Events().Names().Size());
+    SearchCursor extended{ search.MatchNames("id=12", SearchMode::Substring, false) };
+    found.clear();
+    while (const auto count = extended.Next(trace.Events(), batch))
+        found.insert(found.end(), batch, batch + count);
+    REQUIRE( found.size() == 336 );
+    REQUIRE( found[334] == 1000 );
+    REQUIRE( found[335] == 1001 );
+}
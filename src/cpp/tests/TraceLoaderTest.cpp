@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <shared_mutex>
+
+#include "TextTraceParser.hpp"
+#include "TraceLoader.hpp"
+
+using namespace tagliatelle;
+
+namespace
+{
+    std::filesystem::path WriteTempFile(const std::string& name, const std::string& contents)
+    {
+        const auto path = std::filesystem::temp_directory_path() / name;
+        std::ofstream{ path, std::ios::binary } << contents;
+        return path;
+    }
+}
+
+TEST_CASE( "Text records are parsed into local columns", "[TextTraceParser]" ) {
+    ParsedChunk chunk;
+    ParseTextTrace("# comment\n"
+                   "track 1 main thread\n"
+                   "100 20 1 0 frame\n"
+                   "\n"
+                   "110\t5\t1\t1\tdraw  \r\n"
+                   "not a record\n"
+                   "track 4294967295 too far\n"
+                   "120 5 1048576 0 too far\n"
+                   "130 5 1 1 frame", chunk);
+
+    REQUIRE( chunk.columns.Size() == 3 );
+    REQUIRE( chunk.malformedRecords == 3 );
+    REQUIRE( chunk.columns[1].timestamp == 110 );
+    REQUIRE( chunk.columns[1].depth == 1 );
+    REQUIRE( chunk.names.View(chunk.columns[1].name) == "draw" );
+    REQUIRE( chunk.columns[0].name == chunk.columns[2].name );
+    REQUIRE( chunk.trackNames.size() == 1 );
+    REQUIRE( chunk.names.View(chunk.trackNames[0].second) == "main thread" );
+
+    REQUIRE( NextTextRecord("ab\ncd\n", 1) == 3 );
+    REQUIRE( NextTextRecord("ab\ncd\n", 3) == 3 );
+    REQUIRE( NextTextRecord("ab\ncd", 4) == 5 );
+}
+
+TEST_CASE( "Files are loaded in parallel chunks", "[TraceLoader]" ) {
+    std::string contents = "track 0 worker\n";
+    for (int i = 0; i < 20'000; ++i)
+        contents += std::to_string(i * 10) + " 5 " + std::to_string(i % 4) + " 0 task_" + std::to_string(i % 7) + "\n";
+    const auto path = WriteTempFile("tagliatelle_loader_test.txt", contents);
+
+    Trace trace;
+    std::shared_mutex mutex;
+    TraceLoader loader{ trace, mutex };
+    loader.Start(path, 4, 4096);
+    loader.Wait();
+
+    const auto progress = loader.Progress();
+    REQUIRE( progress.done );
+    REQUIRE( !progress.failed );
+    REQUIRE( progress.bytesParsed == contents.size() );
+    REQUIRE( progress.eventsLoaded == 20'000 );
+
+    const auto& events = trace.Events();
+    REQUIRE( events.Size() == 20'000 );
+    REQUIRE( events.Names().Size() == 8 );
+    REQUIRE( events.TrackName(0) == "worker" );
+    for (std::size_t i = 0; i < events.Size(); ++i)
+    {
+        REQUIRE( events.Timestamps()[i] == static_cast<Timestamp>(i * 10) );
+        REQUIRE( events.Name(events.NameIds()[i]) == "task_" + std::to_string(i % 7) );
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Missing files fail the load", "[TraceLoader]" ) {
+    Trace trace;
+    std::shared_mutex mutex;
+    TraceLoader loader{ trace, mutex };
+    loader.Start(std::filesystem::temp_directory_path() / "tagliatelle_does_not_exist.txt");
+    loader.Wait();
+
+    REQUIRE( loader.Progress().failed );
+    REQUIRE( !loader.Error().empty() );
+}
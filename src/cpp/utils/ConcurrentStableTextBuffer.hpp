@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm> // std::copy_n
+#include <array>
+#include <atomic>
+#include <memory>    // std::unique_ptr
+#include <string_view>
+#include <utility>   // std::exchange
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    // Thread-safe counterpart of StableTextBuffer for concurrent producers.
+    // Space is reserved with an atomic bump inside the current page, full
+    // pages are replaced with a CAS, so Store() never takes a lock.
+    // Strings longer than a page get an exact-size block of their own.
+    // Views stay valid until Clear() or destruction.
+    template <std::size_t PageSz>
+    class ConcurrentStableTextBuffer
+    {
+
+        struct Page
+        {
+            // Reservations may overshoot PageSz, those bytes are never used
+            std::atomic<std::size_t> occupied = 0;
+            Page*                    previous = nullptr;
+            std::array<char, PageSz> data;
+        };
+
+        struct LargeBlock
+        {
+            LargeBlock*             previous = nullptr;
+            std::unique_ptr<char[]> data;
+        };
+
+    public:
+        ConcurrentStableTextBuffer() = default;
+
+        ~ConcurrentStableTextBuffer()
+        {
+            Clear();
+        }
+
+        IMMOVABLE(ConcurrentStableTextBuffer);
+
+        // Deallocate all pages, must not race with Store()
+        void Clear()
+        {
+            Page* page = current.exchange(nullptr, std::memory_order_acquire);
+            while (page != nullptr)
+                delete std::exchange(page, page->previous);
+
+            LargeBlock* block = largeBlocks.exchange(nullptr, std::memory_order_acquire);
+            while (block != nullptr)
+                delete std::exchange(block, block->previous);
+        }
+
+        // Copies the given string to the buffer and returns a view of it
+        [[nodiscard]] std::string_view Store(const std::string_view str)
+        {
+            if (str.empty()) [[unlikely]]
+                return str;
+
+            if (str.size() > PageSz) [[unlikely]]
+                return StoreLarge(str);
+
+            Page* page = current.load(std::memory_order_acquire);
+            Page* spare = nullptr;
+            while (true)
+            {
+                if (page != nullptr) [[likely]]
+                {
+                    const auto offset = page->occupied.fetch_add(str.size(), std::memory_order_relaxed);
+                    if (offset + str.size() <= PageSz) [[likely]]
+                    {
+                        delete spare;
+                        return CopyTo(*page, offset, str);
+                    }
+                }
+
+                // Page is full: publish a new one that already holds the string
+                if (spare == nullptr)
+                    spare = new Page;
+                spare->occupied.store(str.size(), std::memory_order_relaxed);
+                spare->previous = page;
+                if (current.compare_exchange_strong(page, spare, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return CopyTo(*spare, 0, str);
+
+                // Lost the race, retry on the page installed by another producer
+            }
+        }
+
+    private:
+        [[nodiscard]] std::string_view StoreLarge(const std::string_view str)
+        {
+            auto* block = new LargeBlock{ largeBlocks.load(std::memory_order_relaxed), std::make_unique_for_overwrite<char[]>(str.size()) };
+            std::copy_n(str.begin(), str.size(), block->data.get());
+            while (!largeBlocks.compare_exchange_weak(block->previous, block, std::memory_order_release, std::memory_order_relaxed))
+                ;
+            return std::string_view{ block->data.get(), str.size() };
+        }
+
+        static std::string_view CopyTo(Page& page, const std::size_t offset, const std::string_view str)
+        {
+            const auto dst = page.data.begin() + offset;
+            std::copy_n(str.begin(), str.size(), dst);
+            return std::string_view{ std::addressof(*dst), str.size() };
+        }
+
+        std::atomic<Page*>       current     = nullptr;
+        std::atomic<LargeBlock*> largeBlocks = nullptr;
+    };
+
+} // namespace tagliatelle
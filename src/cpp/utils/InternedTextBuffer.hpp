@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>  // std::max
+#include <bit>        // std::bit_ceil
+#include <cstdint>
+#include <functional> // std::hash
+#include <memory>     // std::allocator
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "StableTextBuffer.hpp"
+
+namespace tagliatelle
+{
+
+    // Deduplicating text store built on StableTextBuffer.
+    // Every distinct string is copied once and identified by a compact ID;
+    // IDs are dense, assigned in insertion order and never invalidated
+    // until the buffer is cleared.
+    // The allocator is used for the text pages, the index stays on the heap.
+    template <std::size_t PageSz, typename Allocator = std::allocator<char>>
+    class InternedTextBuffer
+    {
+    public:
+        using Id = std::uint32_t;
+
+        static constexpr Id InvalidId = ~Id{ 0 };
+
+        InternedTextBuffer() = default;
+
+        explicit InternedTextBuffer(const Allocator& allocator)
+            : text{ allocator }
+        {
+        }
+
+        MOVE_ONLY(InternedTextBuffer);
+
+        // Returns the ID of the given string, storing it on first occurrence
+        [[nodiscard]] Id Intern(const std::string_view str)
+        {
+            if ((views.size() + 1) * 2 > slots.size()) [[unlikely]]
+                Rehash(std::max<std::size_t>(MinSlots, slots.size() * 2));
+
+            const auto hash = Hash(str);
+            auto idx = hash & Mask();
+            while (true)
+            {
+                Slot& slot = slots[idx];
+                if (slot.id == InvalidId)
+                {
+                    const auto id = static_cast<Id>(views.size());
+                    views.push_back(str.empty() ? std::string_view{} : text.Store(str));
+                    slot = Slot{ hash, id };
+                    return id;
+                }
+                if (slot.hash == hash && views[slot.id] == str) [[likely]]
+                    return slot.id;
+                idx = (idx + 1) & Mask();
+            }
+        }
+
+        // Returns the ID of the given string if it has already been interned
+        [[nodiscard]] std::optional<Id> Find(const std::string_view str) const
+        {
+            if (slots.empty())
+                return std::nullopt;
+
+            const auto hash = Hash(str);
+            for (auto idx = hash & Mask(); slots[idx].id != InvalidId; idx = (idx + 1) & Mask())
+            {
+                if (slots[idx].hash == hash && views[slots[idx].id] == str)
+                    return slots[idx].id;
+            }
+            return std::nullopt;
+        }
+
+        // View of a previously interned string, stable until Clear()
+        [[nodiscard]] std::string_view View(const Id id) const
+        {
+            ASSERT((id < views.size()), _F("InternedTextBuffer: invalid id {}, size is {}", id, views.size()));
+            return views[id];
+        }
+
+        // All interned strings, indexed by ID
+        [[nodiscard]] std::span<const std::string_view> Views() const
+        {
+            return views;
+        }
+
+        [[nodiscard]] std::size_t Size() const
+        {
+            return views.size();
+        }
+
+        // Bytes held by the text, not counting the index
+        [[nodiscard]] std::size_t TextBytes() const
+        {
+            return text.AllocatedBytes();
+        }
+
+        // Deallocates all strings, invalidates all IDs and views
+        void Clear()
+        {
+            text.Clear();
+            views.clear();
+            slots.clear();
+        }
+
+    private:
+        // Hash is kept alongside the ID so that probing rarely touches the text
+        struct Slot
+        {
+            std::size_t hash = 0;
+            Id          id   = InvalidId;
+        };
+
+        static constexpr std::size_t MinSlots = 64;
+
+        static std::size_t Hash(const std::string_view str)
+        {
+            return std::hash<std::string_view>{}(str);
+        }
+
+        std::size_t Mask() const
+        {
+            return slots.size() - 1;
+        }
+
+        void Rehash(const std::size_t slotCount)
+        {
+            std::vector<Slot> newSlots(std::bit_ceil(slotCount));
+            const auto mask = newSlots.size() - 1;
+            for (const Slot& slot : slots)
+            {
+                if (slot.id == InvalidId)
+                    continue;
+                auto idx = slot.hash & mask;
+                while (newSlots[idx].id != InvalidId)
+                    idx = (idx + 1) & mask;
+                newSlots[idx] = slot;
+            }
+            slots = std::move(newSlots);
+        }
+
+        StableTextBuffer<PageSz, Allocator> text;
+        std::vector<std::string_view>       views;
+        std::vector<Slot>                   slots;
+    };
+
+} // namespace tagliatelle
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>  // std::allocator, std::allocator_traits
+#include <mutex>
+#include <vector>
+
+#include "Utils.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace tagliatelle
+{
+
+    struct PagePoolOptions
+    {
+        std::size_t maxFreePages    = 0;     // pages kept for reuse, the rest go back to the allocator
+        bool        adviseOnRelease = false; // let the OS reclaim the memory of free pages
+    };
+
+    struct PagePoolStats
+    {
+        std::size_t inUse     = 0; // acquired and not yet released
+        std::size_t free      = 0; // kept for reuse
+        std::size_t allocated = 0; // obtained from the allocator over the pool's lifetime
+    };
+
+    // Fixed-size pages for text buffers, shared between buffers that come
+    // and go, like the per-connection buffers of a live capture.
+    // Acquire() and Release() are O(1): free pages are kept on a stack, up to
+    // maxFreePages of them, and a released page beyond that is deallocated.
+    // With adviseOnRelease the whole pages inside a free page are handed back
+    // to the OS, which refaults them as zeros on the next acquire.
+    // Thread-safe, the pool must outlive every page acquired from it.
+    template <std::size_t PageSz, typename Allocator = std::allocator<char>>
+    class PagePool
+    {
+        using Traits = std::allocator_traits<Allocator>;
+
+    public:
+        static constexpr std::size_t PageSize = PageSz;
+
+        PagePool() = default;
+
+        explicit PagePool(const PagePoolOptions options, const Allocator& allocator = Allocator{})
+            : options{ options }
+            , allocator{ allocator }
+        {
+            // Release() must not throw
+            freePages.reserve(options.maxFreePages);
+        }
+
+        ~PagePool()
+        {
+            for (char* const page : freePages)
+                Traits::deallocate(allocator, page, PageSz);
+        }
+
+        IMMOVABLE(PagePool);
+
+        [[nodiscard]] char* Acquire()
+        {
+            {
+                std::scoped_lock lock{ mutex };
+                ++stats.inUse;
+                if (!freePages.empty())
+                {
+                    char* const page = freePages.back();
+                    freePages.pop_back();
+                    --stats.free;
+                    return page;
+                }
+                ++stats.allocated;
+            }
+
+            try
+            {
+                return Traits::allocate(allocator, PageSz);
+            }
+            catch (...)
+            {
+                std::scoped_lock lock{ mutex };
+                --stats.inUse;
+                --stats.allocated;
+                throw;
+            }
+        }
+
+        void Release(char* const page)
+        {
+            // Advised before the page is published, another thread may acquire it right after
+            Advise(page);
+            {
+                std::scoped_lock lock{ mutex };
+                --stats.inUse;
+                if (freePages.size() < options.maxFreePages)
+                {
+                    freePages.push_back(page);
+                    ++stats.free;
+                    return;
+                }
+            }
+            Traits::deallocate(allocator, page, PageSz);
+        }
+
+        // Deallocates free pages until at most keep are left
+        void Trim(const std::size_t keep = 0)
+        {
+            std::vector<char*> trimmed;
+            {
+                std::scoped_lock lock{ mutex };
+                while (freePages.size() > keep)
+                {
+                    trimmed.push_back(freePages.back());
+                    freePages.pop_back();
+                }
+                stats.free = freePages.size();
+            }
+            for (char* const page : trimmed)
+                Traits::deallocate(allocator, page, PageSz);
+        }
+
+        [[nodiscard]] PagePoolStats Stats() const
+        {
+            std::scoped_lock lock{ mutex };
+            return stats;
+        }
+
+    private:
+        void Advise(char* const page) const
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            if (!options.adviseOnRelease)
+                return;
+            // Only whole OS pages can be dropped, the allocator does not align ours
+            static const auto osPage = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+            const auto begin = (reinterpret_cast<std::uintptr_t>(page) + osPage - 1) / osPage * osPage;
+            const auto end = (reinterpret_cast<std::uintptr_t>(page) + PageSz) / osPage * osPage;
+            if (begin < end)
+                ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+#else
+            (void)page;
+#endif
+        }
+
+        const PagePoolOptions options;
+        Allocator             allocator;
+
+        mutable std::mutex mutex;
+        std::vector<char*> freePages;
+        PagePoolStats      stats;
+    };
+
+} // namespace tagliatelle
@@ -0,0 +1,19 @@
+#pragma once
+
+#ifdef ENABLE_PROFILE_MACROS
+
+    #include "SelfProfiler.hpp"
+
+    #define PROFILE_CONCAT2(a,b) a##b
+    #define PROFILE_CONCAT(a,b) PROFILE_CONCAT2(a,b)
+
+    // Times the rest of the enclosing scope, name must outlive the process (a literal)
+    #define PROFILE_SCOPE(name) const ::tagliatelle::ProfileScope PROFILE_CONCAT(profileScope_, __LINE__){ name }
+    #define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+
+#else
+
+    #define PROFILE_SCOPE(name)
+    #define PROFILE_FUNCTION()
+
+#endif
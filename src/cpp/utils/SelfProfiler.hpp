@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm> // std::ranges::find
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>    // std::shared_ptr, std::unique_ptr
+#include <mutex>
+#include <utility>   // std::as_const, std::move
+#include <vector>
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    // Timed scope of tagliatelle's own code, recorded by PROFILE_SCOPE in ProfileMacros.hpp.
+    // Fields are atomics so that a dump may read a ring while its thread writes.
+    struct ProfileRecord
+    {
+        std::atomic<const char*>   name  = nullptr; // string literal or __func__
+        std::atomic<std::int64_t>  start = 0;       // ns on the steady clock
+        std::atomic<std::int64_t>  end   = 0;
+        std::atomic<std::uint32_t> depth = 0;
+    };
+
+    // Most recent scopes of one thread, older ones are overwritten.
+    // Single writer, any number of readers.
+    class ProfileRing
+    {
+    public:
+        static constexpr std::size_t Capacity = 1 << 14;
+
+        explicit ProfileRing(const std::uint32_t thread)
+            : records{ std::make_unique<ProfileRecord[]>(Capacity) }
+            , thread{ thread }
+        {
+        }
+
+        IMMOVABLE(ProfileRing);
+
+        void Push(const char* const name, const std::int64_t start, const std::int64_t end, const std::uint32_t depth) noexcept
+        {
+            const auto index = head.load(std::memory_order_relaxed);
+            // Orders the previous head store before the record stores, for ForEach()
+            std::atomic_thread_fence(std::memory_order_release);
+            auto& record = records[index & (Capacity - 1)];
+            record.name.store(name, std::memory_order_relaxed);
+            record.start.store(start, std::memory_order_relaxed);
+            record.end.store(end, std::memory_order_relaxed);
+            record.depth.store(depth, std::memory_order_relaxed);
+            head.store(index + 1, std::memory_order_release);
+        }
+
+        // Calls fn(name, start, end, depth) for up to the Capacity - 1 most recent
+        // records, oldest first. The slot the writer may be filling is skipped.
+        template <typename F>
+        void ForEach(F&& fn) const
+        {
+            struct Copy
+            {
+                std::uint64_t index;
+                const char*   name;
+                std::int64_t  start;
+                std::int64_t  end;
+                std::uint32_t depth;
+            };
+
+            const auto last = head.load(std::memory_order_acquire);
+            const auto first = last > Capacity ? last - Capacity : 0;
+            std::vector<Copy> copies;
+            copies.reserve(last - first);
+            for (auto index = first; index < last; ++index)
+            {
+                const auto& record = records[index & (Capacity - 1)];
+                copies.push_back(Copy{ index, record.name.load(std::memory_order_relaxed), record.start.load(std::memory_order_relaxed),
+                                       record.end.load(std::memory_order_relaxed), record.depth.load(std::memory_order_relaxed) });
+            }
+
+            // The writer may have moved on and be overwriting the slot after the newest record
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const auto now = head.load(std::memory_order_relaxed);
+            const auto valid = now >= Capacity ? now - Capacity + 1 : 0;
+            for (const auto& copy : copies)
+            {
+                if (copy.index >= valid)
+                    fn(copy.name, copy.start, copy.end, copy.depth);
+            }
+        }
+
+        [[nodiscard]] std::uint32_t Thread() const
+        {
+            return thread;
+        }
+
+        // Set by the owning thread as it exits, it pushes no more records
+        void MarkExited() noexcept
+        {
+            exited.store(true, std::memory_order_release);
+        }
+
+        [[nodiscard]] bool Exited() const noexcept
+        {
+            return exited.load(std::memory_order_acquire);
+        }
+
+        // Drops the records for a new owning thread, which keeps the thread number
+        void Reset() noexcept
+        {
+            head.store(0, std::memory_order_release);
+            exited.store(false, std::memory_order_relaxed);
+        }
+
+    private:
+        std::unique_ptr<ProfileRecord[]> records;
+        std::atomic<std::uint64_t>       head   = 0;
+        std::atomic<bool>                exited = false;
+        const std::uint32_t              thread; // numbers of dropped rings are reused
+    };
+
+    // Rings of the threads that recorded a scope. The ring of an exited
+    // thread is kept until it has been read by ForEachRing(), then it is
+    // reused by the next new thread or, beyond SpareRings, freed.
+    class SelfProfiler
+    {
+    public:
+        static constexpr std::size_t SpareRings = 8;
+
+        static SelfProfiler& Instance()
+        {
+            static SelfProfiler profiler;
+            return profiler;
+        }
+
+        // Ring of the calling thread, created on first use, null if that ran out of memory
+        ProfileRing* Local() noexcept
+        {
+            try
+            {
+                thread_local const LocalRing local{ Register() };
+                return local.ring.get();
+            }
+            catch (...)
+            {
+                return nullptr;
+            }
+        }
+
+        // Calls fn(const ProfileRing&) for every ring, then recycles the rings
+        // of the threads that had exited before their ring was read
+        template <typename F>
+        void ForEachRing(F&& fn)
+        {
+            std::vector<std::shared_ptr<ProfileRing>> snapshot;
+            {
+                std::scoped_lock lock{ mutex };
+                snapshot = rings;
+            }
+            std::vector<const ProfileRing*> finished;
+            for (const auto& ring : snapshot)
+            {
+                const bool exited = ring->Exited();
+                fn(std::as_const(*ring));
+                if (exited)
+                    finished.push_back(ring.get());
+            }
+            if (!finished.empty())
+                Recycle(finished);
+        }
+
+        // Rings in use or kept for reuse
+        [[nodiscard]] std::size_t RingCount() const
+        {
+            std::scoped_lock lock{ mutex };
+            return rings.size() + spare.size();
+        }
+
+        static std::int64_t Now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+    private:
+        // Marks the ring as exited with its thread
+        struct LocalRing
+        {
+            std::shared_ptr<ProfileRing> ring;
+
+            ~LocalRing()
+            {
+                if (ring)
+                    ring->MarkExited();
+            }
+        };
+
+        SelfProfiler() = default;
+
+        std::shared_ptr<ProfileRing> Register()
+        {
+            std::scoped_lock lock{ mutex };
+            rings.reserve(rings.size() + 1); // the ring is not lost if this throws
+            if (!spare.empty())
+            {
+                rings.push_back(std::move(spare.back()));
+                spare.pop_back();
+                rings.back()->Reset();
+                return rings.back();
+            }
+            std::uint32_t thread = 0;
+            if (freeThreads.empty())
+            {
+                thread = nextThread++;
+            }
+            else
+            {
+                thread = freeThreads.back();
+                freeThreads.pop_back();
+            }
+            rings.push_back(std::make_shared<ProfileRing>(thread));
+            return rings.back();
+        }
+
+        void Recycle(const std::vector<const ProfileRing*>& finished)
+        {
+            std::scoped_lock lock{ mutex };
+            spare.reserve(SpareRings);
+            freeThreads.reserve(freeThreads.size() + finished.size());
+            for (auto it = rings.begin(); it != rings.end();)
+            {
+                if (std::ranges::find(finished, it->get()) == finished.end())
+                {
+                    ++it;
+                    continue;
+                }
+                if (spare.size() < SpareRings)
+                    spare.push_back(std::move(*it));
+                else
+                    freeThreads.push_back((*it)->Thread());
+                it = rings.erase(it);
+            }
+        }
+
+        mutable std::mutex                        mutex;
+        std::vector<std::shared_ptr<ProfileRing>> rings;       // of running threads, and exited ones not read yet
+        std::vector<std::shared_ptr<ProfileRing>> spare;       // read after their thread exited
+        std::vector<std::uint32_t>                freeThreads; // numbers of freed rings
+        std::uint32_t                             nextThread = 0;
+    };
+
+    // Records the lifetime of the scope into the thread's ring
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const char* const name) noexcept
+            : ring{ SelfProfiler::Instance().Local() }
+            , name{ name }
+            , depth{ Depth()++ }
+            , start{ SelfProfiler::Now() }
+        {
+        }
+
+        ~ProfileScope()
+        {
+            const auto end = SelfProfiler::Now();
+            --Depth();
+            if (ring != nullptr) [[likely]]
+                ring->Push(name, start, end, depth);
+        }
+
+        IMMOVABLE(ProfileScope);
+
+    private:
+        static std::uint32_t& Depth() noexcept
+        {
+            thread_local std::uint32_t depth = 0;
+            return depth;
+        }
+
+        ProfileRing* const  ring;
+        const char* const   name;
+        const std::uint32_t depth;
+        const std::int64_t  start;
+    };
+
+} // namespace tagliatelle
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm> // std::min
+#include <array>
+#include <atomic>
+#include <bit>       // std::has_single_bit
+#include <cstddef>
+#include <span>
+
+#include "Utils.hpp"
+
+namespace tagliatelle
+{
+
+    // Bounded lock-free queue between exactly one producer and one consumer.
+    // Head and tail live on separate cache lines and each side caches the
+    // other's index, so the common case touches no shared line at all.
+    // Pushing into a full ring fails instead of blocking, memory use is fixed.
+    template <typename T, std::size_t Capacity>
+    class SpscRing
+    {
+        static_assert(std::has_single_bit(Capacity), "SpscRing: capacity must be a power of two");
+
+        static constexpr std::size_t CacheLine = 64;
+
+    public:
+        SpscRing() = default;
+
+        IMMOVABLE(SpscRing);
+
+        // Producer side, false if the ring is full
+        [[nodiscard]] bool TryPush(const T& item)
+        {
+            const auto tail = this->tail.load(std::memory_order_relaxed);
+            if (tail - cachedHead == Capacity)
+            {
+                cachedHead = head.load(std::memory_order_acquire);
+                if (tail - cachedHead == Capacity)
+                    return false;
+            }
+            items[tail & (Capacity - 1)] = item;
+            this->tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side, pops up to out.size() items and returns how many were popped
+        [[nodiscard]] std::size_t PopBulk(const std::span<T> out)
+        {
+            const auto head = this->head.load(std::memory_order_relaxed);
+            if (cachedTail - head < out.size())
+            {
+                cachedTail = tail.load(std::memory_order_acquire);
+                if (cachedTail == head)
+                    return 0;
+            }
+            const auto count = std::min(out.size(), cachedTail - head);
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = items[(head + i) & (Capacity - 1)];
+            this->head.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        // Approximate when called concurrently with the other side
+        [[nodiscard]] bool Empty() const
+        {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+        static constexpr std::size_t Size()
+        {
+            return Capacity;
+        }
+
+    private:
+        alignas(CacheLine) std::atomic<std::size_t> head = 0; // written by the consumer
+        std::size_t cachedTail = 0;
+
+        alignas(CacheLine) std::atomic<std::size_t> tail = 0; // written by the producer
+        std::size_t cachedHead = 0;
+
+        alignas(CacheLine) std::array<T, Capacity> items;
+    };
+
+} // namespace tagliatelle
@@ -1,10 +1,13 @@
 #pragma once
 
-#include <algorithm> // std::copy_n, std::ranges::for_each
-#include <array>
-#include <forward_list>
+#include <algorithm> // std::copy_n, std::max, std::ranges::move
+#include <iterator>  // std::back_inserter
+#include <memory>    // std::unique_ptr, std::shared_ptr
 #include <string_view>
+#include <utility>   // std::exchange
+#include <vector>
 
+#include "PagePool.hpp"
 #include "Utils.hpp"
 
 namespace tagliatelle
@@ -12,115 +15,184 @@ namespace tagliatelle
 
     // Text buffer that can grow indefinitely without invalidating
     // existing views to this buffer.
-    template <std::size_t PageSz>
+    // Strings longer than a page get an exact-size block of their own.
+    // Pages come from a PagePool, a private one unless the buffer is given a
+    // pool shared with other buffers; large blocks are allocated on the heap.
+    template <std::size_t PageSz, typename Allocator = std::allocator<char>>
     class StableTextBuffer
     {
 
-        class Page
+        struct Page
         {
-        public:
-            bool Empty() const
-            {
-                return occupied == 0;
-            }
+            char*       data;
+            std::size_t occupied = 0;
+        };
 
-            bool CanFit(const std::string_view str) const
-            {
-                const auto remainingSpace = PageSz - occupied;
-                return str.size() <= remainingSpace;
-            }
+        struct LargeBlock
+        {
+            std::unique_ptr<char[]> data;
+            std::size_t             capacity;
+        };
 
-            [[nodiscard]] std::string_view StoreUnsafe(const std::string_view str)
-            {
-                ASSERT(
-                    CanFit(str),
-                    _F("StoreUnsafe: cannot fit string of length {}, remaining space is {}, page size is {}",
-                        str.size(), PageSz - occupied, PageSz)
-                );
-                const auto len = str.length();
-                const auto dst = data.begin() + occupied;
-                std::copy_n(str.begin(), len, dst);
-                occupied += len;
-                return std::string_view{ std::addressof(*dst), len };
-            }
+    public:
+        using Pool = PagePool<PageSz, Allocator>;
 
-            void Recycle()
-            {
-                occupied = 0;
-            }
+        StableTextBuffer() = default;
 
-            IMMOVABLE(Page);
+        explicit StableTextBuffer(const Allocator& allocator)
+            : allocator{ allocator }
+        {
+        }
 
-        private:
-            std::array<char, PageSz> data;
-            std::size_t occupied = 0;
-        };
+        explicit StableTextBuffer(std::shared_ptr<Pool> pool)
+            : pool{ std::move(pool) }
+        {
+        }
 
-    public:
-        StableTextBuffer() = default;
+        ~StableTextBuffer()
+        {
+            ReleasePages();
+        }
 
-        MOVE_ONLY(StableTextBuffer);
+        IMMOVABLE(StableTextBuffer);
+
+        StableTextBuffer(StableTextBuffer&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        StableTextBuffer& operator=(StableTextBuffer&& other) noexcept
+        {
+            if (this != &other)
+            {
+                ReleasePages();
+                allocator = std::move(other.allocator);
+                pool = std::move(other.pool);
+                pages = std::move(other.pages);
+                fill = std::exchange(other.fill, 0);
+                largeBlocks = std::move(other.largeBlocks);
+                recycledLargeBlocks = std::move(other.recycledLargeBlocks);
+            }
+            return *this;
+        }
 
         // Deallocate all pages, unlike STL's clear()
         void Clear()
         {
-            pages.clear();
-            recycledPages.clear();
+            ReleasePages();
+            largeBlocks.clear();
+            recycledLargeBlocks.clear();
         }
 
         // Reuse allocated pages, equivalent to STL's clear()
-        // Recycled pages are reused in the order of allocation
+        // Recycled pages are reused in the order of allocation,
+        // large blocks are kept for reuse until Prune()
         void Recycle()
         {
-            recycledPages.clear();
-            auto RecycleOne = [this, head = true](Page& p) mutable
-                {
-                    p.Recycle();
-                    if (!head)
-                        recycledPages.push_back(&p);
-                    head = false;
-                };
-            std::ranges::for_each(pages, RecycleOne);
+            for (auto& page : pages)
+                page.occupied = 0;
+            fill = 0;
+            std::ranges::move(largeBlocks, std::back_inserter(recycledLargeBlocks));
+            largeBlocks.clear();
         }
 
-        // Deallocate unused pages
+        // Return the pages and blocks that hold no text, wherever they are
         void Prune()
         {
-            recycledPages.clear();
-            while (!pages.empty() && pages.front().Empty())
-                pages.pop_front();
+            recycledLargeBlocks.clear();
+            std::erase_if(pages, [this](const Page& page)
+                {
+                    if (page.occupied != 0)
+                        return false;
+                    pool->Release(page.data);
+                    return true;
+                });
+            // Pages are filled in order, the ones before the last were skipped as full
+            fill = pages.empty() ? 0 : pages.size() - 1;
         }
 
         // Copies the given string to the buffer and returns a view of it
         [[nodiscard]] std::string_view Store(const std::string_view str)
         {
-            ASSERT(str.size() <= PageSz, _F("StableTextBuffer: cannot fit string of length {}, page size is only {}", str.size(), PageSz));
-
             if (str.empty()) [[unlikely]]
                 return str;
 
-            if (pages.empty()) [[unlikely]]
-                return pages.emplace_front().StoreUnsafe(str);
+            if (str.size() > PageSz) [[unlikely]]
+                return StoreLarge(str);
 
-        TryRecycled:
-            if (!recycledPages.empty())
-            {
-                if (recycledPages.back()->CanFit(str)) [[likely]]
-                    return recycledPages.back()->StoreUnsafe(str);
+            while (fill < pages.size() && PageSz - pages[fill].occupied < str.size())
+                ++fill;
+            if (fill == pages.size()) [[unlikely]]
+                AcquirePage();
+
+            Page& page = pages[fill];
+            char* const dst = page.data + page.occupied;
+            std::copy_n(str.begin(), str.size(), dst);
+            page.occupied += str.size();
+            return std::string_view{ dst, str.size() };
+        }
+
+        // Bytes held by pages and large blocks, including recycled ones
+        [[nodiscard]] std::size_t AllocatedBytes() const
+        {
+            auto bytes = pages.size() * PageSz;
+            for (const auto& block : largeBlocks)
+                bytes += block.capacity;
+            for (const auto& block : recycledLargeBlocks)
+                bytes += block.capacity;
+            return bytes;
+        }
+
+    private:
+        void AcquirePage()
+        {
+            // Grown before acquiring so that a page is never lost to a failed push
+            if (pages.size() == pages.capacity())
+                pages.reserve(std::max<std::size_t>(8, pages.size() * 2));
+            if (!pool)
+                pool = std::make_shared<Pool>(PagePoolOptions{}, allocator);
+            pages.push_back(Page{ pool->Acquire() });
+        }
+
+        void ReleasePages()
+        {
+            for (const auto& page : pages)
+                pool->Release(page.data);
+            pages.clear();
+            fill = 0;
+        }
 
-                recycledPages.pop_back();
-                goto TryRecycled;
+        // Reuses the smallest recycled block that fits, allocates otherwise
+        [[nodiscard]] std::string_view StoreLarge(const std::string_view str)
+        {
+            auto bestFit = recycledLargeBlocks.end();
+            for (auto it = recycledLargeBlocks.begin(); it != recycledLargeBlocks.end(); ++it)
+            {
+                if (it->capacity >= str.size() && (bestFit == recycledLargeBlocks.end() || it->capacity < bestFit->capacity))
+                    bestFit = it;
             }
 
-            if (!pages.front().CanFit(str)) [[unlikely]]
-                pages.emplace_front();
+            if (bestFit != recycledLargeBlocks.end())
+            {
+                largeBlocks.push_back(std::move(*bestFit));
+                recycledLargeBlocks.erase(bestFit);
+            }
+            else
+            {
+                largeBlocks.push_back(LargeBlock{ std::make_unique_for_overwrite<char[]>(str.size()), str.size() });
+            }
 
-            return pages.front().StoreUnsafe(str);
+            char* const dst = largeBlocks.back().data.get();
+            std::copy_n(str.begin(), str.size(), dst);
+            return std::string_view{ dst, str.size() };
         }
 
-    private:
-        std::forward_list<Page> pages;
-        std::vector<Page*>      recycledPages;
+        [[no_unique_address]] Allocator allocator;
+        std::shared_ptr<Pool>           pool; // created with the first page unless shared
+        std::vector<Page>               pages;
+        std::size_t                     fill = 0; // first page that may have room
+        std::vector<LargeBlock>         largeBlocks;
+        std::vector<LargeBlock>         recycledLargeBlocks;
     };
 
 } // namespace tagliatelle